@@ -0,0 +1,219 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <windows.h>
+
+#include "GraphicComponents.h"
+#include "Profiler.h"
+
+
+namespace Graphics
+{
+
+	/**
+	 * @brief Advance the tracks of a lane and evaluate their easing.
+	 *
+	 * @note Plain loops over floats, without branches: the compiler vectorizes them.
+	 */
+	template <class F>
+	void evaluate(_In_ size_t count, _In_ float seconds, _Inout_ float* __restrict elapsed, _In_ const float* __restrict invDuration,
+		_In_ const float* __restrict from, _In_ const float* __restrict delta, _Out_ float* __restrict value, _In_ F ease)
+	{
+		for (size_t i = 0; i < count; i++) elapsed[i] += seconds;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float t = (std::min)((std::max)(elapsed[i] * invDuration[i], 0.0f), 1.0f);
+			value[i] = from[i] + delta[i] * ease(t);
+		}
+	}
+
+	void evaluate(_In_ Easing easing, _In_ size_t count, _In_ float seconds, _Inout_ float* elapsed, _In_ const float* invDuration,
+		_In_ const float* from, _In_ const float* delta, _Out_ float* value)
+	{
+		switch (easing)
+		{
+		case Easing::Linear:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) { return t; });
+			break;
+		case Easing::QuadIn:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) { return t * t; });
+			break;
+		case Easing::QuadOut:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) { return t * (2.0f - t); });
+			break;
+		case Easing::QuadInOut:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) {
+				const float u = 1.0f - t;
+				return t < 0.5f ? 2.0f * t * t : 1.0f - 2.0f * u * u;
+			});
+			break;
+		case Easing::CubicIn:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) { return t * t * t; });
+			break;
+		case Easing::CubicOut:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) {
+				const float u = 1.0f - t;
+				return 1.0f - u * u * u;
+			});
+			break;
+		case Easing::CubicInOut:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) {
+				const float u = 1.0f - t;
+				return t < 0.5f ? 4.0f * t * t * t : 1.0f - 4.0f * u * u * u;
+			});
+			break;
+		case Easing::SmoothStep:
+			evaluate(count, seconds, elapsed, invDuration, from, delta, value, [](float t) { return t * t * (3.0f - 2.0f * t); });
+			break;
+		default:
+			break;
+		}
+	}
+
+	inline void writeBack(_In_ Component* pComponent, _In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		switch (property)
+		{
+		case AnimatedProperty::PositionX:
+		{
+			D2D1_POINT_2F pos = pComponent->getPos();
+			pos.x = value;
+			pComponent->setPos(pos);
+			break;
+		}
+		case AnimatedProperty::PositionY:
+		{
+			D2D1_POINT_2F pos = pComponent->getPos();
+			pos.y = value;
+			pComponent->setPos(pos);
+			break;
+		}
+		case AnimatedProperty::ScaleX:
+		{
+			D2D1_SIZE_F scale = pComponent->getScale();
+			scale.width = value;
+			pComponent->setScale(scale);
+			break;
+		}
+		case AnimatedProperty::ScaleY:
+		{
+			D2D1_SIZE_F scale = pComponent->getScale();
+			scale.height = value;
+			pComponent->setScale(scale);
+			break;
+		}
+		default:
+			pComponent->setAnimatedValue(property, value);
+			break;
+		}
+	}
+
+	TrackId AnimationEngine::add(_Inout_ Component& component, _In_ AnimatedProperty property, _In_ float from, _In_ float to,
+		_In_ float duration, _In_opt_ Easing easing, _In_opt_ float delay)
+	{
+		if (easing >= Easing::Count) easing = Easing::Linear;
+
+		TrackId id;
+		if (!m_freeIds.empty())
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		else
+		{
+			id = static_cast<TrackId>(m_slots.size());
+			m_slots.push_back({});
+			m_freeIds.reserve(m_slots.size()); // Retiring never allocates.
+		}
+
+		Lane& lane = m_lanes[static_cast<size_t>(easing)];
+		m_slots[id] = { static_cast<UINT32>(lane.ids.size()), easing, true, INVALID_TRACK, component.m_firstTrack };
+		if (component.m_firstTrack != INVALID_TRACK) m_slots[component.m_firstTrack].previous = id;
+		component.m_firstTrack = id;
+
+		// A null duration ends on the first update.
+		lane.elapsed.push_back(-delay);
+		lane.invDuration.push_back(duration > 0.0f ? 1.0f / duration : (std::numeric_limits<float>::max)());
+		lane.from.push_back(from);
+		lane.delta.push_back(to - from);
+		lane.value.push_back(from);
+		lane.targets.push_back({ &component, property });
+		lane.ids.push_back(id);
+
+		component.m_pAnimations = this;
+		m_count++;
+		return id;
+	}
+
+	void AnimationEngine::remove(_Inout_ Lane& lane, _In_ UINT32 index) noexcept
+	{
+		const TrackId id = lane.ids[index];
+		const size_t last = lane.ids.size() - 1;
+
+		const Slot& slot = m_slots[id];
+		if (slot.previous != INVALID_TRACK) m_slots[slot.previous].next = slot.next;
+		else lane.targets[index].pComponent->m_firstTrack = slot.next;
+		if (slot.next != INVALID_TRACK) m_slots[slot.next].previous = slot.previous;
+
+		if (index != last)
+		{
+			lane.elapsed[index] = lane.elapsed[last];
+			lane.invDuration[index] = lane.invDuration[last];
+			lane.from[index] = lane.from[last];
+			lane.delta[index] = lane.delta[last];
+			lane.value[index] = lane.value[last];
+			lane.targets[index] = lane.targets[last];
+			lane.ids[index] = lane.ids[last];
+			m_slots[lane.ids[index]].index = index;
+		}
+
+		lane.elapsed.pop_back();
+		lane.invDuration.pop_back();
+		lane.from.pop_back();
+		lane.delta.pop_back();
+		lane.value.pop_back();
+		lane.targets.pop_back();
+		lane.ids.pop_back();
+
+		m_slots[id].isUsed = false;
+		m_freeIds.push_back(id);
+		m_count--;
+	}
+
+	void AnimationEngine::cancel(_In_ TrackId id) noexcept
+	{
+		if (!isRunning(id)) return;
+		remove(m_lanes[static_cast<size_t>(m_slots[id].easing)], m_slots[id].index);
+	}
+
+	void AnimationEngine::cancel(_In_ const Component* pComponent) noexcept
+	{
+		while (pComponent->m_firstTrack != INVALID_TRACK)
+			cancel(pComponent->m_firstTrack);
+	}
+
+	void AnimationEngine::update(_In_ float seconds)
+	{
+		PROFILE_ZONE("AnimationEngine::update");
+
+		for (size_t easing = 0; easing < static_cast<size_t>(Easing::Count); easing++)
+		{
+			Lane& lane = m_lanes[easing];
+			const size_t count = lane.ids.size();
+			if (count == 0) continue;
+
+			evaluate(static_cast<Easing>(easing), count, seconds, lane.elapsed.data(), lane.invDuration.data(),
+				lane.from.data(), lane.delta.data(), lane.value.data());
+
+			for (size_t i = 0; i < count; i++)
+				if (lane.elapsed[i] >= 0.0f) writeBack(lane.targets[i].pComponent, lane.targets[i].property, lane.value[i]);
+
+			// From the end: the track swapped in has already been checked.
+			for (size_t i = count; i-- > 0;)
+				if (lane.elapsed[i] * lane.invDuration[i] >= 1.0f) remove(lane, static_cast<UINT32>(i));
+		}
+	}
+
+} // namespace Graphics
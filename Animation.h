@@ -0,0 +1,145 @@
+#pragma once
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	class Component;
+
+	typedef UINT32 TrackId;
+
+	constexpr TrackId INVALID_TRACK = 0xFFFFFFFF;
+
+	/**
+	 * @brief The component property written by a track.
+	 */
+	enum class AnimatedProperty : BYTE
+	{
+		PositionX,
+		PositionY,
+		ScaleX,
+		ScaleY,
+		Opacity,
+		Frame
+	};
+
+	enum class Easing : BYTE
+	{
+		Linear,
+		QuadIn,
+		QuadOut,
+		QuadInOut,
+		CubicIn,
+		CubicOut,
+		CubicInOut,
+		SmoothStep,
+
+		Count
+	};
+
+
+	/**
+	 * @brief Runs many tweens of component properties at once.
+	 *
+	 * @note The tracks are stored as contiguous arrays, one set per easing, so each frame evaluates
+	 *       every track of an easing in a single loop that the compiler vectorizes. The values are then
+	 *       written back to the components. Finished tracks are removed by swapping with the last one:
+	 *       once the arrays have grown, adding and retiring tracks does not allocate.
+	 */
+	class AnimationEngine
+	{
+	private:
+		struct Target
+		{
+			Component* pComponent;
+			AnimatedProperty property;
+		};
+
+		struct Lane
+		{
+			std::vector<float> elapsed;		// Seconds since the start, negative while delayed.
+			std::vector<float> invDuration;
+			std::vector<float> from;
+			std::vector<float> delta;		// to - from.
+			std::vector<float> value;		// Result of the last update.
+			std::vector<Target> targets;
+			std::vector<TrackId> ids;
+		};
+
+		struct Slot
+		{
+			UINT32 index = 0;
+			Easing easing = Easing::Linear;
+			bool isUsed = false;
+			TrackId previous = INVALID_TRACK;	// The other tracks of the same component.
+			TrackId next = INVALID_TRACK;
+		};
+
+		Lane m_lanes[static_cast<size_t>(Easing::Count)];
+		std::vector<Slot> m_slots;		// Per track id.
+		std::vector<TrackId> m_freeIds;
+		size_t m_count = 0;
+
+		void remove(_Inout_ Lane& lane, _In_ UINT32 index) noexcept;
+
+	public:
+		AnimationEngine() = default;
+		AnimationEngine(AnimationEngine&) = delete;
+		AnimationEngine& operator=(const AnimationEngine&) = delete;
+
+		/**
+		 * @brief Start a tween.
+		 *
+		 * @note The component cancels its tracks when destroyed. A property animated by several tracks
+		 *       ends up with the value of the last one written.
+		 *
+		 * @param[in] component	The component to animate.
+		 * @param[in] property	The property to animate.
+		 * @param[in] from		The value at the start.
+		 * @param[in] to		The value at the end.
+		 * @param[in] duration	In seconds.
+		 * @param[in] easing	The curve from the start to the end value.
+		 * @param[in] delay		Seconds before the start, the property is not written meanwhile.
+		 *
+		 * @retval TrackId
+		 * @return The id of the track, valid until the track ends or is cancelled.
+		 */
+		TrackId add(_Inout_ Component& component, _In_ AnimatedProperty property, _In_ float from, _In_ float to,
+			_In_ float duration, _In_opt_ Easing easing = Easing::Linear, _In_opt_ float delay = 0.0f);
+
+		/**
+		 * @brief Stop a track, leaving the property at its current value.
+		 */
+		void cancel(_In_ TrackId id) noexcept;
+
+		/**
+		 * @brief Stop all the tracks of a component.
+		 *
+		 * @note Walks the tracks of the component only: destroying many components stays linear.
+		 */
+		void cancel(_In_ const Component* pComponent) noexcept;
+
+		inline bool isRunning(_In_ TrackId id) const noexcept { return id < m_slots.size() && m_slots[id].isUsed; }
+
+		inline size_t getCount() const noexcept { return m_count; }
+
+		/**
+		 * @brief Advance all the tracks, write their values to the components and retire the finished ones.
+		 *
+		 * @note Called once per frame by the window, with the time since the previous frame.
+		 *
+		 * @param[in] seconds Elapsed time.
+		 */
+		void update(_In_ float seconds);
+	};
+
+} // namespace Graphics
+
+#endif // ANIMATION_H
@@ -0,0 +1,179 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace Benchmark
+{
+
+	typedef std::chrono::steady_clock ticker;
+
+	double measureMs(_In_ BENCHFCT benchFct, _In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ticker::time_point begin = ticker::now();
+		(*benchFct)(iterations, context);
+		return std::chrono::duration<double, std::milli>(ticker::now() - begin).count();
+	}
+
+	void Suite::add(_In_ const std::string& name, _In_ BENCHFCT benchFct, _In_opt_ void* context, _In_opt_ UINT64 bytesPerIteration, _In_opt_ COUNTERSFCT countersFct)
+	{
+		m_benchmarks.push_back({ name, benchFct, context, bytesPerIteration, countersFct });
+	}
+
+	std::vector<Result> Suite::run(_In_opt_ const std::string& filter, _In_opt_ unsigned int samples, _In_opt_ double minSampleMs) const
+	{
+		std::vector<Result> results;
+		if (samples == 0) samples = 1;
+
+		for (const Entry& entry : m_benchmarks)
+		{
+			if (!filter.empty() && entry.name.find(filter) == std::string::npos) continue;
+
+			// Warm up and find how many iterations a sample needs.
+			UINT64 iterations = 1;
+			while (measureMs(entry.benchFunction, iterations, entry.context) < minSampleMs && iterations < (1ull << 40))
+				iterations *= 2;
+
+			std::vector<double> nsPerIteration;
+			for (unsigned int i = 0; i < samples; i++)
+				nsPerIteration.push_back(measureMs(entry.benchFunction, iterations, entry.context) * 1e6 / static_cast<double>(iterations));
+			std::sort(nsPerIteration.begin(), nsPerIteration.end());
+
+			results.push_back({ entry.name, iterations, nsPerIteration[nsPerIteration.size() / 2], nsPerIteration.front(), nsPerIteration.back(), entry.bytesPerIteration, {} });
+			if (entry.countersFct) entry.countersFct(entry.context, &results.back().counters);
+		}
+		return results;
+	}
+
+	void writeEscaped(_Inout_ std::ofstream& file, _In_ const std::string& text)
+	{
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') file << '\\';
+			file << c;
+		}
+	}
+
+	bool writeJson(_In_ const std::vector<Result>& results, _In_ const wchar_t* path)
+	{
+		std::ofstream file{ std::filesystem::path(path) };
+		if (!file) return false;
+
+		file << std::setprecision(6) << "{\"benchmarks\":[";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const Result& result = results[i];
+			file << (i == 0 ? "\n" : ",\n") << "{\"name\":\"";
+			writeEscaped(file, result.name);
+			file << "\",\"iterations\":" << result.iterations
+				<< ",\"ns_per_iteration\":" << result.nsPerIteration
+				<< ",\"min_ns\":" << result.minNs
+				<< ",\"max_ns\":" << result.maxNs;
+			if (result.bytesPerIteration != 0) file << ",\"bytes_per_iteration\":" << result.bytesPerIteration;
+			// Flat keys: readJson does not handle nested objects.
+			for (const Counter& counter : result.counters)
+			{
+				file << ",\"counter.";
+				writeEscaped(file, counter.name);
+				file << "\":" << counter.value;
+			}
+			file << "}";
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+	/**
+	 * @brief Find the value of a key in a json object written by writeJson.
+	 */
+	bool readValue(_In_ const std::string& object, _In_ const char* key, _Out_ std::string* value)
+	{
+		const std::string pattern = std::string("\"") + key + "\":";
+		size_t begin = object.find(pattern);
+		if (begin == std::string::npos) return false;
+		begin += pattern.size();
+
+		if (object[begin] == '"')
+		{
+			std::string text;
+			for (size_t i = begin + 1; i < object.size() && object[i] != '"'; i++)
+			{
+				if (object[i] == '\\' && i + 1 < object.size()) i++;
+				text += object[i];
+			}
+			*value = text;
+			return true;
+		}
+
+		size_t end = object.find_first_of(",}", begin);
+		*value = object.substr(begin, end - begin);
+		return true;
+	}
+
+	bool readJson(_In_ const wchar_t* path, _Out_ std::vector<Result>* results)
+	{
+		results->clear();
+
+		std::ifstream file{ std::filesystem::path(path) };
+		if (!file) return false;
+
+		std::stringstream content;
+		content << file.rdbuf();
+		const std::string text = content.str();
+
+		// One object per benchmark, without nested objects. Read into a copy: a malformed file gives no result.
+		std::vector<Result> read;
+		size_t begin = text.find('{', text.find('['));
+		while (begin != std::string::npos)
+		{
+			size_t end = text.find('}', begin);
+			if (end == std::string::npos) return false;
+			const std::string object = text.substr(begin, end - begin + 1);
+
+			Result result;
+			std::string value;
+			if (!readValue(object, "name", &result.name)) return false;
+			try
+			{
+				if (readValue(object, "iterations", &value)) result.iterations = std::stoull(value);
+				if (readValue(object, "ns_per_iteration", &value)) result.nsPerIteration = std::stod(value);
+				if (readValue(object, "min_ns", &value)) result.minNs = std::stod(value);
+				if (readValue(object, "max_ns", &value)) result.maxNs = std::stod(value);
+				if (readValue(object, "bytes_per_iteration", &value)) result.bytesPerIteration = std::stoull(value);
+			}
+			catch (const std::logic_error&) // std::invalid_argument or std::out_of_range.
+			{
+				return false;
+			}
+			read.push_back(result);
+
+			begin = text.find('{', end);
+		}
+		*results = std::move(read);
+		return true;
+	}
+
+	std::vector<Regression> compare(_In_ const std::vector<Result>& baseline, _In_ const std::vector<Result>& current, _In_opt_ double tolerance)
+	{
+		std::vector<Regression> regressions;
+		for (const Result& result : current)
+		{
+			auto it = std::find_if(baseline.begin(), baseline.end(), [&result](const Result& r) { return r.name == result.name; });
+			if (it == baseline.end() || it->nsPerIteration <= 0.0) continue;
+
+			const double ratio = result.nsPerIteration / it->nsPerIteration;
+			if (ratio > 1.0 + tolerance)
+				regressions.push_back({ result.name, it->nsPerIteration, result.nsPerIteration, ratio });
+		}
+		return regressions;
+	}
+
+} // namespace Benchmark
@@ -0,0 +1,163 @@
+#pragma once
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Windows.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h> // _ReadWriteBarrier
+#endif
+
+
+namespace Benchmark
+{
+	/**
+	 * @brief Run the measured code iterations times.
+	 *
+	 * @param[in] iterations	The number of times to run the measured code.
+	 * @param[in] context		The context given when adding the benchmark.
+	 */
+	typedef void(*BENCHFCT)(_In_ UINT64 iterations, _Inout_opt_ void* context);
+
+	/**
+	 * @brief A value measured by a benchmark besides its time: a hit rate, a ratio, a peak memory...
+	 */
+	struct Counter
+	{
+		std::string name;
+		double value;
+	};
+
+	/**
+	 * @brief Read the counters of a benchmark, once its samples are measured.
+	 *
+	 * @param[in] context	The context given when adding the benchmark.
+	 * @param[out] counters	The counters to append to.
+	 */
+	typedef void(*COUNTERSFCT)(_In_opt_ void* context, _Inout_ std::vector<Counter>* counters);
+
+	struct Result
+	{
+		std::string name;
+		UINT64 iterations = 0;		// Iterations per sample.
+		double nsPerIteration = 0;	// Median of the samples.
+		double minNs = 0;			// Fastest sample, per iteration.
+		double maxNs = 0;			// Slowest sample, per iteration.
+		UINT64 bytesPerIteration = 0;	// Bytes processed by an iteration, zero if the benchmark has no throughput.
+		std::vector<Counter> counters;	// Read after the samples, not compared against the baseline.
+
+		/**
+		 * @brief Return the throughput of the median sample, in MB/s, zero without bytes per iteration.
+		 */
+		inline double getMBPerSecond() const noexcept { return nsPerIteration <= 0.0 ? 0.0 : static_cast<double>(bytesPerIteration) * 1e3 / nsPerIteration; }
+	};
+
+	struct Regression
+	{
+		std::string name;
+		double baselineNs;
+		double currentNs;
+		double ratio;				// currentNs / baselineNs.
+	};
+
+	/**
+	 * @brief A list of benchmarks run together.
+	 */
+	class Suite
+	{
+	private:
+		struct Entry
+		{
+			std::string name;
+			BENCHFCT benchFunction;
+			void* context;
+			UINT64 bytesPerIteration;
+			COUNTERSFCT countersFct;
+		};
+
+		std::vector<Entry> m_benchmarks;
+
+	public:
+		/**
+		 * @brief Add a benchmark to the suite.
+		 *
+		 * @param[in] name		Unique name, used to compare against the baseline.
+		 * @param[in] benchFct	The function running the measured code.
+		 * @param[in] context	The context given to the function.
+		 * @param[in] bytesPerIteration	The bytes an iteration processes, to report the throughput. Zero for none.
+		 * @param[in] countersFct	The function reading the counters of the benchmark, nullptr for none.
+		 */
+		void add(_In_ const std::string& name, _In_ BENCHFCT benchFct, _In_opt_ void* context = nullptr, _In_opt_ UINT64 bytesPerIteration = 0,
+			_In_opt_ COUNTERSFCT countersFct = nullptr);
+
+		/**
+		 * @brief Run the benchmarks which name contains the filter.
+		 *
+		 * @note The iterations per sample are doubled until a sample lasts at least minSampleMs.
+		 *
+		 * @param[in] filter		Only run the benchmarks which name contains it. Empty runs all of them.
+		 * @param[in] samples		The number of samples per benchmark.
+		 * @param[in] minSampleMs	The minimal duration of a sample.
+		 *
+		 * @retval std::vector<Result>
+		 * @return The result of every benchmark run, in the order they were added.
+		 */
+		std::vector<Result> run(_In_opt_ const std::string& filter = "", _In_opt_ unsigned int samples = 5, _In_opt_ double minSampleMs = 50.0) const;
+	};
+
+	/**
+	 * @brief Write results as json.
+	 *
+	 * @retval bool
+	 * @return True if the file has been written, false otherwise.
+	 */
+	bool writeJson(_In_ const std::vector<Result>& results, _In_ const wchar_t* path);
+
+	/**
+	 * @brief Read results written by writeJson.
+	 *
+	 * @retval bool
+	 * @return True if the file has been read, false if it is missing or malformed: results is then empty.
+	 */
+	bool readJson(_In_ const wchar_t* path, _Out_ std::vector<Result>* results);
+
+	/**
+	 * @brief List the benchmarks slower than their baseline by more than the tolerance.
+	 *
+	 * @note Benchmarks missing from the baseline are ignored.
+	 *
+	 * @param[in] baseline	The stored results.
+	 * @param[in] current	The new results.
+	 * @param[in] tolerance	Accepted slow down, 0.1 for 10%.
+	 */
+	std::vector<Regression> compare(_In_ const std::vector<Result>& baseline, _In_ const std::vector<Result>& current, _In_opt_ double tolerance = 0.1);
+
+	/**
+	 * @brief Keep the compiler from removing the computation of value, or from moving it out of the loop.
+	 *
+	 * @note The value is given to an empty assembly statement which may read it and any memory,
+	 *       or on MSVC, its address escapes to a volatile before a compiler barrier.
+	 */
+	template <class T>
+	inline void doNotOptimize(_In_ const T& value) noexcept
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		// In a register when it fits, else in memory.
+		if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*))
+			asm volatile("" : : "r,m"(value) : "memory");
+		else
+			asm volatile("" : : "m"(value) : "memory");
+#else
+		static const void* volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#endif
+	}
+
+} // namespace Benchmark
+
+#endif // BENCHMARK_H
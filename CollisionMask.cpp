@@ -0,0 +1,109 @@
+#include "CollisionMask.h"
+
+#include <intrin.h> // _BitScanForward64
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "GraphicComponents.h"
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	CollisionMask::CollisionMask(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ BYTE threshold)
+		:m_width(width), m_height(height), m_wordsPerRow((width + 63) / 64)
+	{
+		PROFILE_ZONE("CollisionMask::build");
+		m_words.assign(static_cast<size_t>(m_wordsPerRow) * height, 0);
+
+		LONG left = static_cast<LONG>(width), top = static_cast<LONG>(height), right = 0, bottom = 0;
+		for (UINT32 y = 0; y < height; y++)
+		{
+			const Pixel* row = pixels + static_cast<size_t>(y) * width;
+			UINT64* words = m_words.data() + static_cast<size_t>(y) * m_wordsPerRow;
+			for (UINT32 word = 0; word < m_wordsPerRow; word++)
+			{
+				// 64 pixels at most per word, packed without branches.
+				const UINT32 first = word * 64;
+				const UINT32 count = (std::min)(width - first, 64u);
+				UINT64 bits = 0;
+				for (UINT32 i = 0; i < count; i++)
+					bits |= static_cast<UINT64>(row[first + i].a >= threshold) << i;
+				words[word] = bits;
+			}
+
+			// Bounds of the set bits, from the first and last non zero words of the row.
+			for (UINT32 word = 0; word < m_wordsPerRow; word++)
+			{
+				if (words[word] == 0) continue;
+				unsigned long bit;
+				_BitScanForward64(&bit, words[word]);
+				left = (std::min)(left, static_cast<LONG>(word * 64 + bit));
+				break;
+			}
+			for (UINT32 word = m_wordsPerRow; word-- > 0;)
+			{
+				if (words[word] == 0) continue;
+				unsigned long bit;
+				_BitScanReverse64(&bit, words[word]);
+				right = (std::max)(right, static_cast<LONG>(word * 64 + bit + 1));
+				top = (std::min)(top, static_cast<LONG>(y));
+				bottom = static_cast<LONG>(y + 1);
+				break;
+			}
+		}
+		if (right > left) m_bounds = { left, top, right, bottom };
+	}
+
+	std::shared_ptr<const CollisionMask> CollisionMask::getShared(_In_ const std::wstring& asset, _In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ BYTE threshold)
+	{
+		static std::mutex mutex;
+		static std::map<std::pair<std::wstring, BYTE>, std::weak_ptr<const CollisionMask>> masks;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		std::weak_ptr<const CollisionMask>& entry = masks[{ asset, threshold }];
+		std::shared_ptr<const CollisionMask> mask = entry.lock();
+		if (mask) return mask;
+
+		// The masks no image holds anymore are forgotten.
+		for (auto it = masks.begin(); it != masks.end();)
+		{
+			if (it->second.expired() && &it->second != &entry) it = masks.erase(it);
+			else it++;
+		}
+
+		mask = std::make_shared<const CollisionMask>(pixels, width, height, threshold);
+		entry = mask;
+		return mask;
+	}
+
+	bool CollisionMask::overlaps(_In_ const CollisionMask& other, _In_ LONG offsetX, _In_ LONG offsetY) const noexcept
+	{
+		// The intersection of both bounds, in this mask's pixels: nothing outside of it can collide.
+		const LONG left = (std::max)(m_bounds.left, other.m_bounds.left + offsetX);
+		const LONG top = (std::max)(m_bounds.top, other.m_bounds.top + offsetY);
+		const LONG right = (std::min)(m_bounds.right, other.m_bounds.right + offsetX);
+		const LONG bottom = (std::min)(m_bounds.bottom, other.m_bounds.bottom + offsetY);
+		if (left >= right || top >= bottom) return false;
+
+		// The bits of this mask's words outside of [left, right) are either cleared or over cleared bits of the other mask.
+		const LONG firstWord = left >> 6;
+		const LONG lastWord = (right - 1) >> 6;
+		for (LONG y = top; y < bottom; y++)
+		{
+			const UINT64* row = m_words.data() + static_cast<size_t>(y) * m_wordsPerRow;
+			const UINT64* otherRow = other.m_words.data() + static_cast<size_t>(y - offsetY) * other.m_wordsPerRow;
+			for (LONG word = firstWord; word <= lastWord; word++)
+			{
+				if (row[word] == 0) continue;
+				if (row[word] & other.getBits(otherRow, word * 64 - offsetX)) return true;
+			}
+		}
+		return false;
+	}
+
+} // namespace Graphics
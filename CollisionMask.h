@@ -0,0 +1,106 @@
+#pragma once
+#ifndef COLLISION_MASK_H
+#define COLLISION_MASK_H
+
+#include <Windows.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	struct Pixel;
+
+	/**
+	 * @brief A 1 bit per pixel mask of the pixels of an image that collide: those whose alpha reaches a threshold.
+	 *
+	 * @note Each row is stored in 64 bit words, its leftmost pixel in the lowest bit of the first word. Two masks
+	 *       are tested at any integer offset one word at a time: a word of one mask is ANDed with the 64 bits of
+	 *       the other it covers, shifted into place. Only the rows and words where the tight bounds of the set bits
+	 *       of both masks intersect are read, and masks whose bounds do not intersect are rejected without reading any.
+	 */
+	class CollisionMask
+	{
+	private:
+		std::vector<UINT64> m_words;	// m_wordsPerRow words per row, the bits past the width cleared.
+		UINT32 m_width = 0;
+		UINT32 m_height = 0;
+		UINT32 m_wordsPerRow = 0;
+		RECT m_bounds = { 0, 0, 0, 0 };	// Of the set bits, right and bottom excluded. Empty when none is set.
+
+		/**
+		 * @brief Return the 64 bits of a row starting at a column, which may be outside of the mask: the bits outside are cleared.
+		 */
+		inline UINT64 getBits(_In_ const UINT64* row, _In_ LONG start) const noexcept
+		{
+			const LONG word = start >> 6; // Rounded down, start may be negative.
+			const UINT32 shift = static_cast<UINT32>(start & 63);
+			const LONG count = static_cast<LONG>(m_wordsPerRow);
+
+			const UINT64 low = word >= 0 && word < count ? row[word] : 0;
+			if (shift == 0) return low;
+			const UINT64 high = word + 1 >= 0 && word + 1 < count ? row[word + 1] : 0;
+			return (low >> shift) | (high << (64 - shift));
+		}
+
+	public:
+		CollisionMask() = default;
+
+		/**
+		 * @brief Build the mask of an image.
+		 *
+		 * @param[in] pixels	The width * height premultiplied B8G8R8A8 pixels.
+		 * @param[in] width		The image width in pixels.
+		 * @param[in] height	The image height in pixels.
+		 * @param[in] threshold	The lowest alpha of a colliding pixel.
+		 */
+		CollisionMask(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ BYTE threshold = 0x80);
+
+		/**
+		 * @brief Return the mask of an asset, built once and shared by every image of the asset while one holds it.
+		 *
+		 * @note Thread safe.
+		 *
+		 * @param[in] asset		The key of the asset, its path for a file.
+		 * @param[in] pixels	The pixels of the asset, used if the mask is built.
+		 * @param[in] width		The image width in pixels.
+		 * @param[in] height	The image height in pixels.
+		 * @param[in] threshold	The lowest alpha of a colliding pixel: each threshold has its own mask.
+		 */
+		static std::shared_ptr<const CollisionMask> getShared(_In_ const std::wstring& asset, _In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ BYTE threshold = 0x80);
+
+		/**
+		 * @brief Test whether a set bit of this mask covers a set bit of another mask.
+		 *
+		 * @param[in] other		The other mask.
+		 * @param[in] offsetX	The column of this mask at which the other mask's first column is.
+		 * @param[in] offsetY	The row of this mask at which the other mask's first row is.
+		 *
+		 * @retval bool
+		 * @return True if the masks overlap.
+		 */
+		bool overlaps(_In_ const CollisionMask& other, _In_ LONG offsetX, _In_ LONG offsetY) const noexcept;
+
+		/**
+		 * @brief Return whether the pixel at a column and a row collides, false outside of the mask.
+		 */
+		inline bool isSet(_In_ LONG x, _In_ LONG y) const noexcept
+		{
+			if (x < 0 || y < 0 || x >= static_cast<LONG>(m_width) || y >= static_cast<LONG>(m_height)) return false;
+			return (m_words[static_cast<size_t>(y) * m_wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+		}
+
+		inline UINT32 getWidth() const noexcept { return m_width; }
+		inline UINT32 getHeight() const noexcept { return m_height; }
+		inline const RECT& getBounds() const noexcept { return m_bounds; }
+		inline bool isEmpty() const noexcept { return m_bounds.right <= m_bounds.left; }
+		inline size_t getMemoryUsage() const noexcept { return m_words.size() * sizeof(UINT64); }
+	};
+
+} // namespace Graphics
+
+#endif // COLLISION_MASK_H
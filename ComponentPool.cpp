@@ -0,0 +1,60 @@
+#include "ComponentPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	UINT32 allocatePoolIndex() noexcept
+	{
+		static std::atomic<UINT32> nextIndex = 0;
+		return nextIndex.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	ComponentPool::ComponentPool(_In_ size_t slotSize, _In_ size_t alignment, _In_ UINT32 slotsPerSlab)
+		:m_alignment((std::max)(alignment, alignof(FreeSlot))), m_slotsPerSlab((std::max)(slotsPerSlab, 1u))
+	{
+		// Each slot keeps the alignment of the first one.
+		const size_t size = (std::max)(slotSize, sizeof(FreeSlot));
+		m_slotSize = (size + m_alignment - 1) / m_alignment * m_alignment;
+	}
+
+	ComponentPoolPtr ComponentPool::make(_In_ size_t slotSize, _In_ size_t alignment, _In_opt_ UINT32 slotsPerSlab)
+	{
+		return ComponentPoolPtr(new ComponentPool(slotSize, alignment, slotsPerSlab));
+	}
+
+	void ComponentPool::release() noexcept
+	{
+		if (m_liveCount == 0) delete this;
+		else m_isReleased = true;
+	}
+
+	void ComponentPool::grow()
+	{
+		PROFILE_ZONE("ComponentPool::grow");
+		m_slabs.reserve(m_slabs.size() + 1);
+		BYTE* slab = static_cast<BYTE*>(::operator new(m_slotSize * m_slotsPerSlab, std::align_val_t(m_alignment)));
+		m_slabs.push_back(slab);
+
+		// Chained in address order: the first components created are next to each other.
+		for (UINT32 i = m_slotsPerSlab; i-- > 0;)
+		{
+			FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + i * m_slotSize);
+			slot->pNext = m_pFree;
+			m_pFree = slot;
+		}
+	}
+
+	ComponentPool::~ComponentPool()
+	{
+		// Only destroyed once its owner and its components are gone.
+		for (void* slab : m_slabs) ::operator delete(slab, std::align_val_t(m_alignment));
+	}
+
+} // namespace Graphics
@@ -0,0 +1,198 @@
+#pragma once
+#ifndef COMPONENT_POOL_H
+#define COMPONENT_POOL_H
+
+#include <Windows.h>
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	class ComponentPool;
+
+	/**
+	 * @brief Destroy a component and give its memory back to the pool it was allocated from, or delete it.
+	 *
+	 * @note Converts from std::default_delete: a component made with new or std::make_unique is still deleted.
+	 */
+	struct ComponentDeleter
+	{
+		ComponentPool* pPool = nullptr;
+
+		ComponentDeleter() noexcept = default;
+		ComponentDeleter(_In_opt_ ComponentPool* pool) noexcept : pPool(pool) {}
+
+		template <class T>
+		ComponentDeleter(_In_ const std::default_delete<T>&) noexcept {}
+
+		inline void operator()(_In_ Component* component) const noexcept;
+	};
+
+	typedef std::unique_ptr<Component, ComponentDeleter> ComponentPtr;
+
+	/**
+	 * @brief Give up the owner's share of a pool: the pool is destroyed now, or with its last live component.
+	 */
+	struct ComponentPoolRelease
+	{
+		inline void operator()(_In_ ComponentPool* pool) const noexcept;
+	};
+
+	typedef std::unique_ptr<ComponentPool, ComponentPoolRelease> ComponentPoolPtr;
+
+
+	/**
+	 * @brief Return the next free pool index.
+	 */
+	UINT32 allocatePoolIndex() noexcept;
+
+	/**
+	 * @brief Return the index of the pools of T in the windows' pool tables, the same for every window.
+	 */
+	template <class T>
+	inline UINT32 getPoolIndex() noexcept
+	{
+		static const UINT32 index = allocatePoolIndex();
+		return index;
+	}
+
+
+	/**
+	 * @brief A slab allocator of fixed size slots, for the components of a single type.
+	 *
+	 * @note The slots are carved from slabs that are only freed with the pool, and recycled last in first out:
+	 *       spawning and despawning components neither calls the heap nor fragments it once warmed up.
+	 *       Not thread safe. The pool is shared by its owner and its live components: a component which outlives
+	 *       the owner keeps the pool alive, and the last one destroyed frees it.
+	 */
+	class ComponentPool
+	{
+	private:
+		struct FreeSlot
+		{
+			FreeSlot* pNext;
+		};
+
+		std::vector<void*> m_slabs;
+		FreeSlot* m_pFree = nullptr;
+		size_t m_slotSize;
+		size_t m_alignment;
+		UINT32 m_slotsPerSlab;
+		size_t m_liveCount = 0;
+		bool m_isReleased = false;	// By its owner: the last live component destroys the pool.
+
+		ComponentPool(_In_ size_t slotSize, _In_ size_t alignment, _In_ UINT32 slotsPerSlab);
+		~ComponentPool();
+
+		void grow();
+
+	public:
+		ComponentPool(ComponentPool&) = delete;
+		ComponentPool& operator=(const ComponentPool&) = delete;
+
+		/**
+		 * @brief Create a pool.
+		 *
+		 * @param[in] slotSize		The size of the objects allocated.
+		 * @param[in] alignment		Their alignment.
+		 * @param[in] slotsPerSlab	The number of slots allocated at once.
+		 *
+		 * @retval ComponentPoolPtr
+		 * @return The owner's share of the pool.
+		 */
+		static ComponentPoolPtr make(_In_ size_t slotSize, _In_ size_t alignment, _In_opt_ UINT32 slotsPerSlab = 256);
+
+		/**
+		 * @brief Give up the owner's share: the pool is destroyed now if no component is alive, or with the last one.
+		 */
+		void release() noexcept;
+
+		/**
+		 * @brief Return a free slot, allocating a slab if there is none.
+		 *
+		 * @throw std::bad_alloc When the slab cannot be allocated.
+		 */
+		inline void* allocate()
+		{
+			if (m_pFree == nullptr) grow();
+			FreeSlot* slot = m_pFree;
+			m_pFree = slot->pNext;
+			m_liveCount++;
+			return slot;
+		}
+
+		/**
+		 * @brief Give a slot back, its object already destroyed.
+		 */
+		inline void deallocate(_In_ void* slot) noexcept
+		{
+			FreeSlot* freed = static_cast<FreeSlot*>(slot);
+			freed->pNext = m_pFree;
+			m_pFree = freed;
+			if (--m_liveCount == 0 && m_isReleased) delete this;
+		}
+
+		/**
+		 * @brief Construct a component in a slot.
+		 *
+		 * @note T must fit the slots. The slot is given back if the constructor throws.
+		 *
+		 * @retval std::unique_ptr<T, ComponentDeleter>
+		 * @return The component, given back to this pool when deleted.
+		 */
+		template <class T, class... Args>
+		std::unique_ptr<T, ComponentDeleter> create(_In_ Args&&... args)
+		{
+			static_assert(std::is_base_of_v<Component, T>, "The pool allocates components.");
+			void* slot = allocate();
+			try
+			{
+				return std::unique_ptr<T, ComponentDeleter>(new (slot) T(std::forward<Args>(args)...), ComponentDeleter(this));
+			}
+			catch (...)
+			{
+				deallocate(slot);
+				throw;
+			}
+		}
+
+		/**
+		 * @brief Destroy a component created by this pool and give its slot back.
+		 * @note  Destroys the pool if it was its last component and the owner released it.
+		 */
+		inline void destroy(_In_ Component* component) noexcept
+		{
+			// The slot starts at the most derived object, which may not be where its Component base is.
+			void* slot = dynamic_cast<void*>(component);
+			component->~Component();
+			deallocate(slot);
+		}
+
+		inline size_t getLiveCount() const noexcept { return m_liveCount; }
+		inline size_t getCapacity() const noexcept { return m_slabs.size() * m_slotsPerSlab; }
+		inline size_t getSlotSize() const noexcept { return m_slotSize; }
+	};
+
+
+	inline void ComponentDeleter::operator()(_In_ Component* component) const noexcept
+	{
+		if (pPool) pPool->destroy(component);
+		else delete component;
+	}
+
+	inline void ComponentPoolRelease::operator()(_In_ ComponentPool* pool) const noexcept
+	{
+		pool->release();
+	}
+
+} // namespace Graphics
+
+#endif // COMPONENT_POOL_H
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "Profiler.h"
 #include "fctdef.h"
 
 
@@ -13,6 +14,8 @@ namespace EventHandler
 
 	std::unordered_map<UINT, std::vector<Event>> eventHandler;
 	EVENTID lastEventId = 0xf; // First 15 IDs are reserved.
+	MESSAGEHOOK messageHook = nullptr;
+	void* messageHookContext = nullptr;
 
 
 	void addEvent(_In_ Event&& ev, _Out_ EventList* eventList) noexcept
@@ -63,17 +66,31 @@ namespace EventHandler
 
 	bool unregisterEvent(_In_ EVENTID eventId)
 	{
-		for (std::pair<UINT, std::vector<Event>> listEvents : eventHandler)
+		for (auto& [uMsg, eventList] : eventHandler)
 		{
-			EventList eventList = listEvents.second;
 			if (removeEvent(eventId, &eventList))
 				return true;
 		}
 		return false;
 	}
 
+	void setMessageHook(_In_opt_ MESSAGEHOOK hook, _In_opt_ void* context) noexcept
+	{
+		messageHook = hook;
+		messageHookContext = context;
+	}
+
+	bool hasEvent(_In_ UINT uMsg) noexcept
+	{
+		auto it = eventHandler.find(uMsg);
+		return it != eventHandler.end() && !it->second.empty(); // Unregistering leaves an empty list.
+	}
+
 	LRESULT handleMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_opt_ WPARAM wParam, _In_opt_ LPARAM lParam)
 	{
+		PROFILE_ZONE("handleMessage");
+		if (messageHook) (*messageHook)(hwnd, uMsg, wParam, lParam, messageHookContext);
+
 		auto it = eventHandler.find(uMsg);
 		if (it == eventHandler.end())
 			return DefWindowProc(hwnd, uMsg, wParam, lParam);
@@ -17,6 +17,7 @@
 namespace EventHandler
 {
 	typedef LRESULT(*EVENTFCT)(_In_ HWND, _In_ WPARAM, _In_ LPARAM, _Inout_opt_ void* context);
+	typedef void(*MESSAGEHOOK)(_In_ HWND, _In_ UINT, _In_ WPARAM, _In_ LPARAM, _Inout_opt_ void* context);
 	typedef unsigned long long EVENTID;
 	typedef short PRIORITY;
 
@@ -59,6 +60,26 @@ namespace EventHandler
 	 */
 	bool unregisterEvent(_In_ EVENTID eventId);
 
+	/**
+	 * @brief Set the function called with every handled message, before its events.
+	 *
+	 * @note Used to capture the messages. Only one hook is kept.
+	 *
+	 * @param[in] hook		The function to call, nullptr to remove the hook.
+	 * @param[in] context	The context given to the hook.
+	 */
+	void setMessageHook(_In_opt_ MESSAGEHOOK hook, _In_opt_ void* context = nullptr) noexcept;
+
+	/**
+	 * @brief Tell whether a message has events to call.
+	 *
+	 * @param[in] uMsg The message.
+	 *
+	 * @retval bool
+	 * @return True if at least one event is registered for the message, false otherwise.
+	 */
+	bool hasEvent(_In_ UINT uMsg) noexcept;
+
 	/**
 	 * @brief Handle a recieved message by calling all event linked to the message.
 	 *
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include <Windows.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+
+namespace Render
+{
+	/**
+	 * @brief Hands the latest of a stream of values from one producer thread to one consumer thread, without locks.
+	 *
+	 * @note The producer writes the back buffer then publishes it, the consumer acquires the latest buffer published.
+	 *       Neither waits for the other: a buffer published twice before being acquired is overwritten,
+	 *       and acquiring without a new buffer keeps the previous one.
+	 *       The buffers are reused, their storage is kept between values.
+	 */
+	template <class T>
+	class TripleBuffer
+	{
+	private:
+		static constexpr UINT32 INDEX_MASK = 0x3;
+		static constexpr UINT32 FRESH = 0x4;	// The middle buffer was published and not acquired yet.
+
+		T m_buffers[3];
+		std::atomic<UINT32> m_middle = 1;
+		UINT32 m_back = 0;		// Owned by the producer.
+		UINT32 m_front = 2;		// Owned by the consumer.
+
+	public:
+		TripleBuffer() = default;
+		TripleBuffer(TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		/**
+		 * @brief Return the buffer the producer writes, until it publishes it.
+		 */
+		inline T& getBack() noexcept { return m_buffers[m_back]; }
+
+		/**
+		 * @brief Make the back buffer the latest value, and give the producer a free buffer.
+		 *
+		 * @retval bool
+		 * @return True if the previous value was replaced without being acquired.
+		 */
+		inline bool publish() noexcept
+		{
+			const UINT32 previous = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+			m_back = previous & INDEX_MASK;
+			return (previous & FRESH) != 0;
+		}
+
+		/**
+		 * @brief Take the latest value published, if there is a new one.
+		 *
+		 * @retval bool
+		 * @return True if the front buffer now holds a new value.
+		 */
+		inline bool acquire() noexcept
+		{
+			if ((m_middle.load(std::memory_order_acquire) & FRESH) == 0) return false;
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		}
+
+		/**
+		 * @brief Return the buffer the consumer reads, until it acquires another one.
+		 */
+		inline T& getFront() noexcept { return m_buffers[m_front]; }
+	};
+
+
+	/**
+	 * @brief What the render thread needs of a simulation tick: the recorded commands, which hold the world
+	 *        position of every visible drawable and the handles of their resources.
+	 */
+	struct FrameSnapshot
+	{
+		typedef std::chrono::steady_clock::time_point TimePoint;
+
+		CommandBuffer commands;
+		UINT64 frame = 0;
+		TimePoint recordTime;
+		TimePoint inputTime;	// The oldest input handled since the previous snapshot, or TimePoint() if none.
+	};
+
+
+	/**
+	 * @brief Counters of the frames presented.
+	 *
+	 * @note The latency is measured from the dispatch of an input message to the end of the first frame presented after it.
+	 */
+	struct PresentStats
+	{
+		UINT64 framesRecorded = 0;
+		UINT64 framesPresented = 0;
+		UINT64 framesDropped = 0;		// Recorded, then replaced by a newer snapshot before being drawn.
+		UINT64 latencyCount = 0;
+		double latencyMs = 0.0;			// Sum, input to present.
+		double maxLatencyMs = 0.0;
+		double lastPresentMs = 0.0;		// Duration of the last draw and present.
+		double lastPresentWaitMs = 0.0;	// Of lastPresentMs, spent in EndDraw: mostly waiting for the vsync.
+
+		inline double getAverageLatencyMs() const noexcept { return latencyCount == 0 ? 0.0 : latencyMs / static_cast<double>(latencyCount); }
+	};
+
+} // namespace Render
+
+#endif // FRAME_SNAPSHOT_H
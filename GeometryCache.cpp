@@ -0,0 +1,429 @@
+#include "GeometryCache.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+#include <windows.h>
+#include <d2d1.h>
+
+#include "Profiler.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+
+	constexpr float PI = 3.14159265358979f;
+	constexpr UINT32 SUBSAMPLES = 4; // Per pixel and per axis: 16 levels of coverage.
+
+	typedef std::vector<std::vector<D2D1_POINT_2F>> Contours;
+
+	bool operator==(_In_ const ShapeDesc& a, _In_ const ShapeDesc& b) noexcept
+	{
+		if (a.type != b.type || a.width != b.width || a.height != b.height || a.radiusX != b.radiusX || a.radiusY != b.radiusY
+			|| a.closed != b.closed || a.strokeWidth != b.strokeWidth || a.points.size() != b.points.size()) return false;
+
+		for (size_t i = 0; i < a.points.size(); i++)
+			if (a.points[i].x != b.points[i].x || a.points[i].y != b.points[i].y) return false;
+		return true;
+	}
+
+	inline void combineHash(_Inout_ size_t& seed, _In_ float value) noexcept
+	{
+		seed ^= std::hash<float>()(value) + 0x9E3779B9 + (seed << 6) + (seed >> 2);
+	}
+
+	size_t hashDesc(_In_ const ShapeDesc& desc) noexcept
+	{
+		size_t seed = static_cast<size_t>(desc.type) | (desc.closed ? 0x100 : 0);
+		for (float value : { desc.width, desc.height, desc.radiusX, desc.radiusY, desc.strokeWidth })
+			combineHash(seed, value);
+		for (const D2D1_POINT_2F& point : desc.points)
+		{
+			combineHash(seed, point.x);
+			combineHash(seed, point.y);
+		}
+		return seed;
+	}
+
+
+
+	/************************/
+	/*		Flattening		*/
+	/************************/
+
+
+	/**
+	 * @brief Append a quarter of ellipse, from angle to angle + PI / 2, clockwise on screen.
+	 */
+	void appendArc(_Inout_ std::vector<D2D1_POINT_2F>& contour, _In_ float cx, _In_ float cy, _In_ float rx, _In_ float ry, _In_ float angle)
+	{
+		// Enough segments to stay within about a quarter of pixel of the curve.
+		const UINT32 segments = (std::clamp)(static_cast<UINT32>(std::ceil(std::sqrt((std::max)(rx, ry)) * 2.0f)), 2u, 64u);
+		for (UINT32 i = 0; i <= segments; i++)
+		{
+			const float a = angle + (PI / 2.0f) * static_cast<float>(i) / static_cast<float>(segments);
+			contour.push_back({ cx + rx * std::cos(a), cy + ry * std::sin(a) });
+		}
+	}
+
+	/**
+	 * @brief The contour of a rectangle, rounded or not, or of an ellipse, grown by offset on each side.
+	 */
+	std::vector<D2D1_POINT_2F> closedContour(_In_ const ShapeDesc& desc, _In_ float offset)
+	{
+		const float left = -offset, top = -offset;
+		const float right = desc.width + offset, bottom = desc.height + offset;
+		std::vector<D2D1_POINT_2F> contour;
+		if (right <= left || bottom <= top) return contour;
+
+		switch (desc.type)
+		{
+		case ShapeType::Rectangle:
+			contour = { { left, top }, { right, top }, { right, bottom }, { left, bottom } };
+			break;
+
+		case ShapeType::RoundedRectangle:
+		{
+			const float rx = (std::clamp)(desc.radiusX + offset, 0.0f, (right - left) / 2.0f);
+			const float ry = (std::clamp)(desc.radiusY + offset, 0.0f, (bottom - top) / 2.0f);
+			appendArc(contour, right - rx, top + ry, rx, ry, -PI / 2.0f);
+			appendArc(contour, right - rx, bottom - ry, rx, ry, 0.0f);
+			appendArc(contour, left + rx, bottom - ry, rx, ry, PI / 2.0f);
+			appendArc(contour, left + rx, top + ry, rx, ry, PI);
+			break;
+		}
+
+		case ShapeType::Ellipse:
+		{
+			const float rx = (right - left) / 2.0f, ry = (bottom - top) / 2.0f;
+			for (float angle : { -PI / 2.0f, 0.0f, PI / 2.0f, PI })
+			{
+				appendArc(contour, left + rx, top + ry, rx, ry, angle);
+				contour.pop_back(); // Shared with the next quarter.
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+		return contour;
+	}
+
+	/**
+	 * @brief The area covered by the outline of a polyline: one rectangle per segment, extended by half the width.
+	 *
+	 * @note The rectangles all turn the same way, so they add up with the non-zero rule.
+	 *       The extensions cover the outside of the joins.
+	 */
+	Contours strokePolyline(_In_ const std::vector<D2D1_POINT_2F>& points, _In_ bool closed, _In_ float width)
+	{
+		Contours area;
+		const float half = width / 2.0f;
+		const size_t count = closed ? points.size() : points.size() - 1;
+
+		for (size_t i = 0; i < count && points.size() > 1; i++)
+		{
+			const D2D1_POINT_2F& a = points[i];
+			const D2D1_POINT_2F& b = points[(i + 1) % points.size()];
+			const float length = std::hypot(b.x - a.x, b.y - a.y);
+			if (length <= 0.0f) continue;
+
+			const float dx = (b.x - a.x) / length * half, dy = (b.y - a.y) / length * half;
+			area.push_back({
+				{ a.x - dx - dy, a.y - dy + dx },
+				{ b.x + dx - dy, b.y + dy + dx },
+				{ b.x + dx + dy, b.y + dy - dx },
+				{ a.x - dx + dy, a.y - dy - dx }
+			});
+		}
+		return area;
+	}
+
+	D2D1_RECT_F computeBounds(_In_ const Contours& contours) noexcept
+	{
+		D2D1_RECT_F bounds = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const auto& contour : contours)
+		{
+			for (const D2D1_POINT_2F& point : contour)
+			{
+				bounds.left = (std::min)(bounds.left, point.x);
+				bounds.top = (std::min)(bounds.top, point.y);
+				bounds.right = (std::max)(bounds.right, point.x);
+				bounds.bottom = (std::max)(bounds.bottom, point.y);
+			}
+		}
+		return bounds.right < bounds.left ? D2D1::RectF() : bounds;
+	}
+
+
+
+	/************************/
+	/*		Rasterizing		*/
+	/************************/
+
+
+	/**
+	 * @brief Rasterize an area with the non-zero rule, SUBSAMPLES x SUBSAMPLES samples per pixel.
+	 */
+	void rasterize(_In_ const Contours& area, _In_ const D2D1_RECT_F& bounds, _Out_ GeometrySpans* result)
+	{
+		struct Edge { float x0, y0, x1, y1; int winding; };
+		struct Crossing { float x; int winding; };
+
+		result->spans.clear();
+		result->coverage.clear();
+		result->bounds = bounds;
+
+		std::vector<Edge> edges;
+		for (const auto& contour : area)
+		{
+			for (size_t i = 0; i < contour.size(); i++)
+			{
+				const D2D1_POINT_2F& a = contour[i];
+				const D2D1_POINT_2F& b = contour[(i + 1) % contour.size()];
+				if (a.y != b.y) edges.push_back({ a.x, a.y, b.x, b.y, b.y > a.y ? 1 : -1 });
+			}
+		}
+		if (edges.empty()) return;
+
+		const INT32 left = static_cast<INT32>(std::floor(bounds.left));
+		const INT32 top = static_cast<INT32>(std::floor(bounds.top));
+		const INT32 right = static_cast<INT32>(std::ceil(bounds.right));
+		const INT32 bottom = static_cast<INT32>(std::ceil(bounds.bottom));
+		const UINT32 width = static_cast<UINT32>(right - left);
+		const float step = 1.0f / SUBSAMPLES;
+
+		std::vector<BYTE> samples(width);
+		std::vector<Crossing> crossings;
+
+		for (INT32 y = top; y < bottom; y++)
+		{
+			std::fill(samples.begin(), samples.end(), 0);
+
+			for (UINT32 row = 0; row < SUBSAMPLES; row++)
+			{
+				const float sy = static_cast<float>(y) + (static_cast<float>(row) + 0.5f) * step;
+				crossings.clear();
+				for (const Edge& edge : edges)
+				{
+					if ((edge.y0 <= sy) == (edge.y1 <= sy)) continue;
+					const float t = (sy - edge.y0) / (edge.y1 - edge.y0);
+					crossings.push_back({ edge.x0 + t * (edge.x1 - edge.x0), edge.winding });
+				}
+				std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b) { return a.x < b.x; });
+
+				// Count the samples inside each interval of non-zero winding.
+				int winding = 0;
+				for (size_t i = 0; i + 1 < crossings.size(); i++)
+				{
+					winding += crossings[i].winding;
+					if (winding == 0) continue;
+
+					const float from = (crossings[i].x - static_cast<float>(left)) * SUBSAMPLES - 0.5f;
+					const float to = (crossings[i + 1].x - static_cast<float>(left)) * SUBSAMPLES - 0.5f;
+					const INT32 first = (std::max)(static_cast<INT32>(std::ceil(from)), 0);
+					const INT32 last = (std::min)(static_cast<INT32>(std::ceil(to)), static_cast<INT32>(width * SUBSAMPLES));
+					for (INT32 sample = first; sample < last; sample++)
+						samples[sample / SUBSAMPLES]++;
+				}
+			}
+
+			// Runs of fully covered pixels, and runs of partially covered ones.
+			for (UINT32 x = 0; x < width;)
+			{
+				if (samples[x] == 0) { x++; continue; }
+
+				const bool isFull = samples[x] == SUBSAMPLES * SUBSAMPLES;
+				UINT32 end = x + 1;
+				while (end < width && samples[end] != 0 && (samples[end] == SUBSAMPLES * SUBSAMPLES) == isFull) end++;
+
+				CoverageSpan span = { left + static_cast<INT32>(x), y, end - x, FULL_COVERAGE };
+				if (!isFull)
+				{
+					span.coverage = static_cast<UINT32>(result->coverage.size());
+					for (UINT32 i = x; i < end; i++)
+						result->coverage.push_back(static_cast<BYTE>(samples[i] * 0xFF / (SUBSAMPLES * SUBSAMPLES)));
+				}
+				result->spans.push_back(span);
+				x = end;
+			}
+		}
+	}
+
+
+
+	/****************************/
+	/*		GeometryCache		*/
+	/****************************/
+
+
+	GeometryId GeometryCache::acquire(_In_ const ShapeDesc& desc)
+	{
+		PROFILE_ZONE("GeometryCache::acquire");
+		const size_t hash = hashDesc(desc);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto range = m_lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; it++)
+		{
+			Entry& entry = m_entries.at(it->second);
+			if (entry.desc == desc)
+			{
+				entry.refCount++;
+				return it->second;
+			}
+		}
+
+		const GeometryId id = ++m_lastId;
+		Entry& entry = m_entries[id];
+		entry.desc = desc;
+		entry.hash = hash;
+		entry.refCount = 1;
+
+		const bool isStroked = desc.strokeWidth > 0.0f;
+		if (desc.type == ShapeType::Polyline)
+		{
+			entry.outline.push_back(desc.points);
+			if (isStroked) entry.coverageArea = strokePolyline(desc.points, desc.closed, desc.strokeWidth);
+			else if (desc.closed) entry.coverageArea = entry.outline;
+		}
+		else
+		{
+			entry.outline.push_back(closedContour(desc, 0.0f));
+			if (isStroked)
+			{
+				// A ring: the inner contour turns the other way.
+				entry.coverageArea.push_back(closedContour(desc, desc.strokeWidth / 2.0f));
+				std::vector<D2D1_POINT_2F> inner = closedContour(desc, -desc.strokeWidth / 2.0f);
+				std::reverse(inner.begin(), inner.end());
+				if (!inner.empty()) entry.coverageArea.push_back(std::move(inner));
+			}
+			else entry.coverageArea = entry.outline;
+		}
+		entry.bounds = computeBounds(entry.coverageArea);
+
+		m_lookup.insert({ hash, id });
+		return id;
+	}
+
+	void GeometryCache::release(_In_ GeometryId id) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(id);
+		if (it == m_entries.end() || --it->second.refCount > 0) return;
+
+		auto range = m_lookup.equal_range(it->second.hash);
+		for (auto lookup = range.first; lookup != range.second; lookup++)
+		{
+			if (lookup->second == id)
+			{
+				m_lookup.erase(lookup);
+				break;
+			}
+		}
+		if (it->second.pGeometry) m_dropped.push_back(it->second.pGeometry);
+		m_entries.erase(it);
+	}
+
+	D2D1_RECT_F GeometryCache::getBounds(_In_ GeometryId id) const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(id);
+		return it != m_entries.end() ? it->second.bounds : D2D1::RectF();
+	}
+
+	float GeometryCache::getStrokeWidth(_In_ GeometryId id) const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(id);
+		return it != m_entries.end() ? it->second.desc.strokeWidth : 0.0f;
+	}
+
+	ID2D1PathGeometry* GeometryCache::getDeviceGeometry(_In_ GeometryId id, _In_ ID2D1Factory* pFactory)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(id);
+		if (it == m_entries.end()) return nullptr;
+
+		Entry& entry = it->second;
+		if (entry.pGeometry) return entry.pGeometry;
+
+		ID2D1PathGeometry* pGeometry = nullptr;
+		ID2D1GeometrySink* pSink = nullptr;
+		if (FAILED(pFactory->CreatePathGeometry(&pGeometry))) return nullptr;
+		if (FAILED(pGeometry->Open(&pSink)))
+		{
+			pGeometry->Release();
+			return nullptr;
+		}
+
+		const bool isClosed = entry.desc.type != ShapeType::Polyline || entry.desc.closed;
+		pSink->SetFillMode(D2D1_FILL_MODE_WINDING);
+		for (const auto& contour : entry.outline)
+		{
+			if (contour.size() < 2) continue;
+			pSink->BeginFigure(contour.front(), isClosed ? D2D1_FIGURE_BEGIN_FILLED : D2D1_FIGURE_BEGIN_HOLLOW);
+			pSink->AddLines(contour.data() + 1, static_cast<UINT32>(contour.size() - 1));
+			pSink->EndFigure(isClosed ? D2D1_FIGURE_END_CLOSED : D2D1_FIGURE_END_OPEN);
+		}
+		const HRESULT hr = pSink->Close();
+		pSink->Release();
+		if (FAILED(hr))
+		{
+			pGeometry->Release();
+			return nullptr;
+		}
+
+		entry.pGeometry = pGeometry;
+		return pGeometry;
+	}
+
+	const GeometrySpans* GeometryCache::getSpans(_In_ GeometryId id) const
+	{
+		const Entry* pEntry;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_entries.find(id);
+			if (it == m_entries.end()) return nullptr;
+			pEntry = &it->second; // The nodes don't move, and the caller's reference keeps it alive.
+		}
+
+		// The area and the bounds don't change once acquired: they are read without the lock.
+		std::call_once(pEntry->spansBuilt, [pEntry]() {
+			PROFILE_ZONE("GeometryCache::rasterize");
+			rasterize(pEntry->coverageArea, pEntry->bounds, &pEntry->spans);
+		});
+		return &pEntry->spans;
+	}
+
+	void GeometryCache::releaseDropped() noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (ID2D1PathGeometry* pGeometry : m_dropped)
+			pGeometry->Release();
+		m_dropped.clear();
+	}
+
+	void GeometryCache::releaseDeviceResources() noexcept
+	{
+		releaseDropped();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& [id, entry] : m_entries)
+		{
+			if (entry.pGeometry) entry.pGeometry->Release();
+			entry.pGeometry = nullptr;
+		}
+	}
+
+	GeometryCache::~GeometryCache()
+	{
+		releaseDeviceResources();
+	}
+
+} // namespace Render
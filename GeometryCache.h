@@ -0,0 +1,181 @@
+#pragma once
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include <Windows.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	typedef UINT32 GeometryId;
+
+	constexpr GeometryId INVALID_GEOMETRY = 0;
+
+	enum class ShapeType : BYTE
+	{
+		Rectangle,			// width x height.
+		RoundedRectangle,	// width x height, corners of radiusX x radiusY.
+		Ellipse,			// Inside width x height.
+		Polyline,			// Points, open unless closed is set.
+	};
+
+	/**
+	 * @brief The parameters of a shape, in pixels, relative to its position.
+	 *
+	 * @note Two equal descriptions share the same cached geometry.
+	 */
+	struct ShapeDesc
+	{
+		ShapeType type = ShapeType::Rectangle;
+		float width = 0.0f;
+		float height = 0.0f;
+		float radiusX = 0.0f;
+		float radiusY = 0.0f;
+		std::vector<D2D1_POINT_2F> points;
+		bool closed = false;
+		float strokeWidth = 0.0f;	// Zero to fill the shape, the width of its outline otherwise.
+	};
+
+	bool operator==(_In_ const ShapeDesc& a, _In_ const ShapeDesc& b) noexcept;
+
+	/**
+	 * @brief Pixels of a row covered by a geometry, relative to its position.
+	 */
+	struct CoverageSpan
+	{
+		INT32 x;
+		INT32 y;
+		UINT32 length;
+		UINT32 coverage;	// Index of the first coverage byte, or FULL_COVERAGE if every pixel is covered.
+	};
+
+	constexpr UINT32 FULL_COVERAGE = 0xFFFFFFFF;
+
+	/**
+	 * @brief A geometry rasterized in memory.
+	 */
+	struct GeometrySpans
+	{
+		std::vector<CoverageSpan> spans;	// Sorted by row.
+		std::vector<BYTE> coverage;			// Coverage of the partially covered spans, 0xFF for full.
+		D2D1_RECT_F bounds;					// Of the covered area, as returned by GeometryCache::getBounds.
+	};
+
+
+	/**
+	 * @brief Geometries of the shapes, built once and shared by identical shapes.
+	 *
+	 * @note Shapes are flattened to polygons when acquired. The Direct2D path geometries are created
+	 *       from the factory on first draw, and the coverage spans of the software path on first
+	 *       software render: neither depends on the position of the shape, which is applied when drawing.
+	 *       Ids are never reused, so a command identifies its geometry for the whole run.
+	 */
+	class GeometryCache
+	{
+	private:
+		typedef std::vector<std::vector<D2D1_POINT_2F>> Contours;
+
+		struct Entry
+		{
+			ShapeDesc desc;
+			size_t hash;
+			UINT32 refCount;
+			Contours outline;		// The figure drawn by Direct2D, filled or stroked.
+			Contours coverageArea;	// The area covered, filled with the non-zero rule.
+			D2D1_RECT_F bounds;		// Of the covered area.
+			ID2D1PathGeometry* pGeometry = nullptr;
+			mutable GeometrySpans spans;	// Built on first use.
+			mutable std::once_flag spansBuilt;
+		};
+
+		std::unordered_map<GeometryId, Entry> m_entries;
+		std::unordered_multimap<size_t, GeometryId> m_lookup; // Hash of the description to id.
+		std::vector<ID2D1PathGeometry*> m_dropped; // Of the released geometries, released by the render thread.
+		GeometryId m_lastId = INVALID_GEOMETRY;
+		mutable std::mutex m_mutex;
+
+	public:
+		GeometryCache() = default;
+		GeometryCache(GeometryCache&) = delete;
+		GeometryCache& operator=(const GeometryCache&) = delete;
+
+		/**
+		 * @brief Return the geometry of a shape, building it if no identical shape has one.
+		 *
+		 * @note Thread safe. Each call must be balanced by a call to release.
+		 *
+		 * @param[in] desc The shape.
+		 *
+		 * @retval GeometryId
+		 * @return The id of the geometry.
+		 */
+		GeometryId acquire(_In_ const ShapeDesc& desc);
+
+		/**
+		 * @brief Release a geometry, destroyed when no shape uses it anymore.
+		 * @note  Its Direct2D geometry is only released by releaseDropped.
+		 */
+		void release(_In_ GeometryId id) noexcept;
+
+		/**
+		 * @brief Return the bounds of the area covered by a geometry, relative to the shape's position.
+		 */
+		D2D1_RECT_F getBounds(_In_ GeometryId id) const noexcept;
+
+		/**
+		 * @brief Return the stroke width of a geometry, zero if it is filled.
+		 */
+		float getStrokeWidth(_In_ GeometryId id) const noexcept;
+
+		/**
+		 * @brief Return the Direct2D geometry, creating it if needed.
+		 *
+		 * @param[in] id		The geometry.
+		 * @param[in] pFactory	The factory of the render target.
+		 *
+		 * @retval ID2D1PathGeometry*
+		 * @return The geometry, or nullptr if the id is unknown or the creation failed.
+		 */
+		ID2D1PathGeometry* getDeviceGeometry(_In_ GeometryId id, _In_ ID2D1Factory* pFactory);
+
+		/**
+		 * @brief Return the coverage spans of a geometry, rasterizing them if needed.
+		 *
+		 * @note Thread safe. The cache is only locked to find the geometry: the tiles rasterizing other
+		 *       geometries don't wait, and those needing the same one wait for it. The spans stay valid
+		 *       until the geometry is destroyed.
+		 *
+		 * @retval GeometrySpans*
+		 * @return The spans, or nullptr if the id is unknown.
+		 */
+		const GeometrySpans* getSpans(_In_ GeometryId id) const;
+
+		inline size_t getCount() const noexcept { return m_entries.size(); }
+
+		/**
+		 * @brief Release the Direct2D geometries of the geometries destroyed since the last call.
+		 */
+		void releaseDropped() noexcept;
+
+		/**
+		 * @brief Release the Direct2D geometries.
+		 * @note  Only needed when the factory is destroyed: geometries don't depend on the render target.
+		 */
+		void releaseDeviceResources() noexcept;
+
+		~GeometryCache();
+	};
+
+} // namespace Render
+
+#endif // GEOMETRY_CACHE_H
@@ -0,0 +1,488 @@
+#include "GlyphCache.h"
+
+#include <algorithm>
+
+#include <windows.h>
+
+#include "GraphicComponents.h"
+#include "Profiler.h"
+
+#pragma comment(lib, "d2d1")
+#pragma comment(lib, "gdi32")
+
+
+namespace Render
+{
+
+
+	/********************************/
+	/*		GdiGlyphRasterizer		*/
+	/********************************/
+
+
+	GdiGlyphRasterizer::GdiGlyphRasterizer()
+		:m_hdc(CreateCompatibleDC(NULL))
+	{}
+
+	HFONT GdiGlyphRasterizer::selectFont(_In_ const std::wstring& family, _In_ UINT32 size)
+	{
+		HFONT& font = m_fonts[{ family, size }];
+		if (font == NULL)
+		{
+			// A negative height is the em square: size is in pixels, like the other rasterizers.
+			font = CreateFontW(-static_cast<int>(size), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+				OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, family.c_str());
+			if (font == NULL) return NULL;
+		}
+		SelectObject(m_hdc, font);
+		return font;
+	}
+
+	bool GdiGlyphRasterizer::getMetrics(_In_ const std::wstring& family, _In_ UINT32 size, _Out_ FontMetrics* metrics)
+	{
+		if (m_hdc == NULL || selectFont(family, size) == NULL) return false;
+
+		TEXTMETRICW textMetrics;
+		if (!GetTextMetricsW(m_hdc, &textMetrics)) return false;
+
+		metrics->ascent = static_cast<float>(textMetrics.tmAscent);
+		metrics->descent = static_cast<float>(textMetrics.tmDescent);
+		metrics->lineGap = static_cast<float>(textMetrics.tmExternalLeading);
+		return true;
+	}
+
+	bool GdiGlyphRasterizer::rasterize(_In_ const std::wstring& family, _In_ UINT32 size, _In_ wchar_t character, _Out_ GlyphBitmap* glyph)
+	{
+		if (m_hdc == NULL || selectFont(family, size) == NULL) return false;
+
+		const MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+		GLYPHMETRICS metrics;
+		const DWORD bufferSize = GetGlyphOutlineW(m_hdc, character, GGO_GRAY8_BITMAP, &metrics, 0, nullptr, &identity);
+		if (bufferSize == GDI_ERROR) return false;
+
+		glyph->advance = static_cast<float>(metrics.gmCellIncX);
+		glyph->coverage.clear();
+		glyph->width = glyph->height = 0;
+		if (bufferSize == 0) return true; // Blank, like a space.
+
+		m_buffer.resize(bufferSize);
+		if (GetGlyphOutlineW(m_hdc, character, GGO_GRAY8_BITMAP, &metrics, bufferSize, m_buffer.data(), &identity) == GDI_ERROR) return false;
+
+		// 65 levels of gray, rows aligned on 4 bytes.
+		const UINT32 pitch = (metrics.gmBlackBoxX + 3) & ~3u;
+		glyph->width = metrics.gmBlackBoxX;
+		glyph->height = metrics.gmBlackBoxY;
+		glyph->left = static_cast<float>(metrics.gmptGlyphOrigin.x);
+		glyph->top = -static_cast<float>(metrics.gmptGlyphOrigin.y);
+		glyph->coverage.resize(static_cast<size_t>(glyph->width) * glyph->height);
+		for (UINT32 y = 0; y < glyph->height; y++)
+			for (UINT32 x = 0; x < glyph->width; x++)
+				glyph->coverage[static_cast<size_t>(y) * glyph->width + x] = static_cast<BYTE>((std::min)(m_buffer[static_cast<size_t>(y) * pitch + x] * 0xFF / 64, 0xFF));
+		return true;
+	}
+
+	GdiGlyphRasterizer::~GdiGlyphRasterizer()
+	{
+		for (auto& [key, font] : m_fonts)
+			if (font) DeleteObject(font);
+		if (m_hdc) DeleteDC(m_hdc);
+	}
+
+
+
+	/************************************/
+	/*		BuiltinGlyphRasterizer		*/
+	/************************************/
+
+
+	constexpr UINT32 BUILTIN_WIDTH = 8;
+	constexpr UINT32 BUILTIN_HEIGHT = 16;
+	constexpr UINT32 BUILTIN_BASELINE = 12;
+
+	/**
+	 * Printable ASCII, from ' ' to '~', rendered from DejaVu Sans Mono.
+	 * One UINT16 per row, 2 bits of coverage per pixel, the leftmost pixel in the high bits.
+	 */
+	const UINT16 BUILTIN_FONT[95][BUILTIN_HEIGHT] =
+	{
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // space
+		{ 0x0000, 0x0000, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0000, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // !
+		{ 0x0000, 0x0000, 0x0960, 0x0960, 0x0960, 0x0960, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // "
+		{ 0x0000, 0x0000, 0x0148, 0x0358, 0x0328, 0x6BBE, 0x1A75, 0x0D60, 0xAEF9, 0x6994, 0x24C0, 0x3580, 0x0000, 0x0000, 0x0000, 0x0000 }, // #
+		{ 0x0000, 0x0000, 0x0180, 0x0690, 0x1EA4, 0x2980, 0x2980, 0x0BE0, 0x01AC, 0x018D, 0x119C, 0x1BE4, 0x0180, 0x0180, 0x0000, 0x0000 }, // $
+		{ 0x0000, 0x0000, 0x0400, 0x7A00, 0x8240, 0x9240, 0x2969, 0x0690, 0x64AD, 0x0186, 0x0186, 0x00BD, 0x0000, 0x0000, 0x0000, 0x0000 }, // %
+		{ 0x0000, 0x0000, 0x0AA0, 0x1D50, 0x2800, 0x0C00, 0x1E00, 0x7286, 0xA0D6, 0xA079, 0x742C, 0x2EEA, 0x0100, 0x0000, 0x0000, 0x0000 }, // &
+		{ 0x0000, 0x0000, 0x0140, 0x0280, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // '
+		{ 0x0000, 0x0000, 0x0090, 0x00C0, 0x0280, 0x0340, 0x0300, 0x0700, 0x0700, 0x0340, 0x0240, 0x0180, 0x00C0, 0x0050, 0x0000, 0x0000 }, // (
+		{ 0x0000, 0x0000, 0x0600, 0x0300, 0x0280, 0x01C0, 0x00C0, 0x00D0, 0x00D0, 0x01C0, 0x0180, 0x0280, 0x0300, 0x0500, 0x0000, 0x0000 }, // )
+		{ 0x0000, 0x0000, 0x0140, 0x2148, 0x0AA0, 0x07D0, 0x2558, 0x0140, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // *
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0140, 0x0280, 0x0280, 0x6BE9, 0x6AA9, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // +
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x02C0, 0x02C0, 0x0340, 0x0600, 0x0000, 0x0000 }, // ,
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0550, 0x0BE0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // -
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // .
+		{ 0x0000, 0x0000, 0x0018, 0x0024, 0x0070, 0x00A0, 0x01C0, 0x0280, 0x0300, 0x0A00, 0x0C00, 0x2800, 0x3400, 0x1000, 0x0000, 0x0000 }, // /
+		{ 0x0000, 0x0000, 0x0A90, 0x1D74, 0x2828, 0x341C, 0x369C, 0x769D, 0x341C, 0x341C, 0x2828, 0x0BE0, 0x0140, 0x0000, 0x0000, 0x0000 }, // 0
+		{ 0x0000, 0x0000, 0x0680, 0x2AC0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x1FFC, 0x0000, 0x0000, 0x0000, 0x0000 }, // 1
+		{ 0x0000, 0x0000, 0x1A90, 0x3574, 0x0028, 0x0028, 0x0034, 0x00A0, 0x0280, 0x0A00, 0x2800, 0x3FF8, 0x0000, 0x0000, 0x0000, 0x0000 }, // 2
+		{ 0x0000, 0x0000, 0x1A90, 0x1578, 0x0028, 0x0028, 0x06E0, 0x01B4, 0x001C, 0x001C, 0x1028, 0x3FE4, 0x0100, 0x0000, 0x0000, 0x0000 }, // 3
+		{ 0x0000, 0x0000, 0x00A0, 0x01F0, 0x0270, 0x0A70, 0x0C70, 0x2470, 0x7574, 0x6AB9, 0x0070, 0x0070, 0x0000, 0x0000, 0x0000, 0x0000 }, // 4
+		{ 0x0000, 0x0000, 0x2AA4, 0x2AA0, 0x2800, 0x2940, 0x2AF0, 0x0028, 0x002C, 0x002C, 0x1038, 0x3FE0, 0x0500, 0x0000, 0x0000, 0x0000 }, // 5
+		{ 0x0000, 0x0000, 0x06A4, 0x1E54, 0x2800, 0x3540, 0x3AB4, 0x781C, 0x341C, 0x341C, 0x282C, 0x0BF4, 0x0040, 0x0000, 0x0000, 0x0000 }, // 6
+		{ 0x0000, 0x0000, 0x2AA8, 0x2AA8, 0x0034, 0x0070, 0x00A0, 0x00D0, 0x01C0, 0x0380, 0x0700, 0x0A00, 0x0000, 0x0000, 0x0000, 0x0000 }, // 7
+		{ 0x0000, 0x0000, 0x0AA0, 0x2968, 0x382C, 0x2828, 0x1AA4, 0x1EB4, 0x341C, 0x741D, 0x382C, 0x1FF4, 0x0140, 0x0000, 0x0000, 0x0000 }, // 8
+		{ 0x0000, 0x0000, 0x0A90, 0x2974, 0x3428, 0x701C, 0x342C, 0x296C, 0x0A9C, 0x0018, 0x0074, 0x1FE0, 0x0100, 0x0000, 0x0000, 0x0000 }, // 9
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // :
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x02C0, 0x02C0, 0x0340, 0x0600, 0x0000, 0x0000 }, // ;
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0001, 0x006D, 0x07E0, 0x7900, 0x6E40, 0x02E4, 0x001A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // <
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xBFFE, 0x0000, 0x6AA9, 0x6AA9, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // =
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x4000, 0x7900, 0x0BD0, 0x006D, 0x01B9, 0x1B80, 0xA400, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // >
+		{ 0x0000, 0x0000, 0x0AA0, 0x2978, 0x0028, 0x0074, 0x00E0, 0x0280, 0x0280, 0x0140, 0x0240, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // ?
+		{ 0x0000, 0x0000, 0x0000, 0x0BF8, 0x2809, 0x7056, 0x92AA, 0x970A, 0x9606, 0x970A, 0x92EA, 0x3050, 0x2800, 0x06F8, 0x0000, 0x0000 }, // @
+		{ 0x0000, 0x0000, 0x0280, 0x03C0, 0x0690, 0x0960, 0x0C30, 0x1C34, 0x2EB8, 0x3AAC, 0x700D, 0xA00A, 0x0000, 0x0000, 0x0000, 0x0000 }, // A
+		{ 0x0000, 0x0000, 0x2A90, 0x3AA8, 0x381C, 0x381C, 0x3EB4, 0x39A8, 0x380D, 0x380D, 0x381C, 0x3FE4, 0x0000, 0x0000, 0x0000, 0x0000 }, // B
+		{ 0x0000, 0x0000, 0x02A8, 0x0E58, 0x2800, 0x3400, 0x3400, 0x3400, 0x3400, 0x2800, 0x1D04, 0x07FC, 0x0040, 0x0000, 0x0000, 0x0000 }, // C
+		{ 0x0000, 0x0000, 0x2A40, 0x3AB4, 0x3428, 0x341C, 0x341D, 0x341D, 0x341C, 0x342C, 0x3474, 0x3F90, 0x0000, 0x0000, 0x0000, 0x0000 }, // D
+		{ 0x0000, 0x0000, 0x2AA8, 0x2AA8, 0x2800, 0x2800, 0x2EA8, 0x2AA4, 0x2800, 0x2800, 0x2800, 0x2FFD, 0x0000, 0x0000, 0x0000, 0x0000 }, // E
+		{ 0x0000, 0x0000, 0x1AA9, 0x2EA8, 0x2800, 0x2800, 0x2EA8, 0x2954, 0x2800, 0x2800, 0x2800, 0x2800, 0x0000, 0x0000, 0x0000, 0x0000 }, // F
+		{ 0x0000, 0x0000, 0x06A4, 0x1E58, 0x3800, 0x7400, 0x7000, 0x70BD, 0x700D, 0x340D, 0x2C0D, 0x0BF8, 0x0040, 0x0000, 0x0000, 0x0000 }, // G
+		{ 0x0000, 0x0000, 0x2418, 0x341C, 0x341C, 0x341C, 0x3AAC, 0x3AAC, 0x341C, 0x341C, 0x341C, 0x341C, 0x0000, 0x0000, 0x0000, 0x0000 }, // H
+		{ 0x0000, 0x0000, 0x2AA8, 0x1BE4, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x2FF8, 0x0000, 0x0000, 0x0000, 0x0000 }, // I
+		{ 0x0000, 0x0000, 0x06A4, 0x06B4, 0x0034, 0x0034, 0x0034, 0x0034, 0x0034, 0x0074, 0x5070, 0x7FD0, 0x0100, 0x0000, 0x0000, 0x0000 }, // J
+		{ 0x0000, 0x0000, 0x2409, 0x3428, 0x34A0, 0x3680, 0x3B40, 0x3AC0, 0x34E0, 0x3474, 0x342C, 0x340E, 0x0000, 0x0000, 0x0000, 0x0000 }, // K
+		{ 0x0000, 0x0000, 0x1800, 0x2800, 0x2800, 0x2800, 0x2800, 0x2800, 0x2800, 0x2800, 0x2800, 0x2FFE, 0x0000, 0x0000, 0x0000, 0x0000 }, // L
+		{ 0x0000, 0x0000, 0x6419, 0xB82E, 0xAC3A, 0xA96A, 0xA69A, 0xA3CA, 0xA14A, 0xA00A, 0xA00A, 0xA00A, 0x0000, 0x0000, 0x0000, 0x0000 }, // M
+		{ 0x0000, 0x0000, 0x2818, 0x3C1C, 0x3D1C, 0x3B1C, 0x365C, 0x359C, 0x34DC, 0x34AC, 0x347C, 0x342C, 0x0000, 0x0000, 0x0000, 0x0000 }, // N
+		{ 0x0000, 0x0000, 0x0AA0, 0x2D78, 0x341C, 0x341C, 0x741D, 0x741D, 0x741D, 0x341C, 0x2828, 0x0BE0, 0x0140, 0x0000, 0x0000, 0x0000 }, // O
+		{ 0x0000, 0x0000, 0x2AA0, 0x2AAC, 0x280D, 0x280D, 0x282C, 0x2FF4, 0x2800, 0x2800, 0x2800, 0x2800, 0x0000, 0x0000, 0x0000, 0x0000 }, // P
+		{ 0x0000, 0x0000, 0x0AA0, 0x2D78, 0x341C, 0x341C, 0x741D, 0x741D, 0x741D, 0x341C, 0x2828, 0x0BE0, 0x0174, 0x0014, 0x0000, 0x0000 }, // Q
+		{ 0x0000, 0x0000, 0x2A90, 0x3AB8, 0x342C, 0x342C, 0x3578, 0x3FE0, 0x3474, 0x3428, 0x340D, 0x340A, 0x0000, 0x0000, 0x0000, 0x0000 }, // R
+		{ 0x0000, 0x0000, 0x0AA4, 0x2954, 0x3400, 0x3400, 0x2E80, 0x06B4, 0x001C, 0x001C, 0x202C, 0x2FF4, 0x0140, 0x0000, 0x0000, 0x0000 }, // S
+		{ 0x0000, 0x0000, 0xAAAA, 0x6BE9, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // T
+		{ 0x0000, 0x0000, 0x2418, 0x341C, 0x341C, 0x341C, 0x341C, 0x341C, 0x341C, 0x341C, 0x2828, 0x1FF4, 0x0140, 0x0000, 0x0000, 0x0000 }, // U
+		{ 0x0000, 0x0000, 0x6009, 0x700D, 0x341C, 0x2828, 0x1824, 0x0C30, 0x0960, 0x0AA0, 0x07D0, 0x03C0, 0x0000, 0x0000, 0x0000, 0x0000 }, // V
+		{ 0x0000, 0x0000, 0x9006, 0x9006, 0xA00A, 0xA28A, 0x63C9, 0x769D, 0x369C, 0x396C, 0x2C38, 0x2828, 0x0000, 0x0000, 0x0000, 0x0000 }, // W
+		{ 0x0000, 0x0000, 0x6009, 0x281C, 0x0D34, 0x0AA0, 0x03C0, 0x03D0, 0x0AA0, 0x1C34, 0x381C, 0xA00A, 0x0000, 0x0000, 0x0000, 0x0000 }, // X
+		{ 0x0000, 0x0000, 0x6009, 0x341C, 0x2C38, 0x0D70, 0x07D0, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // Y
+		{ 0x0000, 0x0000, 0x2AA9, 0x1AAD, 0x0028, 0x0070, 0x00D0, 0x0280, 0x0700, 0x0D00, 0x2800, 0x3FFE, 0x0000, 0x0000, 0x0000, 0x0000 }, // Z
+		{ 0x0000, 0x0000, 0x03A0, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0350, 0x02A0, 0x0000, 0x0000 }, // [
+		{ 0x0000, 0x0000, 0x2000, 0x2800, 0x1C00, 0x0D00, 0x0700, 0x0340, 0x0180, 0x00D0, 0x00A0, 0x0034, 0x0028, 0x0004, 0x0000, 0x0000 }, // backslash
+		{ 0x0000, 0x0000, 0x0AC0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x01C0, 0x05C0, 0x0A80, 0x0000, 0x0000 }, // ]
+		{ 0x0000, 0x0000, 0x0280, 0x0AA0, 0x1824, 0x700D, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // ^
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0xAAAA, 0x5555 }, // _
+		{ 0x0000, 0x0900, 0x0700, 0x0140, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // `
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0640, 0x2AB4, 0x0028, 0x06A8, 0x2958, 0x3018, 0x3438, 0x2ED8, 0x0100, 0x0000, 0x0000, 0x0000 }, // a
+		{ 0x0000, 0x0000, 0x2800, 0x2800, 0x2990, 0x2EB4, 0x281C, 0x280D, 0x280D, 0x280C, 0x2C2C, 0x2BB4, 0x0040, 0x0000, 0x0000, 0x0000 }, // b
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0190, 0x0BAC, 0x1C00, 0x2800, 0x2800, 0x2800, 0x1D04, 0x07BC, 0x0040, 0x0000, 0x0000, 0x0000 }, // c
+		{ 0x0000, 0x0000, 0x0028, 0x0028, 0x0668, 0x1EB8, 0x3428, 0x7028, 0x7028, 0x3428, 0x2838, 0x1EE8, 0x0100, 0x0000, 0x0000, 0x0000 }, // d
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0190, 0x1EB4, 0x381C, 0x355D, 0x7AA9, 0x3000, 0x2804, 0x0BB8, 0x0040, 0x0000, 0x0000, 0x0000 }, // e
+		{ 0x0000, 0x0000, 0x01FC, 0x0280, 0x1694, 0x2BE8, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0000, 0x0000, 0x0000, 0x0000 }, // f
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0644, 0x1EB8, 0x3428, 0x7028, 0x7028, 0x3428, 0x2838, 0x0BE8, 0x0028, 0x1474, 0x1A90, 0x0000 }, // g
+		{ 0x0000, 0x0000, 0x2800, 0x2800, 0x2990, 0x2AB4, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x0000, 0x0000, 0x0000, 0x0000 }, // h
+		{ 0x0000, 0x0000, 0x0280, 0x0140, 0x0540, 0x1B80, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x2FFC, 0x0000, 0x0000, 0x0000, 0x0000 }, // i
+		{ 0x0000, 0x0000, 0x00C0, 0x0080, 0x0540, 0x1AC0, 0x00C0, 0x00C0, 0x00C0, 0x00C0, 0x00C0, 0x00C0, 0x00C0, 0x16C0, 0x2A40, 0x0000 }, // j
+		{ 0x0000, 0x0000, 0x2800, 0x2800, 0x2804, 0x2828, 0x28A0, 0x2A80, 0x2ED0, 0x2870, 0x2828, 0x280D, 0x0000, 0x0000, 0x0000, 0x0000 }, // k
+		{ 0x0000, 0x1500, 0x2B40, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x0340, 0x01F8, 0x0000, 0x0000, 0x0000, 0x0000 }, // l
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1514, 0x7BAC, 0x6289, 0x6289, 0x6289, 0x6289, 0x6289, 0x6289, 0x0000, 0x0000, 0x0000, 0x0000 }, // m
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1190, 0x2AB4, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x0000, 0x0000, 0x0000, 0x0000 }, // n
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0140, 0x1EB4, 0x2828, 0x341C, 0x341C, 0x341C, 0x2828, 0x1FF4, 0x0140, 0x0000, 0x0000, 0x0000 }, // o
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1190, 0x2EB4, 0x281C, 0x280C, 0x280D, 0x281C, 0x2C28, 0x2BB4, 0x2840, 0x2800, 0x2400, 0x0000 }, // p
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0144, 0x1EA8, 0x2828, 0x3418, 0x3418, 0x3428, 0x2828, 0x1FE8, 0x0118, 0x0018, 0x0018, 0x0000 }, // q
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0414, 0x0AEA, 0x0B40, 0x0A00, 0x0A00, 0x0A00, 0x0A00, 0x0A00, 0x0000, 0x0000, 0x0000, 0x0000 }, // r
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0190, 0x1EA4, 0x2800, 0x1D40, 0x06F4, 0x0028, 0x1028, 0x1EE0, 0x0100, 0x0000, 0x0000, 0x0000 }, // s
+		{ 0x0000, 0x0000, 0x0100, 0x0700, 0x1754, 0x6BA8, 0x0700, 0x0700, 0x0700, 0x0700, 0x0340, 0x02F8, 0x0000, 0x0000, 0x0000, 0x0000 }, // t
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x2828, 0x1FE8, 0x0100, 0x0000, 0x0000, 0x0000 }, // u
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x300C, 0x2828, 0x1C34, 0x0D70, 0x0AA0, 0x07D0, 0x03C0, 0x0000, 0x0000, 0x0000, 0x0000 }, // v
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x4001, 0x9006, 0xA00A, 0x6289, 0x328C, 0x3AAC, 0x2D78, 0x1C34, 0x0000, 0x0000, 0x0000, 0x0000 }, // w
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x2828, 0x0D70, 0x07D0, 0x03C0, 0x0AA0, 0x1C34, 0x741D, 0x0000, 0x0000, 0x0000, 0x0000 }, // x
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x340D, 0x2818, 0x1C24, 0x0D70, 0x06A0, 0x03D0, 0x02C0, 0x0280, 0x1700, 0x2900, 0x0000 }, // y
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0554, 0x1AB8, 0x0074, 0x00D0, 0x0280, 0x0A00, 0x1C00, 0x2FF8, 0x0000, 0x0000, 0x0000, 0x0000 }, // z
+		{ 0x0000, 0x0000, 0x00F4, 0x0280, 0x0280, 0x0280, 0x0280, 0x1B40, 0x1B40, 0x0280, 0x0280, 0x0280, 0x0280, 0x00E4, 0x0010, 0x0000 }, // {
+		{ 0x0000, 0x0000, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0280, 0x0000 }, // |
+		{ 0x0000, 0x0000, 0x1F00, 0x0280, 0x0280, 0x0280, 0x0280, 0x01E4, 0x01E4, 0x0280, 0x0280, 0x0280, 0x0280, 0x1B00, 0x0400, 0x0000 }, // }
+		{ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x7F99, 0x51A8, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 }, // ~
+	};
+
+	inline UINT32 getBuiltinScale(_In_ UINT32 size) noexcept
+	{
+		return (std::max)((size + BUILTIN_HEIGHT / 2) / BUILTIN_HEIGHT, 1u);
+	}
+
+	bool BuiltinGlyphRasterizer::getMetrics(_In_ const std::wstring& /*family*/, _In_ UINT32 size, _Out_ FontMetrics* metrics)
+	{
+		const float scale = static_cast<float>(getBuiltinScale(size));
+		metrics->ascent = BUILTIN_BASELINE * scale;
+		metrics->descent = (BUILTIN_HEIGHT - BUILTIN_BASELINE) * scale;
+		metrics->lineGap = 0.0f;
+		return true;
+	}
+
+	bool BuiltinGlyphRasterizer::rasterize(_In_ const std::wstring& /*family*/, _In_ UINT32 size, _In_ wchar_t character, _Out_ GlyphBitmap* glyph)
+	{
+		const UINT32 scale = getBuiltinScale(size);
+		glyph->advance = static_cast<float>(BUILTIN_WIDTH * scale);
+		glyph->left = 0.0f;
+		glyph->top = -static_cast<float>(BUILTIN_BASELINE * scale);
+		glyph->coverage.clear();
+		glyph->width = glyph->height = 0;
+		if (character == L' ' || character == L'\n' || character == L'\t') return true;
+
+		if (character < L' ' || character > L'~') character = L'?';
+		const UINT16* rows = BUILTIN_FONT[character - L' '];
+
+		glyph->width = BUILTIN_WIDTH * scale;
+		glyph->height = BUILTIN_HEIGHT * scale;
+		glyph->coverage.resize(static_cast<size_t>(glyph->width) * glyph->height);
+		for (UINT32 y = 0; y < glyph->height; y++)
+		{
+			const UINT16 row = rows[y / scale];
+			for (UINT32 x = 0; x < glyph->width; x++)
+			{
+				const UINT32 level = (row >> (2 * (BUILTIN_WIDTH - 1 - x / scale))) & 0x3;
+				glyph->coverage[static_cast<size_t>(y) * glyph->width + x] = static_cast<BYTE>(level * 0x55);
+			}
+		}
+		return true;
+	}
+
+
+
+	/************************/
+	/*		GlyphCache		*/
+	/************************/
+
+
+	GlyphCache::GlyphCache(_Inout_ ResourceTable& resources, _In_opt_ std::unique_ptr<GlyphRasterizer>&& rasterizer)
+		:m_resources(resources), m_pRasterizer(std::move(rasterizer))
+	{
+		if (m_pRasterizer == nullptr) m_pRasterizer = std::make_unique<GdiGlyphRasterizer>();
+	}
+
+	void GlyphCache::releasePages() noexcept
+	{
+		for (Page& page : m_pages)
+			m_resources.unregisterBitmap(page.resource);
+		m_pages.clear();
+		m_glyphs.clear();
+		m_fonts.clear();
+		m_runCount = 0;
+	}
+
+	void GlyphCache::setRasterizer(_In_ std::unique_ptr<GlyphRasterizer>&& rasterizer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		releasePages();
+		m_pRasterizer = rasterizer ? std::move(rasterizer) : std::make_unique<GdiGlyphRasterizer>();
+		m_generation++;
+	}
+
+	FontId GlyphCache::getFont(_In_ const std::wstring& family, _In_ UINT32 size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_fonts.size(); i++)
+			if (m_fonts[i].size == size && m_fonts[i].family == family) return static_cast<FontId>(i);
+
+		FontMetrics metrics;
+		if (!m_pRasterizer->getMetrics(family, size, &metrics)) return INVALID_FONT;
+
+		m_fonts.push_back({ family, size, metrics, {}, {} });
+		return static_cast<FontId>(m_fonts.size() - 1);
+	}
+
+	FontMetrics GlyphCache::getMetrics(_In_ FontId font) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return font < m_fonts.size() ? m_fonts[font].metrics : FontMetrics();
+	}
+
+	bool GlyphCache::allocate(_In_ UINT32 width, _In_ UINT32 height, _Out_ Page** page, _Out_ UINT32* x, _Out_ UINT32* y)
+	{
+		// One pixel of padding: linear sampling doesn't bleed into the neighbours.
+		const UINT32 w = width + 1, h = height + 1;
+		if (w > ATLAS_PAGE_SIZE || h > ATLAS_PAGE_SIZE) return false;
+
+		// Shelf packing: glyphs of a line of text have close heights.
+		Page* last = m_pages.empty() ? nullptr : &m_pages.back();
+		if (last && last->shelfX + w > ATLAS_PAGE_SIZE)
+		{
+			last->shelfY += last->shelfHeight;
+			last->shelfX = 0;
+			last->shelfHeight = 0;
+		}
+		if (last == nullptr || last->shelfY + h > ATLAS_PAGE_SIZE)
+		{
+			m_pages.push_back({});
+			last = &m_pages.back();
+			last->pixels.assign(static_cast<size_t>(ATLAS_PAGE_SIZE) * ATLAS_PAGE_SIZE, Graphics::Pixel(0x00, 0x00));
+			last->resource = m_resources.registerBitmap(last->pixels.data(), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		}
+
+		*page = last;
+		*x = last->shelfX;
+		*y = last->shelfY;
+		last->shelfX += w;
+		last->shelfHeight = (std::max)(last->shelfHeight, h);
+		return true;
+	}
+
+	UINT32 GlyphCache::getGlyph(_Inout_ Font& font, _In_ wchar_t character)
+	{
+		auto it = font.glyphs.find(character);
+		if (it != font.glyphs.end()) return it->second;
+
+		Glyph glyph = { INVALID_RESOURCE, { 0.0f, 0.0f, 0.0f, 0.0f }, 0.0f, 0.0f, 0.0f };
+		if (m_pRasterizer->rasterize(font.family, font.size, character, &m_bitmap))
+		{
+			glyph.left = m_bitmap.left;
+			glyph.top = m_bitmap.top;
+			glyph.advance = m_bitmap.advance;
+
+			Page* page;
+			UINT32 x, y;
+			if (m_bitmap.width > 0 && m_bitmap.height > 0 && allocate(m_bitmap.width, m_bitmap.height, &page, &x, &y))
+			{
+				// White, premultiplied: the alpha is the coverage.
+				for (UINT32 row = 0; row < m_bitmap.height; row++)
+				{
+					Graphics::Pixel* destination = &page->pixels[static_cast<size_t>(y + row) * ATLAS_PAGE_SIZE + x];
+					const BYTE* source = &m_bitmap.coverage[static_cast<size_t>(row) * m_bitmap.width];
+					for (UINT32 column = 0; column < m_bitmap.width; column++)
+						destination[column] = Graphics::Pixel(source[column], source[column]);
+				}
+				page->isDirty = true;
+				glyph.page = page->resource;
+				glyph.source = D2D1::RectF(static_cast<float>(x), static_cast<float>(y),
+					static_cast<float>(x + m_bitmap.width), static_cast<float>(y + m_bitmap.height));
+			}
+		}
+
+		m_glyphs.push_back(glyph);
+		const UINT32 index = static_cast<UINT32>(m_glyphs.size() - 1);
+		font.glyphs[character] = index;
+		return index;
+	}
+
+	const std::vector<UINT32>& GlyphCache::getRun(_Inout_ Font& font, _In_ const std::wstring& text)
+	{
+		auto it = font.runs.find(text);
+		if (it != font.runs.end())
+		{
+			m_stats.runHits++;
+			return it->second;
+		}
+		m_stats.runMisses++;
+
+		if (m_runCount >= m_runLimit)
+		{
+			for (Font& f : m_fonts) f.runs.clear();
+			m_runCount = 0;
+		}
+
+		std::vector<UINT32> run;
+		run.reserve(text.size());
+		for (wchar_t character : text)
+			run.push_back(getGlyph(font, character));
+
+		m_runCount++;
+		return font.runs.emplace(text, std::move(run)).first->second;
+	}
+
+	void GlyphCache::layout(_In_ FontId fontId, _In_ const std::wstring& text, _In_ float maxWidth, _Out_ std::vector<GlyphQuad>* quads, _Out_ D2D1_SIZE_F* size)
+	{
+		PROFILE_ZONE("GlyphCache::layout");
+		std::lock_guard<std::mutex> lock(m_mutex);
+		quads->clear();
+		*size = { 0.0f, 0.0f };
+		if (fontId >= m_fonts.size() || text.empty()) return;
+
+		Font& font = m_fonts[fontId];
+		const std::vector<UINT32>& run = getRun(font, text);
+		const float lineHeight = font.metrics.ascent + font.metrics.descent + font.metrics.lineGap;
+
+		// Line and pen position of each character, rewritten when a word moves to the next line.
+		m_lineOf.resize(text.size());
+		m_penX.resize(text.size());
+
+		float x = 0.0f;
+		float width = 0.0f;
+		UINT32 line = 0;
+		size_t lineStart = 0;
+		size_t lastSpace = std::wstring::npos;
+
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			if (text[i] == L'\n')
+			{
+				m_lineOf[i] = INVALID_LINE;
+				width = (std::max)(width, x);
+				x = 0.0f;
+				line++;
+				lineStart = i + 1;
+				lastSpace = std::wstring::npos;
+				continue;
+			}
+
+			if (maxWidth > 0.0f && text[i] != L' ' && i > lineStart && x + m_glyphs[run[i]].advance > maxWidth)
+			{
+				// Break after the last space of the line, or before this character if the word is too long.
+				if (lastSpace != std::wstring::npos)
+				{
+					width = (std::max)(width, m_penX[lastSpace]);
+					i = lastSpace + 1;
+				}
+				else width = (std::max)(width, x);
+
+				x = 0.0f;
+				line++;
+				lineStart = i;
+				lastSpace = std::wstring::npos;
+			}
+
+			if (text[i] == L' ') lastSpace = i;
+			m_lineOf[i] = line;
+			m_penX[i] = x;
+			x += m_glyphs[run[i]].advance;
+		}
+		width = (std::max)(width, x);
+
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			const Glyph& glyph = m_glyphs[run[i]];
+			if (m_lineOf[i] == INVALID_LINE || glyph.page == INVALID_RESOURCE) continue;
+
+			const float left = m_penX[i] + glyph.left;
+			const float top = static_cast<float>(m_lineOf[i]) * lineHeight + font.metrics.ascent + glyph.top;
+			quads->push_back({ glyph.page,
+				D2D1::RectF(left, top, left + glyph.source.right - glyph.source.left, top + glyph.source.bottom - glyph.source.top),
+				glyph.source });
+		}
+
+		*size = { width, static_cast<float>(line + 1) * lineHeight - font.metrics.lineGap };
+	}
+
+	void GlyphCache::flush()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (Page& page : m_pages)
+		{
+			if (!page.isDirty) continue;
+			m_resources.updateBitmap(page.resource, page.pixels.data(), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+			page.isDirty = false;
+		}
+	}
+
+	GlyphCacheStats GlyphCache::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		GlyphCacheStats stats = m_stats;
+		stats.pages = m_pages.size();
+		stats.glyphs = m_glyphs.size();
+		stats.runs = m_runCount;
+		return stats;
+	}
+
+	GlyphCache::~GlyphCache()
+	{
+		releasePages();
+	}
+
+} // namespace Render
@@ -0,0 +1,271 @@
+#pragma once
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <Windows.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+#pragma comment(lib, "gdi32")
+
+
+namespace Render
+{
+	typedef UINT32 FontId;
+
+	constexpr FontId INVALID_FONT = 0xFFFFFFFF;
+	constexpr UINT32 ATLAS_PAGE_SIZE = 512; // Width and height of an atlas page, in pixels.
+
+	/**
+	 * @brief Vertical metrics of a font, in pixels.
+	 */
+	struct FontMetrics
+	{
+		float ascent = 0.0f;	// From the top of a line to the baseline.
+		float descent = 0.0f;	// From the baseline to the bottom of a line.
+		float lineGap = 0.0f;	// Between two lines.
+	};
+
+	/**
+	 * @brief A glyph rasterized as an 8 bits coverage mask.
+	 */
+	struct GlyphBitmap
+	{
+		std::vector<BYTE> coverage;	// width * height values, row by row, 0xFF for fully covered.
+		UINT32 width = 0;
+		UINT32 height = 0;
+		float left = 0.0f;			// From the pen position to the left of the mask.
+		float top = 0.0f;			// From the baseline to the top of the mask, negative above it.
+		float advance = 0.0f;		// From the pen position to the next one.
+	};
+
+
+	/**
+	 * @brief Turns characters into coverage masks.
+	 *
+	 * @note Only called by the glyph cache, once per font and character.
+	 */
+	class GlyphRasterizer
+	{
+	public:
+		virtual ~GlyphRasterizer() = default;
+
+		/**
+		 * @brief Return the metrics of a font.
+		 *
+		 * @param[in] family	The font family.
+		 * @param[in] size		The height of the em square, in pixels.
+		 * @param[out] metrics	The metrics of the font.
+		 *
+		 * @retval bool
+		 * @return True on success, false if the font can't be used.
+		 */
+		virtual bool getMetrics(_In_ const std::wstring& family, _In_ UINT32 size, _Out_ FontMetrics* metrics) = 0;
+
+		/**
+		 * @brief Rasterize a character.
+		 *
+		 * @param[in] family	The font family.
+		 * @param[in] size		The height of the em square, in pixels.
+		 * @param[in] character	The UTF-16 code unit to rasterize.
+		 * @param[out] glyph	The glyph, with an empty mask for blank characters.
+		 *
+		 * @retval bool
+		 * @return True on success, false if the character can't be rasterized.
+		 */
+		virtual bool rasterize(_In_ const std::wstring& family, _In_ UINT32 size, _In_ wchar_t character, _Out_ GlyphBitmap* glyph) = 0;
+	};
+
+
+	/**
+	 * @brief Rasterize with GDI, from the fonts installed on the system.
+	 */
+	class GdiGlyphRasterizer : public GlyphRasterizer
+	{
+	private:
+		HDC m_hdc = NULL;
+		std::map<std::pair<std::wstring, UINT32>, HFONT> m_fonts;
+		std::vector<BYTE> m_buffer; // Reused between glyphs.
+
+		HFONT selectFont(_In_ const std::wstring& family, _In_ UINT32 size);
+
+	public:
+		GdiGlyphRasterizer();
+		GdiGlyphRasterizer(GdiGlyphRasterizer&) = delete;
+		GdiGlyphRasterizer& operator=(const GdiGlyphRasterizer&) = delete;
+
+		bool getMetrics(_In_ const std::wstring& family, _In_ UINT32 size, _Out_ FontMetrics* metrics) override;
+		bool rasterize(_In_ const std::wstring& family, _In_ UINT32 size, _In_ wchar_t character, _Out_ GlyphBitmap* glyph) override;
+
+		~GdiGlyphRasterizer();
+	};
+
+
+	/**
+	 * @brief Rasterize with a bundled 8x16 font, whatever the family.
+	 *
+	 * @note Does not depend on the system: meant for tests and offscreen rendering.
+	 *       The font is scaled by a whole factor, the closest to size / 16.
+	 *       Characters outside of printable ASCII are drawn as '?'.
+	 */
+	class BuiltinGlyphRasterizer : public GlyphRasterizer
+	{
+	public:
+		bool getMetrics(_In_ const std::wstring& family, _In_ UINT32 size, _Out_ FontMetrics* metrics) override;
+		bool rasterize(_In_ const std::wstring& family, _In_ UINT32 size, _In_ wchar_t character, _Out_ GlyphBitmap* glyph) override;
+	};
+
+
+	/**
+	 * @brief A glyph placed relatively to the origin of a text: the top left corner of its first line.
+	 */
+	struct GlyphQuad
+	{
+		ResourceId page;
+		D2D1_RECT_F destination;
+		D2D1_RECT_F source;		// In page pixels.
+	};
+
+	struct GlyphCacheStats
+	{
+		size_t pages = 0;
+		size_t glyphs = 0;
+		size_t runs = 0;
+		UINT64 runHits = 0;		// Layouts that found their string already shaped.
+		UINT64 runMisses = 0;
+	};
+
+
+	/**
+	 * @brief Glyphs and shaped strings shared by all the texts of a window.
+	 *
+	 * @note Each glyph is rasterized once per font, into atlas pages registered in the resource table,
+	 *       so a text is drawn as a batch of quads from a few bitmaps. The advances of each string
+	 *       are cached per font: texts sharing a string only pay for the line breaking.
+	 *       The methods are thread safe, so texts can lay out while recording in parallel.
+	 */
+	class GlyphCache
+	{
+	private:
+		static constexpr UINT32 INVALID_LINE = 0xFFFFFFFF;
+
+		struct Glyph
+		{
+			ResourceId page;
+			D2D1_RECT_F source;	// Empty for blank glyphs.
+			float left, top;
+			float advance;
+		};
+
+		struct Font
+		{
+			std::wstring family;
+			UINT32 size;
+			FontMetrics metrics;
+			std::unordered_map<wchar_t, UINT32> glyphs;				// Index in m_glyphs.
+			std::unordered_map<std::wstring, std::vector<UINT32>> runs;	// Glyph indexes of each string.
+		};
+
+		struct Page
+		{
+			std::vector<Graphics::Pixel> pixels;	// Allocated once: the resource table points to it.
+			ResourceId resource = INVALID_RESOURCE;
+			UINT32 shelfX = 0, shelfY = 0, shelfHeight = 0;
+			bool isDirty = false;
+		};
+
+		ResourceTable& m_resources;
+		std::unique_ptr<GlyphRasterizer> m_pRasterizer;
+		std::vector<Font> m_fonts;
+		std::vector<Glyph> m_glyphs;
+		std::vector<Page> m_pages;
+		GlyphBitmap m_bitmap;				// Reused between glyphs.
+		std::vector<UINT32> m_lineOf;		// Reused between layouts.
+		std::vector<float> m_penX;
+		size_t m_runCount = 0;
+		size_t m_runLimit = 4096;
+		UINT32 m_generation = 0;
+		GlyphCacheStats m_stats;
+		mutable std::mutex m_mutex;
+
+		UINT32 getGlyph(_Inout_ Font& font, _In_ wchar_t character);
+		const std::vector<UINT32>& getRun(_Inout_ Font& font, _In_ const std::wstring& text);
+		bool allocate(_In_ UINT32 width, _In_ UINT32 height, _Out_ Page** page, _Out_ UINT32* x, _Out_ UINT32* y);
+		void releasePages() noexcept;
+
+	public:
+		/**
+		 * @brief Constructor for GlyphCache.
+		 *
+		 * @param[in] resources		The table the atlas pages are registered in.
+		 * @param[in] rasterizer	The rasterizer to use, nullptr for GdiGlyphRasterizer.
+		 */
+		explicit GlyphCache(_Inout_ ResourceTable& resources, _In_opt_ std::unique_ptr<GlyphRasterizer>&& rasterizer = nullptr);
+
+		GlyphCache(GlyphCache&) = delete;
+		GlyphCache& operator=(const GlyphCache&) = delete;
+
+		/**
+		 * @brief Replace the rasterizer, emptying the cache.
+		 *
+		 * @note The generation changes: texts lay out again on their next record.
+		 */
+		void setRasterizer(_In_ std::unique_ptr<GlyphRasterizer>&& rasterizer);
+
+		/**
+		 * @brief Return the id of a font, loading it on first use.
+		 *
+		 * @retval FontId
+		 * @return The font's id, or INVALID_FONT if the rasterizer can't use it.
+		 */
+		FontId getFont(_In_ const std::wstring& family, _In_ UINT32 size);
+
+		FontMetrics getMetrics(_In_ FontId font) const;
+
+		/**
+		 * @brief Place the glyphs of a string, rasterizing the missing ones.
+		 *
+		 * @param[in] font		The font to use.
+		 * @param[in] text		The string, '\n' starts a new line.
+		 * @param[in] maxWidth	Lines are broken between words to fit, zero to only break on '\n'.
+		 * @param[out] quads	The glyphs, relative to the top left corner of the first line.
+		 * @param[out] size		The size of the text.
+		 */
+		void layout(_In_ FontId font, _In_ const std::wstring& text, _In_ float maxWidth, _Out_ std::vector<GlyphQuad>* quads, _Out_ D2D1_SIZE_F* size);
+
+		/**
+		 * @brief Give the new glyphs to the resource table.
+		 *
+		 * @note Called once per frame, after recording: each page that received glyphs is uploaded again once.
+		 */
+		void flush();
+
+		/**
+		 * @brief Set the number of shaped strings kept, all are dropped when exceeded.
+		 */
+		inline void setRunLimit(_In_ size_t limit) noexcept { m_runLimit = limit; }
+
+		/**
+		 * @brief Return a number that changes whenever the placed glyphs become invalid.
+		 */
+		inline UINT32 getGeneration() const noexcept { return m_generation; }
+
+		GlyphCacheStats getStats() const;
+
+		~GlyphCache();
+	};
+
+} // namespace Render
+
+#endif // GLYPH_CACHE_H
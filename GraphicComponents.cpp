@@ -8,8 +8,13 @@
 #include <minwindef.h> // BYTE
 #include <d2d1.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "fctdef.h"
 #include "EventHandler.h"
+#include "ImageDecoder.h"
+#include "Profiler.h"
 #include "WindowClass.h"
 
 #pragma comment(lib, "d2d1")
@@ -19,6 +24,76 @@ namespace Graphics
 {
 
 
+	/************************/
+	/*		Component		*/
+	/************************/
+
+
+	void Component::attachTransform(_Inout_ TransformStore& store)
+	{
+		if (m_pTransforms == &store) return;
+
+		detachFromScene();
+		const D2D1_POINT_2F pos = getPos();
+		detachTransform();
+		m_transform = store.create(pos);
+		store.setScale(m_transform, m_scale);
+		store.setSize(m_transform, m_boundsSize);
+		m_pTransforms = &store;
+	}
+
+	void Component::detachTransform() noexcept
+	{
+		if (m_pTransforms == nullptr) return;
+
+		m_position = m_pTransforms->getPos(m_transform);
+		m_scale = m_pTransforms->getScale(m_transform);
+		m_pTransforms->destroy(m_transform);
+		m_pTransforms = nullptr;
+		m_transform = INVALID_TRANSFORM;
+	}
+
+	void Component::attachToScene(_Inout_ SceneGraph& scene, _In_opt_ NodeId parent)
+	{
+		if (m_pScene == &scene)
+		{
+			scene.setParent(m_node, parent);
+			return;
+		}
+
+		const D2D1_POINT_2F pos = getPos();
+		const D2D1_SIZE_F scale = getScale();
+		detachTransform();
+		detachFromScene();
+
+		LocalTransform local;
+		local.position = pos;
+		local.scale = scale;
+		m_node = scene.create(parent, local, this);
+		scene.setSize(m_node, m_boundsSize); // Set by initialize, usually before the component is attached.
+		m_pScene = &scene;
+	}
+
+	void Component::detachFromScene() noexcept
+	{
+		if (m_pScene == nullptr) return;
+
+		m_position = getWorldPos();
+		m_scale = getWorldScale();
+		m_pScene->destroy(m_node);
+		m_pScene = nullptr;
+		m_node = INVALID_NODE;
+	}
+
+	const D2D1_SIZE_F Component::getWorldScale() noexcept
+	{
+		if (m_pScene == nullptr) return getScale();
+		const Affine& world = m_pScene->getWorld(m_node);
+		return { std::hypot(world.m11, world.m12), std::hypot(world.m21, world.m22) };
+	}
+
+
+
 	/********************/
 	/*		 Image		*/
 	/********************/
@@ -28,12 +103,23 @@ namespace Graphics
 
 	Image::Image(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName)
 	{
+		PROFILE_ZONE("Image::load");
 		__super::setPos(pos);
 
-		const unsigned int width = 100;
-		const unsigned int height = 100;
+		Codec::DecodedImage decoded;
+		if (imageName && Codec::loadImage(imageName, decoded, false))
+		{
+			m_width = static_cast<int>(decoded.width);
+			m_height = static_cast<int>(decoded.height);
+			m_memory = std::move(decoded.frames.front().pixels);
+			return;
+		}
+
+		// A placeholder when the file cannot be read or decoded.
+		m_width = 100;
+		m_height = 100;
 
-		const int SIZE = width * height;
+		const int SIZE = m_width * m_height;
 		m_memory.reserve(SIZE);
 
 		for (int i = 0; i < SIZE; i++)
@@ -48,8 +134,14 @@ namespace Graphics
 		:Image({ 0.0f, 0.0f }, imageName)
 	{}
 
+	Image::Image(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName, _In_ BYTE collisionThreshold)
+		:Image(pos, imageName)
+	{
+		m_collisionMask = CollisionMask::getShared(imageName ? imageName : L"", m_memory.data(), m_width, m_height, collisionThreshold);
+	}
 
-	Image::Image(_In_ D2D1_POINT_2F pos, _In_ IWICFormatConverter* pConverter)
+
+	Image::Image(_In_ D2D1_POINT_2F pos, _In_ IWICFormatConverter* /*pConverter*/)
 	{
 		__super::setPos(pos);
 	}
@@ -57,15 +149,27 @@ namespace Graphics
 	Image::Image(Image& other) noexcept
 	{
 		this->setPos(other.getPos());
-		m_memory = other.m_memory;
-		m_pBitmap = other.m_pBitmap;
+		copyPixels(other);
+		m_width = other.m_width;
+		m_height = other.m_height;
+		m_opacity = other.m_opacity;
+		m_isOpaque = other.m_isOpaque;
+		m_collisionMask = other.m_collisionMask;
 	}
 
 	Image::Image(Image&& other) noexcept
 	{
 		this->setPos(other.getPos());
 		m_memory = std::move(other.m_memory);
-		m_pBitmap = other.m_pBitmap;
+		m_width = other.m_width;
+		m_height = other.m_height;
+		m_opacity = other.m_opacity;
+		m_window = other.m_window;
+		m_resource = other.m_resource;
+		m_isCompressed = other.m_isCompressed;
+		m_isOpaque = other.m_isOpaque;
+		m_collisionMask = std::move(other.m_collisionMask);
+		other.m_resource = Render::INVALID_RESOURCE;
 	}
 
 	/**** Operators ****/
@@ -73,8 +177,28 @@ namespace Graphics
 	Image& Image::operator=(Image& other) noexcept
 	{
 		this->setPos(other.getPos());
-		m_memory = other.m_memory;
-		m_pBitmap = other.m_pBitmap;
+		copyPixels(other);
+		m_width = other.m_width;
+		m_height = other.m_height;
+		m_opacity = other.m_opacity;
+		m_isOpaque = other.m_isOpaque;
+		m_collisionMask = other.m_collisionMask;
+
+		// The resource now points to the new pixels.
+		if (m_window && m_resource != Render::INVALID_RESOURCE)
+		{
+			Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+			if (m_isCompressed)
+			{
+				resources.unregisterBitmap(m_resource);
+				m_resource = resources.registerCompressedBitmap(m_memory.data(), m_width, m_height);
+				std::vector<Pixel>().swap(m_memory);
+			}
+			else
+			{
+				resources.updateBitmap(m_resource, m_memory.data(), m_width, m_height);
+			}
+		}
 		return *this;
 	}
 
@@ -82,45 +206,425 @@ namespace Graphics
 	{
 		if (this != &other)
 		{
+			if (m_window && m_resource != Render::INVALID_RESOURCE)
+				reinterpret_cast<BaseWindow*>(m_window)->getResources().unregisterBitmap(m_resource);
+
 			this->setPos(other.getPos());
 			m_memory = std::move(other.m_memory);
-			m_pBitmap = other.m_pBitmap;
+			m_width = other.m_width;
+			m_height = other.m_height;
+			m_opacity = other.m_opacity;
+			m_window = other.m_window;
+			m_resource = other.m_resource;
+			m_isCompressed = other.m_isCompressed;
+			m_isOpaque = other.m_isOpaque;
+			m_collisionMask = std::move(other.m_collisionMask);
+			other.m_resource = Render::INVALID_RESOURCE;
 		}
 		return *this;
 	}
 
 	/**** Methods ****/
 
-	void Image::draw(_In_ HWND hwnd, _In_ ID2D1HwndRenderTarget* renderTarget)
+	bool Image::initialize(void* window) noexcept
 	{
-		if (m_pBitmap == nullptr)
+		if (!__super::initialize(window)) return false;
+
+		if (m_resource == Render::INVALID_RESOURCE)
 		{
-			D2D1_BITMAP_PROPERTIES properties = D2D1::BitmapProperties();
-			properties.pixelFormat.format = DXGI_FORMAT_B8G8R8A8_UNORM;
-			properties.pixelFormat.alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED;
-			throwOnFail(renderTarget->CreateBitmap({ 400, 400 }, reinterpret_cast<void*>(m_memory.data()), 10 * 4, properties, &m_pBitmap));
+			m_isOpaque = !m_memory.empty() && std::all_of(m_memory.begin(), m_memory.end(), [](const Pixel& pixel) { return pixel.a == 0xFF; });
+
+			BaseWindow* pWindow = reinterpret_cast<BaseWindow*>(window);
+			if (pWindow->isImageCompressionEnabled() && !m_memory.empty())
+			{
+				// Only the compressed copy is kept.
+				m_resource = pWindow->getResources().registerCompressedBitmap(m_memory.data(), m_width, m_height);
+				std::vector<Pixel>().swap(m_memory);
+				m_isCompressed = true;
+			}
+			else
+			{
+				m_resource = pWindow->getResources().registerBitmap(m_memory.data(), m_width, m_height);
+			}
 		}
+		setBoundsSize(getSize());
+		return true;
+	}
+
+	void Image::record(_Inout_ Render::CommandList& commands)
+	{
 		D2D1_SIZE_F size = getSize();
-		D2D1_POINT_2F pos = getPos();
+		D2D1_SIZE_F scale = getWorldScale();
+		D2D1_POINT_2F pos = getWorldPos();
+
+		size.width *= scale.width;
+		size.height *= scale.height;
 
 		D2D1_RECT_F rect({ pos.x, pos.y, pos.x + size.width, pos.y + size.height });
 
-		renderTarget->DrawBitmap(m_pBitmap, rect);
+		commands.drawBitmap(m_resource, rect, m_opacity);
+		if (m_isOpaque && m_opacity >= 1.0f) commands.occlude(rect);
 	}
 
 	void Image::reconstruct() noexcept
 	{
-		m_pBitmap = nullptr;
+		// The device bitmap is owned by the window's resource table.
+	}
+
+	D2D1_SIZE_F Image::getSize() const noexcept
+	{
+		return { static_cast<float>(m_width), static_cast<float>(m_height) };
+	}
+
+	const Pixel* Image::getPixels() const
+	{
+		if (!m_isCompressed) return m_memory.data();
+		return reinterpret_cast<BaseWindow*>(m_window)->getResources().getPixels(m_resource);
+	}
+
+	void Image::copyPixels(_In_ const Image& other)
+	{
+		if (!other.m_isCompressed)
+		{
+			m_memory = other.m_memory;
+			return;
+		}
+
+		const Pixel* pixels = other.getPixels();
+		if (pixels) m_memory.assign(pixels, pixels + static_cast<size_t>(other.m_width) * other.m_height);
+		else m_memory.clear();
+	}
+
+	void Image::buildCollisionMask(_In_opt_ BYTE threshold)
+	{
+		const Pixel* pixels = getPixels();
+		if (pixels) m_collisionMask = std::make_shared<const CollisionMask>(pixels, m_width, m_height, threshold);
+		else m_collisionMask.reset();
+	}
+
+	bool Image::overlaps(_In_ Image& other) noexcept
+	{
+		if (!m_collisionMask || !other.m_collisionMask) return false;
+
+		const D2D1_POINT_2F pos = getWorldPos();
+		const D2D1_POINT_2F otherPos = other.getWorldPos();
+		return m_collisionMask->overlaps(*other.m_collisionMask, std::lround(otherPos.x) - std::lround(pos.x), std::lround(otherPos.y) - std::lround(pos.y));
 	}
 
-	D2D1_SIZE_F Image::getSize()
+	void Image::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
 	{
-		if (m_pBitmap == nullptr) return { 0.0f, 0.0f };
-		return m_pBitmap->GetSize();
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
 	}
 
 	Image::~Image()
 	{
+		if (m_window && m_resource != Render::INVALID_RESOURCE)
+			reinterpret_cast<BaseWindow*>(m_window)->getResources().unregisterBitmap(m_resource);
+	}
+
+
+
+	/********************/
+	/*		 Text		*/
+	/********************/
+
+
+	/**** Constructors ****/
+
+	Text::Text(_In_ const D2D1_POINT_2F& pos, _In_ const std::wstring& text, _In_opt_ const std::wstring& family, _In_opt_ UINT32 size, _In_opt_ UINT32 color)
+		:m_text(text), m_family(family), m_fontSize(size), m_color(color)
+	{
+		__super::setPos(pos);
+	}
+
+	/**** Methods ****/
+
+	void Text::layout()
+	{
+		Render::GlyphCache& glyphs = reinterpret_cast<BaseWindow*>(m_window)->getGlyphCache();
+
+		// Fonts and glyphs are dropped when the cache changes its rasterizer.
+		if (m_font == Render::INVALID_FONT || m_generation != glyphs.getGeneration())
+		{
+			m_generation = glyphs.getGeneration();
+			m_font = glyphs.getFont(m_family, m_fontSize);
+		}
+
+		glyphs.layout(m_font, m_text, m_maxWidth, &m_quads, &m_layoutSize);
+		setBoundsSize(m_layoutSize);
+		m_isLayoutDirty = false;
+	}
+
+	bool Text::initialize(void* window) noexcept
+	{
+		if (!__super::initialize(window)) return false;
+
+		m_isLayoutDirty = true;
+		layout();
+		return true;
+	}
+
+	void Text::record(_Inout_ Render::CommandList& commands)
+	{
+		if (m_window == nullptr) return;
+		if (m_isLayoutDirty || m_generation != reinterpret_cast<BaseWindow*>(m_window)->getGlyphCache().getGeneration()) layout();
+
+		const D2D1_SIZE_F scale = getWorldScale();
+		const D2D1_POINT_2F pos = getWorldPos();
+
+		for (const Render::GlyphQuad& quad : m_quads)
+		{
+			const D2D1_RECT_F rect = {
+				pos.x + quad.destination.left * scale.width,
+				pos.y + quad.destination.top * scale.height,
+				pos.x + quad.destination.right * scale.width,
+				pos.y + quad.destination.bottom * scale.height
+			};
+			commands.drawMask(quad.page, rect, quad.source, m_color, m_opacity);
+		}
+	}
+
+	void Text::reconstruct() noexcept
+	{
+		// The atlas pages are owned by the window's resource table.
+	}
+
+	void Text::setText(_In_ const std::wstring& text)
+	{
+		if (text == m_text) return;
+		m_text = text;
+		m_isLayoutDirty = true;
+	}
+
+	void Text::setFont(_In_ const std::wstring& family, _In_ UINT32 size)
+	{
+		if (family == m_family && size == m_fontSize) return;
+		m_family = family;
+		m_fontSize = size;
+		m_font = Render::INVALID_FONT;
+		m_isLayoutDirty = true;
+	}
+
+	void Text::setMaxWidth(_In_ float width) noexcept
+	{
+		if (width == m_maxWidth) return;
+		m_maxWidth = width;
+		m_isLayoutDirty = true;
+	}
+
+	D2D1_SIZE_F Text::getSize()
+	{
+		if (m_window && m_isLayoutDirty) layout();
+		return m_layoutSize;
+	}
+
+	void Text::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
+	}
+
+
+
+	/********************/
+	/*		 Shape		*/
+	/********************/
+
+
+	/**** Constructors ****/
+
+	Shape::Shape(_In_ const D2D1_POINT_2F& pos, _In_ UINT32 fillColor)
+		:m_fillColor(fillColor)
+	{
+		__super::setPos(pos);
+	}
+
+	/**** Methods ****/
+
+	void Shape::buildGeometries(_In_ const D2D1_SIZE_F& scale)
+	{
+		Render::GeometryCache& geometries = reinterpret_cast<BaseWindow*>(m_window)->getResources().getGeometries();
+		releaseGeometries();
+
+		Render::ShapeDesc desc = describe(scale);
+		const bool isOpen = desc.type == Render::ShapeType::Polyline && !desc.closed;
+		if (m_fillColor != 0 && !isOpen)
+		{
+			m_fill = geometries.acquire(desc);
+			m_fillBounds = geometries.getBounds(m_fill);
+		}
+		m_isFillRectangle = m_fill != Render::INVALID_GEOMETRY && desc.type == Render::ShapeType::Rectangle;
+		if (m_strokeColor != 0 && m_strokeWidth > 0.0f)
+		{
+			// The outline follows the shape's scale, like its size.
+			desc.strokeWidth = m_strokeWidth * (std::max)(scale.width, scale.height);
+			m_stroke = geometries.acquire(desc);
+			m_strokeBounds = geometries.getBounds(m_stroke);
+		}
+
+		setBoundsSize({ desc.width / (std::max)(scale.width, 1e-6f), desc.height / (std::max)(scale.height, 1e-6f) });
+		m_geometryScale = scale;
+		m_isGeometryDirty = false;
+	}
+
+	void Shape::releaseGeometries() noexcept
+	{
+		Render::GeometryCache& geometries = reinterpret_cast<BaseWindow*>(m_window)->getResources().getGeometries();
+		if (m_fill != Render::INVALID_GEOMETRY) geometries.release(m_fill);
+		if (m_stroke != Render::INVALID_GEOMETRY) geometries.release(m_stroke);
+		m_fill = Render::INVALID_GEOMETRY;
+		m_stroke = Render::INVALID_GEOMETRY;
+	}
+
+	bool Shape::initialize(void* window) noexcept
+	{
+		if (!__super::initialize(window)) return false;
+
+		m_isGeometryDirty = true;
+		return true;
+	}
+
+	void Shape::record(_Inout_ Render::CommandList& commands)
+	{
+		if (m_window == nullptr) return;
+
+		const D2D1_SIZE_F scale = getWorldScale();
+		if (m_isGeometryDirty || scale.width != m_geometryScale.width || scale.height != m_geometryScale.height)
+			buildGeometries(scale);
+
+		const D2D1_POINT_2F pos = getWorldPos();
+		if (m_fill != Render::INVALID_GEOMETRY)
+		{
+			const D2D1_RECT_F rect = { pos.x + m_fillBounds.left, pos.y + m_fillBounds.top, pos.x + m_fillBounds.right, pos.y + m_fillBounds.bottom };
+			commands.fillGeometry(m_fill, rect, m_fillColor, m_opacity);
+			if (m_isFillRectangle && (m_fillColor >> 24) == 0xFF && m_opacity >= 1.0f) commands.occlude(rect);
+		}
+		if (m_stroke != Render::INVALID_GEOMETRY)
+		{
+			const D2D1_RECT_F rect = { pos.x + m_strokeBounds.left, pos.y + m_strokeBounds.top, pos.x + m_strokeBounds.right, pos.y + m_strokeBounds.bottom };
+			commands.fillGeometry(m_stroke, rect, m_strokeColor, m_opacity);
+		}
+	}
+
+	void Shape::reconstruct() noexcept
+	{
+		// The geometries are owned by the window's resource table, and don't depend on the render target.
+	}
+
+	void Shape::setStroke(_In_ UINT32 color, _In_ float width) noexcept
+	{
+		m_strokeColor = color;
+		m_strokeWidth = width;
+		m_isGeometryDirty = true;
+	}
+
+	void Shape::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
+	}
+
+	Shape::~Shape()
+	{
+		if (m_window) releaseGeometries();
+	}
+
+
+
+	/****************************/
+	/*		RectangleShape		*/
+	/****************************/
+
+
+	RectangleShape::RectangleShape(_In_ const D2D1_POINT_2F& pos, _In_ const D2D1_SIZE_F& size, _In_ UINT32 fillColor, _In_opt_ float radiusX, _In_opt_ float radiusY)
+		:Shape(pos, fillColor), m_size(size), m_radiusX(radiusX), m_radiusY(radiusY)
+	{}
+
+	Render::ShapeDesc RectangleShape::describe(_In_ const D2D1_SIZE_F& scale) const
+	{
+		Render::ShapeDesc desc;
+		desc.type = m_radiusX > 0.0f && m_radiusY > 0.0f ? Render::ShapeType::RoundedRectangle : Render::ShapeType::Rectangle;
+		desc.width = m_size.width * scale.width;
+		desc.height = m_size.height * scale.height;
+		if (desc.type == Render::ShapeType::RoundedRectangle)
+		{
+			desc.radiusX = m_radiusX * scale.width;
+			desc.radiusY = m_radiusY * scale.height;
+		}
+		return desc;
+	}
+
+	void RectangleShape::setSize(_In_ const D2D1_SIZE_F& size) noexcept
+	{
+		m_size = size;
+		invalidateGeometry();
+	}
+
+	void RectangleShape::setCornerRadius(_In_ float radiusX, _In_ float radiusY) noexcept
+	{
+		m_radiusX = radiusX;
+		m_radiusY = radiusY;
+		invalidateGeometry();
+	}
+
+
+
+	/****************************/
+	/*		 EllipseShape		*/
+	/****************************/
+
+
+	EllipseShape::EllipseShape(_In_ const D2D1_POINT_2F& pos, _In_ const D2D1_SIZE_F& size, _In_ UINT32 fillColor)
+		:Shape(pos, fillColor), m_size(size)
+	{}
+
+	Render::ShapeDesc EllipseShape::describe(_In_ const D2D1_SIZE_F& scale) const
+	{
+		Render::ShapeDesc desc;
+		desc.type = Render::ShapeType::Ellipse;
+		desc.width = m_size.width * scale.width;
+		desc.height = m_size.height * scale.height;
+		return desc;
+	}
+
+	void EllipseShape::setSize(_In_ const D2D1_SIZE_F& size) noexcept
+	{
+		m_size = size;
+		invalidateGeometry();
+	}
+
+
+
+	/************************/
+	/*		 PathShape		*/
+	/************************/
+
+
+	PathShape::PathShape(_In_ const D2D1_POINT_2F& pos, _In_ const std::vector<D2D1_POINT_2F>& points, _In_ bool closed, _In_opt_ UINT32 fillColor)
+		:Shape(pos, fillColor), m_points(points), m_isClosed(closed)
+	{}
+
+	Render::ShapeDesc PathShape::describe(_In_ const D2D1_SIZE_F& scale) const
+	{
+		Render::ShapeDesc desc;
+		desc.type = Render::ShapeType::Polyline;
+		desc.closed = m_isClosed;
+		desc.points.reserve(m_points.size());
+		for (const D2D1_POINT_2F& point : m_points)
+		{
+			desc.points.push_back({ point.x * scale.width, point.y * scale.height });
+			desc.width = (std::max)(desc.width, point.x * scale.width);
+			desc.height = (std::max)(desc.height, point.y * scale.height);
+		}
+		return desc;
+	}
+
+	void PathShape::setPoints(_In_ const std::vector<D2D1_POINT_2F>& points, _In_ bool closed)
+	{
+		m_points = points;
+		m_isClosed = closed;
+		invalidateGeometry();
 	}
 
 
@@ -181,10 +685,10 @@ namespace Graphics
 	/**** Methods ****/
 
 	/*
-	void AnimatedImage::draw(_In_ HWND hwnd, _In_ ID2D1HwndRenderTarget* renderTarget)
+	void AnimatedImage::record(_Inout_ Render::CommandList& commands)
 	{
 		std::unique_ptr<Image>& im = m_images[m_currentFrame];
-		im->draw(hwnd, renderTarget);
+		im->record(commands);
 		//m_currentFrame = (m_currentFrame + 1) % (m_nbFrame);
 	}
 
@@ -9,10 +9,17 @@
 #include <WinUser.h>
 #include <wincodec.h>
 #include <minwindef.h> // BYTE
+#include <string>
 #include <vector>
 
 #include <d2d1.h>
 
+#include "Animation.h"
+#include "CollisionMask.h"
+#include "GlyphCache.h"
+#include "RenderCommands.h"
+#include "SceneGraph.h"
+#include "TransformStore.h"
 #include "fctdef.h"
 
 #pragma comment (lib, "d2d1")
@@ -57,10 +64,13 @@ namespace Graphics
 		ID2D1Factory* pFactory = nullptr;
 		ID2D1HwndRenderTarget* pRenderTarget = nullptr;
 
+		/**
+		 * @brief Create a multithreaded factory: with threaded rendering, the main loop and the render thread both use its resources.
+		 */
 		inline HRESULT CreateFactory()
 		{
 			D2D1_FACTORY_OPTIONS option(D2D1_DEBUG_LEVEL_WARNING); //TODO: remove
-			return D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, __uuidof(ID2D1Factory), &option, reinterpret_cast<void**>(&pFactory));
+			return D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, __uuidof(ID2D1Factory), &option, reinterpret_cast<void**>(&pFactory));
 		}
 
 		inline HRESULT CreateRenderTarget(_In_ HWND hwnd)
@@ -113,15 +123,42 @@ namespace Graphics
 	{
 	private:
 		D2D1_POINT_2F m_position = { .0f, .0f };
+		D2D1_SIZE_F m_scale = { 1.0f, 1.0f };
+		TransformStore* m_pTransforms = nullptr;
+		TransformIndex m_transform = INVALID_TRANSFORM;
+		SceneGraph* m_pScene = nullptr;
+		NodeId m_node = INVALID_NODE;
+		AnimationEngine* m_pAnimations = nullptr; // Set when a track animates the component.
+		TrackId m_firstTrack = INVALID_TRACK; // Its running tracks, linked by the engine.
+		D2D1_SIZE_F m_boundsSize = { 0.0f, 0.0f }; // Given to the transform store or the scene graph the component moves to.
+
+		friend class AnimationEngine;
 
 	protected:
 		void* m_window = nullptr;
 
 		Component() = default;
 
+		/**
+		 * @brief Set the unscaled size used to compute the bounds in the transform store, or to hit test in the scene graph.
+		 */
+		inline void setBoundsSize(_In_ const D2D1_SIZE_F& size) noexcept
+		{
+			m_boundsSize = size;
+			if (m_pTransforms) m_pTransforms->setSize(m_transform, size);
+			if (m_pScene) m_pScene->setSize(m_node, size);
+		}
+
 	public:
 		Component(_In_ D2D1_POINT_2F position) : m_position(position) {}
 
+		virtual ~Component()
+		{
+			if (m_pAnimations) m_pAnimations->cancel(this);
+			detachTransform();
+			detachFromScene();
+		}
+
 		/**
 		 * @brief Initialize the component.
 		 *
@@ -133,10 +170,100 @@ namespace Graphics
 		 * @retval bool
 		 * @return True if the component should be added to the window, false otherwise.
 		 */
-		virtual bool initialize(void* window) noexcept { return m_window = window; }
+		virtual bool initialize(void* window) noexcept { return (m_window = window) != nullptr; }
+
+		/**
+		 * @brief Move the transform of the component into a transform store.
+		 *
+		 * @note The position is kept. getPos and setPos then read and write the store.
+		 *       The component leaves its scene graph, if any.
+		 *
+		 * @param[in] store The store to move the transform to.
+		 */
+		void attachTransform(_Inout_ TransformStore& store);
+
+		/**
+		 * @brief Move the transform of the component out of its transform store, if any.
+		 */
+		void detachTransform() noexcept;
+
+		/**
+		 * @brief Give the component a node in a scene graph.
+		 *
+		 * @note The position becomes relative to the parent node: getPos and setPos then read and write
+		 *       the local transform, getWorldPos returns the absolute position.
+		 *       The component leaves its transform store, if any.
+		 *
+		 * @param[in] scene		The scene graph.
+		 * @param[in] parent	The parent node, INVALID_NODE for a root.
+		 */
+		void attachToScene(_Inout_ SceneGraph& scene, _In_opt_ NodeId parent = INVALID_NODE);
+
+		/**
+		 * @brief Remove the component's node from its scene graph, if any, keeping its absolute position.
+		 */
+		void detachFromScene() noexcept;
+
+		inline const D2D1_POINT_2F getPos() noexcept
+		{
+			if (m_pScene) return m_pScene->getLocal(m_node).position;
+			return m_pTransforms ? m_pTransforms->getPos(m_transform) : m_position;
+		}
+
+		inline void setPos(const D2D1_POINT_2F& pos) noexcept
+		{
+			if (m_pScene) m_pScene->setPosition(m_node, pos);
+			else if (m_pTransforms) m_pTransforms->setPos(m_transform, pos);
+			else m_position = pos;
+		}
+
+		inline const D2D1_SIZE_F getScale() noexcept
+		{
+			if (m_pScene) return m_pScene->getLocal(m_node).scale;
+			return m_pTransforms ? m_pTransforms->getScale(m_transform) : m_scale;
+		}
+
+		inline void setScale(const D2D1_SIZE_F& scale) noexcept
+		{
+			if (m_pScene)
+			{
+				LocalTransform local = m_pScene->getLocal(m_node);
+				local.scale = scale;
+				m_pScene->setLocal(m_node, local);
+			}
+			else if (m_pTransforms) m_pTransforms->setScale(m_transform, scale);
+			else m_scale = scale;
+		}
+
+		/**
+		 * @brief Write a property specific to the component, animated by an AnimationEngine.
+		 *
+		 * @note Positions and scales are written directly: only the other properties get here.
+		 *
+		 * @param[in] property	The animated property.
+		 * @param[in] value		Its new value.
+		 */
+		virtual void setAnimatedValue(_In_ AnimatedProperty /*property*/, _In_ float /*value*/) noexcept {}
+
+		/**
+		 * @brief Return the absolute position, from the world transform of the last scene graph update.
+		 */
+		inline const D2D1_POINT_2F getWorldPos() noexcept
+		{
+			if (m_pScene == nullptr) return getPos();
+			const Affine& world = m_pScene->getWorld(m_node);
+			return { world.dx, world.dy };
+		}
+
+		/**
+		 * @brief Return the absolute scale, from the world transform of the last scene graph update.
+		 */
+		const D2D1_SIZE_F getWorldScale() noexcept;
 
-		inline const D2D1_POINT_2F getPos() noexcept { return m_position; }
-		inline void setPos(const D2D1_POINT_2F& pos) noexcept { m_position = pos; }
+		inline TransformIndex getTransformIndex() const noexcept { return m_transform; }
+		inline NodeId getSceneNode() const noexcept { return m_node; }
+		inline SceneGraph* getScene() noexcept { return m_pScene; }
+		inline TransformStore* getTransformStore() noexcept { return m_pTransforms; }
 		inline void* getWindow() noexcept { return m_window; }
 	};
 
@@ -153,16 +280,12 @@ namespace Graphics
 
 	public:
 		/**
-		 * @brief Method to draw the component.
-		 * @note  renderTarget->BeginDraw() Must have been called.
-		 *
-		 * @param[in] hwnd		The window handle.
-		 * @param[in] hdc		The device context handle.
+		 * @brief Method to record the draw commands of the component.
+		 * @note  May be called from another thread than the main loop's one.
 		 *
-		 * @retval LRESULT
-		 * @return The draw result value.
+		 * @param[in] commands	The command list of the component's layer.
 		 */
-		virtual void draw(_In_ HWND hwnd, _In_ ID2D1HwndRenderTarget* renderTarget) = 0;
+		virtual void record(_Inout_ Render::CommandList& commands) = 0;
 
 		/**
 		 * @brief Method called whenever the render target is destroyed.
@@ -181,7 +304,15 @@ namespace Graphics
 	{
 	private:
 		std::vector<Pixel> m_memory;
-		ID2D1Bitmap* m_pBitmap = nullptr;
+		UINT32 m_width = 0;
+		UINT32 m_height = 0;
+		Render::ResourceId m_resource = Render::INVALID_RESOURCE;
+		float m_opacity = 1.0f;
+		bool m_isCompressed = false; // The pixels live compressed in the window's resource table, m_memory is empty.
+		bool m_isOpaque = false; // Every pixel has a full alpha: drawn at full opacity, the image hides what is below.
+		std::shared_ptr<const CollisionMask> m_collisionMask; // Shared by the images of the same asset, null if none was built.
+
+		void copyPixels(_In_ const Image& other);
 
 	public:
 		/**
@@ -193,6 +324,17 @@ namespace Graphics
 		Image(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName);
 		Image(_In_ const wchar_t* imageName);
 
+		/**
+		 * @brief Constructor for an image with a collision mask, built at load time.
+		 *
+		 * @note The mask is shared with the other images of the same path and threshold.
+		 *
+		 * @param[in] pos					The image's position in client dependent pixel.
+		 * @param[in] imageName				The image's path, relative or absolute.
+		 * @param[in] collisionThreshold	The lowest alpha of a colliding pixel.
+		 */
+		Image(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName, _In_ BYTE collisionThreshold);
+
 		Image(Image&) noexcept;
 		Image(Image&& other) noexcept;
 
@@ -208,9 +350,53 @@ namespace Graphics
 		 */
 		Image(_In_ D2D1_POINT_2F pos, _In_ IWICFormatConverter* pConverter);
 
-		void draw(_In_ HWND hwnd, _In_ ID2D1HwndRenderTarget* renderTarget) override;
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
 		void reconstruct() noexcept override;
-		inline D2D1_SIZE_F getSize();
+		D2D1_SIZE_F getSize() const noexcept;
+
+		/**
+		 * @brief Return the pixels of the image, decoding them if they are compressed.
+		 *
+		 * @note Decoded pixels stay valid until the end of the frame.
+		 *
+		 * @retval Pixel*
+		 * @return The width * height premultiplied B8G8R8A8 pixels.
+		 */
+		const Pixel* getPixels() const;
+
+		inline bool isCompressed() const noexcept { return m_isCompressed; }
+		inline bool isOpaque() const noexcept { return m_isOpaque; }
+
+		/**
+		 * @brief Build the collision mask of the image from its current pixels, for this image only.
+		 *
+		 * @param[in] threshold	The lowest alpha of a colliding pixel.
+		 */
+		void buildCollisionMask(_In_opt_ BYTE threshold = 0x80);
+
+		/**
+		 * @brief Set the collision mask of the image, built for another image of the same size. Null to remove it.
+		 */
+		inline void setCollisionMask(_In_ std::shared_ptr<const CollisionMask> mask) noexcept { m_collisionMask = std::move(mask); }
+		inline const std::shared_ptr<const CollisionMask>& getCollisionMask() const noexcept { return m_collisionMask; }
+
+		/**
+		 * @brief Test whether the colliding pixels of two images overlap.
+		 *
+		 * @note The images are compared at their world positions rounded to whole pixels, unscaled.
+		 *
+		 * @param[in] other	The other image.
+		 *
+		 * @retval bool
+		 * @return False if either image has no collision mask.
+		 */
+		bool overlaps(_In_ Image& other) noexcept;
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
 
 		~Image();
 	};
@@ -218,6 +404,245 @@ namespace Graphics
 
 
 
+	/**
+	 * @brief Class for text component.
+	 *
+	 * @note The glyphs come from the window's glyph cache. The layout is kept between frames:
+	 *       it is computed again only when the string, the font or the maximum width changes.
+	 */
+	class Text : public DrawableComponent
+	{
+	private:
+		std::wstring m_text;
+		std::wstring m_family;
+		UINT32 m_fontSize = 16;
+		UINT32 m_color = 0xFF000000;
+		float m_opacity = 1.0f;
+		float m_maxWidth = 0.0f;
+
+		Render::FontId m_font = Render::INVALID_FONT;
+		std::vector<Render::GlyphQuad> m_quads;
+		D2D1_SIZE_F m_layoutSize = { 0.0f, 0.0f };
+		UINT32 m_generation = 0;
+		bool m_isLayoutDirty = true;
+
+		void layout();
+
+	public:
+		/**
+		 * @brief Constructor for a text.
+		 *
+		 * @param[in] pos		The position of the top left corner of the first line, in client dependent pixel.
+		 * @param[in] text		The string to draw, '\n' starts a new line.
+		 * @param[in] family	The font family.
+		 * @param[in] size		The font size, in pixels.
+		 * @param[in] color		The color, as 0xAARRGGBB.
+		 */
+		Text(_In_ const D2D1_POINT_2F& pos, _In_ const std::wstring& text, _In_opt_ const std::wstring& family = L"Segoe UI", _In_opt_ UINT32 size = 16, _In_opt_ UINT32 color = 0xFF000000);
+
+		Text(Text&) = delete;
+		Text& operator=(const Text&) = delete;
+
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
+		void reconstruct() noexcept override;
+
+		inline const std::wstring& getText() const noexcept { return m_text; }
+		void setText(_In_ const std::wstring& text);
+
+		/**
+		 * @brief Set the font.
+		 *
+		 * @param[in] family	The font family.
+		 * @param[in] size		The font size, in pixels.
+		 */
+		void setFont(_In_ const std::wstring& family, _In_ UINT32 size);
+
+		/**
+		 * @brief Break the lines between words to fit a width.
+		 *
+		 * @param[in] width The maximum width, in unscaled pixels. Zero to only break on '\n'.
+		 */
+		void setMaxWidth(_In_ float width) noexcept;
+
+		inline UINT32 getColor() const noexcept { return m_color; }
+		inline void setColor(_In_ UINT32 color) noexcept { m_color = color; }
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		/**
+		 * @brief Return the unscaled size of the text, laid out if needed.
+		 */
+		D2D1_SIZE_F getSize();
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
+	};
+
+
+
+
+	/**
+	 * @brief Base class for vector shapes, filled and/or outlined with solid colors.
+	 *
+	 * @note The geometries come from the window's geometry cache: identical shapes share them,
+	 *       and they are only rebuilt when a parameter or the world scale changes. Moving a shape is free.
+	 *       Rotations of the scene graph are not applied.
+	 */
+	class Shape : public DrawableComponent
+	{
+	private:
+		UINT32 m_fillColor = 0xFF000000;
+		UINT32 m_strokeColor = 0;
+		float m_strokeWidth = 1.0f;
+		float m_opacity = 1.0f;
+
+		Render::GeometryId m_fill = Render::INVALID_GEOMETRY;
+		Render::GeometryId m_stroke = Render::INVALID_GEOMETRY;
+		D2D1_RECT_F m_fillBounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+		D2D1_RECT_F m_strokeBounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+		D2D1_SIZE_F m_geometryScale = { 0.0f, 0.0f };	// World scale the geometries were built for.
+		bool m_isFillRectangle = false;	// The fill covers its bounds: opaque, it hides what is below.
+		bool m_isGeometryDirty = true;
+
+		void buildGeometries(_In_ const D2D1_SIZE_F& scale);
+		void releaseGeometries() noexcept;
+
+	protected:
+		Shape(_In_ const D2D1_POINT_2F& pos, _In_ UINT32 fillColor);
+
+		/**
+		 * @brief Return the description of the shape, scaled by the world scale.
+		 */
+		virtual Render::ShapeDesc describe(_In_ const D2D1_SIZE_F& scale) const = 0;
+
+		/**
+		 * @brief Rebuild the geometries on the next record, after a parameter of the shape changed.
+		 */
+		inline void invalidateGeometry() noexcept { m_isGeometryDirty = true; }
+
+	public:
+		Shape(Shape&) = delete;
+		Shape& operator=(const Shape&) = delete;
+
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
+		void reconstruct() noexcept override;
+
+		/**
+		 * @brief Set the fill color, as 0xAARRGGBB. Zero to only draw the outline.
+		 */
+		inline void setFillColor(_In_ UINT32 color) noexcept { m_fillColor = color; m_isGeometryDirty = true; }
+		inline UINT32 getFillColor() const noexcept { return m_fillColor; }
+
+		/**
+		 * @brief Set the outline.
+		 *
+		 * @param[in] color The color, as 0xAARRGGBB. Zero to draw no outline.
+		 * @param[in] width The width, in unscaled pixels, centered on the edge of the shape.
+		 */
+		void setStroke(_In_ UINT32 color, _In_ float width) noexcept;
+		inline UINT32 getStrokeColor() const noexcept { return m_strokeColor; }
+		inline float getStrokeWidth() const noexcept { return m_strokeWidth; }
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
+
+		~Shape();
+	};
+
+
+	/**
+	 * @brief A rectangle, with rounded corners if given radiuses.
+	 */
+	class RectangleShape : public Shape
+	{
+	private:
+		D2D1_SIZE_F m_size;
+		float m_radiusX = 0.0f;
+		float m_radiusY = 0.0f;
+
+	protected:
+		Render::ShapeDesc describe(_In_ const D2D1_SIZE_F& scale) const override;
+
+	public:
+		/**
+		 * @brief Constructor for a rectangle.
+		 *
+		 * @param[in] pos		The position of the top left corner, in client dependent pixel.
+		 * @param[in] size		The size, in unscaled pixels.
+		 * @param[in] fillColor	The fill color, as 0xAARRGGBB.
+		 * @param[in] radiusX	The horizontal radius of the corners.
+		 * @param[in] radiusY	The vertical radius of the corners.
+		 */
+		RectangleShape(_In_ const D2D1_POINT_2F& pos, _In_ const D2D1_SIZE_F& size, _In_ UINT32 fillColor, _In_opt_ float radiusX = 0.0f, _In_opt_ float radiusY = 0.0f);
+
+		inline const D2D1_SIZE_F& getSize() const noexcept { return m_size; }
+		void setSize(_In_ const D2D1_SIZE_F& size) noexcept;
+		void setCornerRadius(_In_ float radiusX, _In_ float radiusY) noexcept;
+	};
+
+
+	/**
+	 * @brief An ellipse, inscribed in a rectangle.
+	 */
+	class EllipseShape : public Shape
+	{
+	private:
+		D2D1_SIZE_F m_size;
+
+	protected:
+		Render::ShapeDesc describe(_In_ const D2D1_SIZE_F& scale) const override;
+
+	public:
+		/**
+		 * @brief Constructor for an ellipse.
+		 *
+		 * @param[in] pos		The position of the top left corner of its rectangle, in client dependent pixel.
+		 * @param[in] size		The size of its rectangle, in unscaled pixels.
+		 * @param[in] fillColor	The fill color, as 0xAARRGGBB.
+		 */
+		EllipseShape(_In_ const D2D1_POINT_2F& pos, _In_ const D2D1_SIZE_F& size, _In_ UINT32 fillColor);
+
+		inline const D2D1_SIZE_F& getSize() const noexcept { return m_size; }
+		void setSize(_In_ const D2D1_SIZE_F& size) noexcept;
+	};
+
+
+	/**
+	 * @brief A path of straight segments: an outline if open, a polygon if closed.
+	 *
+	 * @note An open path is only drawn by its stroke.
+	 */
+	class PathShape : public Shape
+	{
+	private:
+		std::vector<D2D1_POINT_2F> m_points;
+		bool m_isClosed;
+
+	protected:
+		Render::ShapeDesc describe(_In_ const D2D1_SIZE_F& scale) const override;
+
+	public:
+		/**
+		 * @brief Constructor for a path.
+		 *
+		 * @param[in] pos		The origin of the points, in client dependent pixel.
+		 * @param[in] points	The points, in unscaled pixels relative to the origin.
+		 * @param[in] closed	Whether the last point joins the first one.
+		 * @param[in] fillColor	The fill color of a closed path, as 0xAARRGGBB.
+		 */
+		PathShape(_In_ const D2D1_POINT_2F& pos, _In_ const std::vector<D2D1_POINT_2F>& points, _In_ bool closed, _In_opt_ UINT32 fillColor = 0);
+
+		inline const std::vector<D2D1_POINT_2F>& getPoints() const noexcept { return m_points; }
+		void setPoints(_In_ const std::vector<D2D1_POINT_2F>& points, _In_ bool closed);
+	};
+
+
+
+
 	/**
 	 * @brief Class for animated image.
 	 */
@@ -240,13 +665,14 @@ namespace Graphics
 			AnimatedImage& operator=(const AnimatedImage&) = delete;
 
 
-			void draw(_In_ HWND hwnd, _In_ ID2D1HwndRenderTarget* renderTarget) override;
+			void record(_Inout_ Render::CommandList& commands) override;
 			void reconstruct() noexcept override;
 			bool initialize(void* window) noexcept override;
 
 			inline const unsigned int getNbFrame() const noexcept { return m_nbFrame; }
 			inline const unsigned int getCurrentFrame() const noexcept { return m_currentFrame; }
 			inline void setCurrentFrame(const unsigned int& frame) noexcept { m_currentFrame = frame; }
+			void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
 			~AnimatedImage()
 			{}
 		*/
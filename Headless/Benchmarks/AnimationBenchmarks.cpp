@@ -0,0 +1,78 @@
+#include "Benchmarks.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Animation.h"
+#include "GraphicComponents.h"
+
+
+namespace Benchmarks
+{
+
+	struct AnimationContext
+	{
+		Graphics::AnimationEngine engine;
+		std::vector<std::unique_ptr<Graphics::Component>> components;
+		UINT64 next = 0;
+	};
+
+	/**
+	 * @brief Give each component two looping tracks, spread over the easings.
+	 */
+	void buildTracks(_Inout_ AnimationContext& animations, _In_ UINT32 components)
+	{
+		for (UINT32 i = 0; i < components; i++)
+		{
+			Graphics::Component& component = *animations.components.emplace_back(
+				std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ 8.0f, 8.0f }, 0xFF2060A0u));
+			const Graphics::Easing easing = static_cast<Graphics::Easing>(i % static_cast<UINT32>(Graphics::Easing::Count));
+			animations.engine.add(component, Graphics::AnimatedProperty::PositionX, 0.0f, 1000.0f, 1e9f, easing);
+			animations.engine.add(component, Graphics::AnimatedProperty::ScaleY, 1.0f, 2.0f, 1e9f, easing);
+		}
+	}
+
+	/**
+	 * @brief One frame of every track: evaluation and write back.
+	 */
+	void benchAnimationUpdate(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		AnimationContext& animations = *reinterpret_cast<AnimationContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			animations.engine.update(1.0f / 60.0f);
+		Benchmark::doNotOptimize(animations.components.front()->getPos());
+	}
+
+	/**
+	 * @brief Restart the tracks of a component, as a component destroyed and replaced does, among all the running tracks.
+	 */
+	void benchAnimationCancel(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		AnimationContext& animations = *reinterpret_cast<AnimationContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Graphics::Component& component = *animations.components[(animations.next++ * 7919) % animations.components.size()];
+			animations.engine.cancel(&component);
+			animations.engine.add(component, Graphics::AnimatedProperty::PositionX, 0.0f, 1000.0f, 1e9f);
+			animations.engine.add(component, Graphics::AnimatedProperty::ScaleY, 1.0f, 2.0f, 1e9f);
+		}
+		Benchmark::doNotOptimize(animations.engine.getCount());
+	}
+
+
+	void addAnimationBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static std::vector<std::unique_ptr<AnimationContext>> contexts;
+		for (UINT32 components : { 1000u, 250000u })
+		{
+			AnimationContext& animations = *contexts.emplace_back(std::make_unique<AnimationContext>());
+			buildTracks(animations, components);
+
+			const std::string suffix = '/' + std::to_string(components * 2) + "_tracks";
+			suite.add("animation/update" + suffix, benchAnimationUpdate, &animations);
+			suite.add("animation/cancel_component" + suffix, benchAnimationCancel, &animations);
+		}
+	}
+
+} // namespace Benchmarks
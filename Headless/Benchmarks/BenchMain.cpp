@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Benchmarks.h"
+
+
+/**
+ * Runs the benchmarks, prints their results and optionally writes them as json, or compares them against a baseline.
+ *
+ *   benchmarks [--filter text] [--samples n] [--min-ms ms] [--json path] [--baseline path] [--tolerance ratio]
+ *
+ * Exits with 1 if a benchmark is slower than its baseline by more than the tolerance, 2 on a bad argument or file.
+ */
+int main(int argc, char** argv)
+{
+	std::string filter;
+	unsigned int samples = 5;
+	double minSampleMs = 50.0;
+	double tolerance = 0.1;
+	std::filesystem::path jsonPath;
+	std::filesystem::path baselinePath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--filter") == 0 && hasValue) filter = argv[++i];
+		else if (std::strcmp(argv[i], "--samples") == 0 && hasValue) samples = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--min-ms") == 0 && hasValue) minSampleMs = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--json") == 0 && hasValue) jsonPath = argv[++i];
+		else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) baselinePath = argv[++i];
+		else if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue) tolerance = std::atof(argv[++i]);
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--filter text] [--samples n] [--min-ms ms] [--json path] [--baseline path] [--tolerance ratio]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	// Read first: a bad baseline is reported before spending minutes on the benchmarks.
+	std::vector<Benchmark::Result> baseline;
+	if (!baselinePath.empty() && !Benchmark::readJson(baselinePath.wstring().c_str(), &baseline))
+	{
+		std::fprintf(stderr, "cannot read the baseline %s: missing or malformed\n", baselinePath.string().c_str());
+		return 2;
+	}
+
+	Benchmark::Suite suite;
+	Benchmarks::addCoreBenchmarks(suite);
+	Benchmarks::addAnimationBenchmarks(suite);
+	Benchmarks::addShapeBenchmarks(suite);
+	Benchmarks::addTaskBenchmarks(suite);
+	Benchmarks::addTimerBenchmarks(suite);
+	Benchmarks::addCullingBenchmarks(suite);
+	Benchmarks::addPresentBenchmarks(suite);
+	Benchmarks::addDecoderBenchmarks(suite);
+	Benchmarks::addComponentBenchmarks(suite);
+	Benchmarks::addParticleBenchmarks(suite);
+	Benchmarks::addTileMapBenchmarks(suite);
+	Benchmarks::addCollisionBenchmarks(suite);
+	Benchmarks::addLargeImageBenchmarks(suite);
+	Benchmarks::addSceneBenchmarks(suite);
+	Benchmarks::addTransformBenchmarks(suite);
+	Benchmarks::addCommandBenchmarks(suite);
+	Benchmarks::addLayerBenchmarks(suite);
+	Benchmarks::addTextBenchmarks(suite);
+	Benchmarks::addProfilerBenchmarks(suite);
+	Benchmarks::addTextureBenchmarks(suite);
+
+	const std::vector<Benchmark::Result> results = suite.run(filter, samples, minSampleMs);
+	for (const Benchmark::Result& result : results)
+	{
+		std::printf("%-48s %14.1f ns  (min %.1f, max %.1f, %llu iterations)", result.name.c_str(), result.nsPerIteration,
+			result.minNs, result.maxNs, static_cast<unsigned long long>(result.iterations));
+		if (result.bytesPerIteration != 0) std::printf("  %.1f MB/s", result.getMBPerSecond());
+		for (const Benchmark::Counter& counter : result.counters)
+			std::printf("  %s=%g", counter.name.c_str(), counter.value);
+		std::printf("\n");
+	}
+
+	if (!jsonPath.empty() && !Benchmark::writeJson(results, jsonPath.wstring().c_str()))
+	{
+		std::fprintf(stderr, "cannot write %s\n", jsonPath.string().c_str());
+		return 2;
+	}
+
+	if (baselinePath.empty()) return 0;
+	const std::vector<Benchmark::Regression> regressions = Benchmark::compare(baseline, results, tolerance);
+	for (const Benchmark::Regression& regression : regressions)
+	{
+		std::printf("REGRESSION %s: %.1f ns -> %.1f ns (x%.2f)\n", regression.name.c_str(), regression.baselineNs,
+			regression.currentNs, regression.ratio);
+	}
+	return regressions.empty() ? 0 : 1;
+}
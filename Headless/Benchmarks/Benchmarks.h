@@ -0,0 +1,125 @@
+#pragma once
+#ifndef HEADLESS_BENCHMARKS_H
+#define HEADLESS_BENCHMARKS_H
+
+#include <Windows.h>
+
+#include <string>
+
+#include "Benchmark.h"
+
+
+namespace Benchmarks
+{
+	/**
+	 * @brief Return the path of an image of the repository's Images directory.
+	 */
+	inline std::wstring getImagePath(_In_ const wchar_t* name)
+	{
+		return std::wstring(L"" IMAGES_DIR) + name;
+	}
+
+	/**
+	 * @brief Add the benchmarks of the event handler, the component store, the dichotomous search,
+	 *        the pixel buffers and the headless paint of synthetic scenes.
+	 */
+	void addCoreBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the tween engine: a frame of all the tracks, and cancelling the tracks of a component.
+	 */
+	void addAnimationBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the shapes: 50k mixed shapes painted, and geometries rasterized on first draw.
+	 */
+	void addShapeBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the coroutine tasks: 100k tasks resumed each frame, and tasks cancelled among 100k delayed ones.
+	 */
+	void addTaskBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the timer wheel, with 1M timers armed: replacing a timer, and a frame.
+	 */
+	void addTimerBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the occlusion culling: overlapping windows painted with and without it.
+	 */
+	void addCullingBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the input to present latency, presenting on the main loop and on a render thread.
+	 */
+	void addPresentBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the image decoder, with their throughput in MB/s of decoded bytes.
+	 */
+	void addDecoderBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the component pools: 1M components spawned and despawned, pooled and allocated.
+	 */
+	void addComponentBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the particle systems, with 1M particles: a frame updated, recorded and rendered.
+	 */
+	void addParticleBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the tile maps, on a 4096 x 4096 map: scrolling, editing a visible tile, and a cold frame.
+	 */
+	void addTileMapBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the collision masks: 1M pairs tested with masks, and by reading their pixels.
+	 */
+	void addCollisionBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the large images, streaming a 32768 x 32768 image: still, panned and zoomed.
+	 */
+	void addLargeImageBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the scene graph: moving the root of a 100k nodes tree, and moving one of its leaves.
+	 */
+	void addSceneBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the transform store: a frame of 1M moving entities, on the calling thread and on a pool.
+	 */
+	void addTransformBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the command buffers: 100k commands recorded, and executed by the software renderer.
+	 */
+	void addCommandBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the layer cache: 20 z-indexes, one of them animated, cached or not, with the hit rates.
+	 */
+	void addLayerBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the texts: 10k labels painted with the bundled font, and labels changing their string.
+	 */
+	void addTextBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the profiler: the cost of a zone, with and without a capture.
+	 */
+	void addProfilerBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+	/**
+	 * @brief Add the benchmarks of the texture store: the decode of a palette, a true color and a flat color texture.
+	 */
+	void addTextureBenchmarks(_Inout_ Benchmark::Suite& suite);
+
+} // namespace Benchmarks
+
+#endif // HEADLESS_BENCHMARKS_H
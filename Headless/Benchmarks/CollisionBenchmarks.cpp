@@ -0,0 +1,102 @@
+#include "Benchmarks.h"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "CollisionMask.h"
+#include "GraphicComponents.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr UINT32 PAIR_COUNT = 1000000;
+
+	/**
+	 * @brief Return the pixels of an opaque disc centered in a transparent square.
+	 */
+	std::vector<Graphics::Pixel> makeDisc(_In_ UINT32 size, _In_ float radius)
+	{
+		std::vector<Graphics::Pixel> pixels(static_cast<size_t>(size) * size, Graphics::Pixel(0x00, 0x00));
+		for (UINT32 y = 0; y < size; y++)
+		{
+			for (UINT32 x = 0; x < size; x++)
+			{
+				const float dx = x + 0.5f - size / 2.0f, dy = y + 0.5f - size / 2.0f;
+				if (dx * dx + dy * dy <= radius * radius) pixels[y * size + x] = Graphics::Pixel(0xFF, 0x00, 0x00, 0xFF);
+			}
+		}
+		return pixels;
+	}
+
+	struct CollisionContext
+	{
+		UINT32 size;
+		std::vector<Graphics::Pixel> pixelsA, pixelsB;
+		Graphics::CollisionMask maskA, maskB;
+		std::vector<std::pair<LONG, LONG>> offsets;	// Of B relative to A, half of them with bounds overlapping.
+		UINT64 hits = 0;							// Counted in the context for each pair to be tested at every iteration.
+
+		explicit CollisionContext(_In_ UINT32 discSize)
+			: size(discSize), pixelsA(makeDisc(discSize, discSize * 0.45f)), pixelsB(makeDisc(discSize, discSize * 0.3f)),
+			maskA(pixelsA.data(), discSize, discSize), maskB(pixelsB.data(), discSize, discSize), offsets(PAIR_COUNT)
+		{
+			std::mt19937 random(48);
+			std::uniform_int_distribution<LONG> offset(-static_cast<LONG>(discSize) * 3 / 2, static_cast<LONG>(discSize) * 3 / 2);
+			for (std::pair<LONG, LONG>& pair : offsets)
+				pair = { offset(random), offset(random) };
+		}
+	};
+
+	/**
+	 * @brief Test 1M pairs of masks for a pixel perfect collision.
+	 */
+	void benchMaskPairs(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		CollisionContext& collision = *reinterpret_cast<CollisionContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			for (const std::pair<LONG, LONG>& pair : collision.offsets)
+				collision.hits += collision.maskA.overlaps(collision.maskB, pair.first, pair.second);
+		}
+		Benchmark::doNotOptimize(collision.hits);
+	}
+
+	/**
+	 * @brief Test 1M pairs for a pixel perfect collision by reading the alpha of their pixels, as done without masks.
+	 */
+	void benchPixelPairs(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		CollisionContext& collision = *reinterpret_cast<CollisionContext*>(context);
+		const LONG size = static_cast<LONG>(collision.size);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			for (const std::pair<LONG, LONG>& pair : collision.offsets)
+			{
+				bool isHit = false;
+				for (LONG y = (std::max)(0L, pair.second); y < (std::min)(size, size + pair.second) && !isHit; y++)
+				{
+					for (LONG x = (std::max)(0L, pair.first); x < (std::min)(size, size + pair.first) && !isHit; x++)
+					{
+						isHit = collision.pixelsA[y * size + x].a >= 0x80
+							&& collision.pixelsB[(y - pair.second) * size + (x - pair.first)].a >= 0x80;
+					}
+				}
+				collision.hits += isHit;
+			}
+		}
+		Benchmark::doNotOptimize(collision.hits);
+	}
+
+
+	void addCollisionBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static CollisionContext small(64), large(200);
+
+		suite.add("collision/masks/1000000_pairs_64x64", benchMaskPairs, &small);
+		suite.add("collision/masks/1000000_pairs_200x200", benchMaskPairs, &large);
+		suite.add("collision/pixels/1000000_pairs_64x64", benchPixelPairs, &small);
+	}
+
+} // namespace Benchmarks
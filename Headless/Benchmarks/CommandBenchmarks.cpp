@@ -0,0 +1,81 @@
+#include "Benchmarks.h"
+
+#include <random>
+#include <vector>
+
+#include "RenderCommands.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr size_t COMMAND_COUNT = 100000;
+	constexpr Render::Layer COMMAND_LAYERS = 8;
+
+	struct CommandContext
+	{
+		Render::ResourceTable resources;
+		Render::ResourceId sprite = Render::INVALID_RESOURCE;
+		std::vector<D2D1_RECT_F> destinations;
+		std::vector<UINT32> colors;
+		Render::CommandBuffer commands;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+	};
+
+	/**
+	 * @brief Record the 100k commands of a frame: rectangles and 32 x 32 bitmaps, alternately, over 8 layers.
+	 */
+	void recordCommands(_Inout_ CommandContext& command)
+	{
+		command.commands.reset();
+		for (size_t i = 0; i < COMMAND_COUNT; i++)
+		{
+			Render::CommandList& list = command.commands.getLayer(static_cast<Render::Layer>(i % COMMAND_LAYERS));
+			if (i % 2 == 0) list.fillRect(command.destinations[i], command.colors[i]);
+			else list.drawBitmap(command.sprite, command.destinations[i], 0.8f);
+		}
+	}
+
+	void benchRecordCommands(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		CommandContext& command = *reinterpret_cast<CommandContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			recordCommands(command);
+		Benchmark::doNotOptimize(command.commands.size());
+	}
+
+	void benchExecuteCommands(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		CommandContext& command = *reinterpret_cast<CommandContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			command.renderer.render(command.commands, command.resources, command.target);
+		Benchmark::doNotOptimize(command.target.pixels.data());
+	}
+
+
+	void addCommandBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static CommandContext command;
+		std::vector<Graphics::Pixel> sprite;
+		for (UINT32 i = 0; i < 32 * 32; i++)
+			sprite.emplace_back(static_cast<BYTE>(i * 8), static_cast<BYTE>(i / 4), 0x80, 0xFF);
+		command.sprite = command.resources.registerBitmap(sprite.data(), 32, 32);
+
+		std::mt19937 random(11);
+		for (size_t i = 0; i < COMMAND_COUNT; i++)
+		{
+			const float left = static_cast<float>(random() % 1900), top = static_cast<float>(random() % 1060);
+			const float size = i % 2 == 0 ? static_cast<float>(8 + random() % 32) : 32.0f;
+			command.destinations.push_back(D2D1::RectF(left, top, left + size, top + size));
+			command.colors.push_back(0x80000000u | (random() & 0xFFFFFF));
+		}
+
+		// Executed on the commands recorded once: recording is measured on its own.
+		recordCommands(command);
+		suite.add("commands/record/100000", benchRecordCommands, &command);
+		suite.add("commands/execute/100000", benchExecuteCommands, &command);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,67 @@
+#include "Benchmarks.h"
+
+#include <deque>
+#include <memory>
+
+#include "GraphicComponents.h"
+#include "Replay.h"
+
+
+namespace Benchmarks
+{
+
+	/**
+	 * @brief A short lived component, spawned and despawned in bursts.
+	 */
+	struct Bullet : Graphics::Component
+	{
+		float vx, vy, life;
+		BYTE payload[40];
+
+		Bullet(_In_ D2D1_POINT_2F pos, _In_ float velocity) : Graphics::Component(pos), vx(velocity), vy(velocity), life(1.0f) {}
+	};
+
+	struct SpawnContext
+	{
+		Replay::HeadlessWindow window;
+		std::deque<ComponentId> ids;	// Oldest first.
+		size_t liveCount;
+		bool isPooled;
+	};
+
+	constexpr UINT32 SPAWNS_PER_ITERATION = 1000000;
+
+	/**
+	 * @brief Spawn 1M bullets, despawning the oldest one once more than liveCount are alive.
+	 */
+	void benchSpawn(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		SpawnContext& spawn = *reinterpret_cast<SpawnContext*>(context);
+		for (UINT64 i = 0; i < iterations * SPAWNS_PER_ITERATION; i++)
+		{
+			const int zIndex = static_cast<int>(i % 4);
+			if (spawn.isPooled)
+				spawn.ids.push_back(spawn.window.emplaceComponent<Bullet>(zIndex, D2D1_POINT_2F{ 1.0f, 2.0f }, 3.0f));
+			else
+				spawn.ids.push_back(spawn.window.addComponent(std::make_unique<Bullet>(D2D1_POINT_2F{ 1.0f, 2.0f }, 3.0f), zIndex));
+			if (spawn.ids.size() > spawn.liveCount)
+			{
+				spawn.window.removeComponent(spawn.ids.front());
+				spawn.ids.pop_front();
+			}
+		}
+		Benchmark::doNotOptimize(spawn.ids.back());
+	}
+
+	void addComponentBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static SpawnContext allocated16{ {}, {}, 16, false }, pooled16{ {}, {}, 16, true };
+		static SpawnContext allocated1000{ {}, {}, 1000, false }, pooled1000{ {}, {}, 1000, true };
+
+		suite.add("components/spawn/1000000_allocated_16_live", benchSpawn, &allocated16);
+		suite.add("components/spawn/1000000_pooled_16_live", benchSpawn, &pooled16);
+		suite.add("components/spawn/1000000_allocated_1000_live", benchSpawn, &allocated1000);
+		suite.add("components/spawn/1000000_pooled_1000_live", benchSpawn, &pooled1000);
+	}
+
+} // namespace Benchmarks
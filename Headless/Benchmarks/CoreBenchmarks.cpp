@@ -0,0 +1,309 @@
+#include "Benchmarks.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "EventHandler.h"
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+#include "fctdef.h"
+
+
+namespace Benchmarks
+{
+	/********************/
+	/*		Events		*/
+	/********************/
+
+	struct EventContext
+	{
+		UINT message;
+		UINT64 counter = 0;
+	};
+
+	LRESULT onBenchEvent(_In_ HWND /*hwnd*/, _In_ WPARAM wParam, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
+	{
+		*reinterpret_cast<UINT64*>(context) += wParam;
+		return S_OK;
+	}
+
+	/**
+	 * @brief Register and unregister one more handler of a message.
+	 */
+	void benchRegisterEvent(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		EventContext& events = *reinterpret_cast<EventContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const EventHandler::EVENTID id = EventHandler::registerEvent(events.message, onBenchEvent, &events.counter);
+			EventHandler::unregisterEvent(id);
+		}
+	}
+
+	/**
+	 * @brief Dispatch a message to all its handlers.
+	 */
+	void benchHandleMessage(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		EventContext& events = *reinterpret_cast<EventContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			EventHandler::handleMessage(NULL, events.message, 1, 0);
+		Benchmark::doNotOptimize(events.counter);
+	}
+
+
+	/************************/
+	/*		Components		*/
+	/************************/
+
+	struct ComponentContext
+	{
+		Replay::HeadlessWindow window;
+		std::vector<ComponentId> ids;
+		UINT64 next = 0;
+	};
+
+	/**
+	 * @brief Return one of the components of the window, spread over the z-indexes.
+	 */
+	inline size_t pickComponent(_Inout_ ComponentContext& components) noexcept
+	{
+		return static_cast<size_t>((components.next++ * 7919) % components.ids.size());
+	}
+
+	void benchAddRemoveComponent(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ComponentContext& components = *reinterpret_cast<ComponentContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const ComponentId id = components.window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 10.0f, 10.0f }, D2D1_SIZE_F{ 20.0f, 20.0f }, 0xFF2060A0u), static_cast<int>(i % 8));
+			components.window.removeComponent(id);
+		}
+	}
+
+	void benchGetComponent(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ComponentContext& components = *reinterpret_cast<ComponentContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			Benchmark::doNotOptimize(components.window.getComponent(components.ids[pickComponent(components)]));
+	}
+
+	void benchSetComponentZIndex(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ComponentContext& components = *reinterpret_cast<ComponentContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			components.window.setComponentZIndex(components.ids[pickComponent(components)], static_cast<ZIndex>(i % 8));
+	}
+
+
+	/****************************/
+	/*	  Dichotomous search	*/
+	/****************************/
+
+	struct SearchContext
+	{
+		std::vector<UINT64> values;
+		UINT64 next = 0;
+	};
+
+	UINT64 getValue(UINT64 value)
+	{
+		return value;
+	}
+
+	void benchDichotomousSearch(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		SearchContext& search = *reinterpret_cast<SearchContext*>(context);
+		const size_t count = search.values.size();
+		size_t found = 0;
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			// Values of the list, or between two of them: never below the first one.
+			const UINT64 value = search.values[(search.next++ * 7919) % count] + (i & 1);
+			found += dichotomous_search(search.values, value, getValue);
+		}
+		Benchmark::doNotOptimize(found);
+	}
+
+
+	/********************/
+	/*		Pixels		*/
+	/********************/
+
+	struct PixelContext
+	{
+		UINT32 width;
+		UINT32 height;
+		std::wstring imagePath;
+	};
+
+	void benchFillPixels(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		const PixelContext& pixels = *reinterpret_cast<PixelContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			std::vector<Graphics::Pixel> buffer(static_cast<size_t>(pixels.width) * pixels.height, Graphics::Pixel(0x20, 0x60, 0xA0, 0xFF));
+			Benchmark::doNotOptimize(buffer.data());
+		}
+	}
+
+	void benchConstructPixels(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		const PixelContext& pixels = *reinterpret_cast<PixelContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			std::vector<Graphics::Pixel> buffer;
+			buffer.reserve(static_cast<size_t>(pixels.width) * pixels.height);
+			for (UINT32 y = 0; y < pixels.height; y++)
+				for (UINT32 x = 0; x < pixels.width; x++)
+					buffer.emplace_back(static_cast<BYTE>(x), static_cast<BYTE>(y), static_cast<BYTE>(x ^ y), 0xFF);
+			Benchmark::doNotOptimize(buffer.data());
+		}
+	}
+
+	void benchLoadImage(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		const PixelContext& pixels = *reinterpret_cast<PixelContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Graphics::Image image({ 0.0f, 0.0f }, pixels.imagePath.c_str());
+			Benchmark::doNotOptimize(image);
+		}
+	}
+
+
+	/********************/
+	/*		Paint		*/
+	/********************/
+
+	struct PaintContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+	};
+
+	void benchPaint(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		PaintContext& paint = *reinterpret_cast<PaintContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			paint.window.renderOffscreen(paint.renderer, paint.target);
+		Benchmark::doNotOptimize(paint.target.pixels.data());
+	}
+
+	struct ScalingContext
+	{
+		BaseWindow* pWindow;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target;
+
+		ScalingContext(_In_ BaseWindow& window, _In_ unsigned int threadCount, _In_ UINT32 width, _In_ UINT32 height)
+			:pWindow(&window), renderer(threadCount), target(width, height)
+		{}
+	};
+
+	void benchPaintScaling(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ScalingContext& paint = *reinterpret_cast<ScalingContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			paint.pWindow->renderOffscreen(paint.renderer, paint.target);
+		Benchmark::doNotOptimize(paint.target.pixels.data());
+	}
+
+	/**
+	 * @brief Fill a window with a synthetic scene, on 8 z-indexes of a client area of 1920x1080 by default.
+	 */
+	void buildScene(_Inout_ BaseWindow& window, _In_ UINT32 shapes, _In_ UINT32 images, _In_ UINT32 texts, _In_opt_ UINT32 width = 1920, _In_opt_ UINT32 height = 1080)
+	{
+		std::mt19937 random(7);
+		const std::wstring imagePath = getImagePath(L"test.png");
+		auto position = [&random, width, height]() { return D2D1_POINT_2F{ static_cast<float>(random() % (width - 120)), static_cast<float>(random() % (height - 100)) }; };
+
+		window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ static_cast<float>(width), static_cast<float>(height) }, 0xFF202830u), 0);
+		for (UINT32 i = 0; i < shapes; i++)
+		{
+			const D2D1_SIZE_F size = { static_cast<float>(20 + random() % 100), static_cast<float>(20 + random() % 100) };
+			const UINT32 color = 0x80000000u | (random() & 0xFFFFFF);
+			if (i % 2 == 0) window.addComponent(std::make_unique<Graphics::RectangleShape>(position(), size, color, 4.0f, 4.0f), static_cast<int>(i % 8));
+			else window.addComponent(std::make_unique<Graphics::EllipseShape>(position(), size, color), static_cast<int>(i % 8));
+		}
+		for (UINT32 i = 0; i < images; i++)
+			window.addComponent(std::make_unique<Graphics::Image>(position(), imagePath.c_str()), static_cast<int>(i % 8));
+		for (UINT32 i = 0; i < texts; i++)
+			window.addComponent(std::make_unique<Graphics::Text>(position(), L"Synthetic label", L"Segoe UI", 14), static_cast<int>(i % 8));
+	}
+
+
+	void addCoreBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		// The contexts live until the end of the program, like the suite.
+		static std::vector<std::unique_ptr<EventContext>> eventContexts;
+		for (UINT32 handlers : { 1u, 16u, 256u })
+		{
+			EventContext& events = *eventContexts.emplace_back(std::make_unique<EventContext>());
+			events.message = WM_APP + handlers;
+			for (UINT32 i = 0; i < handlers; i++)
+				EventHandler::registerEvent(events.message, onBenchEvent, &events.counter, static_cast<EventHandler::PRIORITY>(static_cast<int>(i % 5) - 2));
+
+			const std::string suffix = '/' + std::to_string(handlers) + "_handlers";
+			suite.add("events/register_unregister" + suffix, benchRegisterEvent, &events);
+			suite.add("events/handle_message" + suffix, benchHandleMessage, &events);
+		}
+
+		static std::vector<std::unique_ptr<ComponentContext>> componentContexts;
+		for (UINT32 count : { 1000u, 10000u })
+		{
+			ComponentContext& components = *componentContexts.emplace_back(std::make_unique<ComponentContext>());
+			for (UINT32 i = 0; i < count; i++)
+			{
+				const D2D1_POINT_2F pos = { static_cast<float>(i % 1900), static_cast<float>(i / 1900 * 20) };
+				components.ids.push_back(components.window.addComponent(std::make_unique<Graphics::RectangleShape>(pos, D2D1_SIZE_F{ 20.0f, 20.0f }, 0xFF2060A0u), static_cast<int>(i % 8)));
+			}
+
+			const std::string suffix = '/' + std::to_string(count);
+			suite.add("components/add_remove" + suffix, benchAddRemoveComponent, &components);
+			suite.add("components/get" + suffix, benchGetComponent, &components);
+			suite.add("components/set_z_index" + suffix, benchSetComponentZIndex, &components);
+		}
+
+		static std::vector<std::unique_ptr<SearchContext>> searchContexts;
+		for (UINT32 count : { 1000u, 1000000u })
+		{
+			SearchContext& search = *searchContexts.emplace_back(std::make_unique<SearchContext>());
+			for (UINT32 i = 0; i < count; i++)
+				search.values.push_back(static_cast<UINT64>(i) * 3);
+			suite.add("dichotomous_search/" + std::to_string(count), benchDichotomousSearch, &search);
+		}
+
+		static PixelContext fullHd = { 1920, 1080, getImagePath(L"image.png") };
+		suite.add("pixels/fill/1920x1080", benchFillPixels, &fullHd);
+		suite.add("pixels/construct/1920x1080", benchConstructPixels, &fullHd);
+		suite.add("pixels/load_image/800x600", benchLoadImage, &fullHd);
+
+		static PaintContext shapes, images, mixed;
+		buildScene(shapes.window, 1000, 0, 0);
+		buildScene(images.window, 0, 200, 0);
+		buildScene(mixed.window, 400, 100, 100);
+		suite.add("paint/shapes/1000", benchPaint, &shapes);
+		suite.add("paint/images/200", benchPaint, &images);
+		suite.add("paint/mixed/600", benchPaint, &mixed);
+
+		// The mixed scene, as dense in 4K as in 1080p, painted by 1 to 32 threads.
+		static Replay::HeadlessWindow mixed4K;
+		buildScene(mixed4K, 1600, 400, 400, 3840, 2160);
+		static std::vector<std::unique_ptr<ScalingContext>> scalingContexts;
+		for (BaseWindow* pWindow : { static_cast<BaseWindow*>(&mixed.window), static_cast<BaseWindow*>(&mixed4K) })
+		{
+			const bool is4K = pWindow == &mixed4K;
+			for (unsigned int threads : { 1u, 2u, 4u, 8u, 16u, 32u })
+			{
+				ScalingContext& paint = *scalingContexts.emplace_back(std::make_unique<ScalingContext>(*pWindow, threads, is4K ? 3840 : 1920, is4K ? 2160 : 1080));
+				suite.add(std::string("paint/threads/") + (is4K ? "3840x2160/" : "1920x1080/") + std::to_string(threads), benchPaintScaling, &paint);
+			}
+		}
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,76 @@
+#include "Benchmarks.h"
+
+#include <memory>
+#include <random>
+#include <string>
+
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Benchmarks
+{
+
+	struct CullingContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+	};
+
+	/**
+	 * @brief Draw the window: record, cull if enabled, then render in tiles.
+	 */
+	void benchPaintWindows(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		CullingContext& culling = *reinterpret_cast<CullingContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			culling.window.renderOffscreen(culling.renderer, culling.target);
+		Benchmark::doNotOptimize(culling.target.pixels.data());
+	}
+
+	/**
+	 * @brief Fill a window with a desktop of 8 overlapping opaque windows, each holding images, shapes and labels.
+	 *
+	 * @note The windows hide most of the 400 shapes of the background and of the windows below them.
+	 */
+	void buildDesktop(_Inout_ BaseWindow& window)
+	{
+		std::mt19937 random(41);
+		const std::wstring imagePath = getImagePath(L"test.png");
+
+		window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ 1920.0f, 1080.0f }, 0xFF202830u), 0);
+		for (UINT32 i = 0; i < 400; i++)
+		{
+			const D2D1_POINT_2F pos = { static_cast<float>(random() % 1880), static_cast<float>(random() % 1040) };
+			window.addComponent(std::make_unique<Graphics::EllipseShape>(pos, D2D1_SIZE_F{ 40.0f, 40.0f }, 0xFF8090A0u), 0);
+		}
+		for (int w = 0; w < 8; w++)
+		{
+			const float x = 60.0f * w + 20.0f, y = 40.0f * w + 20.0f;
+			window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ x, y }, D2D1_SIZE_F{ 1200.0f, 760.0f }, 0xFFE0E0E0u - w * 0x00101010u), w + 1);
+			for (UINT32 i = 0; i < 150; i++)
+			{
+				const D2D1_POINT_2F pos = { x + 10.0f + static_cast<float>(random() % 1080), y + 40.0f + static_cast<float>(random() % 600) };
+				if (i % 3 == 0) window.addComponent(std::make_unique<Graphics::Image>(pos, imagePath.c_str()), w + 1);
+				else if (i % 3 == 1) window.addComponent(std::make_unique<Graphics::EllipseShape>(pos, D2D1_SIZE_F{ 60.0f, 60.0f }, 0xC0306090u), w + 1);
+				else window.addComponent(std::make_unique<Graphics::Text>(pos, L"Label text", L"Segoe UI", 14), w + 1);
+			}
+		}
+	}
+
+
+	void addCullingBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static CullingContext unculled, culled;
+		buildDesktop(unculled.window);
+		unculled.window.setOcclusionCulling(false);
+		buildDesktop(culled.window);
+		culled.window.setOcclusionCulling(true);
+
+		suite.add("culling/paint/8_windows_unculled", benchPaintWindows, &unculled);
+		suite.add("culling/paint/8_windows_culled", benchPaintWindows, &culled);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,82 @@
+#include "Benchmarks.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "ImageDecoder.h"
+
+
+namespace Benchmarks
+{
+
+	struct DecoderContext
+	{
+		std::vector<BYTE> file;
+		std::vector<BYTE> output;	// For the inflate benchmark, as large as the stream decompresses.
+	};
+
+	std::vector<BYTE> readFile(_In_ const std::wstring& path)
+	{
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		return std::vector<BYTE>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	/**
+	 * @brief Return the zlib stream of a PNG: its IDAT chunks, concatenated.
+	 */
+	std::vector<BYTE> extractPngStream(_In_ const std::vector<BYTE>& png)
+	{
+		std::vector<BYTE> stream;
+		for (size_t offset = 8; offset + 12 <= png.size();)
+		{
+			const size_t length = (static_cast<size_t>(png[offset]) << 24) | (png[offset + 1] << 16) | (png[offset + 2] << 8) | png[offset + 3];
+			if (offset + 12 + length > png.size()) break;
+			if (std::memcmp(&png[offset + 4], "IDAT", 4) == 0)
+				stream.insert(stream.end(), png.begin() + offset + 8, png.begin() + offset + 8 + length);
+			offset += 12 + length;
+		}
+		return stream;
+	}
+
+	void benchDecodeImage(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		DecoderContext& decoder = *reinterpret_cast<DecoderContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Codec::DecodedImage image;
+			Codec::decodeImage(decoder.file.data(), decoder.file.size(), image);
+			Benchmark::doNotOptimize(image.frames.data());
+		}
+	}
+
+	void benchInflate(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		DecoderContext& decoder = *reinterpret_cast<DecoderContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			Benchmark::doNotOptimize(Codec::inflateZlib(decoder.file.data(), decoder.file.size(), decoder.output.data(), decoder.output.size()));
+	}
+
+
+	void addDecoderBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		// The throughput is given in decoded bytes: B8G8R8A8 pixels of every frame, or the bytes inflated.
+		static DecoderContext rgba = { readFile(getImagePath(L"image.png")), {} };
+		suite.add("decoder/png/800x600_rgba", benchDecodeImage, &rgba, 800ull * 600 * sizeof(Graphics::Pixel));
+
+		static DecoderContext palette = { readFile(getImagePath(L"test.png")), {} };
+		suite.add("decoder/png/210x208_palette", benchDecodeImage, &palette, 210ull * 208 * sizeof(Graphics::Pixel));
+
+		static DecoderContext gif = { readFile(getImagePath(L"gif.gif")), {} };
+		suite.add("decoder/gif/480x306_29_frames", benchDecodeImage, &gif, 29ull * 480 * 306 * sizeof(Graphics::Pixel));
+
+		// The filtered rows of image.png: a filter byte, then 800 RGBA pixels per row.
+		static DecoderContext inflate = { extractPngStream(rgba.file), std::vector<BYTE>(600 * (1 + 800 * 4)) };
+		suite.add("decoder/inflate/800x600_rgba_rows", benchInflate, &inflate, inflate.output.size());
+	}
+
+} // namespace Benchmarks
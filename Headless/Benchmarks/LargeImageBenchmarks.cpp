@@ -0,0 +1,153 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include "LargeImage.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr UINT32 LARGE_IMAGE_SIZE = 32768;
+
+	/**
+	 * @brief A 32768 x 32768 image whose every level is computed directly, as a tiled pyramid file would store it.
+	 */
+	class GradientTileSource : public Graphics::TileSource
+	{
+	public:
+		UINT32 getWidth() const noexcept override { return LARGE_IMAGE_SIZE; }
+		UINT32 getHeight() const noexcept override { return LARGE_IMAGE_SIZE; }
+
+		bool decode(_In_ UINT32 level, _In_ const D2D1_RECT_U& region, _Out_ Graphics::Pixel* pixels) override
+		{
+			for (UINT32 y = region.top; y < region.bottom; y++)
+			{
+				for (UINT32 x = region.left; x < region.right; x++)
+				{
+					const UINT32 imageX = x << level, imageY = y << level;
+					*pixels++ = Graphics::Pixel(static_cast<BYTE>(imageX >> 7), static_cast<BYTE>(imageY >> 7),
+						((imageX >> 9) ^ (imageY >> 9)) & 1 ? 200 : 40, 0xFF);
+				}
+			}
+			return true;
+		}
+	};
+
+	struct LargeImageContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer{ 1 };
+		Render::Framebuffer target{ 1280, 720 };
+		Render::CommandBuffer commands;
+		Graphics::LargeImage* pImage = nullptr;
+		UINT64 frame = 0;
+	};
+
+	/**
+	 * @brief Add a 32768 x 32768 image of 256 px tiles, decoded by 2 threads, to a 1280 x 720 viewport.
+	 */
+	void buildLargeImage(_Inout_ LargeImageContext& large)
+	{
+		const ComponentId id = large.window.emplaceComponent<Graphics::LargeImage>(0, D2D1_POINT_2F{ -8000.0f, -8000.0f },
+			std::unique_ptr<Graphics::TileSource>(new GradientTileSource()), 256, 2);
+		large.pImage = static_cast<Graphics::LargeImage*>(large.window.getComponent(id));
+		large.pImage->setViewport(D2D1::RectF(0.0f, 0.0f, 1280.0f, 720.0f));
+	}
+
+	/**
+	 * @brief Record and render a frame of the image.
+	 */
+	void drawLargeImage(_Inout_ LargeImageContext& large)
+	{
+		large.commands.reset();
+		large.pImage->record(large.commands.getLayer(0));
+		large.renderer.render(large.commands, large.window.getResources(), large.target);
+	}
+
+	/**
+	 * @brief Record the still image, every visible tile decoded.
+	 */
+	void benchRecordStill(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		LargeImageContext& large = *reinterpret_cast<LargeImageContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			large.commands.reset();
+			large.pImage->record(large.commands.getLayer(0));
+		}
+		Benchmark::doNotOptimize(large.commands.getLayer(0).getCommands().data());
+	}
+
+	/**
+	 * @brief Draw a frame of a pan at full resolution, 24 x 12 pixels per frame: the tiles coming into view are queued.
+	 */
+	void benchPan(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		LargeImageContext& large = *reinterpret_cast<LargeImageContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const float frame = static_cast<float>(large.frame++ % 1000);
+			large.pImage->setPos({ -8000.0f - 24.0f * frame, -8000.0f - 12.0f * frame });
+			drawLargeImage(large);
+		}
+		Benchmark::doNotOptimize(large.target.pixels.data());
+	}
+
+	/**
+	 * @brief Draw a frame of a zoom from 1:1 to the whole image and back, around the center, in 600 frames.
+	 */
+	void benchZoom(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		LargeImageContext& large = *reinterpret_cast<LargeImageContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const UINT64 frame = large.frame++ % 600;
+			const float progress = frame < 300 ? frame / 299.0f : (599 - frame) / 299.0f;
+			const float scale = std::pow(2.0f, -7.5f * progress);
+			const float center = LARGE_IMAGE_SIZE / 2.0f;
+			large.pImage->setScale({ scale, scale });
+			large.pImage->setPos({ 640.0f - center * scale, 360.0f - center * scale });
+			drawLargeImage(large);
+		}
+		Benchmark::doNotOptimize(large.target.pixels.data());
+	}
+
+	/**
+	 * @brief Report the memory of the decoded tiles: the most held in a frame since the image was built, and in the last frame.
+	 */
+	void readLargeImageCounters(_In_opt_ void* context, _Inout_ std::vector<Benchmark::Counter>* counters)
+	{
+		const Graphics::LargeImageStats& stats = reinterpret_cast<LargeImageContext*>(context)->pImage->getStats();
+		counters->push_back({ "peak_resident_mb", static_cast<double>(stats.peakResidentBytes) / (1 << 20) });
+		counters->push_back({ "resident_mb", static_cast<double>(stats.lastFrameResidentBytes) / (1 << 20) });
+		counters->push_back({ "evicted_tiles", static_cast<double>(stats.evictedTiles) });
+	}
+
+
+	void addLargeImageBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static LargeImageContext still, pan, zoom;
+		buildLargeImage(still);
+		buildLargeImage(pan);
+		buildLargeImage(zoom);
+
+		// The still image is drawn until its visible tiles are decoded.
+		for (int i = 0; i < 1000; i++)
+		{
+			drawLargeImage(still);
+			if (still.pImage->isComplete() && still.pImage->getStats().lastFramePending == 0) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+
+		suite.add("large_image/record/32768x32768_still", benchRecordStill, &still);
+		suite.add("large_image/pan/32768x32768_24px_per_frame", benchPan, &pan, 0, readLargeImageCounters);
+		suite.add("large_image/zoom/32768x32768_1_to_181", benchZoom, &zoom, 0, readLargeImageCounters);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,95 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "LayerCache.h"
+#include "Replay.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr ZIndex LAYER_COUNT = 20;
+	constexpr ZIndex ANIMATED_LAYER = 10;
+
+	struct LayerContext
+	{
+		Replay::HeadlessWindow window;
+		Graphics::Component* pMoving = nullptr;
+		UINT64 frame = 0;
+	};
+
+	/**
+	 * @brief Fill a window with 20 z-indexes of 50 shapes each, one of them animated, all cached or none.
+	 */
+	void buildLayers(_Inout_ LayerContext& layers, _In_ bool cached)
+	{
+		std::mt19937 random(3);
+		for (ZIndex zIndex = 0; zIndex < LAYER_COUNT; zIndex++)
+		{
+			for (int i = 0; i < 50; i++)
+			{
+				const D2D1_POINT_2F pos = { static_cast<float>(random() % 1200), static_cast<float>(random() % 680) };
+				const UINT32 color = 0x80000000u | (random() & 0xFFFFFF);
+				const ComponentId id = i % 2 == 0
+					? layers.window.addComponent(std::make_unique<Graphics::RectangleShape>(pos, D2D1_SIZE_F{ 60.0f, 30.0f }, color, 4.0f, 4.0f), zIndex)
+					: layers.window.addComponent(std::make_unique<Graphics::EllipseShape>(pos, D2D1_SIZE_F{ 40.0f, 40.0f }, color), zIndex);
+				if (zIndex == ANIMATED_LAYER && i == 0) layers.pMoving = layers.window.getComponent(id);
+			}
+			layers.window.setLayerCached(zIndex, cached);
+		}
+		// Room for the 20 bitmaps of the headless client size.
+		layers.window.getLayerCache().setMemoryBudget(static_cast<size_t>(Headless::clientWidth) * Headless::clientHeight * 4 * LAYER_COUNT);
+	}
+
+	/**
+	 * @brief Move a shape of the animated z-index, then paint the frame through the layer cache.
+	 *
+	 * @note The headless render target draws nothing: the time is the CPU side of a frame, recording,
+	 *       culling, and comparing each cached z-index with the commands its bitmap was built with.
+	 */
+	void benchPaintLayers(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		LayerContext& layers = *reinterpret_cast<LayerContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			layers.pMoving->setPos({ static_cast<float>(layers.frame++ % 1200), 100.0f });
+			layers.window.paintFrame();
+		}
+		Benchmark::doNotOptimize(layers.window.getLayerCache());
+	}
+
+	/**
+	 * @brief Report the hit rate of the animated z-index, and the lowest of the static ones.
+	 */
+	void readLayerCounters(_In_opt_ void* context, _Inout_ std::vector<Benchmark::Counter>* counters)
+	{
+		LayerContext& layers = *reinterpret_cast<LayerContext*>(context);
+		const Render::LayerCache& cache = layers.window.getLayerCache();
+		if (!cache.isLayerCached(ANIMATED_LAYER)) return;
+
+		double staticHitRate = 1.0;
+		for (ZIndex zIndex = 0; zIndex < LAYER_COUNT; zIndex++)
+		{
+			if (zIndex != ANIMATED_LAYER) staticHitRate = (std::min)(staticHitRate, cache.getStats(zIndex)->getHitRate());
+		}
+		counters->push_back({ "animated_hit_rate", cache.getStats(ANIMATED_LAYER)->getHitRate() });
+		counters->push_back({ "static_hit_rate", staticHitRate });
+	}
+
+
+	void addLayerBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static LayerContext cached, uncached;
+		buildLayers(cached, true);
+		buildLayers(uncached, false);
+
+		suite.add("layers/paint/20_one_animated_cached", benchPaintLayers, &cached, 0, readLayerCounters);
+		suite.add("layers/paint/20_one_animated_uncached", benchPaintLayers, &uncached);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,103 @@
+#include "Benchmarks.h"
+
+#include "ParticleSystem.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr size_t PARTICLE_COUNT = 1000000;
+
+	struct ParticleContext
+	{
+		Replay::HeadlessWindow window;
+		ThreadPool pool;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1280, 720 };
+		Render::CommandBuffer commands;
+		Graphics::ParticleSystem* pParticles = nullptr;
+
+		explicit ParticleContext(_In_ unsigned int threadCount) : pool(threadCount), renderer(threadCount) {}
+	};
+
+	/**
+	 * @brief Fill a particle system with 1M particles, respawned as fast as they die.
+	 *
+	 * @note The particles live 1 to 2 seconds: after 120 frames, the emitter only replaces the dead ones.
+	 */
+	void buildParticles(_Inout_ ParticleContext& particles, _In_ bool isThreaded)
+	{
+		const ComponentId id = particles.window.emplaceComponent<Graphics::ParticleSystem>(0, D2D1_POINT_2F{ 0.0f, 0.0f }, PARTICLE_COUNT);
+		particles.pParticles = static_cast<Graphics::ParticleSystem*>(particles.window.getComponent(id));
+		particles.pParticles->setAutoUpdate(false);
+		if (isThreaded) particles.pParticles->setThreadPool(&particles.pool);
+
+		Graphics::ParticleEmitter emitter;
+		emitter.area = { 1280.0f, 720.0f };
+		emitter.rate = PARTICLE_COUNT / 1.5f * 1.1f;
+		emitter.minSpeed = 5.0f;
+		emitter.maxSpeed = 40.0f;
+		particles.pParticles->addEmitter(emitter);
+		particles.pParticles->setGravity({ 0.0f, 30.0f });
+		particles.pParticles->setColorOverLife(0xFFFF8020u, 0x002040FFu);
+		particles.pParticles->setSizeOverLife(3.0f, 1.0f);
+		for (int frame = 0; frame < 120; frame++)
+			particles.pParticles->update(1.0f / 60.0f);
+
+		particles.pParticles->record(particles.commands.getLayer(0));
+	}
+
+	/**
+	 * @brief Advance the particles by a frame at 60 Hz.
+	 */
+	void benchUpdateParticles(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ParticleContext& particles = *reinterpret_cast<ParticleContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			particles.pParticles->update(1.0f / 60.0f);
+		Benchmark::doNotOptimize(particles.pParticles->getCount());
+	}
+
+	/**
+	 * @brief Record the sprite batch of the particles.
+	 */
+	void benchRecordParticles(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ParticleContext& particles = *reinterpret_cast<ParticleContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			particles.commands.reset();
+			particles.pParticles->record(particles.commands.getLayer(0));
+		}
+		Benchmark::doNotOptimize(particles.commands.getLayer(0).getCommands().data());
+	}
+
+	/**
+	 * @brief Render the recorded sprite batch in tiles.
+	 */
+	void benchRenderParticles(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ParticleContext& particles = *reinterpret_cast<ParticleContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			particles.renderer.render(particles.commands, particles.window.getResources(), particles.target);
+		Benchmark::doNotOptimize(particles.target.pixels.data());
+	}
+
+
+	void addParticleBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static ParticleContext threaded(0), single(1);
+		buildParticles(threaded, true);
+		buildParticles(single, false);
+
+		suite.add("particles/update/1000000", benchUpdateParticles, &threaded);
+		suite.add("particles/update/1000000_single_thread", benchUpdateParticles, &single);
+		suite.add("particles/record/1000000", benchRecordParticles, &threaded);
+		suite.add("particles/render/1000000", benchRenderParticles, &threaded);
+		suite.add("particles/render/1000000_single_thread", benchRenderParticles, &single);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,101 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "FrameSnapshot.h"
+#include "GraphicComponents.h"
+#include "WindowClass.h"
+
+
+namespace Benchmarks
+{
+
+	/**
+	 * @brief A window run by its own main loop, presenting at 60 Hz like a swap chain synchronized on the vsync.
+	 *
+	 * @note The loop takes the messages of the headless queue: CM_UPDATEFRAME paints the frames through paintFrame,
+	 *       or submitFrame and the render thread, as on Windows. The window measures the latency of the inputs,
+	 *       from their dispatch to the end of the first present that reflects them.
+	 */
+	struct PresentContext
+	{
+		static constexpr UINT64 INPUTS_PER_ITERATION = 30;
+
+		BaseWindow* pWindow;
+		bool isThreaded;
+	};
+
+	/**
+	 * @brief Post mouse moves at any time of the frames, one or two frames apart, then close the window.
+	 */
+	void postInputs(_In_ UINT64 count)
+	{
+		std::mt19937 random(42);
+		for (UINT64 i = 0; i < count; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(16000 + random() % 16000));
+			PostMessage(NULL, WM_MOUSEMOVE, 0, 0);
+		}
+
+		// The last input is presented within 3 frames.
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		PostMessage(NULL, WM_DESTROY, 0, 0);
+	}
+
+	/**
+	 * @brief Run the main loop while inputs are posted by another thread, like the system does.
+	 *
+	 * @note An iteration posts 30 inputs, 24 ms apart on average: the latency is in the counters, not in the time.
+	 */
+	void benchInputLatency(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		PresentContext& present = *reinterpret_cast<PresentContext*>(context);
+		present.pWindow->setThreadedRendering(present.isThreaded);
+		present.pWindow->resetPresentStats();
+		Headless::vsyncIntervalMs = 1000.0 / 60.0;
+
+		std::thread user(postInputs, iterations * PresentContext::INPUTS_PER_ITERATION);
+		present.pWindow->mainLoop();
+		user.join();
+		Headless::vsyncIntervalMs = 0.0;
+	}
+
+	/**
+	 * @brief Report the latency of the inputs and the frames of the last run, counted by the window.
+	 */
+	void readPresentCounters(_In_opt_ void* context, _Inout_ std::vector<Benchmark::Counter>* counters)
+	{
+		const Render::PresentStats& stats = reinterpret_cast<PresentContext*>(context)->pWindow->getPresentStats();
+		counters->push_back({ "latency_ms", stats.getAverageLatencyMs() });
+		counters->push_back({ "max_latency_ms", stats.maxLatencyMs });
+		counters->push_back({ "frames_presented", static_cast<double>(stats.framesPresented) });
+		counters->push_back({ "frames_dropped", static_cast<double>(stats.framesDropped) });
+	}
+
+	void buildPresentScene(_Inout_ BaseWindow& window)
+	{
+		std::mt19937 random(42);
+		for (UINT32 i = 0; i < 600; i++)
+		{
+			const D2D1_POINT_2F pos = { static_cast<float>(random() % 1200), static_cast<float>(random() % 700) };
+			window.addComponent(std::make_unique<Graphics::EllipseShape>(pos, D2D1_SIZE_F{ 50.0f, 50.0f }, 0xC0306090u), static_cast<int>(i % 4));
+		}
+	}
+
+
+	void addPresentBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		// One window: its events are registered for good by show, every window would paint on each CM_UPDATEFRAME.
+		static BaseWindow window(nullptr, L"PresentBenchmarks", L"PresentBenchmarks");
+		buildPresentScene(window);
+		window.show(SW_SHOW);
+
+		static PresentContext single = { &window, false }, threaded = { &window, true };
+		suite.add("present/input_latency/main_thread", benchInputLatency, &single, 0, readPresentCounters);
+		suite.add("present/input_latency/render_thread", benchInputLatency, &threaded, 0, readPresentCounters);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,44 @@
+#include "Benchmarks.h"
+
+#include "Profiler.h"
+
+
+namespace Benchmarks
+{
+
+	/**
+	 * @brief Open and close a zone, while no capture runs: a relaxed load.
+	 */
+	void benchIdleZone(_In_ UINT64 iterations, _Inout_opt_ void* /*context*/)
+	{
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Profiler::Zone zone("idle");
+			Benchmark::doNotOptimize(zone);
+		}
+	}
+
+	/**
+	 * @brief Open and close a zone during a capture: two time stamps, written to the thread's ring buffer.
+	 *
+	 * @note The zones should cost less than 50 ns each, to be left in the frame's hot paths.
+	 */
+	void benchCapturedZone(_In_ UINT64 iterations, _Inout_opt_ void* /*context*/)
+	{
+		Profiler::beginCapture(1);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Profiler::Zone zone("captured");
+			Benchmark::doNotOptimize(zone);
+		}
+		Profiler::markFrame();
+	}
+
+
+	void addProfilerBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		suite.add("profiler/zone/idle", benchIdleZone);
+		suite.add("profiler/zone/captured", benchCapturedZone);
+	}
+
+} // namespace Benchmarks
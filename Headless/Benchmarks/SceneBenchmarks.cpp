@@ -0,0 +1,76 @@
+#include "Benchmarks.h"
+
+#include <vector>
+
+#include "SceneGraph.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr UINT32 SCENE_NODES = 100000;
+	constexpr UINT32 SCENE_GROUPS = 100;
+
+	struct SceneContext
+	{
+		Graphics::SceneGraph scene;
+		Graphics::NodeId root = Graphics::INVALID_NODE;
+		Graphics::NodeId leaf = Graphics::INVALID_NODE;
+		Graphics::NodeId moved = Graphics::INVALID_NODE;
+		UINT64 frame = 0;
+	};
+
+	/**
+	 * @brief Build a tree of 100k nodes: a root, 100 groups under it, and the leaves spread over the groups.
+	 */
+	void buildScene(_Inout_ SceneContext& scene)
+	{
+		Graphics::LocalTransform local;
+		scene.root = scene.scene.create(Graphics::INVALID_NODE, local);
+
+		std::vector<Graphics::NodeId> groups;
+		for (UINT32 i = 0; i < SCENE_GROUPS; i++)
+		{
+			local.position = { static_cast<float>(i % 10) * 100.0f, static_cast<float>(i / 10) * 100.0f };
+			local.rotation = 0.01f * i;
+			groups.push_back(scene.scene.create(scene.root, local));
+		}
+		for (UINT32 i = 0; i < SCENE_NODES - SCENE_GROUPS - 1; i++)
+		{
+			local.position = { static_cast<float>(i % 7) * 4.0f, static_cast<float>(i % 11) * 4.0f };
+			local.rotation = 0.0f;
+			scene.leaf = scene.scene.create(groups[i % SCENE_GROUPS], local);
+			scene.scene.setSize(scene.leaf, { 8.0f, 8.0f });
+		}
+		scene.scene.update();
+	}
+
+	/**
+	 * @brief Move a node, then update the world transforms: its whole subtree is recomputed.
+	 */
+	void benchMoveNode(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		SceneContext& scene = *reinterpret_cast<SceneContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const float offset = static_cast<float>(scene.frame++ % 64);
+			scene.scene.setPosition(scene.moved, { offset, offset * 0.5f });
+			scene.scene.update();
+		}
+		Benchmark::doNotOptimize(scene.scene.getWorld(scene.leaf));
+	}
+
+
+	void addSceneBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static SceneContext rootMoved, leafMoved;
+		buildScene(rootMoved);
+		rootMoved.moved = rootMoved.root;
+		buildScene(leafMoved);
+		leafMoved.moved = leafMoved.leaf;
+
+		suite.add("scene/move/100000_nodes_root", benchMoveNode, &rootMoved);
+		suite.add("scene/move/100000_nodes_leaf", benchMoveNode, &leafMoved);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,117 @@
+#include "Benchmarks.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GeometryCache.h"
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Benchmarks
+{
+
+	struct ShapeContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+	};
+
+	/**
+	 * @brief Draw every shape of the window: record, then render in tiles.
+	 */
+	void benchPaintShapes(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		ShapeContext& shapes = *reinterpret_cast<ShapeContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			shapes.window.renderOffscreen(shapes.renderer, shapes.target);
+		Benchmark::doNotOptimize(shapes.target.pixels.data());
+	}
+
+	/**
+	 * @brief Fill a window with rectangles, rounded rectangles, ellipses and paths, filled or outlined.
+	 *
+	 * @note The sizes take 16 values per axis: identical shapes share their geometry, as gizmos and widgets do.
+	 */
+	void buildShapes(_Inout_ BaseWindow& window, _In_ UINT32 count)
+	{
+		std::mt19937 random(36);
+		for (UINT32 i = 0; i < count; i++)
+		{
+			const D2D1_POINT_2F pos = { static_cast<float>(random() % 1880), static_cast<float>(random() % 1040) };
+			const D2D1_SIZE_F size = { static_cast<float>(8 + (random() % 16) * 2), static_cast<float>(8 + (random() % 16) * 2) };
+			const UINT32 color = 0x80000000u | (random() & 0xFFFFFF);
+
+			std::unique_ptr<Graphics::Shape> shape;
+			switch (i % 4)
+			{
+			case 0:
+				shape = std::make_unique<Graphics::RectangleShape>(pos, size, color);
+				break;
+			case 1:
+				shape = std::make_unique<Graphics::RectangleShape>(pos, size, color, 4.0f, 4.0f);
+				break;
+			case 2:
+				shape = std::make_unique<Graphics::EllipseShape>(pos, size, color);
+				break;
+			default:
+				shape = std::make_unique<Graphics::PathShape>(pos, std::vector<D2D1_POINT_2F>{ { 0.0f, size.height }, { size.width / 2.0f, 0.0f }, { size.width, size.height } }, true, color);
+				break;
+			}
+			if (i % 3 == 0) shape->setStroke(0xFF000000u, 2.0f);
+			window.addComponent(std::move(shape), static_cast<int>(i % 8));
+		}
+	}
+
+	struct GeometryContext
+	{
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+		UINT32 geometries = 4096;
+	};
+
+	/**
+	 * @brief Draw geometries never rasterized yet: the tiles rasterize their spans concurrently.
+	 */
+	void benchRasterizeGeometries(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		GeometryContext& geometries = *reinterpret_cast<GeometryContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Render::ResourceTable resources;
+			Render::CommandBuffer commands;
+			Render::CommandList& layer = commands.getLayer(0);
+			for (UINT32 g = 0; g < geometries.geometries; g++)
+			{
+				Render::ShapeDesc desc;
+				desc.type = (g % 2 == 0) ? Render::ShapeType::Ellipse : Render::ShapeType::RoundedRectangle;
+				desc.width = static_cast<float>(16 + g % 64);
+				desc.height = static_cast<float>(16 + g / 64 % 64);
+				desc.radiusX = desc.radiusY = 6.0f;
+				const Render::GeometryId id = resources.getGeometries().acquire(desc);
+
+				const D2D1_RECT_F bounds = resources.getGeometries().getBounds(id);
+				const float x = static_cast<float>((g * 37) % 1840), y = static_cast<float>((g * 53) % 1000);
+				layer.fillGeometry(id, { x + bounds.left, y + bounds.top, x + bounds.right, y + bounds.bottom }, 0xC0206080u);
+			}
+			geometries.renderer.render(commands, resources, geometries.target);
+		}
+		Benchmark::doNotOptimize(geometries.target.pixels.data());
+	}
+
+
+	void addShapeBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static ShapeContext shapes;
+		buildShapes(shapes.window, 50000);
+		suite.add("shapes/paint/50000_mixed", benchPaintShapes, &shapes);
+
+		static GeometryContext geometries;
+		suite.add("shapes/rasterize_cold/4096_geometries", benchRasterizeGeometries, &geometries);
+	}
+
+} // namespace Benchmarks
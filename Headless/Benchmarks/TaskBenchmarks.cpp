@@ -0,0 +1,78 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "Task.h"
+
+
+namespace Benchmarks
+{
+
+	struct TaskContext
+	{
+		Tasks::TaskScheduler scheduler;
+		Tasks::TimePoint now = std::chrono::steady_clock::now();
+		UINT64 counter = 0;
+	};
+
+	Tasks::Task everyFrame(_Inout_ UINT64& counter)
+	{
+		while (true)
+		{
+			co_await Tasks::nextFrame();
+			counter++;
+		}
+	}
+
+	Tasks::Task waitLong(_Inout_ UINT64& counter)
+	{
+		co_await Tasks::delay(3600.0f);
+		counter++;
+	}
+
+	/**
+	 * @brief One frame of tasks all resumed: advance the frame, then update.
+	 */
+	void benchResumeFrame(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TaskContext& tasks = *reinterpret_cast<TaskContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			tasks.scheduler.advanceFrame();
+			tasks.now += std::chrono::milliseconds(16);
+			tasks.scheduler.update(tasks.now);
+		}
+		Benchmark::doNotOptimize(tasks.counter);
+	}
+
+	/**
+	 * @brief Start a delayed task and cancel it, among the running tasks: the waits left behind are purged.
+	 */
+	void benchSpawnCancel(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TaskContext& tasks = *reinterpret_cast<TaskContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			tasks.scheduler.cancel(tasks.scheduler.spawn(waitLong(tasks.counter)));
+		Benchmark::doNotOptimize(tasks.scheduler.getCount());
+	}
+
+
+	void addTaskBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		// Never destroyed: the frames of the tasks go back to the thread's pool, destroyed before the statics.
+		TaskContext& frames = *new TaskContext;
+		for (UINT32 i = 0; i < 100000; i++)
+			frames.scheduler.spawn(everyFrame(frames.counter));
+		suite.add("tasks/resume_frame/100000", benchResumeFrame, &frames);
+
+		TaskContext& delayed = *new TaskContext;
+		for (UINT32 i = 0; i < 100000; i++)
+			delayed.scheduler.spawn(waitLong(delayed.counter));
+		suite.add("tasks/spawn_cancel/100000_delayed", benchSpawnCancel, &delayed);
+	}
+
+} // namespace Benchmarks
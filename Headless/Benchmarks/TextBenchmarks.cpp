@@ -0,0 +1,92 @@
+#include "Benchmarks.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GlyphCache.h"
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Benchmarks
+{
+
+	struct TextContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer;
+		Render::Framebuffer target{ 1920, 1080 };
+		std::vector<Graphics::Text*> texts;
+		UINT64 next = 0;
+	};
+
+	/**
+	 * @brief Add 10k labels to a 1920x1080 window, drawn with the bundled font: one string in ten is shared.
+	 */
+	void buildLabels(_Inout_ TextContext& text)
+	{
+		text.window.getGlyphCache().setRasterizer(std::make_unique<Render::BuiltinGlyphRasterizer>());
+
+		std::mt19937 random(5);
+		for (UINT32 i = 0; i < 10000; i++)
+		{
+			const D2D1_POINT_2F pos = { static_cast<float>(random() % 1800), static_cast<float>(random() % 1060) };
+			const std::wstring label = i % 10 == 0 ? L"Shared label" : L"Label " + std::to_wstring(i);
+			const ComponentId id = text.window.addComponent(std::make_unique<Graphics::Text>(pos, label, L"Builtin", 16, 0xFFE0E0E0u), static_cast<int>(i % 8));
+			text.texts.push_back(static_cast<Graphics::Text*>(text.window.getComponent(id)));
+		}
+	}
+
+	void benchPaintLabels(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TextContext& text = *reinterpret_cast<TextContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			text.window.renderOffscreen(text.renderer, text.target);
+		Benchmark::doNotOptimize(text.target.pixels.data());
+	}
+
+	/**
+	 * @brief Change the string of a label, to one already shaped: the layout only pays for the line breaking.
+	 */
+	void benchSetLabel(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TextContext& text = *reinterpret_cast<TextContext*>(context);
+		Render::CommandList commands;
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Graphics::Text& label = *text.texts[(text.next++ * 7919) % text.texts.size()];
+			label.setText(label.getText() == L"Shared label" ? L"Label 1" : L"Shared label");
+			commands.reset();
+			label.record(commands);
+		}
+		Benchmark::doNotOptimize(commands.getCommands().data());
+	}
+
+	/**
+	 * @brief Report the glyphs and atlas pages of the labels, and how often a layout found its string shaped.
+	 */
+	void readTextCounters(_In_opt_ void* context, _Inout_ std::vector<Benchmark::Counter>* counters)
+	{
+		TextContext& text = *reinterpret_cast<TextContext*>(context);
+		const Render::GlyphCacheStats stats = text.window.getGlyphCache().getStats();
+		const UINT64 layouts = stats.runHits + stats.runMisses;
+		counters->push_back({ "glyphs", static_cast<double>(stats.glyphs) });
+		counters->push_back({ "pages", static_cast<double>(stats.pages) });
+		counters->push_back({ "run_hit_rate", layouts == 0 ? 0.0 : static_cast<double>(stats.runHits) / static_cast<double>(layouts) });
+	}
+
+
+	void addTextBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static TextContext paint, layout;
+		buildLabels(paint);
+		buildLabels(layout);
+
+		suite.add("text/paint/10000_labels", benchPaintLabels, &paint, 0, readTextCounters);
+		suite.add("text/set_text/10000_labels", benchSetLabel, &layout, 0, readTextCounters);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,70 @@
+#include "Benchmarks.h"
+
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "ImageDecoder.h"
+#include "TextureStore.h"
+
+
+namespace Benchmarks
+{
+
+	struct TextureContext
+	{
+		Render::TextureStore store;
+		Render::TextureId id = Render::INVALID_TEXTURE;
+		std::vector<Graphics::Pixel> pixels; // Decoded into.
+
+		void add(_In_ const std::vector<Graphics::Pixel>& source, _In_ UINT32 width, _In_ UINT32 height)
+		{
+			id = store.add(source.data(), width, height);
+			pixels.assign(source.size(), Graphics::Pixel(0x00, 0x00));
+		}
+	};
+
+	/**
+	 * @brief Decode a texture, as its upload does when the store evicted its pixels.
+	 */
+	void benchDecodeTexture(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TextureContext& texture = *reinterpret_cast<TextureContext*>(context);
+		const Render::CompressedTexture& compressed = *texture.store.get(texture.id);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			Render::decodeTexture(compressed, texture.pixels.data());
+			Benchmark::doNotOptimize(texture.pixels.data());
+		}
+	}
+
+	/**
+	 * @brief Report how much smaller the texture is kept, and in which format.
+	 */
+	void readTextureCounters(_In_opt_ void* context, _Inout_ std::vector<Benchmark::Counter>* counters)
+	{
+		const TextureContext& texture = *reinterpret_cast<TextureContext*>(context);
+		const Render::TextureStats& stats = texture.store.getStats();
+		counters->push_back({ "ratio", stats.getCompressionRatio() });
+		counters->push_back({ "compressed_bytes", static_cast<double>(stats.compressedBytes) });
+		counters->push_back({ "format", static_cast<double>(texture.store.get(texture.id)->format) });
+	}
+
+
+	void addTextureBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static TextureContext palette, rgba, flat;
+
+		Codec::DecodedImage image;
+		if (Codec::loadImage(getImagePath(L"test.png").c_str(), image))
+			palette.add(image.frames[0].pixels, image.width, image.height);
+		if (Codec::loadImage(getImagePath(L"image.png").c_str(), image))
+			rgba.add(image.frames[0].pixels, image.width, image.height);
+		flat.add(std::vector<Graphics::Pixel>(1024 * 1024, Graphics::Pixel(0x30, 0x60, 0x90, 0xFF)), 1024, 1024);
+
+		// The throughput is given in decoded bytes.
+		suite.add("textures/decode/210x208_palette", benchDecodeTexture, &palette, 210ull * 208 * sizeof(Graphics::Pixel), readTextureCounters);
+		suite.add("textures/decode/800x600_rgba", benchDecodeTexture, &rgba, 800ull * 600 * sizeof(Graphics::Pixel), readTextureCounters);
+		suite.add("textures/decode/1024x1024_flat", benchDecodeTexture, &flat, 1024ull * 1024 * sizeof(Graphics::Pixel), readTextureCounters);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,131 @@
+#include "Benchmarks.h"
+
+#include <random>
+#include <vector>
+
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+#include "TileMap.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr UINT32 MAP_TILES = 4096;
+	constexpr UINT32 TILE_SIZE = 16;
+
+	struct TileMapContext
+	{
+		Replay::HeadlessWindow window;
+		Render::SoftwareRenderer renderer{ 1 };
+		Render::Framebuffer target{ 1280, 720 };
+		Render::CommandBuffer commands;
+		Graphics::TileMap* pMap = nullptr;
+		std::vector<Graphics::TileIndex> tiles;
+		std::mt19937 random{ 47 };
+		UINT64 frame = 0;
+	};
+
+	/**
+	 * @brief Fill a window with a 4096 x 4096 map of 16 x 16 tiles picked at random in a tileset of 256 opaque tiles.
+	 */
+	void buildTileMap(_Inout_ TileMapContext& map)
+	{
+		const ComponentId id = map.window.emplaceComponent<Graphics::TileMap>(0, D2D1_POINT_2F{ 0.0f, 0.0f }, nullptr, TILE_SIZE, TILE_SIZE, MAP_TILES, MAP_TILES);
+		map.pMap = static_cast<Graphics::TileMap*>(map.window.getComponent(id));
+
+		std::vector<Graphics::Pixel> tileset(256 * 256, Graphics::Pixel(0, 0));
+		for (Graphics::Pixel& pixel : tileset)
+			pixel = Graphics::Pixel(map.random() & 0xFF, map.random() & 0xFF, map.random() & 0xFF, 0xFF);
+		map.pMap->setTileset(tileset.data(), 256, 256);
+
+		map.tiles.resize(static_cast<size_t>(MAP_TILES) * MAP_TILES);
+		for (Graphics::TileIndex& tile : map.tiles)
+			tile = static_cast<Graphics::TileIndex>(map.random() % 256);
+		map.pMap->setTiles(map.tiles);
+		map.pMap->setViewport(D2D1::RectF(0.0f, 0.0f, 1280.0f, 720.0f));
+	}
+
+	/**
+	 * @brief Scroll the map by 7 x 3 pixels, wrapping before its end, and record it.
+	 */
+	void scrollTileMap(_Inout_ TileMapContext& map)
+	{
+		const UINT64 frame = map.frame++ % 8192;
+		map.pMap->setPos({ -7.0f * frame, -3.0f * frame });
+		map.commands.reset();
+		map.pMap->record(map.commands.getLayer(0));
+	}
+
+	/**
+	 * @brief Record a frame of the scrolling map: the chunks entering the viewport are composed.
+	 */
+	void benchScrollRecord(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TileMapContext& map = *reinterpret_cast<TileMapContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			scrollTileMap(map);
+		Benchmark::doNotOptimize(map.commands.getLayer(0).getCommands().data());
+	}
+
+	/**
+	 * @brief Record and render a frame of the scrolling map.
+	 */
+	void benchScrollFrame(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TileMapContext& map = *reinterpret_cast<TileMapContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			scrollTileMap(map);
+			map.renderer.render(map.commands, map.window.getResources(), map.target);
+		}
+		Benchmark::doNotOptimize(map.target.pixels.data());
+	}
+
+	/**
+	 * @brief Change a visible tile, then record the frame: the tile is copied into its cached chunk.
+	 */
+	void benchEditRecord(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TileMapContext& map = *reinterpret_cast<TileMapContext*>(context);
+		const D2D1_POINT_2F pos = map.pMap->getPos();
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			const UINT32 column = static_cast<UINT32>(-pos.x + map.random() % 1280) / TILE_SIZE;
+			const UINT32 row = static_cast<UINT32>(-pos.y + map.random() % 720) / TILE_SIZE;
+			map.pMap->setTile(column, row, static_cast<Graphics::TileIndex>(map.random() % 256));
+			map.commands.reset();
+			map.pMap->record(map.commands.getLayer(0));
+		}
+		Benchmark::doNotOptimize(map.commands.getLayer(0).getCommands().data());
+	}
+
+	/**
+	 * @brief Replace every tile, then record: each visible chunk is composed again.
+	 */
+	void benchColdRecord(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TileMapContext& map = *reinterpret_cast<TileMapContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			map.pMap->setTiles(map.tiles);
+			map.commands.reset();
+			map.pMap->record(map.commands.getLayer(0));
+		}
+		Benchmark::doNotOptimize(map.commands.getLayer(0).getCommands().data());
+	}
+
+
+	void addTileMapBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static TileMapContext map;
+		buildTileMap(map);
+		scrollTileMap(map);
+
+		suite.add("tilemap/scroll/4096x4096_record", benchScrollRecord, &map);
+		suite.add("tilemap/scroll/4096x4096_frame", benchScrollFrame, &map);
+		suite.add("tilemap/edit/visible_tile", benchEditRecord, &map);
+		suite.add("tilemap/cold/4096x4096_all_tiles_replaced", benchColdRecord, &map);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,75 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TimerWheel.h"
+
+
+namespace Benchmarks
+{
+
+	struct TimerContext
+	{
+		Timers::TimePoint origin = std::chrono::steady_clock::now();
+		Timers::TimerWheel wheel{ origin };
+		std::vector<Timers::TimerId> ids;
+		std::mt19937 random{ 39 };
+		UINT64 frame = 0;
+		UINT64 calls = 0;
+	};
+
+	LRESULT onBenchTimer(_In_ HWND /*hwnd*/, _In_ WPARAM /*wParam*/, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
+	{
+		reinterpret_cast<TimerContext*>(context)->calls++;
+		return S_OK;
+	}
+
+	/**
+	 * @brief Replace one of the armed timers by a new one, due within 10 minutes.
+	 */
+	inline void churn(_Inout_ TimerContext& timers)
+	{
+		Timers::TimerId& id = timers.ids[timers.random() % timers.ids.size()];
+		timers.wheel.cancel(id);
+		id = timers.wheel.schedule(timers.random() % 600000, 0, onBenchTimer, &timers);
+	}
+
+	void benchTimerChurn(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TimerContext& timers = *reinterpret_cast<TimerContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+			churn(timers);
+		Benchmark::doNotOptimize(timers.wheel.getCount());
+	}
+
+	/**
+	 * @brief A 16 ms frame: 20 timers replaced, then the wheel advanced, calling the timers due.
+	 */
+	void benchTimerFrame(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TimerContext& timers = *reinterpret_cast<TimerContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			for (UINT32 c = 0; c < 20; c++)
+				churn(timers);
+			timers.wheel.advance(timers.origin + std::chrono::milliseconds(16 * ++timers.frame));
+		}
+		Benchmark::doNotOptimize(timers.calls);
+	}
+
+
+	void addTimerBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static TimerContext timers;
+		timers.ids.resize(1000000);
+		for (Timers::TimerId& id : timers.ids)
+			id = timers.wheel.schedule(timers.random() % 600000, 0, onBenchTimer, &timers);
+
+		suite.add("timers/cancel_schedule/1000000_armed", benchTimerChurn, &timers);
+		suite.add("timers/frame/1000000_armed", benchTimerFrame, &timers);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,63 @@
+#include "Benchmarks.h"
+
+#include <random>
+
+#include "ThreadPool.h"
+#include "TransformStore.h"
+
+
+namespace Benchmarks
+{
+
+	constexpr UINT32 ENTITY_COUNT = 1000000;
+
+	struct TransformContext
+	{
+		Graphics::TransformStore store;
+		ThreadPool* pPool = nullptr;
+	};
+
+	/**
+	 * @brief Fill a store with 1M moving entities of random sizes and rotations.
+	 */
+	void buildTransforms(_Inout_ Graphics::TransformStore& store)
+	{
+		std::mt19937 random(32);
+		std::uniform_real_distribution<float> coordinate(0.0f, 1920.0f), speed(-60.0f, 60.0f), angle(0.0f, 6.2831855f);
+		for (UINT32 i = 0; i < ENTITY_COUNT; i++)
+		{
+			const Graphics::TransformIndex index = store.create({ coordinate(random), coordinate(random) });
+			store.setSize(index, { 16.0f, 8.0f });
+			store.setRotation(index, angle(random));
+			store.setVelocity(index, { speed(random), speed(random) });
+		}
+	}
+
+	/**
+	 * @brief Move every entity by its velocity for a frame at 60 Hz, then compute the bounds they are culled with.
+	 */
+	void benchMoveEntities(_In_ UINT64 iterations, _Inout_opt_ void* context)
+	{
+		TransformContext& transforms = *reinterpret_cast<TransformContext*>(context);
+		for (UINT64 i = 0; i < iterations; i++)
+		{
+			transforms.store.applyVelocity(1.0f / 60.0f, transforms.pPool);
+			transforms.store.computeBounds(transforms.pPool);
+		}
+		Benchmark::doNotOptimize(transforms.store.getBounds(0));
+	}
+
+
+	void addTransformBenchmarks(_Inout_ Benchmark::Suite& suite)
+	{
+		static ThreadPool pool;
+		static TransformContext serial, parallel;
+		buildTransforms(serial.store);
+		buildTransforms(parallel.store);
+		parallel.pPool = &pool;
+
+		suite.add("transforms/move/1000000", benchMoveEntities, &serial);
+		suite.add("transforms/move/1000000_parallel", benchMoveEntities, &parallel);
+	}
+
+} // namespace Benchmarks
@@ -0,0 +1,12 @@
+#pragma once
+#ifndef HEADLESS_COMPAT_H
+#define HEADLESS_COMPAT_H
+
+/**
+ * Included before every source of the headless build, for the MSVC extensions GCC does not have.
+ */
+
+// Only the components derived from DrawableComponent call their base class with __super.
+#define __super DrawableComponent
+
+#endif // HEADLESS_COMPAT_H
@@ -0,0 +1,380 @@
+#pragma once
+#ifndef HEADLESS_WIN32_H
+#define HEADLESS_WIN32_H
+
+/**
+ * Stand-ins for the parts of the Win32 API the engine uses, to build it on Linux without a window.
+ *
+ * The types have the sizes of their Windows counterparts. The window functions do nothing, except
+ * GetClientRect which returns the client size set in Headless, and the message queue: PostMessage
+ * queues the messages for PeekMessage, DispatchMessage gives them to the procedure of the last class
+ * registered. The GDI glyph functions return empty glyphs: the frames are drawn by the software renderer.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+/**** SAL annotations ****/
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_(size)
+#define _In_reads_bytes_(size)
+#define _Out_writes_(size)
+#define _Out_writes_bytes_(size)
+#define _Inout_updates_bytes_(size)
+
+#define WINAPI
+#define CALLBACK
+#define DECLSPEC_NOVTABLE
+#define interface struct
+
+
+/**** Types ****/
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int DWORD; // 32 bits, unlike the unsigned long of Linux.
+typedef int BOOL;
+typedef int INT;
+typedef unsigned int UINT;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef unsigned short UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef unsigned long long UINT64;
+
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef int32_t HRESULT;
+
+typedef void* HANDLE;
+typedef void* HGDIOBJ;
+typedef struct HWND__* HWND;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef struct HDC__* HDC;
+typedef struct HFONT__* HFONT;
+typedef struct HBITMAP__* HBITMAP;
+
+typedef void* LPVOID;
+typedef char* PSTR;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+
+typedef LRESULT(*WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+
+#define TRUE 1
+#define FALSE 0
+#define INFINITE 0xFFFFFFFF
+
+#define LOWORD(l) (static_cast<WORD>(static_cast<uintptr_t>(l) & 0xFFFF))
+#define HIWORD(l) (static_cast<WORD>((static_cast<uintptr_t>(l) >> 16) & 0xFFFF))
+
+
+/**** Errors ****/
+
+#define S_OK				(static_cast<HRESULT>(0))
+#define S_FALSE				(static_cast<HRESULT>(1))
+#define E_PENDING			(static_cast<HRESULT>(0x8000000A))
+#define E_NOINTERFACE		(static_cast<HRESULT>(0x80004002))
+#define E_FAIL				(static_cast<HRESULT>(0x80004005))
+#define E_OUTOFMEMORY		(static_cast<HRESULT>(0x8007000E))
+#define E_INVALIDARG		(static_cast<HRESULT>(0x80070057))
+#define D2DERR_RECREATE_TARGET	(static_cast<HRESULT>(0x8899000C))
+
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+
+class _com_error
+{
+private:
+	HRESULT m_hr;
+
+public:
+	explicit _com_error(HRESULT hr) noexcept : m_hr(hr) {}
+	HRESULT Error() const noexcept { return m_hr; }
+};
+
+
+/**** COM ****/
+
+/**
+ * @brief Reference counted like a COM object: the last Release deletes it.
+ */
+struct IUnknown
+{
+private:
+	ULONG m_references = 1;
+
+public:
+	virtual ~IUnknown() = default;
+
+	ULONG AddRef() noexcept { return ++m_references; }
+	ULONG Release() noexcept
+	{
+		const ULONG references = --m_references;
+		if (references == 0) delete this;
+		return references;
+	}
+
+	// No stand-in implements another interface than its own.
+	template <typename Q>
+	HRESULT QueryInterface(Q** object) noexcept
+	{
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+};
+
+#define __uuidof(type) 0
+#define COINIT_MULTITHREADED 0
+
+inline HRESULT CoInitialize(LPVOID) { return S_OK; }
+inline HRESULT CoInitializeEx(LPVOID, DWORD) { return S_OK; }
+inline void CoUninitialize() {}
+
+
+/**** Messages ****/
+
+#define WM_DESTROY			0x0002
+#define WM_SIZE				0x0005
+#define WM_SETTEXT			0x000C
+#define WM_PAINT			0x000F
+#define WM_CLOSE			0x0010
+#define WM_GETMINMAXINFO	0x0024
+#define WM_WINDOWPOSCHANGING 0x0046
+#define WM_WINDOWPOSCHANGED	0x0047
+#define WM_NCCALCSIZE		0x0083
+#define WM_KEYFIRST			0x0100
+#define WM_KEYDOWN			0x0100
+#define WM_KEYUP			0x0101
+#define WM_CHAR				0x0102
+#define WM_KEYLAST			0x0109
+#define WM_SYSCOMMAND		0x0112
+#define WM_TIMER			0x0113
+#define WM_MOUSEFIRST		0x0200
+#define WM_MOUSEMOVE		0x0200
+#define WM_LBUTTONDOWN		0x0201
+#define WM_LBUTTONUP		0x0202
+#define WM_RBUTTONDOWN		0x0204
+#define WM_RBUTTONUP		0x0205
+#define WM_MOUSEWHEEL		0x020A
+#define WM_MOUSELAST		0x020E
+#define WM_EXITSIZEMOVE		0x0232
+#define WM_USER				0x0400
+#define WM_APP				0x8000
+
+#define SC_CLOSE			0xF060
+#define VK_F9				0x78
+
+#define PM_REMOVE			0x0001
+#define QS_ALLINPUT			0x04FF
+#define MWMO_INPUTAVAILABLE	0x0004
+#define WAIT_OBJECT_0		0
+#define WAIT_TIMEOUT		258
+
+struct POINT
+{
+	LONG x;
+	LONG y;
+};
+
+struct RECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+struct MSG
+{
+	HWND hwnd;
+	UINT message;
+	WPARAM wParam;
+	LPARAM lParam;
+	DWORD time;
+	POINT pt;
+};
+
+
+/**** Windows ****/
+
+#define SW_SHOW				5
+#define CW_USEDEFAULT		(static_cast<int>(0x80000000))
+#define WS_OVERLAPPEDWINDOW	0x00CF0000
+
+struct WNDCLASS
+{
+	UINT style;
+	WNDPROC lpfnWndProc;
+	int cbClsExtra;
+	int cbWndExtra;
+	HINSTANCE hInstance;
+	HANDLE hIcon;
+	HANDLE hCursor;
+	HANDLE hbrBackground;
+	LPCWSTR lpszMenuName;
+	LPCWSTR lpszClassName;
+};
+
+struct PAINTSTRUCT
+{
+	HDC hdc;
+	BOOL fErase;
+	RECT rcPaint;
+};
+
+namespace Headless
+{
+	/**
+	 * @brief The client size returned by GetClientRect, for every window.
+	 */
+	inline LONG clientWidth = 1280;
+	inline LONG clientHeight = 720;
+
+	/**
+	 * @brief The refresh interval EndDraw waits for, up to the next multiple of it since the start. Zero not to wait.
+	 */
+	inline double vsyncIntervalMs = 0.0;
+
+	/**
+	 * @brief The messages posted to any window, oldest first, and the procedure they are dispatched to.
+	 */
+	inline std::deque<MSG> messages;
+	inline std::mutex messageLock;
+	inline std::condition_variable messagePosted;
+	inline WNDPROC windowProcedure = nullptr;
+}
+
+inline WORD RegisterClass(const WNDCLASS* windowClass) { Headless::windowProcedure = windowClass->lpfnWndProc; return 1; }
+inline HWND CreateWindowEx(DWORD, LPCWSTR, LPCWSTR, DWORD, int, int, int, int, HWND, HANDLE, HINSTANCE, LPVOID) { return nullptr; }
+inline BOOL ShowWindow(HWND, int) { return TRUE; }
+inline BOOL GetClientRect(HWND, RECT* rect)
+{
+	*rect = { 0, 0, Headless::clientWidth, Headless::clientHeight };
+	return TRUE;
+}
+inline BOOL InvalidateRect(HWND, const RECT*, BOOL) { return TRUE; }
+inline HDC BeginPaint(HWND, PAINTSTRUCT* paint) { *paint = {}; return nullptr; }
+inline BOOL EndPaint(HWND, const PAINTSTRUCT*) { return TRUE; }
+
+inline LRESULT DefWindowProc(HWND, UINT, WPARAM, LPARAM) { return 0; }
+inline BOOL PostMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	{
+		std::lock_guard<std::mutex> lock(Headless::messageLock);
+		Headless::messages.push_back({ hwnd, message, wParam, lParam, 0, { 0, 0 } });
+	}
+	Headless::messagePosted.notify_all();
+	return TRUE;
+}
+
+inline BOOL PeekMessage(MSG* msg, HWND, UINT, UINT, UINT remove)
+{
+	std::lock_guard<std::mutex> lock(Headless::messageLock);
+	if (Headless::messages.empty()) return FALSE;
+	*msg = Headless::messages.front();
+	if (remove & PM_REMOVE) Headless::messages.pop_front();
+	return TRUE;
+}
+
+inline BOOL TranslateMessage(const MSG*) { return TRUE; }
+inline LRESULT DispatchMessage(const MSG* msg)
+{
+	return Headless::windowProcedure ? Headless::windowProcedure(msg->hwnd, msg->message, msg->wParam, msg->lParam) : 0;
+}
+inline void PostQuitMessage(int) {}
+
+inline DWORD MsgWaitForMultipleObjectsEx(DWORD count, const HANDLE*, DWORD milliseconds, DWORD, DWORD)
+{
+	// Wakes up when a message is posted, like for the input the flags ask for.
+	std::unique_lock<std::mutex> lock(Headless::messageLock);
+	const bool isPosted = Headless::messagePosted.wait_for(lock, std::chrono::milliseconds(milliseconds), [] { return !Headless::messages.empty(); });
+	return isPosted ? WAIT_OBJECT_0 + count : WAIT_TIMEOUT;
+}
+
+
+/**** System ****/
+
+inline UINT timeBeginPeriod(UINT) { return 0; }
+inline UINT timeEndPeriod(UINT) { return 0; }
+inline void OutputDebugStringA(LPCSTR) {}
+inline void OutputDebugStringW(LPCWSTR) {}
+
+inline DWORD GetCurrentThreadId()
+{
+	return static_cast<DWORD>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+
+/**** GDI ****/
+
+#define FW_NORMAL			400
+#define DEFAULT_CHARSET		1
+#define OUT_DEFAULT_PRECIS	0
+#define CLIP_DEFAULT_PRECIS	0
+#define ANTIALIASED_QUALITY	4
+#define DEFAULT_PITCH		0
+#define FF_DONTCARE			0
+#define GGO_GRAY8_BITMAP	6
+#define GDI_ERROR			0xFFFFFFFF
+
+struct TEXTMETRICW
+{
+	LONG tmHeight;
+	LONG tmAscent;
+	LONG tmDescent;
+	LONG tmInternalLeading;
+	LONG tmExternalLeading;
+	LONG tmAveCharWidth;
+	LONG tmMaxCharWidth;
+};
+
+struct GLYPHMETRICS
+{
+	UINT gmBlackBoxX;
+	UINT gmBlackBoxY;
+	POINT gmptGlyphOrigin;
+	short gmCellIncX;
+	short gmCellIncY;
+};
+
+struct FIXED
+{
+	WORD fract;
+	short value;
+};
+
+struct MAT2
+{
+	FIXED eM11;
+	FIXED eM12;
+	FIXED eM21;
+	FIXED eM22;
+};
+
+inline HDC CreateCompatibleDC(HDC) { return nullptr; }
+inline BOOL DeleteDC(HDC) { return TRUE; }
+inline HFONT CreateFontW(int, int, int, int, int, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, LPCWSTR) { return nullptr; }
+inline HGDIOBJ SelectObject(HDC, HGDIOBJ) { return nullptr; }
+inline BOOL DeleteObject(HGDIOBJ) { return TRUE; }
+inline BOOL GetTextMetricsW(HDC, TEXTMETRICW* metrics) { *metrics = {}; return TRUE; }
+inline DWORD GetGlyphOutlineW(HDC, UINT, UINT, GLYPHMETRICS* metrics, DWORD, LPVOID, const MAT2*) { *metrics = {}; return 0; }
+
+#endif // HEADLESS_WIN32_H
@@ -0,0 +1,260 @@
+#pragma once
+#ifndef HEADLESS_D2D1_H
+#define HEADLESS_D2D1_H
+
+/**
+ * Stand-ins for the parts of Direct2D the engine uses.
+ *
+ * The factory and the render targets create real, reference counted objects, so the device resource
+ * paths run as on Windows, but nothing is drawn: the frames are drawn by the software renderer.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "Win32.h"
+
+
+/**** Types ****/
+
+struct D2D1_POINT_2F { float x; float y; };
+struct D2D1_POINT_2U { UINT32 x; UINT32 y; };
+struct D2D1_SIZE_F { float width; float height; };
+struct D2D1_SIZE_U { UINT32 width; UINT32 height; };
+struct D2D1_RECT_F { float left; float top; float right; float bottom; };
+struct D2D1_RECT_U { UINT32 left; UINT32 top; UINT32 right; UINT32 bottom; };
+struct D2D1_COLOR_F { float r; float g; float b; float a; };
+struct D2D1_MATRIX_3X2_F { float _11; float _12; float _21; float _22; float _31; float _32; };
+struct D2D1_ROUNDED_RECT { D2D1_RECT_F rect; float radiusX; float radiusY; };
+struct D2D1_ELLIPSE { D2D1_POINT_2F point; float radiusX; float radiusY; };
+
+enum D2D1_FACTORY_TYPE { D2D1_FACTORY_TYPE_SINGLE_THREADED, D2D1_FACTORY_TYPE_MULTI_THREADED };
+enum D2D1_DEBUG_LEVEL { D2D1_DEBUG_LEVEL_NONE, D2D1_DEBUG_LEVEL_ERROR, D2D1_DEBUG_LEVEL_WARNING, D2D1_DEBUG_LEVEL_INFORMATION };
+enum DXGI_FORMAT { DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_A8_UNORM };
+enum D2D1_ALPHA_MODE { D2D1_ALPHA_MODE_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED, D2D1_ALPHA_MODE_STRAIGHT, D2D1_ALPHA_MODE_IGNORE };
+enum D2D1_BITMAP_INTERPOLATION_MODE { D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR };
+enum D2D1_ANTIALIAS_MODE { D2D1_ANTIALIAS_MODE_PER_PRIMITIVE, D2D1_ANTIALIAS_MODE_ALIASED };
+enum D2D1_OPACITY_MASK_CONTENT { D2D1_OPACITY_MASK_CONTENT_GRAPHICS, D2D1_OPACITY_MASK_CONTENT_TEXT_NATURAL, D2D1_OPACITY_MASK_CONTENT_TEXT_GDI_COMPATIBLE };
+enum D2D1_FIGURE_BEGIN { D2D1_FIGURE_BEGIN_FILLED, D2D1_FIGURE_BEGIN_HOLLOW };
+enum D2D1_FIGURE_END { D2D1_FIGURE_END_OPEN, D2D1_FIGURE_END_CLOSED };
+enum D2D1_FILL_MODE { D2D1_FILL_MODE_ALTERNATE, D2D1_FILL_MODE_WINDING };
+
+struct D2D1_FACTORY_OPTIONS { D2D1_DEBUG_LEVEL debugLevel; };
+struct D2D1_PIXEL_FORMAT { DXGI_FORMAT format; D2D1_ALPHA_MODE alphaMode; };
+struct D2D1_BITMAP_PROPERTIES { D2D1_PIXEL_FORMAT pixelFormat; float dpiX; float dpiY; };
+struct D2D1_RENDER_TARGET_PROPERTIES { D2D1_PIXEL_FORMAT pixelFormat; float dpiX; float dpiY; };
+struct D2D1_HWND_RENDER_TARGET_PROPERTIES { HWND hwnd; D2D1_SIZE_U pixelSize; };
+
+
+/**** Resources ****/
+
+struct ID2D1Factory;
+
+struct ID2D1Resource : IUnknown
+{
+	ID2D1Factory* pFactory = nullptr; // The factory of a render target, not referenced: it outlives its targets.
+
+	void GetFactory(ID2D1Factory** factory) const;
+};
+
+struct ID2D1Image : ID2D1Resource {};
+
+struct ID2D1Bitmap : ID2D1Image
+{
+	D2D1_SIZE_U pixelSize = { 0, 0 };
+
+	D2D1_SIZE_F GetSize() const { return { static_cast<float>(pixelSize.width), static_cast<float>(pixelSize.height) }; }
+	D2D1_SIZE_U GetPixelSize() const { return pixelSize; }
+	HRESULT CopyFromMemory(const D2D1_RECT_U*, const void*, UINT32) { return S_OK; }
+};
+
+struct ID2D1Brush : ID2D1Resource
+{
+	void SetOpacity(float) {}
+	void SetTransform(const D2D1_MATRIX_3X2_F&) {}
+};
+
+struct ID2D1SolidColorBrush : ID2D1Brush
+{
+	void SetColor(const D2D1_COLOR_F&) {}
+};
+
+struct ID2D1SimplifiedGeometrySink : IUnknown
+{
+	void SetFillMode(D2D1_FILL_MODE) {}
+	void BeginFigure(D2D1_POINT_2F, D2D1_FIGURE_BEGIN) {}
+	void AddLines(const D2D1_POINT_2F*, UINT32) {}
+	void EndFigure(D2D1_FIGURE_END) {}
+	HRESULT Close() { return S_OK; }
+};
+
+struct ID2D1GeometrySink : ID2D1SimplifiedGeometrySink {};
+
+struct ID2D1Geometry : ID2D1Resource {};
+
+struct ID2D1PathGeometry : ID2D1Geometry
+{
+	HRESULT Open(ID2D1GeometrySink** sink) { *sink = new ID2D1GeometrySink(); return S_OK; }
+};
+
+
+/**** Render targets ****/
+
+struct ID2D1BitmapRenderTarget;
+
+struct ID2D1RenderTarget : ID2D1Resource
+{
+	D2D1_SIZE_U pixelSize = { 0, 0 };
+
+	void BeginDraw() {}
+	HRESULT EndDraw()
+	{
+		// Like a swap chain synchronized on the vsync.
+		if (Headless::vsyncIntervalMs <= 0.0) return S_OK;
+		typedef std::chrono::steady_clock ticker;
+		static const ticker::time_point origin = ticker::now();
+		const std::chrono::duration<double, std::milli> interval(Headless::vsyncIntervalMs);
+		const double vsyncs = std::floor((ticker::now() - origin) / interval) + 1.0;
+		std::this_thread::sleep_until(origin + std::chrono::duration_cast<ticker::duration>(vsyncs * interval));
+		return S_OK;
+	}
+	void Clear(const D2D1_COLOR_F&) {}
+
+	HRESULT CreateBitmap(D2D1_SIZE_U size, const void*, UINT32, const D2D1_BITMAP_PROPERTIES&, ID2D1Bitmap** bitmap)
+	{
+		*bitmap = new ID2D1Bitmap();
+		(*bitmap)->pixelSize = size;
+		return S_OK;
+	}
+	HRESULT CreateSolidColorBrush(const D2D1_COLOR_F&, ID2D1SolidColorBrush** brush) { *brush = new ID2D1SolidColorBrush(); return S_OK; }
+	HRESULT CreateCompatibleRenderTarget(D2D1_SIZE_F size, ID2D1BitmapRenderTarget** target);
+
+	void DrawBitmap(ID2D1Bitmap*, const D2D1_RECT_F&, float = 1.0f, D2D1_BITMAP_INTERPOLATION_MODE = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, const D2D1_RECT_F* = nullptr) {}
+	void DrawBitmap(ID2D1Bitmap*, const D2D1_RECT_F* = nullptr, float = 1.0f, D2D1_BITMAP_INTERPOLATION_MODE = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, const D2D1_RECT_F* = nullptr) {}
+	void FillRectangle(const D2D1_RECT_F&, ID2D1Brush*) {}
+	void FillGeometry(ID2D1Geometry*, ID2D1Brush*, ID2D1Brush* = nullptr) {}
+	void DrawGeometry(ID2D1Geometry*, ID2D1Brush*, float = 1.0f) {}
+	void FillOpacityMask(ID2D1Bitmap*, ID2D1Brush*, D2D1_OPACITY_MASK_CONTENT, const D2D1_RECT_F* = nullptr, const D2D1_RECT_F* = nullptr) {}
+
+	void SetTransform(const D2D1_MATRIX_3X2_F&) {}
+	void GetTransform(D2D1_MATRIX_3X2_F* transform) const { *transform = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f }; }
+	void SetAntialiasMode(D2D1_ANTIALIAS_MODE) {}
+	void SetDpi(float, float) {}
+
+	D2D1_SIZE_F GetSize() const { return { static_cast<float>(pixelSize.width), static_cast<float>(pixelSize.height) }; }
+	D2D1_SIZE_U GetPixelSize() const { return pixelSize; }
+};
+
+struct ID2D1BitmapRenderTarget : ID2D1RenderTarget
+{
+	HRESULT GetBitmap(ID2D1Bitmap** bitmap)
+	{
+		*bitmap = new ID2D1Bitmap();
+		(*bitmap)->pixelSize = pixelSize;
+		return S_OK;
+	}
+};
+
+inline HRESULT ID2D1RenderTarget::CreateCompatibleRenderTarget(D2D1_SIZE_F size, ID2D1BitmapRenderTarget** target)
+{
+	*target = new ID2D1BitmapRenderTarget();
+	(*target)->pFactory = pFactory;
+	(*target)->pixelSize = { static_cast<UINT32>(size.width), static_cast<UINT32>(size.height) };
+	return S_OK;
+}
+
+struct ID2D1HwndRenderTarget : ID2D1RenderTarget
+{
+	HRESULT Resize(const D2D1_SIZE_U& size) { pixelSize = size; return S_OK; }
+};
+
+
+/**** Factory ****/
+
+struct ID2D1Factory : IUnknown
+{
+	HRESULT CreateHwndRenderTarget(const D2D1_RENDER_TARGET_PROPERTIES&, const D2D1_HWND_RENDER_TARGET_PROPERTIES& properties, ID2D1HwndRenderTarget** target)
+	{
+		*target = new ID2D1HwndRenderTarget();
+		(*target)->pFactory = this;
+		(*target)->pixelSize = properties.pixelSize;
+		return S_OK;
+	}
+	HRESULT CreatePathGeometry(ID2D1PathGeometry** geometry) { *geometry = new ID2D1PathGeometry(); return S_OK; }
+};
+
+inline void ID2D1Resource::GetFactory(ID2D1Factory** factory) const
+{
+	if (pFactory) pFactory->AddRef();
+	*factory = pFactory;
+}
+
+inline HRESULT D2D1CreateFactory(D2D1_FACTORY_TYPE, int, const D2D1_FACTORY_OPTIONS*, void** factory)
+{
+	*factory = new ID2D1Factory();
+	return S_OK;
+}
+
+
+/**** Helpers ****/
+
+namespace D2D1
+{
+	struct ColorF : D2D1_COLOR_F
+	{
+		enum Enum : UINT32
+		{
+			Black = 0x000000,
+			White = 0xFFFFFF,
+			Azure = 0xF0FFFF,
+			Magenta = 0xFF00FF,
+		};
+
+		ColorF(UINT32 rgb, float alpha = 1.0f)
+			:D2D1_COLOR_F{ static_cast<float>((rgb >> 16) & 0xFF) / 255.0f, static_cast<float>((rgb >> 8) & 0xFF) / 255.0f, static_cast<float>(rgb & 0xFF) / 255.0f, alpha }
+		{}
+		ColorF(float red, float green, float blue, float alpha = 1.0f)
+			:D2D1_COLOR_F{ red, green, blue, alpha }
+		{}
+	};
+
+	struct Matrix3x2F : D2D1_MATRIX_3X2_F
+	{
+		Matrix3x2F(float m11, float m12, float m21, float m22, float dx, float dy)
+			:D2D1_MATRIX_3X2_F{ m11, m12, m21, m22, dx, dy }
+		{}
+		Matrix3x2F()
+			:Matrix3x2F(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f)
+		{}
+
+		static Matrix3x2F Identity() { return Matrix3x2F(); }
+		static Matrix3x2F Translation(float x, float y) { return Matrix3x2F(1.0f, 0.0f, 0.0f, 1.0f, x, y); }
+		static Matrix3x2F Scale(float x, float y, D2D1_POINT_2F center = { 0.0f, 0.0f })
+		{
+			return Matrix3x2F(x, 0.0f, 0.0f, y, center.x - x * center.x, center.y - y * center.y);
+		}
+
+		Matrix3x2F operator*(const Matrix3x2F& other) const
+		{
+			return Matrix3x2F(
+				_11 * other._11 + _12 * other._21, _11 * other._12 + _12 * other._22,
+				_21 * other._11 + _22 * other._21, _21 * other._12 + _22 * other._22,
+				_31 * other._11 + _32 * other._21 + other._31, _31 * other._12 + _32 * other._22 + other._32);
+		}
+	};
+
+	inline D2D1_POINT_2F Point2F(float x = 0.0f, float y = 0.0f) { return { x, y }; }
+	inline D2D1_SIZE_F SizeF(float width = 0.0f, float height = 0.0f) { return { width, height }; }
+	inline D2D1_SIZE_U SizeU(UINT32 width = 0, UINT32 height = 0) { return { width, height }; }
+	inline D2D1_RECT_F RectF(float left = 0.0f, float top = 0.0f, float right = 0.0f, float bottom = 0.0f) { return { left, top, right, bottom }; }
+	inline D2D1_RECT_U RectU(UINT32 left = 0, UINT32 top = 0, UINT32 right = 0, UINT32 bottom = 0) { return { left, top, right, bottom }; }
+
+	inline D2D1_PIXEL_FORMAT PixelFormat(DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE alphaMode = D2D1_ALPHA_MODE_UNKNOWN) { return { format, alphaMode }; }
+	inline D2D1_BITMAP_PROPERTIES BitmapProperties(D2D1_PIXEL_FORMAT format = PixelFormat(), float dpiX = 96.0f, float dpiY = 96.0f) { return { format, dpiX, dpiY }; }
+	inline D2D1_RENDER_TARGET_PROPERTIES RenderTargetProperties() { return { PixelFormat(), 0.0f, 0.0f }; }
+	inline D2D1_HWND_RENDER_TARGET_PROPERTIES HwndRenderTargetProperties(HWND hwnd, D2D1_SIZE_U pixelSize = { 0, 0 }) { return { hwnd, pixelSize }; }
+
+} // namespace D2D1
+
+#endif // HEADLESS_D2D1_H
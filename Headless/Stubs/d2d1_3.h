@@ -0,0 +1,36 @@
+#pragma once
+#ifndef HEADLESS_D2D1_3_H
+#define HEADLESS_D2D1_3_H
+
+/**
+ * Stand-ins for the sprite batches of Direct2D 1.3.
+ *
+ * The headless render targets are not device contexts: QueryInterface fails, and the engine draws the sprites one by one.
+ */
+
+#include "d2d1.h"
+
+
+enum D2D1_SPRITE_OPTIONS { D2D1_SPRITE_OPTIONS_NONE, D2D1_SPRITE_OPTIONS_CLAMP_TO_SOURCE_RECTANGLE };
+
+struct ID2D1SpriteBatch : ID2D1Resource
+{
+	UINT32 spriteCount = 0;
+
+	HRESULT AddSprites(UINT32 count, const D2D1_RECT_F*, const D2D1_RECT_U* = nullptr, const D2D1_COLOR_F* = nullptr, const D2D1_MATRIX_3X2_F* = nullptr,
+		UINT32 = sizeof(D2D1_RECT_F), UINT32 = sizeof(D2D1_RECT_U), UINT32 = sizeof(D2D1_COLOR_F), UINT32 = sizeof(D2D1_MATRIX_3X2_F))
+	{
+		spriteCount += count;
+		return S_OK;
+	}
+	void Clear() { spriteCount = 0; }
+	UINT32 GetSpriteCount() const { return spriteCount; }
+};
+
+struct ID2D1DeviceContext3 : ID2D1RenderTarget
+{
+	HRESULT CreateSpriteBatch(ID2D1SpriteBatch** batch) { *batch = new ID2D1SpriteBatch(); return S_OK; }
+	void DrawSpriteBatch(ID2D1SpriteBatch*, ID2D1Bitmap*, D2D1_BITMAP_INTERPOLATION_MODE = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, D2D1_SPRITE_OPTIONS = D2D1_SPRITE_OPTIONS_NONE) {}
+};
+
+#endif // HEADLESS_D2D1_3_H
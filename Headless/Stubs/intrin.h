@@ -0,0 +1,25 @@
+#pragma once
+#ifndef HEADLESS_INTRIN_H
+#define HEADLESS_INTRIN_H
+
+/**
+ * Stand-ins for the MSVC intrinsics the engine uses, on top of the GCC ones.
+ */
+
+#include <x86intrin.h> // __rdtsc
+
+inline unsigned char _BitScanForward64(unsigned long* index, unsigned long long mask)
+{
+	if (mask == 0) return 0;
+	*index = static_cast<unsigned long>(__builtin_ctzll(mask));
+	return 1;
+}
+
+inline unsigned char _BitScanReverse64(unsigned long* index, unsigned long long mask)
+{
+	if (mask == 0) return 0;
+	*index = static_cast<unsigned long>(63 - __builtin_clzll(mask));
+	return 1;
+}
+
+#endif // HEADLESS_INTRIN_H
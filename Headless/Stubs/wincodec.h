@@ -0,0 +1,14 @@
+#pragma once
+#ifndef HEADLESS_WINCODEC_H
+#define HEADLESS_WINCODEC_H
+
+/**
+ * Stand-ins for the WIC interfaces still named by the engine: the images are decoded by ImageDecoder.
+ */
+
+#include "Win32.h"
+
+struct IWICFormatConverter : IUnknown {};
+struct IWICImagingFactory : IUnknown {};
+
+#endif // HEADLESS_WINCODEC_H
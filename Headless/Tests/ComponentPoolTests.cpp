@@ -0,0 +1,92 @@
+#include "Tests.h"
+
+#include <vector>
+
+#include "ComponentPool.h"
+#include "GraphicComponents.h"
+#include "Replay.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief A component counting its destructions.
+	 */
+	struct Probe : Graphics::Component
+	{
+		static inline UINT32 destroyedCount = 0;
+		UINT64 payload[4] = {};
+
+		Probe(_In_ D2D1_POINT_2F pos) : Graphics::Component(pos) {}
+		~Probe() { destroyedCount++; }
+	};
+
+
+	void testRecyclesSlots()
+	{
+		Graphics::ComponentPoolPtr pool = Graphics::ComponentPool::make(sizeof(Probe), alignof(Probe), 4);
+		std::vector<std::unique_ptr<Probe, Graphics::ComponentDeleter>> probes;
+		for (UINT32 i = 0; i < 5; i++)
+			probes.push_back(pool->create<Probe>(D2D1_POINT_2F{ 0.0f, 0.0f }));
+		CHECK(pool->getLiveCount() == 5);
+		CHECK(pool->getCapacity() == 8);
+
+		// Last in, first out.
+		Probe* const freed = probes[2].get();
+		probes[2].reset();
+		CHECK(pool->getLiveCount() == 4);
+		probes[2] = pool->create<Probe>(D2D1_POINT_2F{ 0.0f, 0.0f });
+		CHECK(probes[2].get() == freed);
+		CHECK(pool->getCapacity() == 8);
+	}
+
+	/**
+	 * @brief Released by its owner with components alive, the pool lives until the last one is destroyed.
+	 */
+	void testReleasedWithLiveComponents()
+	{
+		Probe::destroyedCount = 0;
+		Graphics::ComponentPoolPtr pool = Graphics::ComponentPool::make(sizeof(Probe), alignof(Probe), 4);
+		std::unique_ptr<Probe, Graphics::ComponentDeleter> first = pool->create<Probe>(D2D1_POINT_2F{ 0.0f, 0.0f });
+		std::unique_ptr<Probe, Graphics::ComponentDeleter> second = pool->create<Probe>(D2D1_POINT_2F{ 0.0f, 0.0f });
+		pool.reset();
+
+		first->payload[0] = 1;
+		second->payload[3] = 2;
+		first.reset();
+		CHECK(Probe::destroyedCount == 1);
+		CHECK(second->payload[3] == 2);
+		second.reset(); // Frees the pool.
+		CHECK(Probe::destroyedCount == 2);
+	}
+
+	/**
+	 * @brief A component removed from its window can outlive it.
+	 */
+	void testComponentOutlivesWindow()
+	{
+		Probe::destroyedCount = 0;
+		Graphics::ComponentPtr removed;
+		{
+			Replay::HeadlessWindow window;
+			window.emplaceComponent<Probe>(0, D2D1_POINT_2F{ 1.0f, 2.0f });
+			const ComponentId id = window.emplaceComponent<Probe>(0, D2D1_POINT_2F{ 3.0f, 4.0f });
+			removed = window.removeComponent(id);
+			CHECK(window.getComponentPool<Probe>().getLiveCount() == 2);
+		}
+		CHECK(Probe::destroyedCount == 1);
+
+		static_cast<Probe*>(removed.get())->payload[0] = 5;
+		removed.reset();
+		CHECK(Probe::destroyedCount == 2);
+	}
+
+
+	void addComponentPoolTests(_Inout_ Suite& suite)
+	{
+		suite.add("component_pool/recycles_slots", testRecyclesSlots);
+		suite.add("component_pool/released_with_live_components", testReleasedWithLiveComponents);
+		suite.add("component_pool/component_outlives_window", testComponentOutlivesWindow);
+	}
+
+} // namespace Tests
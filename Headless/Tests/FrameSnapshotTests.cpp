@@ -0,0 +1,182 @@
+#include "Tests.h"
+
+#include <atomic>
+#include <thread>
+
+#include "FrameSnapshot.h"
+#include "GeometryCache.h"
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+
+
+namespace Tests
+{
+	using Render::FrameSnapshot;
+	using Render::TripleBuffer;
+
+	/**
+	 * @brief Record the snapshot of a frame: every command and the command count are derived from its number.
+	 */
+	void writeSnapshot(_Inout_ FrameSnapshot& snapshot, _In_ UINT64 frame)
+	{
+		snapshot.commands.reset();
+		snapshot.frame = frame;
+		for (UINT64 c = 0; c < frame % 5 + 1; c++)
+		{
+			const float x = static_cast<float>(frame % 1000);
+			snapshot.commands.getLayer(static_cast<int>(c % 3)).drawBitmap(static_cast<Render::ResourceId>(frame), { x, 0.0f, x + 1.0f, 1.0f });
+		}
+	}
+
+	/**
+	 * @brief Return whether a snapshot holds exactly what writeSnapshot recorded for its frame.
+	 */
+	bool isConsistent(_In_ const FrameSnapshot& snapshot)
+	{
+		size_t count = 0;
+		for (const auto& [layer, list] : snapshot.commands.getLayers())
+		{
+			for (const Render::Command& command : list.getCommands())
+			{
+				if (command.resource != static_cast<Render::ResourceId>(snapshot.frame)) return false;
+				if (command.destination.left != static_cast<float>(snapshot.frame % 1000)) return false;
+				count++;
+			}
+		}
+		return count == snapshot.frame % 5 + 1;
+	}
+
+
+	void testLatestWins()
+	{
+		TripleBuffer<FrameSnapshot> snapshots;
+		CHECK(!snapshots.acquire());
+
+		writeSnapshot(snapshots.getBack(), 1);
+		CHECK(!snapshots.publish());
+		writeSnapshot(snapshots.getBack(), 2);
+		CHECK(snapshots.publish()); // Frame 1 was never acquired.
+
+		CHECK(snapshots.acquire());
+		CHECK(snapshots.getFront().frame == 2);
+		CHECK(isConsistent(snapshots.getFront()));
+
+		// Nothing new: the front keeps the last frame.
+		CHECK(!snapshots.acquire());
+		CHECK(snapshots.getFront().frame == 2);
+
+		// The producer never writes the buffer the consumer reads.
+		for (UINT64 frame = 3; frame < 10; frame++)
+		{
+			CHECK(&snapshots.getBack() != &snapshots.getFront());
+			writeSnapshot(snapshots.getBack(), frame);
+			snapshots.publish();
+		}
+		CHECK(snapshots.acquire());
+		CHECK(snapshots.getFront().frame == 9);
+	}
+
+	/**
+	 * @brief A producer and a consumer thread: the consumer never sees a torn snapshot, nor an older one.
+	 */
+	void testConcurrentConsistency()
+	{
+		TripleBuffer<FrameSnapshot> snapshots;
+		std::atomic<bool> isDone = false;
+		UINT64 acquired = 0, torn = 0, outOfOrder = 0;
+
+		std::thread consumer([&]() {
+			UINT64 last = 0;
+			for (;;)
+			{
+				// Once the producer is done, a last acquire gets its last frame.
+				const bool isLast = isDone.load(std::memory_order_acquire);
+				if (!snapshots.acquire())
+				{
+					if (isLast) break;
+					continue;
+				}
+				const FrameSnapshot& snapshot = snapshots.getFront();
+				if (!isConsistent(snapshot)) torn++;
+				if (snapshot.frame <= last) outOfOrder++;
+				last = snapshot.frame;
+				acquired++;
+			}
+		});
+
+		const UINT64 frames = 200000;
+		for (UINT64 frame = 1; frame <= frames; frame++)
+		{
+			writeSnapshot(snapshots.getBack(), frame);
+			snapshots.publish();
+			if (frame % 64 == 0) std::this_thread::yield();
+		}
+		isDone.store(true, std::memory_order_release);
+		consumer.join();
+
+		CHECK(torn == 0);
+		CHECK(outOfOrder == 0);
+		CHECK(acquired > 0);
+		CHECK(snapshots.getFront().frame == frames);
+	}
+
+	/**
+	 * @brief The device copies dropped by the main loop stay alive until the render thread releases them.
+	 */
+	void testDroppedResourcesReleasedLater()
+	{
+		Graphics::D2D1RenderTools rt;
+		CHECK(SUCCEEDED(rt.CreateFactory()));
+		CHECK(SUCCEEDED(rt.CreateRenderTarget(nullptr)));
+
+		const Graphics::Pixel pixels[4] = { Graphics::Pixel(0, 0), Graphics::Pixel(0, 0), Graphics::Pixel(0, 0), Graphics::Pixel(0, 0) };
+		{
+			Render::ResourceTable resources;
+			const Render::ResourceId updated = resources.registerBitmap(pixels, 2, 2);
+			const Render::ResourceId unregistered = resources.registerBitmap(pixels, 2, 2);
+			CHECK(resources.uploadBitmap(updated, rt.pRenderTarget) == S_OK);
+			CHECK(resources.uploadBitmap(unregistered, rt.pRenderTarget) == S_OK);
+
+			// Held like a frame being presented holds them.
+			ID2D1Bitmap* pUpdated = resources.getResidentBitmap(updated);
+			ID2D1Bitmap* pUnregistered = resources.getResidentBitmap(unregistered);
+			pUpdated->AddRef();
+			pUnregistered->AddRef();
+
+			Render::ShapeDesc desc;
+			desc.type = Render::ShapeType::Ellipse;
+			desc.width = desc.height = 8.0f;
+			const Render::GeometryId geometry = resources.getGeometries().acquire(desc);
+			ID2D1PathGeometry* pGeometry = resources.getGeometries().getDeviceGeometry(geometry, rt.pFactory);
+			CHECK(pGeometry != nullptr);
+			pGeometry->AddRef();
+
+			resources.updateBitmap(updated, pixels, 2, 2);
+			resources.unregisterBitmap(unregistered);
+			resources.getGeometries().release(geometry);
+			CHECK(resources.getResidentBitmap(updated) == nullptr);
+
+			// Still referenced by the table: one release leaves one reference.
+			CHECK(pUpdated->AddRef() == 3);
+			CHECK(pUpdated->Release() == 2);
+			CHECK(pUnregistered->AddRef() == 3);
+			CHECK(pUnregistered->Release() == 2);
+			CHECK(pGeometry->AddRef() == 3);
+			CHECK(pGeometry->Release() == 2);
+
+			resources.releaseDropped();
+			CHECK(pUpdated->Release() == 0);
+			CHECK(pUnregistered->Release() == 0);
+			CHECK(pGeometry->Release() == 0);
+		}
+	}
+
+
+	void addFrameSnapshotTests(_Inout_ Suite& suite)
+	{
+		suite.add("frame_snapshot/latest_wins", testLatestWins);
+		suite.add("frame_snapshot/concurrent_consistency", testConcurrentConsistency);
+		suite.add("frame_snapshot/dropped_resources_released_later", testDroppedResourcesReleasedLater);
+	}
+
+} // namespace Tests
@@ -0,0 +1,152 @@
+#include "Tests.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlyphCache.h"
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief A glyph cache on its own resource table, with the bundled 8x16 font.
+	 */
+	struct BuiltinGlyphs
+	{
+		Render::ResourceTable resources;
+		Render::GlyphCache cache{ resources, std::make_unique<Render::BuiltinGlyphRasterizer>() };
+	};
+
+	inline bool isRect(_In_ const D2D1_RECT_F& rect, _In_ float left, _In_ float top, _In_ float right, _In_ float bottom) noexcept
+	{
+		return rect.left == left && rect.top == top && rect.right == right && rect.bottom == bottom;
+	}
+
+
+	/**
+	 * @brief The glyphs are packed on shelves of a 512 px page, one pixel apart, their masks copied as white coverage.
+	 */
+	void testAtlasPlacement()
+	{
+		BuiltinGlyphs glyphs;
+		const Render::FontId font = glyphs.cache.getFont(L"Any family", 16);
+		const Render::FontMetrics metrics = glyphs.cache.getMetrics(font);
+		CHECK(metrics.ascent == 12.0f && metrics.descent == 4.0f);
+
+		std::vector<Render::GlyphQuad> quads;
+		D2D1_SIZE_F size;
+		glyphs.cache.layout(font, L"A B", 0.0f, &quads, &size);
+		CHECK(size.width == 24.0f && size.height == 16.0f);
+		CHECK(quads.size() == 2); // The space has no mask.
+		CHECK(isRect(quads[0].source, 0.0f, 0.0f, 8.0f, 16.0f));
+		CHECK(isRect(quads[0].destination, 0.0f, 0.0f, 8.0f, 16.0f));
+		CHECK(isRect(quads[1].source, 9.0f, 0.0f, 17.0f, 16.0f));
+		CHECK(isRect(quads[1].destination, 16.0f, 0.0f, 24.0f, 16.0f));
+
+		// The third row of 'A' covers its 4th and 5th columns by two thirds.
+		glyphs.cache.flush();
+		const Render::BitmapResource* page = glyphs.resources.getBitmap(quads[0].page);
+		CHECK(page != nullptr && page->width == Render::ATLAS_PAGE_SIZE && page->version == 1);
+		if (page == nullptr) return;
+		const Graphics::Pixel& covered = page->pixels[2 * Render::ATLAS_PAGE_SIZE + 3];
+		CHECK(covered.a == 0xAA && covered.r == 0xAA);
+		CHECK(page->pixels[2 * Render::ATLAS_PAGE_SIZE + 2].a == 0x00);
+
+		// Twice the size: the font is scaled by 2.
+		const Render::FontId large = glyphs.cache.getFont(L"Any family", 32);
+		glyphs.cache.layout(large, L"A", 0.0f, &quads, &size);
+		CHECK(quads.size() == 1 && isRect(quads[0].source, 18.0f, 0.0f, 34.0f, 32.0f));
+		CHECK(size.width == 16.0f && size.height == 32.0f);
+	}
+
+	/**
+	 * @brief 56 glyphs of 8 + 1 px fit on a shelf: the 57th starts the next one, one pixel below the tallest glyph.
+	 */
+	void testAtlasShelves()
+	{
+		BuiltinGlyphs glyphs;
+		const Render::FontId font = glyphs.cache.getFont(L"Any family", 16);
+
+		std::wstring printable;
+		for (wchar_t character = L'!'; character <= L'~'; character++)
+			printable += character;
+		std::vector<Render::GlyphQuad> quads;
+		D2D1_SIZE_F size;
+		glyphs.cache.layout(font, printable, 0.0f, &quads, &size);
+		CHECK(quads.size() == printable.size());
+		if (quads.size() != printable.size()) return;
+		CHECK(isRect(quads[55].source, 495.0f, 0.0f, 503.0f, 16.0f));
+		CHECK(isRect(quads[56].source, 0.0f, 17.0f, 8.0f, 33.0f));
+		CHECK(isRect(quads[93].source, 333.0f, 17.0f, 341.0f, 33.0f));
+		CHECK(glyphs.cache.getStats().pages == 1);
+		CHECK(glyphs.cache.getStats().glyphs == printable.size());
+	}
+
+	/**
+	 * @brief A string is shaped once per font: laying it out again hits the cache, and gives the same quads.
+	 */
+	void testRunCache()
+	{
+		BuiltinGlyphs glyphs;
+		const Render::FontId font = glyphs.cache.getFont(L"Any family", 16);
+
+		std::vector<Render::GlyphQuad> first, second;
+		D2D1_SIZE_F size;
+		glyphs.cache.layout(font, L"Hello", 0.0f, &first, &size);
+		glyphs.cache.layout(font, L"Hello", 0.0f, &second, &size);
+		Render::GlyphCacheStats stats = glyphs.cache.getStats();
+		CHECK(stats.runMisses == 1 && stats.runHits == 1 && stats.runs == 1);
+		CHECK(stats.glyphs == 4); // 'l' twice.
+		CHECK(first.size() == second.size());
+		for (size_t i = 0; i < first.size() && i < second.size(); i++)
+			CHECK(isRect(first[i].source, second[i].source.left, second[i].source.top, second[i].source.right, second[i].source.bottom));
+
+		// Another size is another font: its runs are its own.
+		glyphs.cache.layout(glyphs.cache.getFont(L"Any family", 32), L"Hello", 0.0f, &first, &size);
+		CHECK(glyphs.cache.getStats().runMisses == 2);
+
+		// Past the limit, every run is dropped, the glyphs are kept.
+		glyphs.cache.setRunLimit(2);
+		glyphs.cache.layout(font, L"World", 0.0f, &first, &size);
+		stats = glyphs.cache.getStats();
+		CHECK(stats.runs == 1 && stats.runMisses == 3);
+		glyphs.cache.layout(font, L"Hello", 0.0f, &first, &size);
+		CHECK(glyphs.cache.getStats().runMisses == 4);
+	}
+
+	/**
+	 * @brief Lines are broken after the last space that fits, or inside a word longer than the width.
+	 */
+	void testLineBreaks()
+	{
+		BuiltinGlyphs glyphs;
+		const Render::FontId font = glyphs.cache.getFont(L"Any family", 16);
+
+		std::vector<Render::GlyphQuad> quads;
+		D2D1_SIZE_F size;
+		glyphs.cache.layout(font, L"ab cd", 30.0f, &quads, &size);
+		CHECK(quads.size() == 4);
+		CHECK(size.width == 16.0f && size.height == 32.0f);
+		CHECK(isRect(quads[2].destination, 0.0f, 16.0f, 8.0f, 32.0f));
+
+		glyphs.cache.layout(font, L"abcde", 20.0f, &quads, &size);
+		CHECK(size.height == 48.0f);
+		CHECK(isRect(quads[4].destination, 0.0f, 32.0f, 8.0f, 48.0f));
+
+		glyphs.cache.layout(font, L"a\nb", 0.0f, &quads, &size);
+		CHECK(quads.size() == 2 && isRect(quads[1].destination, 0.0f, 16.0f, 8.0f, 32.0f));
+	}
+
+
+	void addGlyphCacheTests(_Inout_ Suite& suite)
+	{
+		suite.add("glyph_cache/atlas_placement", testAtlasPlacement);
+		suite.add("glyph_cache/atlas_shelves", testAtlasShelves);
+		suite.add("glyph_cache/run_cache", testRunCache);
+		suite.add("glyph_cache/line_breaks", testLineBreaks);
+	}
+
+} // namespace Tests
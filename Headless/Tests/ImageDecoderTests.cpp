@@ -0,0 +1,535 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "ImageDecoder.h"
+#include "LargeImage.h"
+
+
+namespace Tests
+{
+	constexpr UINT64 FNV_OFFSET = 1469598103934665603ull;
+
+	/**
+	 * @brief Return the FNV-1a hash of bytes, continuing a previous hash.
+	 */
+	inline UINT64 hashBytes(_In_ const void* data, _In_ size_t size, _In_opt_ UINT64 hash = FNV_OFFSET) noexcept
+	{
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::vector<BYTE> readImageFile(_In_ const wchar_t* name)
+	{
+		std::ifstream file(std::filesystem::path(std::wstring(L"" IMAGES_DIR) + name), std::ios::binary);
+		return std::vector<BYTE>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+
+	/************************/
+	/*		 Inflate		*/
+	/************************/
+
+
+	/**
+	 * @brief The bytes compressed by the zlib streams below, by zlib itself.
+	 */
+	std::vector<BYTE> makeInflateInput(_In_ size_t size)
+	{
+		std::vector<BYTE> input(size);
+		for (size_t k = 0; k < size; k++)
+			input[k] = static_cast<BYTE>('a' + k % 7 + k / 50 % 3 + (k * k % 11 == 0));
+		return input;
+	}
+
+	// 64 bytes, level 0: a stored block.
+	const BYTE STORED_STREAM[] = {
+		0x78, 0x01, 0x01, 0x40, 0x00, 0xbf, 0xff, 0x62, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x61, 0x62, 0x63, 0x64, 0x66, 0x66,
+		0x67, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x61, 0x63, 0x63, 0x64, 0x65, 0x66, 0x67, 0x61, 0x62, 0x63, 0x64, 0x65,
+		0x67, 0x67, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x61, 0x62, 0x64, 0x64, 0x65, 0x66, 0x67, 0x61, 0x63, 0x64, 0x65,
+		0x66, 0x67, 0x69, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x62, 0x2d, 0x32, 0x19, 0x12 };
+
+	// 200 bytes, level 1 with the fixed codes.
+	const BYTE FIXED_STREAM[] = {
+		0x78, 0x01, 0x4b, 0x4a, 0x4a, 0x4e, 0x49, 0x4d, 0x4b, 0x4f, 0x04, 0x52, 0x69, 0x10, 0x0a, 0xc4, 0x4b, 0x86, 0x0b, 0xa6,
+		0xa6, 0x83, 0xe5, 0xc0, 0x4a, 0x52, 0xc0, 0x2a, 0xc1, 0x52, 0x99, 0x10, 0x6d, 0x19, 0x10, 0x6d, 0x20, 0x0a, 0xa8, 0x22,
+		0x03, 0xa2, 0x0d, 0xcc, 0x4b, 0x4f, 0x87, 0x09, 0x26, 0x81, 0xa5, 0x32, 0x21, 0xda, 0x20, 0x54, 0x06, 0x90, 0x02, 0xda,
+		0x06, 0xa2, 0x40, 0xda, 0xb2, 0x20, 0x14, 0x88, 0x07, 0xd4, 0x06, 0xa2, 0x40, 0xc2, 0x49, 0x10, 0x43, 0x89, 0x74, 0x19,
+		0x00, 0xe8, 0x76, 0x4e, 0xc4 };
+
+	// 1000 bytes, level 9: dynamic codes.
+	const BYTE DYNAMIC_STREAM[] = {
+		0x78, 0xda, 0x95, 0xd2, 0x4b, 0x0e, 0xc0, 0x20, 0x08, 0x04, 0xd0, 0xb3, 0x8a, 0x3f, 0xec, 0xfd, 0x0f, 0x50, 0x01, 0x99,
+		0x35, 0xb3, 0x91, 0x40, 0x25, 0xf3, 0x92, 0x2a, 0xd2, 0xc7, 0x5c, 0xbb, 0xdd, 0xb2, 0xa2, 0x58, 0xd7, 0x31, 0x9c, 0x1b,
+		0x43, 0x19, 0xf1, 0xcd, 0xce, 0x13, 0x33, 0x8d, 0x35, 0x7d, 0x5d, 0xc7, 0xf0, 0xae, 0xe5, 0x50, 0xfc, 0x3c, 0xb1, 0x16,
+		0xc5, 0xba, 0x85, 0xa1, 0x7e, 0x18, 0xda, 0x9a, 0x15, 0xeb, 0x85, 0x92, 0x01, 0x51, 0x96, 0xdd, 0xa0, 0xc9, 0xc9, 0x32,
+		0xaf, 0x2e, 0x93, 0x88, 0x20, 0x64, 0x2f, 0x8f, 0x90, 0xf9, 0x5d, 0x4a, 0x16, 0x79, 0x8c, 0x4c, 0x15, 0x88, 0xa2, 0xcc,
+		0xf3, 0x28, 0x19, 0xde, 0x4b, 0x59, 0xe6, 0x7f, 0x91, 0x92, 0x01, 0x51, 0x96, 0x79, 0x04, 0x25, 0xcb, 0xbc, 0xba, 0xec,
+		0xde, 0x6d, 0x9c, 0x2c, 0x9f, 0x70, 0x5d, 0xf6, 0x03, 0xa7, 0xe9, 0x8a, 0xbe };
+
+	void checkInflate(_In_reads_bytes_(size) const BYTE* stream, _In_ size_t size, _In_ size_t expectedSize)
+	{
+		const std::vector<BYTE> expected = makeInflateInput(expectedSize);
+		std::vector<BYTE> output(expectedSize + 16);
+		CHECK(Codec::inflateZlib(stream, size, output.data(), output.size()) == expectedSize);
+		CHECK(std::memcmp(output.data(), expected.data(), expectedSize) == 0);
+
+		// Too small an output, or a stream cut short, are errors.
+		CHECK(Codec::inflateZlib(stream, size, output.data(), expectedSize - 1) == SIZE_MAX);
+		CHECK(Codec::inflateZlib(stream, size / 2, output.data(), output.size()) == SIZE_MAX);
+	}
+
+	void testInflateVectors()
+	{
+		checkInflate(STORED_STREAM, sizeof(STORED_STREAM), 64);
+		checkInflate(FIXED_STREAM, sizeof(FIXED_STREAM), 200);
+		checkInflate(DYNAMIC_STREAM, sizeof(DYNAMIC_STREAM), 1000);
+	}
+
+
+	/************************/
+	/*	  Reference images	*/
+	/************************/
+
+
+	struct ReferenceImage
+	{
+		const wchar_t* name;
+		UINT32 width;
+		UINT32 height;
+		size_t frameCount;
+		UINT64 hash;	// Of the pixels of every frame.
+	};
+
+	// The pixels decoded by libpng for the PNGs, by a plain LZW decoder compositing the frames for the GIF,
+	// converted to premultiplied B8G8R8A8.
+	const ReferenceImage REFERENCE_IMAGES[] = {
+		{ L"image.png", 800, 600, 1, 0xcc97bb9fd6547fe0ull },
+		{ L"test.png", 210, 208, 1, 0xd986a4c93b26635bull },
+		{ L"16.png", 16, 16, 1, 0x99867711b49f73a1ull },
+		{ L"N16.png", 16, 16, 1, 0x99867711b49f73a1ull },
+		{ L"gif.gif", 480, 306, 29, 0xae5164464ef7e0d9ull },
+	};
+
+	void testReferenceImages()
+	{
+		for (const ReferenceImage& reference : REFERENCE_IMAGES)
+		{
+			const std::vector<BYTE> file = readImageFile(reference.name);
+			CHECK(!file.empty());
+
+			Codec::DecodedImage image;
+			CHECK(Codec::decodeImage(file.data(), file.size(), image));
+			CHECK(image.width == reference.width && image.height == reference.height);
+			CHECK(image.frames.size() == reference.frameCount);
+
+			UINT64 hash = FNV_OFFSET;
+			for (const Codec::DecodedFrame& frame : image.frames)
+				hash = hashBytes(frame.pixels.data(), frame.pixels.size() * sizeof(Graphics::Pixel), hash);
+			CHECK(hash == reference.hash);
+		}
+
+		// Its header says interlaced, its data is not: libpng rejects it too.
+		const std::vector<BYTE> file = readImageFile(L"image2.png");
+		Codec::DecodedImage image;
+		CHECK(!Codec::decodeImage(file.data(), file.size(), image));
+	}
+
+	void testCorruptedImages()
+	{
+		const std::vector<BYTE> file = readImageFile(L"image.png");
+		std::mt19937 random(43);
+		for (UINT32 i = 0; i < 200; i++)
+		{
+			std::vector<BYTE> corrupted = file;
+			for (UINT32 j = 0; j < 8; j++)
+				corrupted[random() % corrupted.size()] ^= static_cast<BYTE>(1 << (random() % 8));
+			Codec::DecodedImage image;
+			Codec::decodeImage(corrupted.data(), corrupted.size(), image); // Must not crash, whatever it returns.
+		}
+
+		for (size_t size : { size_t(0), size_t(8), size_t(100), size_t(5000), file.size() - 20 })
+		{
+			Codec::DecodedImage image;
+			CHECK(!Codec::decodeImage(file.data(), size, image));
+		}
+	}
+
+
+	/************************/
+	/*		PNG corpus		*/
+	/************************/
+
+
+	/**
+	 * @brief Writes PNGs with stored deflate blocks, each row with a filter of its own.
+	 */
+	class PngWriter
+	{
+	private:
+		std::vector<BYTE> m_file;
+
+		static UINT32 crc32(_In_ const BYTE* data, _In_ size_t size) noexcept
+		{
+			UINT32 crc = 0xFFFFFFFF;
+			for (size_t i = 0; i < size; i++)
+			{
+				crc ^= data[i];
+				for (int k = 0; k < 8; k++)
+					crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+			}
+			return ~crc;
+		}
+
+		static void writeUint32(_Inout_ std::vector<BYTE>& bytes, _In_ UINT32 value)
+		{
+			for (int shift = 24; shift >= 0; shift -= 8)
+				bytes.push_back(static_cast<BYTE>(value >> shift));
+		}
+
+	public:
+		PngWriter()
+		{
+			m_file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		}
+
+		void writeChunk(_In_ const char* type, _In_ const std::vector<BYTE>& data)
+		{
+			writeUint32(m_file, static_cast<UINT32>(data.size()));
+			const size_t start = m_file.size();
+			m_file.insert(m_file.end(), type, type + 4);
+			m_file.insert(m_file.end(), data.begin(), data.end());
+			writeUint32(m_file, crc32(m_file.data() + start, m_file.size() - start));
+		}
+
+		/**
+		 * @brief Write the IDAT chunk of filtered rows, as a zlib stream of stored blocks.
+		 */
+		void writeData(_In_ const std::vector<BYTE>& rows)
+		{
+			std::vector<BYTE> stream = { 0x78, 0x01 };
+			size_t offset = 0;
+			do
+			{
+				const size_t length = (std::min)(rows.size() - offset, size_t(65535));
+				stream.push_back(offset + length == rows.size() ? 1 : 0);
+				stream.push_back(static_cast<BYTE>(length));
+				stream.push_back(static_cast<BYTE>(length >> 8));
+				stream.push_back(static_cast<BYTE>(~length));
+				stream.push_back(static_cast<BYTE>(~length >> 8));
+				stream.insert(stream.end(), rows.begin() + offset, rows.begin() + offset + length);
+				offset += length;
+			} while (offset < rows.size());
+
+			UINT32 a = 1, b = 0;
+			for (BYTE byte : rows)
+			{
+				a = (a + byte) % 65521;
+				b = (b + a) % 65521;
+			}
+			writeUint32(stream, (b << 16) | a);
+			writeChunk("IDAT", stream);
+		}
+
+		static std::vector<BYTE> header(_In_ UINT32 width, _In_ UINT32 height, _In_ BYTE depth, _In_ BYTE colorType, _In_ bool interlaced)
+		{
+			std::vector<BYTE> data;
+			writeUint32(data, width);
+			writeUint32(data, height);
+			data.insert(data.end(), { depth, colorType, 0, 0, static_cast<BYTE>(interlaced ? 1 : 0) });
+			return data;
+		}
+
+		inline const std::vector<BYTE>& getFile() const noexcept { return m_file; }
+	};
+
+	struct PngCase
+	{
+		BYTE colorType;
+		BYTE depth;
+		bool interlaced;
+		bool transparent;	// With a tRNS chunk.
+		UINT32 width;
+		UINT32 height;
+	};
+
+	inline UINT32 getChannelCount(_In_ BYTE colorType) noexcept
+	{
+		switch (colorType)
+		{
+		case 2: return 3;
+		case 4: return 2;
+		case 6: return 4;
+		default: return 1;
+		}
+	}
+
+	inline BYTE premultiply(_In_ UINT32 color, _In_ UINT32 alpha) noexcept
+	{
+		const UINT32 product = color * alpha + 128;
+		return static_cast<BYTE>((product + (product >> 8)) >> 8);
+	}
+
+	/**
+	 * @brief Paeth predictor, as the PNG specification writes it.
+	 */
+	inline BYTE paeth(_In_ int a, _In_ int b, _In_ int c) noexcept
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return static_cast<BYTE>(a);
+		return static_cast<BYTE>(pb <= pc ? b : c);
+	}
+
+	/**
+	 * @brief Encode a random image with the writer, and compute its pixels the straightforward way.
+	 *
+	 * @retval std::vector<BYTE>
+	 * @return The PNG file.
+	 */
+	std::vector<BYTE> makePng(_In_ const PngCase& test, _Inout_ std::mt19937& random, _Out_ std::vector<Graphics::Pixel>* expected)
+	{
+		const UINT32 channels = getChannelCount(test.colorType);
+		const UINT32 maxSample = (1u << test.depth) - 1;
+		const UINT32 paletteSize = (std::min)(1u << test.depth, 256u);
+
+		// The samples, at their depth. A third of the pixels have the transparent color, if any.
+		const UINT16 key[3] = { 1, 2, 3 };
+		std::vector<UINT16> samples(static_cast<size_t>(test.width) * test.height * channels);
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i] = static_cast<UINT16>(random() % (test.colorType == 3 ? paletteSize : maxSample + 1));
+		if (test.transparent && test.colorType != 3)
+			for (size_t p = 0; p < samples.size() / channels; p += 3)
+				for (UINT32 c = 0; c < channels; c++)
+					samples[p * channels + c] = key[c] & maxSample;
+
+		PngWriter writer;
+		writer.writeChunk("IHDR", PngWriter::header(test.width, test.height, test.depth, test.colorType, test.interlaced));
+
+		std::vector<BYTE> palette, alphas;
+		if (test.colorType == 3)
+		{
+			for (UINT32 i = 0; i < paletteSize * 3; i++)
+				palette.push_back(static_cast<BYTE>(random()));
+			writer.writeChunk("PLTE", palette);
+			if (test.transparent)
+			{
+				for (UINT32 i = 0; i < paletteSize / 2 + 1; i++)
+					alphas.push_back(static_cast<BYTE>(random()));
+				writer.writeChunk("tRNS", alphas);
+			}
+		}
+		else if (test.transparent)
+		{
+			std::vector<BYTE> keyChunk;
+			for (UINT32 c = 0; c < channels; c++)
+				keyChunk.insert(keyChunk.end(), { 0, static_cast<BYTE>(key[c] & maxSample) });
+			writer.writeChunk("tRNS", keyChunk);
+		}
+
+		// Pack and filter the rows of each pass, or of the whole image.
+		struct Pass { UINT32 x, y, dx, dy; };
+		const Pass adam7[7] = { { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+		const Pass whole = { 0, 0, 1, 1 };
+		const UINT32 bitsPerPixel = channels * test.depth;
+		const UINT32 filterStride = (std::max)(bitsPerPixel / 8, 1u);
+
+		std::vector<BYTE> rows;
+		for (const Pass& pass : test.interlaced ? std::vector<Pass>(adam7, adam7 + 7) : std::vector<Pass>{ whole })
+		{
+			const UINT32 passWidth = test.width > pass.x ? (test.width - pass.x + pass.dx - 1) / pass.dx : 0;
+			const UINT32 passHeight = test.height > pass.y ? (test.height - pass.y + pass.dy - 1) / pass.dy : 0;
+			if (passWidth == 0 || passHeight == 0) continue;
+
+			const size_t rowSize = (static_cast<size_t>(passWidth) * bitsPerPixel + 7) / 8;
+			std::vector<BYTE> previous(rowSize, 0), row(rowSize);
+			for (UINT32 py = 0; py < passHeight; py++)
+			{
+				std::fill(row.begin(), row.end(), BYTE(0));
+				size_t bit = 0;
+				for (UINT32 px = 0; px < passWidth; px++)
+				{
+					const size_t pixel = static_cast<size_t>(pass.y + py * pass.dy) * test.width + pass.x + px * pass.dx;
+					for (UINT32 c = 0; c < channels; c++, bit += test.depth)
+					{
+						const UINT16 sample = samples[pixel * channels + c];
+						if (test.depth == 16)
+						{
+							row[bit / 8] = static_cast<BYTE>(sample >> 8);
+							row[bit / 8 + 1] = static_cast<BYTE>(sample);
+						}
+						else row[bit / 8] |= static_cast<BYTE>(sample << (8 - test.depth - bit % 8));
+					}
+				}
+
+				const BYTE filter = static_cast<BYTE>(py % 5);
+				rows.push_back(filter);
+				for (size_t i = 0; i < rowSize; i++)
+				{
+					const int left = i >= filterStride ? row[i - filterStride] : 0;
+					const int up = previous[i];
+					const int upLeft = i >= filterStride ? previous[i - filterStride] : 0;
+					int predictor = 0;
+					switch (filter)
+					{
+					case 1: predictor = left; break;
+					case 2: predictor = up; break;
+					case 3: predictor = (left + up) / 2; break;
+					case 4: predictor = paeth(left, up, upLeft); break;
+					}
+					rows.push_back(static_cast<BYTE>(row[i] - predictor));
+				}
+				previous = row;
+			}
+		}
+		writer.writeData(rows);
+		writer.writeChunk("IEND", {});
+
+		// The expected pixels: 8 bit samples, the transparency applied, premultiplied.
+		auto to8Bits = [&test, maxSample](UINT16 sample) -> UINT32 {
+			if (test.depth == 16) return sample >> 8;
+			return sample * 255u / maxSample;
+		};
+		expected->clear();
+		for (size_t p = 0; p < samples.size() / channels; p++)
+		{
+			const UINT16* sample = &samples[p * channels];
+			UINT32 r, g, b, a = 255;
+			switch (test.colorType)
+			{
+			case 3:
+				r = palette[sample[0] * 3];
+				g = palette[sample[0] * 3 + 1];
+				b = palette[sample[0] * 3 + 2];
+				if (sample[0] < alphas.size()) a = alphas[sample[0]];
+				break;
+			case 0:
+			case 4:
+				r = g = b = to8Bits(sample[0]);
+				if (test.colorType == 4) a = to8Bits(sample[1]);
+				else if (test.transparent && sample[0] == (key[0] & maxSample)) a = 0;
+				break;
+			default:
+				r = to8Bits(sample[0]);
+				g = to8Bits(sample[1]);
+				b = to8Bits(sample[2]);
+				if (test.colorType == 6) a = to8Bits(sample[3]);
+				else if (test.transparent && sample[0] == (key[0] & maxSample) && sample[1] == (key[1] & maxSample) && sample[2] == (key[2] & maxSample)) a = 0;
+				break;
+			}
+			expected->push_back(Graphics::Pixel(premultiply(r, a), premultiply(g, a), premultiply(b, a), static_cast<BYTE>(a)));
+		}
+		return writer.getFile();
+	}
+
+	/**
+	 * @brief Every color type and bit depth, interlaced or not, with and without transparency, at sizes
+	 *        leaving some Adam7 passes empty: each decoded image must equal the pixels it was written from.
+	 */
+	void testPngCorpus()
+	{
+		const std::pair<BYTE, BYTE> formats[] = {
+			{ 0, 1 }, { 0, 2 }, { 0, 4 }, { 0, 8 }, { 0, 16 }, { 2, 8 }, { 2, 16 }, { 3, 1 }, { 3, 2 }, { 3, 4 }, { 3, 8 },
+			{ 4, 8 }, { 4, 16 }, { 6, 8 }, { 6, 16 } };
+		const std::pair<UINT32, UINT32> sizes[] = { { 1, 1 }, { 3, 2 }, { 7, 9 }, { 17, 13 }, { 64, 33 } };
+
+		std::mt19937 random(43);
+		UINT32 cases = 0, mismatches = 0;
+		for (const auto& [colorType, depth] : formats)
+		{
+			for (bool interlaced : { false, true })
+			{
+				for (bool transparent : { false, true })
+				{
+					if (transparent && (colorType == 4 || colorType == 6)) continue; // They have an alpha channel.
+					for (const auto& [width, height] : sizes)
+					{
+						const PngCase test = { colorType, depth, interlaced, transparent, width, height };
+						std::vector<Graphics::Pixel> expected;
+						const std::vector<BYTE> file = makePng(test, random, &expected);
+
+						Codec::DecodedImage image;
+						const bool isDecoded = Codec::decodePng(file.data(), file.size(), image);
+						cases++;
+						if (isDecoded && image.width == width && image.height == height && image.frames.size() == 1
+							&& std::memcmp(image.frames[0].pixels.data(), expected.data(), expected.size() * sizeof(Graphics::Pixel)) == 0)
+							continue;
+
+						mismatches++;
+						std::printf("  color type %d, depth %d, %s, %s, %ux%u: %s\n", colorType, depth, interlaced ? "interlaced" : "progressive",
+							transparent ? "tRNS" : "opaque", width, height, isDecoded ? "wrong pixels" : "not decoded");
+					}
+				}
+			}
+		}
+		CHECK(cases == 260);
+		CHECK(mismatches == 0);
+	}
+
+
+	/**
+	 * @brief Images past 16384 x 16384 pixels are rejected from their header, and a large image opening one fails loudly.
+	 */
+	void testSizeLimit()
+	{
+		CHECK(Codec::isSizeSupported(16384, 16384));
+		CHECK(!Codec::isSizeSupported(16385, 16384));
+		CHECK(!Codec::isSizeSupported(0, 16));
+
+		PngWriter writer;
+		writer.writeChunk("IHDR", PngWriter::header(32768, 32768, 8, 6, false));
+		writer.writeChunk("IEND", {});
+		const std::vector<BYTE>& png = writer.getFile();
+		UINT32 width, height;
+		CHECK(Codec::readImageSize(png.data(), png.size(), width, height) && width == 32768 && height == 32768);
+		Codec::DecodedImage image;
+		CHECK(!Codec::decodePng(png.data(), png.size(), image));
+
+		const std::vector<BYTE> gif = { 'G', 'I', 'F', '8', '9', 'a', 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x3B };
+		CHECK(Codec::readImageSize(gif.data(), gif.size(), width, height) && width == 65535 && height == 65535);
+		CHECK(!Codec::decodeGif(gif.data(), gif.size(), image));
+
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "size_limit_test.png";
+		{
+			std::ofstream file(path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+		}
+		bool hasThrown = false;
+		try
+		{
+			Graphics::LargeImage large({ 0.0f, 0.0f }, path.wstring().c_str());
+		}
+		catch (const std::length_error&)
+		{
+			hasThrown = true;
+		}
+		std::filesystem::remove(path);
+		CHECK(hasThrown);
+	}
+
+
+	void addImageDecoderTests(_Inout_ Suite& suite)
+	{
+		suite.add("image_decoder/inflate_vectors", testInflateVectors);
+		suite.add("image_decoder/reference_images", testReferenceImages);
+		suite.add("image_decoder/corrupted_images", testCorruptedImages);
+		suite.add("image_decoder/png_corpus", testPngCorpus);
+		suite.add("image_decoder/size_limit", testSizeLimit);
+	}
+
+} // namespace Tests
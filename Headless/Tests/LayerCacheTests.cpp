@@ -0,0 +1,131 @@
+#include "Tests.h"
+
+#include <memory>
+
+#include "GraphicComponents.h"
+#include "LayerCache.h"
+#include "Replay.h"
+
+
+namespace Tests
+{
+	constexpr ZIndex LAYER_COUNT = 20;
+	constexpr ZIndex ANIMATED_LAYER = 7;
+
+	/**
+	 * @brief Bytes of the offscreen bitmap of a layer, at the client size of the headless windows.
+	 */
+	inline size_t getLayerBytes() noexcept
+	{
+		return static_cast<size_t>(Headless::clientWidth) * Headless::clientHeight * 4;
+	}
+
+	/**
+	 * @brief A window of 20 cached z-indexes of 10 rectangles each, one of which moves every frame.
+	 */
+	struct LayeredWindow
+	{
+		Replay::HeadlessWindow window;
+		Graphics::Component* pMoving = nullptr;
+
+		LayeredWindow()
+		{
+			for (ZIndex zIndex = 0; zIndex < LAYER_COUNT; zIndex++)
+			{
+				for (int i = 0; i < 10; i++)
+				{
+					const D2D1_POINT_2F pos = { static_cast<float>(i * 60 + zIndex), static_cast<float>(zIndex * 30) };
+					const ComponentId id = window.addComponent(std::make_unique<Graphics::RectangleShape>(pos, D2D1_SIZE_F{ 40.0f, 20.0f }, 0x80306090u), zIndex);
+					if (zIndex == ANIMATED_LAYER && i == 0) pMoving = window.getComponent(id);
+				}
+				window.setLayerCached(zIndex, true);
+			}
+		}
+
+		void paint(_In_ UINT32 frames)
+		{
+			for (UINT32 i = 0; i < frames; i++)
+			{
+				const D2D1_POINT_2F pos = pMoving->getPos();
+				pMoving->setPos({ pos.x + 1.0f, pos.y });
+				window.paintFrame();
+			}
+		}
+	};
+
+
+	/**
+	 * @brief The static z-indexes are built once then blitted, the animated one is rebuilt every frame.
+	 */
+	void testHitRates()
+	{
+		LayeredWindow layered;
+		layered.window.getLayerCache().setMemoryBudget(getLayerBytes() * LAYER_COUNT);
+		layered.paint(10);
+
+		const Render::LayerCache& cache = layered.window.getLayerCache();
+		for (ZIndex zIndex = 0; zIndex < LAYER_COUNT; zIndex++)
+		{
+			const Render::LayerCacheStats* stats = cache.getStats(zIndex);
+			CHECK(stats != nullptr);
+			if (stats == nullptr) continue;
+			if (zIndex == ANIMATED_LAYER)
+			{
+				CHECK(stats->hits == 0 && stats->misses == 10);
+				CHECK(stats->getHitRate() == 0.0);
+			}
+			else
+			{
+				CHECK(stats->hits == 9 && stats->misses == 1);
+				CHECK(stats->getHitRate() == 0.9);
+			}
+			CHECK(stats->uncached == 0 && stats->evictions == 0);
+		}
+	}
+
+	/**
+	 * @brief An invalidated z-index is rebuilt once, the others still hit.
+	 */
+	void testInvalidateLayer()
+	{
+		LayeredWindow layered;
+		layered.window.getLayerCache().setMemoryBudget(getLayerBytes() * LAYER_COUNT);
+		layered.paint(2);
+		layered.window.getLayerCache().invalidateLayer(3);
+		layered.paint(1);
+
+		const Render::LayerCache& cache = layered.window.getLayerCache();
+		CHECK(cache.getStats(3)->misses == 2 && cache.getStats(3)->hits == 1);
+		CHECK(cache.getStats(4)->misses == 1 && cache.getStats(4)->hits == 2);
+	}
+
+	/**
+	 * @brief With room for 2 bitmaps, the first 2 z-indexes keep theirs and the others are drawn directly,
+	 *        instead of each one evicting the next. A smaller budget evicts the least recently used.
+	 */
+	void testMemoryBudget()
+	{
+		LayeredWindow layered;
+		Render::LayerCache& cache = layered.window.getLayerCache();
+		cache.setMemoryBudget(getLayerBytes() * 2);
+		layered.paint(3);
+
+		CHECK(cache.getMemoryUsage() == getLayerBytes() * 2);
+		CHECK(cache.getStats(0)->hits == 2 && cache.getStats(1)->hits == 2);
+		for (ZIndex zIndex = 2; zIndex < LAYER_COUNT; zIndex++)
+			CHECK(cache.getStats(zIndex)->uncached == 3 && cache.getStats(zIndex)->evictions == 0);
+
+		cache.setMemoryBudget(getLayerBytes());
+		CHECK(cache.getMemoryUsage() == getLayerBytes());
+		CHECK(cache.getStats(0)->evictions == 1 && cache.getStats(1)->evictions == 0);
+	}
+
+
+	void addLayerCacheTests(_Inout_ Suite& suite)
+	{
+		suite.add("layer_cache/hit_rates", testHitRates);
+		suite.add("layer_cache/invalidate_layer", testInvalidateLayer);
+		suite.add("layer_cache/memory_budget", testMemoryBudget);
+	}
+
+} // namespace Tests
@@ -0,0 +1,71 @@
+#include "Tests.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Profiler.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief Return the number of times a pattern is found in a text.
+	 */
+	size_t countOccurrences(_In_ const std::string& text, _In_ const std::string& pattern)
+	{
+		size_t count = 0;
+		for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + pattern.size()))
+			count++;
+		return count;
+	}
+
+
+	/**
+	 * @brief A capture started by the main thread ends after the frames marked by a render thread, then exports them.
+	 */
+	void testCaptureAcrossThreads()
+	{
+		std::atomic<bool> isRendering = true;
+		std::thread renderThread([&isRendering]() {
+			while (isRendering.load())
+			{
+				{
+					Profiler::Zone zone("render");
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+				}
+				Profiler::markFrame();
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Profiler::beginCapture(20);
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "profiler_test.json";
+		CHECK(!Profiler::exportChromeTrace(path.wstring().c_str()) || !Profiler::isCapturing); // Refused while capturing.
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (Profiler::isCapturing.load() && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		isRendering = false;
+		renderThread.join();
+		CHECK(!Profiler::isCapturing);
+
+		CHECK(Profiler::exportChromeTrace(path.wstring().c_str()));
+		std::stringstream trace;
+		trace << std::ifstream(path).rdbuf();
+		std::filesystem::remove(path);
+		CHECK(countOccurrences(trace.str(), "\"name\":\"Frame\"") == 20);
+		CHECK(countOccurrences(trace.str(), "\"name\":\"render\"") >= 19);
+	}
+
+
+	void addProfilerTests(_Inout_ Suite& suite)
+	{
+		suite.add("profiler/capture_across_threads", testCaptureAcrossThreads);
+	}
+
+} // namespace Tests
@@ -0,0 +1,116 @@
+#include "Tests.h"
+
+#include <chrono>
+#include <memory>
+
+#include "GraphicComponents.h"
+#include "WindowClass.h"
+
+
+namespace Tests
+{
+	typedef std::chrono::steady_clock ticker;
+
+	/**
+	 * @brief A component which recording keeps the CPU busy, to load the frames at will.
+	 */
+	class LoadComponent : public Graphics::DrawableComponent
+	{
+	public:
+		double loadMs = 0.0;
+
+		void record(_Inout_ Render::CommandList& commands) override
+		{
+			const ticker::time_point end = ticker::now() + std::chrono::duration_cast<ticker::duration>(std::chrono::duration<double, std::milli>(loadMs));
+			while (ticker::now() < end) {}
+			commands.fillRect({ 0.0f, 0.0f, 10.0f, 10.0f }, 0xFF000000u);
+		}
+
+		void reconstruct() noexcept override {}
+	};
+
+	/**
+	 * @brief A window of the headless build, presenting at 60 Hz like a swap chain synchronized on the vsync.
+	 */
+	struct VsyncWindow
+	{
+		BaseWindow window{ nullptr, L"QualityTests", L"QualityTests" };
+		LoadComponent* pLoad = nullptr;
+
+		VsyncWindow()
+		{
+			Headless::vsyncIntervalMs = 1000.0 / 60.0;
+			std::unique_ptr<LoadComponent> load = std::make_unique<LoadComponent>();
+			pLoad = load.get();
+			window.addComponent(std::move(load), 0);
+
+			Render::QualityThresholds thresholds;
+			thresholds.sampleCount = 8;
+			thresholds.downFrames = 2;
+			thresholds.upFrames = 10;
+			window.getQuality().setThresholds(thresholds);
+			window.setQualityScaling(true);
+		}
+
+		void paint(_In_ UINT32 frames, _In_ double loadMs)
+		{
+			pLoad->loadMs = loadMs;
+			for (UINT32 i = 0; i < frames; i++)
+				window.paintFrame();
+		}
+
+		~VsyncWindow()
+		{
+			Headless::vsyncIntervalMs = 0.0;
+		}
+	};
+
+
+	/**
+	 * @brief Frames of little work last a refresh interval, a bit more than the 16 ms budget: the wait must not count.
+	 */
+	void testIdleFramesKeepQuality()
+	{
+		VsyncWindow vsync;
+		vsync.paint(40, 0.0);
+		CHECK(vsync.window.getPresentStats().lastPresentWaitMs > 0.0);
+		CHECK(vsync.window.getQuality().getLevel() == 0);
+		CHECK(vsync.window.getQuality().getDecisions().empty());
+	}
+
+	/**
+	 * @brief A spike of 30 ms frames lowers the quality, which comes back to full once the load is gone.
+	 */
+	void testLoadSpike()
+	{
+		VsyncWindow vsync;
+		const Render::QualityGovernor& quality = vsync.window.getQuality();
+
+		vsync.paint(10, 1.0);
+		CHECK(quality.getLevel() == 0);
+
+		vsync.paint(24, 30.0);
+		const UINT32 spikeLevel = quality.getLevel();
+		CHECK(spikeLevel > 0);
+
+		vsync.paint(80, 1.0);
+		CHECK(quality.getLevel() == 0);
+
+		// Down during the spike only, then up one level at a time.
+		const auto& decisions = quality.getDecisions();
+		CHECK(decisions.size() == 2 * spikeLevel);
+		for (size_t i = 0; i < decisions.size(); i++)
+		{
+			if (i < spikeLevel) CHECK(decisions[i].toLevel == decisions[i].fromLevel + 1);
+			else CHECK(decisions[i].toLevel + 1 == decisions[i].fromLevel);
+		}
+	}
+
+
+	void addQualityTests(_Inout_ Suite& suite)
+	{
+		suite.add("quality/idle_frames_keep_quality", testIdleFramesKeepQuality);
+		suite.add("quality/load_spike", testLoadSpike);
+	}
+
+} // namespace Tests
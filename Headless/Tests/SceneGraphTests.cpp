@@ -0,0 +1,90 @@
+#include "Tests.h"
+
+#include <cmath>
+#include <memory>
+
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "SceneGraph.h"
+#include "SoftwareRenderer.h"
+
+
+namespace Tests
+{
+	inline bool isNear(_In_ const D2D1_POINT_2F& a, _In_ const D2D1_POINT_2F& b) noexcept
+	{
+		return std::fabs(a.x - b.x) < 1e-3f && std::fabs(a.y - b.y) < 1e-3f;
+	}
+
+	/**
+	 * @brief Destroying a node leaves its children where they were on screen.
+	 */
+	void testDestroyKeepsChildrenInPlace()
+	{
+		Graphics::SceneGraph scene;
+		Graphics::LocalTransform rootLocal, parentLocal, childLocal;
+		rootLocal.position = { 40.0f, 20.0f };
+		rootLocal.rotation = -0.3f;
+		parentLocal.position = { 100.0f, 50.0f };
+		parentLocal.scale = { 2.0f, 2.0f };
+		parentLocal.rotation = 0.5f;
+		childLocal.position = { 10.0f, 4.0f };
+		childLocal.scale = { 1.5f, 0.5f };
+		childLocal.rotation = 0.25f;
+
+		const Graphics::NodeId root = scene.create(Graphics::INVALID_NODE, rootLocal);
+		const Graphics::NodeId parent = scene.create(root, parentLocal);
+		const Graphics::NodeId child = scene.create(parent, childLocal);
+		scene.update();
+
+		const D2D1_POINT_2F corners[] = { { 0.0f, 0.0f }, { 30.0f, 0.0f }, { 0.0f, 20.0f } };
+		D2D1_POINT_2F before[3];
+		for (int i = 0; i < 3; i++) before[i] = scene.getWorld(child).apply(corners[i]);
+
+		scene.destroy(parent);
+		scene.update();
+		CHECK(scene.getParent(child) == root);
+		for (int i = 0; i < 3; i++) CHECK(isNear(scene.getWorld(child).apply(corners[i]), before[i]));
+	}
+
+	/**
+	 * @brief A hit test only returns the window's components: not those removed, nor the nodes of other owners.
+	 */
+	void testHitTestWindowComponents()
+	{
+		Replay::HeadlessWindow window;
+		const ComponentId parentId = window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ 100.0f, 100.0f }, 0xFFFFFFFFu), 0);
+		const ComponentId childId = window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 10.0f, 10.0f }, D2D1_SIZE_F{ 20.0f, 20.0f }, 0xFF0000FFu), 0);
+		Graphics::Component* const parent = window.getComponent(parentId);
+		Graphics::Component* const child = window.getComponent(childId);
+		CHECK(window.setComponentParent(childId, parentId));
+		Render::SoftwareRenderer renderer(1);
+		Render::Framebuffer target(320, 240);
+		window.renderOffscreen(renderer, target); // Sizes the shapes, and updates the scene.
+		CHECK(window.hitTest({ 15.0f, 15.0f }) == child);
+
+		Graphics::ComponentPtr removed = window.removeComponent(childId);
+		CHECK(removed->getScene() == nullptr);
+		CHECK(isNear(removed->getPos(), { 10.0f, 10.0f }));
+		window.getScene().update();
+		CHECK(window.hitTest({ 15.0f, 15.0f }) == parent);
+
+		// A node of the window's scene whose component the window does not hold.
+		Graphics::RectangleShape foreign({ 200.0f, 200.0f }, { 20.0f, 20.0f }, 0xFFFFFFFFu);
+		Graphics::LocalTransform local;
+		local.position = { 200.0f, 200.0f };
+		const Graphics::NodeId node = window.getScene().create(Graphics::INVALID_NODE, local, &foreign);
+		window.getScene().setSize(node, { 20.0f, 20.0f });
+		window.getScene().update();
+		CHECK(window.hitTest({ 205.0f, 205.0f }) == nullptr);
+		CHECK(window.hitTest({ 500.0f, 500.0f }) == nullptr);
+	}
+
+
+	void addSceneGraphTests(_Inout_ Suite& suite)
+	{
+		suite.add("scene/destroy_keeps_children_in_place", testDestroyKeepsChildrenInPlace);
+		suite.add("scene/hit_test_window_components", testHitTestWindowComponents);
+	}
+
+} // namespace Tests
@@ -0,0 +1,82 @@
+#include "Tests.h"
+
+#include <memory>
+
+#include "GraphicComponents.h"
+#include "Replay.h"
+#include "Task.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief Count the frames until cancelled.
+	 */
+	Tasks::Task countFrames(_Inout_ UINT32& frames)
+	{
+		while (true)
+		{
+			co_await Tasks::nextFrame();
+			frames++;
+		}
+	}
+
+	/**
+	 * @brief Run a frame of the tasks.
+	 */
+	void runTaskFrame(_Inout_ BaseWindow& window)
+	{
+		window.getTasks().advanceFrame();
+		window.updateTasks();
+	}
+
+	/**
+	 * @brief Moved to another z-index, a component keeps its id and its tasks.
+	 */
+	void testSurvivesZIndexChange()
+	{
+		Replay::HeadlessWindow window;
+		const ComponentId id = window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ 8.0f, 8.0f }, 0xFFFFFFFFu), 0);
+		Graphics::Component* const component = window.getComponent(id);
+
+		UINT32 frames = 0;
+		const Tasks::TaskId task = window.getTasks().spawn(countFrames(frames), component);
+		runTaskFrame(window);
+		CHECK(frames == 1);
+
+		CHECK(window.setComponentZIndex(id, 3));
+		CHECK(window.getComponent(id) == component);
+		CHECK(window.getComponentList().at(3).back().second == id);
+		CHECK(window.getComponentList().at(0).empty());
+		CHECK(window.getTasks().isRunning(task));
+		runTaskFrame(window);
+		CHECK(frames == 2);
+
+		CHECK(!window.setComponentZIndex(id + 1, 3));
+	}
+
+	/**
+	 * @brief Removed from the window, a component loses its tasks.
+	 */
+	void testCancelledOnRemoval()
+	{
+		Replay::HeadlessWindow window;
+		const ComponentId id = window.addComponent(std::make_unique<Graphics::RectangleShape>(D2D1_POINT_2F{ 0.0f, 0.0f }, D2D1_SIZE_F{ 8.0f, 8.0f }, 0xFFFFFFFFu), 0);
+
+		UINT32 frames = 0;
+		const Tasks::TaskId task = window.getTasks().spawn(countFrames(frames), window.getComponent(id));
+		Graphics::ComponentPtr removed = window.removeComponent(id);
+		CHECK(removed != nullptr);
+		CHECK(!window.getTasks().isRunning(task));
+		runTaskFrame(window);
+		CHECK(frames == 0);
+	}
+
+
+	void addTaskTests(_Inout_ Suite& suite)
+	{
+		suite.add("tasks/survive_z_index_change", testSurvivesZIndexChange);
+		suite.add("tasks/cancelled_on_removal", testCancelledOnRemoval);
+	}
+
+} // namespace Tests
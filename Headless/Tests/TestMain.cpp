@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "Tests.h"
+
+
+namespace Tests
+{
+
+	unsigned int failedChecks = 0; // Of the running test.
+
+	void fail(_In_ const char* expression, _In_ const char* file, _In_ int line)
+	{
+		failedChecks++;
+		std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+	}
+
+	void Suite::add(_In_ const std::string& name, _In_ TESTFCT testFct)
+	{
+		m_tests.push_back({ name, testFct });
+	}
+
+	unsigned int Suite::run(_In_opt_ const std::string& filter) const
+	{
+		unsigned int failedTests = 0;
+		for (const Entry& entry : m_tests)
+		{
+			if (!filter.empty() && entry.name.find(filter) == std::string::npos) continue;
+
+			failedChecks = 0;
+			(*entry.testFunction)();
+			if (failedChecks != 0) failedTests++;
+			std::printf("%s %s\n", failedChecks == 0 ? "[ OK ]" : "[FAIL]", entry.name.c_str());
+		}
+		return failedTests;
+	}
+
+} // namespace Tests
+
+
+/**
+ * Runs the tests, optionally only those whose name contains a text.
+ *
+ *   tests [--filter text]
+ *
+ * Exits with 1 if a test failed, 2 on a bad argument.
+ */
+int main(int argc, char** argv)
+{
+	std::string filter;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--filter text]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	Tests::Suite suite;
+	Tests::addTimerWheelTests(suite);
+	Tests::addFrameSnapshotTests(suite);
+	Tests::addImageDecoderTests(suite);
+	Tests::addQualityTests(suite);
+	Tests::addComponentPoolTests(suite);
+	Tests::addTaskTests(suite);
+	Tests::addSceneGraphTests(suite);
+	Tests::addTransformStoreTests(suite);
+	Tests::addLayerCacheTests(suite);
+	Tests::addGlyphCacheTests(suite);
+	Tests::addProfilerTests(suite);
+	Tests::addUploadQueueTests(suite);
+	Tests::addTextureStoreTests(suite);
+
+	const unsigned int failedTests = suite.run(filter);
+	if (failedTests != 0) std::printf("%u test(s) failed\n", failedTests);
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#ifndef HEADLESS_TESTS_H
+#define HEADLESS_TESTS_H
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Check a condition, reporting it with its place when false. The test goes on.
+ */
+#define CHECK(condition) Tests::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+
+namespace Tests
+{
+	typedef void(*TESTFCT)();
+
+	/**
+	 * @brief Record a failed check of the running test and print it.
+	 */
+	void fail(_In_ const char* expression, _In_ const char* file, _In_ int line);
+
+	inline void check(_In_ bool condition, _In_ const char* expression, _In_ const char* file, _In_ int line)
+	{
+		if (!condition) fail(expression, file, line);
+	}
+
+	/**
+	 * @brief A list of named tests.
+	 */
+	class Suite
+	{
+	private:
+		struct Entry
+		{
+			std::string name;
+			TESTFCT testFunction;
+		};
+
+		std::vector<Entry> m_tests;
+
+	public:
+		void add(_In_ const std::string& name, _In_ TESTFCT testFct);
+
+		/**
+		 * @brief Run the tests whose name contains the filter, printing each result.
+		 *
+		 * @retval unsigned int
+		 * @return The number of tests that failed.
+		 */
+		unsigned int run(_In_opt_ const std::string& filter = "") const;
+	};
+
+	/**
+	 * @brief Add the tests of the timer wheel, driven by a virtual clock.
+	 */
+	void addTimerWheelTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the snapshots handed to the render thread, and of the device resources it releases.
+	 */
+	void addFrameSnapshotTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the image decoder: inflate vectors, the repository's images against reference hashes,
+	 *        corrupted files, a corpus of generated PNGs, and the size limit.
+	 */
+	void addImageDecoderTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the quality governor driven by a window, against a simulated vsync.
+	 */
+	void addQualityTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the component pools, and of the components outliving their window.
+	 */
+	void addComponentPoolTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the coroutine tasks bound to the components of a window.
+	 */
+	void addTaskTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the scene graph, and of the hit tests of a window.
+	 */
+	void addSceneGraphTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the transform store: slots, bounds, and the batch operations split over a pool.
+	 */
+	void addTransformStoreTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the layer cache driven by a window: per z-index hit rates, invalidation and the memory budget.
+	 */
+	void addLayerCacheTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the glyph cache with the bundled font: atlas placement, run caching and line breaks.
+	 */
+	void addGlyphCacheTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the profiler: a capture started and ended on different threads, then exported.
+	 */
+	void addProfilerTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the upload queue: the bounded prefetch of the recent bitmaps, and the culled ones left out.
+	 */
+	void addUploadQueueTests(_Inout_ Suite& suite);
+
+	/**
+	 * @brief Add the tests of the texture store: the compressed textures decode to their pixels, palette or flat color.
+	 */
+	void addTextureStoreTests(_Inout_ Suite& suite);
+
+} // namespace Tests
+
+#endif // HEADLESS_TESTS_H
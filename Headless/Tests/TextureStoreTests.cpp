@@ -0,0 +1,70 @@
+#include "Tests.h"
+
+#include <cstring>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "ImageDecoder.h"
+#include "TextureStore.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief Return true if a texture decodes to the pixels it was compressed from.
+	 */
+	bool isRoundTrip(_In_ const Render::CompressedTexture& texture, _In_ const std::vector<Graphics::Pixel>& pixels)
+	{
+		std::vector<Graphics::Pixel> decoded(pixels.size(), Graphics::Pixel(0x00, 0x00));
+		Render::decodeTexture(texture, decoded.data());
+		return std::memcmp(decoded.data(), pixels.data(), pixels.size() * sizeof(Graphics::Pixel)) == 0;
+	}
+
+
+	/**
+	 * @brief The palette PNG keeps its 256 colors or less as an indexed texture, and decodes to the same pixels.
+	 */
+	void testPaletteRoundTrip()
+	{
+		Codec::DecodedImage image;
+		CHECK(Codec::loadImage(L"" IMAGES_DIR L"test.png", image));
+		if (image.frames.empty()) return;
+		const std::vector<Graphics::Pixel>& pixels = image.frames[0].pixels;
+
+		const Render::CompressedTexture texture = Render::compressTexture(pixels.data(), image.width, image.height);
+		CHECK(texture.format == Render::TextureFormat::Indexed);
+		CHECK(texture.getCompressedBytes() < texture.getRawBytes());
+		CHECK(isRoundTrip(texture, pixels));
+
+		// Through the store: the ratio it reports is the texture's.
+		Render::TextureStore store;
+		const Render::TextureId id = store.add(pixels.data(), image.width, image.height);
+		const Render::TextureStats& stats = store.getStats();
+		CHECK(stats.getCompressionRatio() == static_cast<double>(texture.getRawBytes()) / static_cast<double>(texture.getCompressedBytes()));
+		const Graphics::Pixel* decoded = store.decode(id);
+		CHECK(decoded != nullptr && std::memcmp(decoded, pixels.data(), pixels.size() * sizeof(Graphics::Pixel)) == 0);
+	}
+
+	/**
+	 * @brief A flat color is a palette of one color, in runs of 130 pixels: about 260 times smaller.
+	 */
+	void testFlatRoundTrip()
+	{
+		const std::vector<Graphics::Pixel> pixels(256 * 256, Graphics::Pixel(0x30, 0x60, 0x90, 0xFF));
+		const Render::CompressedTexture texture = Render::compressTexture(pixels.data(), 256, 256);
+		CHECK(texture.format == Render::TextureFormat::Indexed && texture.palette.size() == 1);
+		CHECK(isRoundTrip(texture, pixels));
+
+		Render::TextureStore store;
+		store.add(pixels.data(), 256, 256);
+		CHECK(store.getStats().getCompressionRatio() > 200.0);
+	}
+
+
+	void addTextureStoreTests(_Inout_ Suite& suite)
+	{
+		suite.add("texture_store/palette_round_trip", testPaletteRoundTrip);
+		suite.add("texture_store/flat_round_trip", testFlatRoundTrip);
+	}
+
+} // namespace Tests
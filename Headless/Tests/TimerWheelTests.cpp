@@ -0,0 +1,324 @@
+#include "Tests.h"
+
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "TimerWheel.h"
+
+
+namespace Tests
+{
+	using Timers::TimePoint;
+	using Timers::TimerId;
+	using Timers::TimerWheel;
+
+	// The virtual clock: the wheel only sees the times given to advance.
+	const TimePoint origin = TimePoint{} + std::chrono::hours(1);
+
+	inline TimePoint at(_In_ UINT64 ms) noexcept
+	{
+		return origin + std::chrono::milliseconds(ms);
+	}
+
+	struct Call
+	{
+		TimerId id;
+		LPARAM periods;
+		UINT64 tick;	// The time given to the advance that called it.
+		int tag;
+	};
+
+	struct Log
+	{
+		std::vector<Call> calls;
+		UINT64 now = 0;
+		TimerWheel* pWheel = nullptr;
+		std::unordered_map<TimerId, int> tags;
+		bool cancelSelf = false;
+	};
+
+	LRESULT onTimer(_In_ HWND /*hwnd*/, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+	{
+		Log& log = *reinterpret_cast<Log*>(context);
+		const TimerId id = static_cast<TimerId>(wParam);
+		log.calls.push_back({ id, lParam, log.now, log.tags.count(id) ? log.tags[id] : 0 });
+		if (log.cancelSelf) CHECK(log.pWheel->cancel(id));
+		return S_OK;
+	}
+
+	/**
+	 * @brief Advance the wheel to a time, one millisecond at a time.
+	 */
+	void advanceTo(_Inout_ TimerWheel& wheel, _Inout_ Log& log, _In_ UINT64 ms)
+	{
+		while (log.now < ms)
+		{
+			log.now++;
+			wheel.advance(at(log.now));
+		}
+	}
+
+	/**
+	 * @brief Advance the wheel to a time at once, as after a long sleep.
+	 */
+	void jumpTo(_Inout_ TimerWheel& wheel, _Inout_ Log& log, _In_ UINT64 ms)
+	{
+		log.now = ms;
+		wheel.advance(at(ms));
+	}
+
+
+	void testOneShot()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		const TimerId id = wheel.schedule(10, 0, onTimer, &log);
+		CHECK(wheel.isArmed(id));
+		CHECK(wheel.getCount() == 1);
+
+		advanceTo(wheel, log, 9);
+		CHECK(log.calls.empty());
+		advanceTo(wheel, log, 10);
+		CHECK(log.calls.size() == 1 && log.calls[0].id == id && log.calls[0].tick == 10 && log.calls[0].periods == 1);
+		CHECK(!wheel.isArmed(id));
+		CHECK(wheel.getCount() == 0);
+
+		advanceTo(wheel, log, 1000);
+		CHECK(log.calls.size() == 1);
+		CHECK(!wheel.cancel(id));
+	}
+
+	void testZeroDelay()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		wheel.schedule(0, 0, onTimer, &log);
+		wheel.advance(at(0)); // The delay counts from the last tick handled: nothing is due yet.
+		CHECK(log.calls.empty());
+		advanceTo(wheel, log, 1);
+		CHECK(log.calls.size() == 1 && log.calls[0].tick == 1);
+	}
+
+	void testSameTickOrder()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		log.tags[wheel.schedule(5, 0, onTimer, &log)] = 1;
+		log.tags[wheel.schedule(5, 0, onTimer, &log, PRIORITY_HIGHEST)] = 2;
+		log.tags[wheel.schedule(5, 0, onTimer, &log)] = 3;
+		log.tags[wheel.schedule(5, 0, onTimer, &log, PRIORITY_LOWEST)] = 4;
+		log.tags[wheel.schedule(4, 0, onTimer, &log, PRIORITY_LOWEST)] = 5;
+
+		jumpTo(wheel, log, 100);
+		std::vector<int> order;
+		for (const Call& call : log.calls) order.push_back(call.tag);
+		CHECK((order == std::vector<int>{ 5, 2, 1, 3, 4 }));
+	}
+
+	void testLateRepeatingTimer()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		const TimerId id = wheel.schedule(10, 10, onTimer, &log);
+
+		// Due at 10, 20 and 30: called once, with the three periods.
+		jumpTo(wheel, log, 35);
+		CHECK(log.calls.size() == 1 && log.calls[0].periods == 3);
+
+		// Still on its beat: 40, then 50.
+		advanceTo(wheel, log, 39);
+		CHECK(log.calls.size() == 1);
+		advanceTo(wheel, log, 40);
+		CHECK(log.calls.size() == 2 && log.calls[1].periods == 1 && log.calls[1].tick == 40);
+		advanceTo(wheel, log, 50);
+		CHECK(log.calls.size() == 3 && log.calls[2].tick == 50);
+		CHECK(wheel.isArmed(id));
+	}
+
+	void testCancelFromCallback()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		log.pWheel = &wheel;
+		log.cancelSelf = true;
+		const TimerId id = wheel.schedule(10, 10, onTimer, &log);
+
+		advanceTo(wheel, log, 100);
+		CHECK(log.calls.size() == 1);
+		CHECK(!wheel.isArmed(id));
+		CHECK(wheel.getCount() == 0);
+		CHECK(wheel.getNextDeadline() == TimePoint::max());
+	}
+
+	void testFarTimers()
+	{
+		// One per level, and one beyond the range of the wheel, moved down again when reached.
+		for (UINT64 delay : { 200ull, 300ull, 20000ull, 2000000ull, 100000000ull })
+		{
+			TimerWheel wheel(origin);
+			Log log;
+			wheel.schedule(delay, 0, onTimer, &log);
+
+			jumpTo(wheel, log, delay / 2);
+			jumpTo(wheel, log, delay - 1);
+			CHECK(log.calls.empty());
+			jumpTo(wheel, log, delay);
+			CHECK(log.calls.size() == 1);
+			CHECK(wheel.getCount() == 0);
+		}
+	}
+
+	void testNextDeadline()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		CHECK(wheel.getNextDeadline() == TimePoint::max());
+
+		// Exact within the root level.
+		wheel.schedule(100, 0, onTimer, &log);
+		CHECK(wheel.getNextDeadline() == at(100));
+
+		// Farther timers wake the loop when they are moved down, never after they are due.
+		const UINT64 due = 100000;
+		wheel.schedule(due, 0, onTimer, &log);
+		UINT32 wakeUps = 0;
+		while (log.calls.size() < 2 && wakeUps < 10000)
+		{
+			const TimePoint deadline = wheel.getNextDeadline();
+			CHECK(deadline > at(log.now));
+			CHECK(deadline <= at(due));
+			jumpTo(wheel, log, static_cast<UINT64>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - origin).count()));
+			wakeUps++;
+		}
+		CHECK(log.calls.size() == 2 && log.calls[0].tick == 100 && log.calls[1].tick == due);
+		CHECK(wakeUps <= due / 256 + 4); // At most once per turn of the root level.
+	}
+
+	void testRebase()
+	{
+		TimerWheel wheel(origin);
+		Log log;
+		wheel.schedule(50, 0, onTimer, &log);
+		advanceTo(wheel, log, 20);
+
+		// The clock jumps an hour ahead: 30 ms remain.
+		const TimePoint later = origin + std::chrono::hours(1);
+		wheel.rebase(later + std::chrono::milliseconds(20));
+		wheel.advance(later + std::chrono::milliseconds(49));
+		CHECK(log.calls.empty());
+		wheel.advance(later + std::chrono::milliseconds(50));
+		CHECK(log.calls.size() == 1);
+	}
+
+	/**
+	 * @brief Random schedules, cancels and advances, checked against a plain model of the timers.
+	 */
+	void testAgainstModel()
+	{
+		struct Expected
+		{
+			UINT64 due;
+			UINT64 period;
+		};
+
+		struct Model
+		{
+			std::unordered_map<TimerId, Expected> timers;
+			UINT64 from = 0, to = 0;	// The advance being checked: the calls are due in (from, to].
+			UINT64 lastDue = 0;
+			UINT64 calls = 0;
+			UINT64 errors = 0;
+		};
+
+		static Model model;
+		model = {};
+
+		auto onModelTimer = [](HWND /*hwnd*/, WPARAM wParam, LPARAM lParam, void* /*context*/) -> LRESULT {
+			auto it = model.timers.find(static_cast<TimerId>(wParam));
+			if (it == model.timers.end())
+			{
+				model.errors++; // Cancelled or already done.
+				return S_OK;
+			}
+
+			// A timer due before the advance is called on its first tick.
+			const Expected expected = it->second;
+			const UINT64 due = (std::max)(expected.due, model.from + 1);
+			if (due > model.to || due < model.lastDue) model.errors++;
+			if (expected.period != 0 && static_cast<UINT64>(lParam) != 1 + (model.to - expected.due) / expected.period) model.errors++;
+			model.lastDue = due;
+			model.calls++;
+
+			if (expected.period != 0) it->second.due = expected.due + expected.period * static_cast<UINT64>(lParam);
+			else model.timers.erase(it);
+			return S_OK;
+		};
+
+		TimerWheel wheel(origin);
+		std::mt19937_64 random(39);
+		std::vector<TimerId> ids;
+		UINT64 now = 0;
+
+		for (UINT32 step = 0; step < 3000; step++)
+		{
+			const UINT32 count = static_cast<UINT32>(random() % 40);
+			for (UINT32 i = 0; i < count; i++)
+			{
+				const UINT64 range = (random() % 4 == 0) ? (1ull << 28) : (random() % 2 ? 300 : 20000);
+				const UINT64 delay = random() % range;
+				const UINT64 period = (random() % 5 == 0) ? 1 + random() % 5000 : 0;
+				const TimerId id = wheel.schedule(delay, period, onModelTimer);
+				model.timers[id] = { now + delay, period };
+				ids.push_back(id);
+			}
+			for (UINT32 i = 0; i < count / 2 && !ids.empty(); i++)
+			{
+				const size_t index = random() % ids.size();
+				const TimerId id = ids[index];
+				ids[index] = ids.back();
+				ids.pop_back();
+				CHECK(wheel.cancel(id) == (model.timers.count(id) != 0));
+				model.timers.erase(id);
+			}
+
+			// The deadline is never after the next timer.
+			UINT64 next = UINT64_MAX;
+			for (const auto& [id, expected] : model.timers) next = (std::min)(next, expected.due);
+			const TimePoint deadline = wheel.getNextDeadline();
+			CHECK((deadline == TimePoint::max()) == model.timers.empty());
+			if (!model.timers.empty()) CHECK(deadline <= at((std::max)(next, now + 1)));
+
+			// Mostly frames, sometimes long sleeps.
+			const UINT64 elapsed = (random() % 10 == 0) ? random() % 100000 : random() % 40;
+			model.from = now;
+			model.to = now + elapsed;
+			model.lastDue = 0;
+			now += elapsed;
+			wheel.advance(at(now));
+
+			if (elapsed != 0)
+				for (const auto& [id, expected] : model.timers) CHECK(expected.due > now);
+			CHECK(wheel.getCount() == model.timers.size());
+		}
+
+		CHECK(model.errors == 0);
+		CHECK(model.calls > 10000);
+	}
+
+
+	void addTimerWheelTests(_Inout_ Suite& suite)
+	{
+		suite.add("timer_wheel/one_shot", testOneShot);
+		suite.add("timer_wheel/zero_delay", testZeroDelay);
+		suite.add("timer_wheel/same_tick_order", testSameTickOrder);
+		suite.add("timer_wheel/late_repeating_timer", testLateRepeatingTimer);
+		suite.add("timer_wheel/cancel_from_callback", testCancelFromCallback);
+		suite.add("timer_wheel/far_timers", testFarTimers);
+		suite.add("timer_wheel/next_deadline", testNextDeadline);
+		suite.add("timer_wheel/rebase", testRebase);
+		suite.add("timer_wheel/against_model", testAgainstModel);
+	}
+
+} // namespace Tests
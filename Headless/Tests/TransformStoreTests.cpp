@@ -0,0 +1,109 @@
+#include "Tests.h"
+
+#include <cmath>
+#include <random>
+
+#include "ThreadPool.h"
+#include "TransformStore.h"
+
+
+namespace Tests
+{
+	inline bool isNear(_In_ float a, _In_ float b) noexcept
+	{
+		return std::fabs(a - b) < 1e-3f;
+	}
+
+	/**
+	 * @brief A freed slot is reused, with the neutral values of a new one.
+	 */
+	void testReusesSlots()
+	{
+		Graphics::TransformStore store;
+		const Graphics::TransformIndex first = store.create({ 1.0f, 2.0f });
+		const Graphics::TransformIndex second = store.create({ 3.0f, 4.0f });
+		store.setScale(second, { 2.0f, 3.0f });
+		store.setVelocity(second, { 5.0f, 6.0f });
+		store.setRotation(second, 1.0f);
+		CHECK(store.getCount() == 2);
+
+		store.destroy(second);
+		CHECK(store.getCount() == 1);
+		const Graphics::TransformIndex third = store.create({ 7.0f, 8.0f });
+		CHECK(third == second);
+		CHECK(store.getCapacity() == 2);
+		CHECK(store.getPos(third).x == 7.0f && store.getPos(third).y == 8.0f);
+		CHECK(store.getScale(third).width == 1.0f && store.getScale(third).height == 1.0f);
+		CHECK(store.getVelocity(third).x == 0.0f && store.getRotation(third) == 0.0f);
+		CHECK(store.getPos(first).x == 1.0f);
+	}
+
+	/**
+	 * @brief The bounds cover the rotated, scaled rectangle, whose (0, 0) corner is the position.
+	 */
+	void testComputesBounds()
+	{
+		Graphics::TransformStore store;
+		const Graphics::TransformIndex index = store.create({ 100.0f, 50.0f });
+		store.setSize(index, { 20.0f, 10.0f });
+		store.setScale(index, { 2.0f, 1.0f });
+		store.setRotation(index, 1.5707964f); // A quarter turn clockwise: x goes down, y goes left.
+		store.computeBounds();
+
+		const D2D1_RECT_F bounds = store.getBounds(index);
+		CHECK(isNear(bounds.left, 90.0f) && isNear(bounds.right, 100.0f));
+		CHECK(isNear(bounds.top, 50.0f) && isNear(bounds.bottom, 90.0f));
+	}
+
+	/**
+	 * @brief Split over a pool, the batch operations give the same transforms as on the calling thread.
+	 */
+	void testParallelMatchesSerial()
+	{
+		Graphics::TransformStore serial, parallel;
+		std::mt19937 random(32);
+		std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+		for (UINT32 i = 0; i < 100000; i++)
+		{
+			const D2D1_POINT_2F pos = { value(random), value(random) };
+			const D2D1_POINT_2F velocity = { value(random), value(random) };
+			const float rotation = value(random);
+			for (Graphics::TransformStore* store : { &serial, &parallel })
+			{
+				const Graphics::TransformIndex index = store->create(pos);
+				store->setVelocity(index, velocity);
+				store->setRotation(index, rotation);
+				store->setSize(index, { 4.0f, 6.0f });
+			}
+		}
+
+		ThreadPool pool(4);
+		for (int frame = 0; frame < 10; frame++)
+		{
+			serial.applyVelocity(1.0f / 60.0f);
+			parallel.applyVelocity(1.0f / 60.0f, &pool);
+		}
+		serial.translateAll(3.0f, -2.0f);
+		parallel.translateAll(3.0f, -2.0f, &pool);
+		serial.computeBounds();
+		parallel.computeBounds(&pool);
+
+		UINT32 mismatches = 0;
+		for (Graphics::TransformIndex i = 0; i < serial.getCapacity(); i++)
+		{
+			const D2D1_RECT_F a = serial.getBounds(i), b = parallel.getBounds(i);
+			if (a.left != b.left || a.top != b.top || a.right != b.right || a.bottom != b.bottom) mismatches++;
+		}
+		CHECK(mismatches == 0);
+		CHECK(isNear(serial.getPos(0).x, parallel.getPos(0).x));
+	}
+
+
+	void addTransformStoreTests(_Inout_ Suite& suite)
+	{
+		suite.add("transform_store/reuses_slots", testReusesSlots);
+		suite.add("transform_store/computes_bounds", testComputesBounds);
+		suite.add("transform_store/parallel_matches_serial", testParallelMatchesSerial);
+	}
+
+} // namespace Tests
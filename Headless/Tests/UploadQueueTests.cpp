@@ -0,0 +1,99 @@
+#include "Tests.h"
+
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "OcclusionCuller.h"
+#include "RenderCommands.h"
+#include "UploadQueue.h"
+
+
+namespace Tests
+{
+	/**
+	 * @brief A resource table and its upload queue, with a budget large enough for every bitmap.
+	 */
+	struct Uploads
+	{
+		Render::ResourceTable resources;
+		Render::UploadQueue queue;
+		Render::CommandBuffer commands;
+		ID2D1RenderTarget target;
+		std::vector<Graphics::Pixel> pixels;
+
+		Uploads()
+		{
+			queue.setBudget(SIZE_MAX, 1e9);
+			pixels.emplace_back(0xFF, 0xFF, 0xFF, 0xFF);
+		}
+
+		inline Render::ResourceId add() { return resources.registerBitmap(pixels.data(), 1, 1); }
+		inline bool isResident(_In_ Render::ResourceId id) const noexcept { return resources.getResidentBitmap(id) != nullptr; }
+	};
+
+
+	/**
+	 * @brief Only the last 256 bitmaps registered are prefetched, once: the older ones wait to be drawn.
+	 */
+	void testPrefetchRecent()
+	{
+		Uploads uploads;
+		std::vector<Render::ResourceId> ids;
+		for (int i = 0; i < 1000; i++)
+			ids.push_back(uploads.add());
+		CHECK(uploads.resources.getRecentBitmaps().size() == 256);
+
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target);
+		CHECK(uploads.queue.getStats().lastFrameUploads == 256);
+		CHECK(!uploads.isResident(ids[743]) && uploads.isResident(ids[744]) && uploads.isResident(ids[999]));
+
+		// Uploaded, they leave the list. An update puts a bitmap back.
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target);
+		CHECK(uploads.queue.getStats().lastFrameUploads == 0);
+		CHECK(uploads.resources.getRecentBitmaps().empty());
+		uploads.resources.updateBitmap(ids[0], uploads.pixels.data(), 1, 1);
+		uploads.resources.updateBitmap(ids[1], nullptr, 0, 0); // Evicted: nothing to upload.
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target);
+		CHECK(uploads.queue.getStats().lastFrameUploads == 1 && uploads.isResident(ids[0]));
+
+		// The bitmaps drawn are uploaded, recent or not.
+		uploads.commands.getLayer(0).drawBitmap(ids[10], D2D1::RectF(0.0f, 0.0f, 1.0f, 1.0f));
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target);
+		CHECK(uploads.isResident(ids[10]));
+	}
+
+	/**
+	 * @brief A bitmap culled from the frame is not prefetched in this frame, the others still are.
+	 */
+	void testSkipCulled()
+	{
+		Uploads uploads;
+		const Render::ResourceId hidden = uploads.add(), offScreen = uploads.add(), other = uploads.add();
+		Render::CommandList& list = uploads.commands.getLayer(0);
+		list.drawBitmap(hidden, D2D1::RectF(16.0f, 16.0f, 32.0f, 32.0f));
+		list.drawBitmap(offScreen, D2D1::RectF(-64.0f, 0.0f, -32.0f, 32.0f));
+		uploads.commands.getLayer(1).fillRect(D2D1::RectF(0.0f, 0.0f, 64.0f, 64.0f), 0xFF000000u);
+		uploads.commands.getLayer(1).occlude(D2D1::RectF(0.0f, 0.0f, 64.0f, 64.0f));
+
+		Render::OcclusionCuller culler;
+		culler.setEnabled(true);
+		culler.cull(uploads.commands, 640, 480);
+		CHECK(culler.getCulledBitmaps().size() == 2);
+
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target, &culler.getCulledBitmaps());
+		CHECK(!uploads.isResident(hidden) && !uploads.isResident(offScreen) && uploads.isResident(other));
+
+		// Next frame, with nothing culled, they are prefetched.
+		uploads.commands.reset();
+		uploads.queue.process(uploads.commands, uploads.resources, &uploads.target);
+		CHECK(uploads.isResident(hidden) && uploads.isResident(offScreen));
+	}
+
+
+	void addUploadQueueTests(_Inout_ Suite& suite)
+	{
+		suite.add("upload_queue/prefetch_recent", testPrefetchRecent);
+		suite.add("upload_queue/skip_culled", testSkipCulled);
+	}
+
+} // namespace Tests
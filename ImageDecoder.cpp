@@ -0,0 +1,1262 @@
+#include "ImageDecoder.h"
+
+#include <emmintrin.h> // SSE2
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+
+#include "GraphicComponents.h"
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Codec
+{
+	static_assert(sizeof(Graphics::Pixel) == 4, "The pixels are written as B8G8R8A8 bytes.");
+
+	// The most pixels of an image the decoders accept: 1 << 28, a 16384 x 16384 image, 1 GB decoded.
+	// Larger images are rejected from their header, before anything is allocated: LargeImage needs a TileSource for them.
+	constexpr UINT64 MAX_PIXELS = 1ull << 28;
+
+
+	/************************/
+	/*		 Inflate		*/
+	/************************/
+
+
+	constexpr UINT32 FAST_BITS = 10;
+	constexpr UINT32 MAX_CODE_BITS = 15;
+
+	constexpr UINT16 LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr BYTE LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr UINT16 DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr BYTE DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	constexpr BYTE CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	/**
+	 * @brief Reads a deflate stream, least significant bit first, 64 bits at a time.
+	 *
+	 * @note Past the end, zero bytes are read: the stream is corrupted if they are consumed.
+	 */
+	class BitReader
+	{
+	private:
+		const BYTE* m_data;
+		const BYTE* m_end;
+		UINT64 m_bits = 0;
+		UINT32 m_count = 0;		// Valid bits in m_bits, the bits above are the next bytes or zero.
+		size_t m_overrun = 0;	// Zero bytes added past the end.
+
+	public:
+		BitReader(_In_ const BYTE* data, _In_ const BYTE* end) noexcept
+			:m_data(data), m_end(end)
+		{}
+
+		/**
+		 * @brief Make at least 56 bits available.
+		 */
+		inline void refill() noexcept
+		{
+			if (m_end - m_data >= 8)
+			{
+				UINT64 word;
+				std::memcpy(&word, m_data, 8);
+				m_bits |= word << m_count;
+				m_data += (63 - m_count) >> 3;
+				m_count |= 56;
+				return;
+			}
+			while (m_count <= 56)
+			{
+				if (m_data < m_end) m_bits |= static_cast<UINT64>(*m_data++) << m_count;
+				else m_overrun++;
+				m_count += 8;
+			}
+		}
+
+		inline UINT32 peek(_In_ UINT32 count) const noexcept { return static_cast<UINT32>(m_bits & ((1ull << count) - 1)); }
+		inline UINT64 getBits() const noexcept { return m_bits; }
+		inline void consume(_In_ UINT32 count) noexcept { m_bits >>= count; m_count -= count; }
+
+		inline UINT32 read(_In_ UINT32 count) noexcept
+		{
+			const UINT32 value = peek(count);
+			consume(count);
+			return value;
+		}
+
+		inline bool isOverrun() const noexcept { return m_overrun * 8 > m_count; }
+
+		/**
+		 * @brief Skip to the next byte boundary.
+		 *
+		 * @retval BYTE*
+		 * @return The position of the next byte in the data, or nullptr if the end was passed.
+		 */
+		inline const BYTE* alignToByte() noexcept
+		{
+			consume(m_count & 7);
+			if (isOverrun()) return nullptr;
+			const BYTE* position = m_data - ((m_count >> 3) - m_overrun);
+			seek(position);
+			return position;
+		}
+
+		inline void seek(_In_ const BYTE* position) noexcept
+		{
+			m_data = position;
+			m_bits = 0;
+			m_count = 0;
+			m_overrun = 0;
+		}
+	};
+
+	/**
+	 * @brief A canonical Huffman code: a table for the short codes, a search by length for the others.
+	 */
+	struct Huffman
+	{
+		UINT16 fast[1 << FAST_BITS];	// (length << 9) | symbol, indexed by the next FAST_BITS bits. Zero for the longer codes.
+		UINT16 counts[MAX_CODE_BITS + 1];
+		UINT16 symbols[288];			// Sorted by code.
+	};
+
+	bool buildHuffman(_Out_ Huffman& huffman, _In_reads_(count) const BYTE* lengths, _In_ UINT32 count) noexcept
+	{
+		std::memset(huffman.counts, 0, sizeof(huffman.counts));
+		for (UINT32 i = 0; i < count; i++) huffman.counts[lengths[i]]++;
+		huffman.counts[0] = 0;
+
+		// Over-subscribed codes are invalid. Incomplete ones are allowed, their unused codes fail when read.
+		int left = 1;
+		for (UINT32 length = 1; length <= MAX_CODE_BITS; length++)
+		{
+			left = (left << 1) - huffman.counts[length];
+			if (left < 0) return false;
+		}
+
+		UINT16 offsets[MAX_CODE_BITS + 1];
+		UINT32 codes[MAX_CODE_BITS + 1];
+		offsets[1] = 0;
+		codes[1] = 0;
+		for (UINT32 length = 1; length < MAX_CODE_BITS; length++)
+		{
+			offsets[length + 1] = offsets[length] + huffman.counts[length];
+			codes[length + 1] = (codes[length] + huffman.counts[length]) << 1;
+		}
+
+		std::memset(huffman.fast, 0, sizeof(huffman.fast));
+		for (UINT32 symbol = 0; symbol < count; symbol++)
+		{
+			const UINT32 length = lengths[symbol];
+			if (length == 0) continue;
+			huffman.symbols[offsets[length]++] = static_cast<UINT16>(symbol);
+
+			const UINT32 code = codes[length]++;
+			if (length > FAST_BITS) continue;
+
+			// The stream holds the codes most significant bit first.
+			UINT32 reversed = 0;
+			for (UINT32 bit = 0; bit < length; bit++) reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+			for (UINT32 i = reversed; i < (1u << FAST_BITS); i += 1u << length)
+				huffman.fast[i] = static_cast<UINT16>((length << 9) | symbol);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Decode a symbol, at least MAX_CODE_BITS bits must be available.
+	 *
+	 * @retval int
+	 * @return The symbol, or -1 for an unused code.
+	 */
+	inline int decodeSymbol(_In_ const Huffman& huffman, _Inout_ BitReader& reader) noexcept
+	{
+		const UINT16 entry = huffman.fast[reader.peek(FAST_BITS)];
+		if (entry != 0)
+		{
+			reader.consume(entry >> 9);
+			return entry & 0x1FF;
+		}
+
+		// The codes longer than FAST_BITS, one bit at a time.
+		UINT64 bits = reader.getBits();
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (UINT32 length = 1; length <= MAX_CODE_BITS; length++)
+		{
+			code |= static_cast<int>(bits & 1);
+			bits >>= 1;
+			const int count = huffman.counts[length];
+			if (code - count < first)
+			{
+				reader.consume(length);
+				return huffman.symbols[index + (code - first)];
+			}
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	struct FixedHuffman
+	{
+		Huffman literals;
+		Huffman distances;
+
+		FixedHuffman() noexcept
+		{
+			BYTE lengths[288];
+			std::fill(lengths, lengths + 144, static_cast<BYTE>(8));
+			std::fill(lengths + 144, lengths + 256, static_cast<BYTE>(9));
+			std::fill(lengths + 256, lengths + 280, static_cast<BYTE>(7));
+			std::fill(lengths + 280, lengths + 288, static_cast<BYTE>(8));
+			buildHuffman(literals, lengths, 288);
+
+			std::fill(lengths, lengths + 30, static_cast<BYTE>(5));
+			buildHuffman(distances, lengths, 30);
+		}
+	};
+
+	const FixedHuffman& getFixedHuffman() noexcept
+	{
+		static const FixedHuffman fixed;
+		return fixed;
+	}
+
+	bool readDynamicHuffman(_Inout_ BitReader& reader, _Out_ Huffman& literals, _Out_ Huffman& distances) noexcept
+	{
+		reader.refill();
+		const UINT32 literalCount = reader.read(5) + 257;
+		const UINT32 distanceCount = reader.read(5) + 1;
+		const UINT32 codeLengthCount = reader.read(4) + 4;
+		if (literalCount > 286 || distanceCount > 30) return false;
+
+		BYTE codeLengths[19] = {};
+		for (UINT32 i = 0; i < codeLengthCount; i++)
+		{
+			if (i % 16 == 0) reader.refill();
+			codeLengths[CODE_LENGTH_ORDER[i]] = static_cast<BYTE>(reader.read(3));
+		}
+
+		Huffman codeLengthHuffman;
+		if (!buildHuffman(codeLengthHuffman, codeLengths, 19)) return false;
+
+		BYTE lengths[286 + 30];
+		const UINT32 total = literalCount + distanceCount;
+		UINT32 i = 0;
+		while (i < total)
+		{
+			reader.refill();
+			const int symbol = decodeSymbol(codeLengthHuffman, reader);
+			if (symbol < 0) return false;
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<BYTE>(symbol);
+				continue;
+			}
+
+			BYTE value = 0;
+			UINT32 repeat;
+			if (symbol == 16)
+			{
+				if (i == 0) return false;
+				value = lengths[i - 1];
+				repeat = 3 + reader.read(2);
+			}
+			else if (symbol == 17)
+			{
+				repeat = 3 + reader.read(3);
+			}
+			else
+			{
+				repeat = 11 + reader.read(7);
+			}
+			if (i + repeat > total) return false;
+			std::memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+
+		if (lengths[256] == 0 || reader.isOverrun()) return false;
+		return buildHuffman(literals, lengths, literalCount) && buildHuffman(distances, lengths + literalCount, distanceCount);
+	}
+
+	/**
+	 * @brief Copy a match, which may overlap its source.
+	 */
+	inline void copyMatch(_Inout_ BYTE* out, _In_ size_t distance, _In_ size_t length, _In_ const BYTE* end) noexcept
+	{
+		const BYTE* from = out - distance;
+		if (distance >= 8 && static_cast<size_t>(end - out) >= length + 8)
+		{
+			// 8 bytes at a time, the source is always written already. The bytes past the match are written again later.
+			for (size_t i = 0; i < length; i += 8)
+			{
+				UINT64 word;
+				std::memcpy(&word, from + i, 8);
+				std::memcpy(out + i, &word, 8);
+			}
+		}
+		else if (distance == 1)
+		{
+			std::memset(out, *from, length);
+		}
+		else
+		{
+			for (size_t i = 0; i < length; i++) out[i] = from[i];
+		}
+	}
+
+	bool inflateBlock(_Inout_ BitReader& reader, _In_ const Huffman& literals, _In_ const Huffman& distances,
+		_In_ const BYTE* begin, _Inout_ BYTE*& out, _In_ const BYTE* end) noexcept
+	{
+		for (;;)
+		{
+			// Enough for a literal or length code, its extra bits, a distance code and its extra bits.
+			reader.refill();
+			int symbol = decodeSymbol(literals, reader);
+			if (symbol < 256)
+			{
+				if (symbol < 0 || out == end) return false;
+				*out++ = static_cast<BYTE>(symbol);
+				continue;
+			}
+			if (symbol == 256) return !reader.isOverrun();
+
+			symbol -= 257;
+			if (symbol >= 29) return false;
+			const size_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+
+			const int distanceSymbol = decodeSymbol(distances, reader);
+			if (distanceSymbol < 0 || distanceSymbol >= 30) return false;
+			const size_t distance = DISTANCE_BASE[distanceSymbol] + reader.read(DISTANCE_EXTRA[distanceSymbol]);
+
+			if (distance > static_cast<size_t>(out - begin) || length > static_cast<size_t>(end - out)) return false;
+			copyMatch(out, distance, length, end);
+			out += length;
+		}
+	}
+
+	size_t inflateZlib(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_writes_bytes_(capacity) BYTE* output, _In_ size_t capacity)
+	{
+		PROFILE_ZONE("inflateZlib");
+		if (size < 2) return SIZE_MAX;
+
+		// Deflate, a window of at most 32 KiB, no preset dictionary.
+		const UINT32 cmf = data[0];
+		const UINT32 flg = data[1];
+		if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0) return SIZE_MAX;
+
+		const BYTE* const dataEnd = data + size;
+		BitReader reader(data + 2, dataEnd);
+		BYTE* out = output;
+		const BYTE* const outEnd = output + capacity;
+		Huffman literals;
+		Huffman distances;
+
+		bool isFinal = false;
+		while (!isFinal)
+		{
+			reader.refill();
+			isFinal = reader.read(1) != 0;
+			const UINT32 type = reader.read(2);
+
+			if (type == 0)
+			{
+				// Stored: LEN, NLEN, then LEN bytes as they are.
+				const BYTE* position = reader.alignToByte();
+				if (position == nullptr || dataEnd - position < 4) return SIZE_MAX;
+				const size_t length = position[0] | (position[1] << 8);
+				const size_t complement = position[2] | (position[3] << 8);
+				if (length != (~complement & 0xFFFF)) return SIZE_MAX;
+				position += 4;
+				if (static_cast<size_t>(dataEnd - position) < length || static_cast<size_t>(outEnd - out) < length) return SIZE_MAX;
+				std::memcpy(out, position, length);
+				out += length;
+				reader.seek(position + length);
+			}
+			else if (type == 1)
+			{
+				const FixedHuffman& fixed = getFixedHuffman();
+				if (!inflateBlock(reader, fixed.literals, fixed.distances, output, out, outEnd)) return SIZE_MAX;
+			}
+			else if (type == 2)
+			{
+				if (!readDynamicHuffman(reader, literals, distances)) return SIZE_MAX;
+				if (!inflateBlock(reader, literals, distances, output, out, outEnd)) return SIZE_MAX;
+			}
+			else
+			{
+				return SIZE_MAX;
+			}
+		}
+		return static_cast<size_t>(out - output);
+	}
+
+
+
+	/************************/
+	/*		  Pixels		*/
+	/************************/
+
+
+	/**
+	 * @brief Round c * a / 255.
+	 */
+	inline BYTE premultiply(_In_ UINT32 color, _In_ UINT32 alpha) noexcept
+	{
+		const UINT32 t = color * alpha + 128;
+		return static_cast<BYTE>((t + (t >> 8)) >> 8);
+	}
+
+	/**
+	 * @brief Write R8G8B8A8 pixels as premultiplied B8G8R8A8 pixels.
+	 *
+	 * @param[in] step The distance between two written pixels, in pixels.
+	 */
+	void storeRow(_In_reads_bytes_(count * 4) const BYTE* rgba, _In_ UINT32 count, _Out_ Graphics::Pixel* pixels, _In_ UINT32 step) noexcept
+	{
+		BYTE* out = reinterpret_cast<BYTE*>(pixels);
+		UINT32 x = 0;
+		if (step == 1)
+		{
+			// 4 pixels at a time: 16 bit products, divided by 255 with rounding. The alpha is multiplied by 255.
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i colorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+			const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+			const __m128i half = _mm_set1_epi16(128);
+			for (; x + 4 <= count; x += 4)
+			{
+				const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x * 4));
+				__m128i halves[2] = { _mm_unpacklo_epi8(source, zero), _mm_unpackhi_epi8(source, zero) };
+				for (__m128i& value : halves)
+				{
+					__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+					alpha = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaOne);
+					const __m128i t = _mm_add_epi16(_mm_mullo_epi16(value, alpha), half);
+					value = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+					value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(halves[0], halves[1]));
+			}
+		}
+
+		for (; x < count; x++)
+		{
+			const BYTE* source = rgba + x * 4;
+			BYTE* destination = out + static_cast<size_t>(x) * step * 4;
+			const UINT32 alpha = source[3];
+			destination[0] = premultiply(source[2], alpha);
+			destination[1] = premultiply(source[1], alpha);
+			destination[2] = premultiply(source[0], alpha);
+			destination[3] = static_cast<BYTE>(alpha);
+		}
+	}
+
+
+
+	/************************/
+	/*			PNG			*/
+	/************************/
+
+
+	constexpr BYTE PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+	constexpr BYTE COLOR_GRAY = 0;
+	constexpr BYTE COLOR_RGB = 2;
+	constexpr BYTE COLOR_PALETTE = 3;
+	constexpr BYTE COLOR_GRAY_ALPHA = 4;
+	constexpr BYTE COLOR_RGBA = 6;
+
+	// Adam7 passes: first pixel and step of each.
+	constexpr UINT32 ADAM7_X[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	constexpr UINT32 ADAM7_Y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	constexpr UINT32 ADAM7_DX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	constexpr UINT32 ADAM7_DY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	struct PngInfo
+	{
+		UINT32 width = 0;
+		UINT32 height = 0;
+		UINT32 depth = 0;
+		UINT32 channels = 0;
+		BYTE colorType = 0;
+		bool isInterlaced = false;
+
+		BYTE palette[256][4];			// R8G8B8A8.
+		bool hasTransparentColor = false;
+		UINT16 transparentColor[3];		// Gray, or RGB, at the image's bit depth.
+
+		PngInfo() noexcept
+		{
+			for (auto& entry : palette)
+			{
+				entry[0] = entry[1] = entry[2] = 0x00;
+				entry[3] = 0xFF;
+			}
+		}
+
+		inline UINT32 getBitsPerPixel() const noexcept { return channels * depth; }
+		inline size_t getRowBytes(_In_ UINT32 width) const noexcept { return (static_cast<size_t>(width) * getBitsPerPixel() + 7) / 8; }
+	};
+
+	inline UINT32 readBigEndian(_In_reads_bytes_(4) const BYTE* bytes) noexcept
+	{
+		return (static_cast<UINT32>(bytes[0]) << 24) | (static_cast<UINT32>(bytes[1]) << 16) | (static_cast<UINT32>(bytes[2]) << 8) | bytes[3];
+	}
+
+	inline UINT32 readBigEndian16(_In_reads_bytes_(2) const BYTE* bytes) noexcept
+	{
+		return (static_cast<UINT32>(bytes[0]) << 8) | bytes[1];
+	}
+
+	bool readPngHeader(_In_reads_bytes_(13) const BYTE* content, _Out_ PngInfo& info) noexcept
+	{
+		info.width = readBigEndian(content);
+		info.height = readBigEndian(content + 4);
+		info.depth = content[8];
+		info.colorType = content[9];
+		info.isInterlaced = content[12] == 1;
+		if (!isSizeSupported(info.width, info.height)) return false;
+		if (content[10] != 0 || content[11] != 0 || content[12] > 1) return false;
+
+		const UINT32 depth = info.depth;
+		switch (info.colorType)
+		{
+		case COLOR_GRAY:
+			info.channels = 1;
+			return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+		case COLOR_PALETTE:
+			info.channels = 1;
+			return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+		case COLOR_RGB:
+			info.channels = 3;
+			return depth == 8 || depth == 16;
+		case COLOR_GRAY_ALPHA:
+			info.channels = 2;
+			return depth == 8 || depth == 16;
+		case COLOR_RGBA:
+			info.channels = 4;
+			return depth == 8 || depth == 16;
+		default:
+			return false;
+		}
+	}
+
+	/**** Unfiltering ****/
+
+	template <size_t BPP>
+	inline __m128i loadPixel(_In_reads_bytes_(BPP) const BYTE* bytes) noexcept
+	{
+		UINT32 value = 0;
+		std::memcpy(&value, bytes, BPP);
+		return _mm_cvtsi32_si128(static_cast<int>(value));
+	}
+
+	template <size_t BPP>
+	inline void storePixel(_Out_writes_bytes_(BPP) BYTE* bytes, _In_ __m128i pixel) noexcept
+	{
+		const UINT32 value = static_cast<UINT32>(_mm_cvtsi128_si32(pixel));
+		std::memcpy(bytes, &value, BPP);
+	}
+
+	inline __m128i select(_In_ __m128i mask, _In_ __m128i a, _In_ __m128i b) noexcept
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	inline __m128i absolute(_In_ __m128i value) noexcept
+	{
+		return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+	}
+
+	inline BYTE paeth(_In_ int a, _In_ int b, _In_ int c) noexcept
+	{
+		const int pa = std::abs(b - c);
+		const int pb = std::abs(a - c);
+		const int pc = std::abs(a + b - 2 * c);
+		if (pa <= pb && pa <= pc) return static_cast<BYTE>(a);
+		return static_cast<BYTE>(pb <= pc ? b : c);
+	}
+
+	void unfilterUp(_Inout_updates_bytes_(length) BYTE* row, _In_reads_bytes_(length) const BYTE* previous, _In_ size_t length) noexcept
+	{
+		size_t i = 0;
+		for (; i + 16 <= length; i += 16)
+		{
+			const __m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(value, above));
+		}
+		for (; i < length; i++) row[i] += previous[i];
+	}
+
+	/**
+	 * @brief Sub, Average and Paeth for 3 and 4 bytes per pixel: the bytes of a pixel are computed together,
+	 *        the pixels one after the other as each depends on its left neighbour.
+	 */
+	template <size_t BPP>
+	void unfilterPixels(_In_ BYTE filter, _Inout_updates_bytes_(length) BYTE* row, _In_reads_bytes_(length) const BYTE* previous, _In_ size_t length) noexcept
+	{
+		const __m128i zero = _mm_setzero_si128();
+		if (filter == 1)
+		{
+			__m128i left = zero;
+			for (size_t i = 0; i + BPP <= length; i += BPP)
+			{
+				left = _mm_add_epi8(left, loadPixel<BPP>(row + i));
+				storePixel<BPP>(row + i, left);
+			}
+		}
+		else if (filter == 3)
+		{
+			// floor((a + b) / 2) from the rounded up average.
+			const __m128i one = _mm_set1_epi8(1);
+			__m128i left = zero;
+			for (size_t i = 0; i + BPP <= length; i += BPP)
+			{
+				const __m128i above = loadPixel<BPP>(previous + i);
+				const __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, above), _mm_and_si128(_mm_xor_si128(left, above), one));
+				left = _mm_add_epi8(loadPixel<BPP>(row + i), average);
+				storePixel<BPP>(row + i, left);
+			}
+		}
+		else
+		{
+			// In 16 bits: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|.
+			__m128i left = zero;
+			__m128i upperLeft = zero;
+			for (size_t i = 0; i + BPP <= length; i += BPP)
+			{
+				const __m128i above = _mm_unpacklo_epi8(loadPixel<BPP>(previous + i), zero);
+				__m128i pa = _mm_sub_epi16(above, upperLeft);
+				__m128i pb = _mm_sub_epi16(left, upperLeft);
+				__m128i pc = _mm_add_epi16(pa, pb);
+				pa = absolute(pa);
+				pb = absolute(pb);
+				pc = absolute(pc);
+				const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+				const __m128i predictor = select(_mm_cmpeq_epi16(pa, smallest), left, select(_mm_cmpeq_epi16(pb, smallest), above, upperLeft));
+
+				const __m128i value = _mm_add_epi8(loadPixel<BPP>(row + i), _mm_packus_epi16(predictor, predictor));
+				storePixel<BPP>(row + i, value);
+				left = _mm_unpacklo_epi8(value, zero);
+				upperLeft = above;
+			}
+		}
+	}
+
+	void unfilterScalar(_In_ BYTE filter, _Inout_updates_bytes_(length) BYTE* row, _In_reads_bytes_(length) const BYTE* previous, _In_ size_t length, _In_ size_t bpp) noexcept
+	{
+		const size_t first = (std::min)(bpp, length);
+		if (filter == 1)
+		{
+			for (size_t i = bpp; i < length; i++) row[i] += row[i - bpp];
+		}
+		else if (filter == 3)
+		{
+			for (size_t i = 0; i < first; i++) row[i] += previous[i] >> 1;
+			for (size_t i = bpp; i < length; i++) row[i] += static_cast<BYTE>((row[i - bpp] + previous[i]) >> 1);
+		}
+		else
+		{
+			for (size_t i = 0; i < first; i++) row[i] += previous[i];
+			for (size_t i = bpp; i < length; i++) row[i] += paeth(row[i - bpp], previous[i], previous[i - bpp]);
+		}
+	}
+
+	/**
+	 * @retval bool
+	 * @return False for an unknown filter.
+	 */
+	bool unfilterRow(_In_ BYTE filter, _Inout_updates_bytes_(length) BYTE* row, _In_reads_bytes_(length) const BYTE* previous, _In_ size_t length, _In_ size_t bpp) noexcept
+	{
+		switch (filter)
+		{
+		case 0:
+			return true;
+		case 2:
+			unfilterUp(row, previous, length);
+			return true;
+		case 1:
+		case 3:
+		case 4:
+			if (bpp == 4) unfilterPixels<4>(filter, row, previous, length);
+			else if (bpp == 3) unfilterPixels<3>(filter, row, previous, length);
+			else unfilterScalar(filter, row, previous, length, bpp);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/**** Conversion ****/
+
+	/**
+	 * @brief Read the sample of a pixel of less than 8 bits, packed most significant first.
+	 */
+	inline UINT32 readPackedSample(_In_ const BYTE* row, _In_ UINT32 x, _In_ UINT32 depth) noexcept
+	{
+		const UINT32 bit = x * depth;
+		return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+	}
+
+	/**
+	 * @brief Expand a row of any format to R8G8B8A8, 16 bit samples keep their high byte.
+	 */
+	void expandRow(_In_ const PngInfo& info, _In_ const BYTE* row, _In_ UINT32 count, _Out_writes_bytes_(count * 4) BYTE* rgba) noexcept
+	{
+		const bool isWide = info.depth == 16;
+		const UINT32 sampleBytes = isWide ? 2 : 1;
+
+		for (UINT32 x = 0; x < count; x++)
+		{
+			BYTE* out = rgba + static_cast<size_t>(x) * 4;
+			switch (info.colorType)
+			{
+			case COLOR_GRAY:
+			{
+				UINT32 sample;
+				BYTE gray;
+				if (info.depth < 8)
+				{
+					sample = readPackedSample(row, x, info.depth);
+					gray = static_cast<BYTE>(sample * (255 / ((1u << info.depth) - 1)));
+				}
+				else
+				{
+					sample = isWide ? readBigEndian16(row + x * 2) : row[x];
+					gray = row[x * sampleBytes];
+				}
+				out[0] = out[1] = out[2] = gray;
+				out[3] = info.hasTransparentColor && sample == info.transparentColor[0] ? 0x00 : 0xFF;
+				break;
+			}
+			case COLOR_RGB:
+			{
+				const BYTE* pixel = row + static_cast<size_t>(x) * 3 * sampleBytes;
+				bool isTransparent = info.hasTransparentColor;
+				for (UINT32 c = 0; c < 3; c++)
+				{
+					const UINT32 sample = isWide ? readBigEndian16(pixel + c * 2) : pixel[c];
+					isTransparent = isTransparent && sample == info.transparentColor[c];
+					out[c] = pixel[c * sampleBytes];
+				}
+				out[3] = isTransparent ? 0x00 : 0xFF;
+				break;
+			}
+			case COLOR_PALETTE:
+			{
+				const UINT32 index = info.depth < 8 ? readPackedSample(row, x, info.depth) : row[x];
+				std::memcpy(out, info.palette[index], 4);
+				break;
+			}
+			case COLOR_GRAY_ALPHA:
+			{
+				const BYTE* pixel = row + static_cast<size_t>(x) * 2 * sampleBytes;
+				out[0] = out[1] = out[2] = pixel[0];
+				out[3] = pixel[sampleBytes];
+				break;
+			}
+			default: // RGBA 16.
+			{
+				const BYTE* pixel = row + static_cast<size_t>(x) * 8;
+				out[0] = pixel[0];
+				out[1] = pixel[2];
+				out[2] = pixel[4];
+				out[3] = pixel[6];
+				break;
+			}
+			}
+		}
+	}
+
+	bool decodePng(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image)
+	{
+		PROFILE_ZONE("decodePng");
+		image = {};
+		if (detectFormat(data, size) != ImageFormat::Png) return false;
+
+		PngInfo info;
+		bool hasHeader = false;
+		const BYTE* idat = nullptr;
+		size_t idatSize = 0;
+		std::vector<BYTE> joined; // The IDAT chunks, when there are several.
+
+		const BYTE* chunk = data + sizeof(PNG_SIGNATURE);
+		const BYTE* const end = data + size;
+		while (end - chunk >= 12)
+		{
+			const size_t length = readBigEndian(chunk);
+			const BYTE* type = chunk + 4;
+			const BYTE* content = chunk + 8;
+			if (length > static_cast<size_t>(end - content) - 4) return false;
+			chunk = content + length + 4; // Past the CRC.
+
+			if (std::memcmp(type, "IHDR", 4) == 0)
+			{
+				if (length < 13 || !readPngHeader(content, info)) return false;
+				hasHeader = true;
+			}
+			else if (std::memcmp(type, "PLTE", 4) == 0)
+			{
+				const size_t count = (std::min)(length / 3, static_cast<size_t>(256));
+				for (size_t i = 0; i < count; i++) std::memcpy(info.palette[i], content + i * 3, 3);
+			}
+			else if (std::memcmp(type, "tRNS", 4) == 0)
+			{
+				if (info.colorType == COLOR_PALETTE)
+				{
+					for (size_t i = 0; i < (std::min)(length, static_cast<size_t>(256)); i++) info.palette[i][3] = content[i];
+				}
+				else if (info.colorType == COLOR_GRAY && length >= 2)
+				{
+					info.transparentColor[0] = static_cast<UINT16>(readBigEndian16(content));
+					info.hasTransparentColor = true;
+				}
+				else if (info.colorType == COLOR_RGB && length >= 6)
+				{
+					for (UINT32 c = 0; c < 3; c++) info.transparentColor[c] = static_cast<UINT16>(readBigEndian16(content + c * 2));
+					info.hasTransparentColor = true;
+				}
+			}
+			else if (std::memcmp(type, "IDAT", 4) == 0)
+			{
+				if (idat == nullptr)
+				{
+					idat = content;
+					idatSize = length;
+				}
+				else
+				{
+					if (joined.empty()) joined.assign(idat, idat + idatSize);
+					joined.insert(joined.end(), content, content + length);
+				}
+			}
+			else if (std::memcmp(type, "IEND", 4) == 0)
+			{
+				break;
+			}
+		}
+		if (!hasHeader || idat == nullptr) return false;
+		if (!joined.empty())
+		{
+			idat = joined.data();
+			idatSize = joined.size();
+		}
+
+		// Each pass is a small image, each row starts with its filter byte.
+		const UINT32 passCount = info.isInterlaced ? 7 : 1;
+		UINT32 passWidths[7];
+		UINT32 passHeights[7];
+		size_t rawSize = 0;
+		for (UINT32 pass = 0; pass < passCount; pass++)
+		{
+			const UINT32 x0 = info.isInterlaced ? ADAM7_X[pass] : 0;
+			const UINT32 y0 = info.isInterlaced ? ADAM7_Y[pass] : 0;
+			const UINT32 dx = info.isInterlaced ? ADAM7_DX[pass] : 1;
+			const UINT32 dy = info.isInterlaced ? ADAM7_DY[pass] : 1;
+			passWidths[pass] = info.width > x0 ? (info.width - x0 + dx - 1) / dx : 0;
+			passHeights[pass] = info.height > y0 ? (info.height - y0 + dy - 1) / dy : 0;
+			if (passWidths[pass] > 0) rawSize += passHeights[pass] * (1 + info.getRowBytes(passWidths[pass]));
+		}
+
+		std::vector<BYTE> raw(rawSize);
+		if (inflateZlib(idat, idatSize, raw.data(), raw.size()) != rawSize) return false;
+
+		image.format = ImageFormat::Png;
+		image.width = info.width;
+		image.height = info.height;
+		image.frames.resize(1);
+		std::vector<Graphics::Pixel>& pixels = image.frames.front().pixels;
+		pixels.resize(static_cast<size_t>(info.width) * info.height, Graphics::Pixel(0x00, 0x00));
+
+		PROFILE_ZONE("unfilter");
+		const bool isRgba8 = info.colorType == COLOR_RGBA && info.depth == 8;
+		const size_t bpp = (std::max)(info.getBitsPerPixel() / 8, 1u);
+		const std::vector<BYTE> zeroRow(info.getRowBytes(info.width), 0);
+		std::vector<BYTE> rgba(isRgba8 ? 0 : static_cast<size_t>(info.width) * 4);
+
+		BYTE* cursor = raw.data();
+		for (UINT32 pass = 0; pass < passCount; pass++)
+		{
+			if (passWidths[pass] == 0 || passHeights[pass] == 0) continue;
+			const UINT32 x0 = info.isInterlaced ? ADAM7_X[pass] : 0;
+			const UINT32 y0 = info.isInterlaced ? ADAM7_Y[pass] : 0;
+			const UINT32 dx = info.isInterlaced ? ADAM7_DX[pass] : 1;
+			const UINT32 dy = info.isInterlaced ? ADAM7_DY[pass] : 1;
+			const size_t rowBytes = info.getRowBytes(passWidths[pass]);
+
+			const BYTE* previous = zeroRow.data();
+			for (UINT32 y = 0; y < passHeights[pass]; y++)
+			{
+				BYTE* row = cursor + 1;
+				if (!unfilterRow(cursor[0], row, previous, rowBytes, bpp)) return false;
+
+				const BYTE* rowRgba = row;
+				if (!isRgba8)
+				{
+					expandRow(info, row, passWidths[pass], rgba.data());
+					rowRgba = rgba.data();
+				}
+				storeRow(rowRgba, passWidths[pass], pixels.data() + static_cast<size_t>(y0 + y * dy) * info.width + x0, dx);
+
+				previous = row;
+				cursor += 1 + rowBytes;
+			}
+		}
+		return true;
+	}
+
+
+
+	/************************/
+	/*			GIF			*/
+	/************************/
+
+
+	constexpr UINT32 MAX_LZW_CODES = 4096;
+
+	/**
+	 * @brief Decode the LZW codes of a frame into palette indices.
+	 *
+	 * @note Each string is written back to front from its last code: no stack, no copy.
+	 *
+	 * @retval size_t
+	 * @return The number of indices decoded, the end of the data or an invalid code stops the decoding.
+	 */
+	size_t decodeLzw(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _In_ UINT32 minCodeSize, _Out_writes_(capacity) BYTE* indices, _In_ size_t capacity) noexcept
+	{
+		UINT16 prefixes[MAX_LZW_CODES];
+		BYTE suffixes[MAX_LZW_CODES];
+		BYTE firsts[MAX_LZW_CODES];
+		UINT16 lengths[MAX_LZW_CODES];
+
+		const UINT32 clear = 1u << minCodeSize;
+		const UINT32 stop = clear + 1;
+		for (UINT32 code = 0; code < clear; code++)
+		{
+			prefixes[code] = 0;
+			suffixes[code] = firsts[code] = static_cast<BYTE>(code);
+			lengths[code] = 1;
+		}
+
+		constexpr UINT32 NONE = 0xFFFFFFFF;
+		UINT32 codeSize = minCodeSize + 1;
+		UINT32 next = clear + 2;
+		UINT32 previous = NONE;
+
+		UINT64 bits = 0;
+		UINT32 count = 0;
+		const BYTE* cursor = data;
+		const BYTE* const end = data + size;
+		size_t written = 0;
+		while (written < capacity)
+		{
+			while (count < codeSize)
+			{
+				if (cursor == end) return written;
+				bits |= static_cast<UINT64>(*cursor++) << count;
+				count += 8;
+			}
+			const UINT32 code = static_cast<UINT32>(bits) & ((1u << codeSize) - 1);
+			bits >>= codeSize;
+			count -= codeSize;
+
+			if (code == clear)
+			{
+				codeSize = minCodeSize + 1;
+				next = clear + 2;
+				previous = NONE;
+				continue;
+			}
+			if (code == stop) return written;
+
+			if (previous == NONE)
+			{
+				if (code >= clear) return written;
+				indices[written++] = static_cast<BYTE>(code);
+				previous = code;
+				continue;
+			}
+			if (code > next || (code == next && next == MAX_LZW_CODES)) return written;
+
+			// The new string is the previous one and the first index of the current one, which is itself when code == next.
+			if (next < MAX_LZW_CODES)
+			{
+				prefixes[next] = static_cast<UINT16>(previous);
+				suffixes[next] = firsts[code == next ? previous : code];
+				firsts[next] = firsts[previous];
+				lengths[next] = lengths[previous] + 1;
+				next++;
+				if (next == (1u << codeSize) && codeSize < 12) codeSize++;
+			}
+
+			const size_t length = lengths[code];
+			const size_t kept = (std::min)(length, capacity - written);
+			UINT32 string = code;
+			for (size_t i = length; i-- > 0;)
+			{
+				if (i < kept) indices[written + i] = suffixes[string];
+				string = prefixes[string];
+			}
+			written += kept;
+			previous = code;
+		}
+		return written;
+	}
+
+	/**
+	 * @brief Append the content of data sub-blocks.
+	 *
+	 * @retval BYTE*
+	 * @return The position after the block terminator.
+	 */
+	const BYTE* readSubBlocks(_In_ const BYTE* cursor, _In_ const BYTE* end, _Inout_opt_ std::vector<BYTE>* content)
+	{
+		while (cursor < end)
+		{
+			const size_t length = *cursor++;
+			if (length == 0) break;
+			const size_t available = (std::min)(length, static_cast<size_t>(end - cursor));
+			if (content) content->insert(content->end(), cursor, cursor + available);
+			cursor += available;
+		}
+		return cursor;
+	}
+
+	bool decodeGif(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image, _In_opt_ bool allFrames)
+	{
+		PROFILE_ZONE("decodeGif");
+		image = {};
+		if (detectFormat(data, size) != ImageFormat::Gif || size < 13) return false;
+
+		const UINT32 width = data[6] | (data[7] << 8);
+		const UINT32 height = data[8] | (data[9] << 8);
+		if (!isSizeSupported(width, height)) return false;
+
+		const BYTE* cursor = data + 13;
+		const BYTE* const end = data + size;
+
+		std::vector<Graphics::Pixel> globalColors;
+		if (data[10] & 0x80)
+		{
+			const size_t count = 2ull << (data[10] & 0x07);
+			if (static_cast<size_t>(end - cursor) < count * 3) return false;
+			for (size_t i = 0; i < count; i++) globalColors.push_back(Graphics::Pixel(cursor[i * 3], cursor[i * 3 + 1], cursor[i * 3 + 2]));
+			cursor += count * 3;
+		}
+
+		image.format = ImageFormat::Gif;
+		image.width = width;
+		image.height = height;
+
+		std::vector<Graphics::Pixel> canvas(static_cast<size_t>(width) * height, Graphics::Pixel(0x00, 0x00));
+		std::vector<Graphics::Pixel> saved;
+		std::vector<Graphics::Pixel> localColors;
+		std::vector<BYTE> codes;
+		std::vector<BYTE> indices;
+
+		// Graphic control extension of the next frame.
+		UINT32 disposal = 0;
+		UINT32 delayMs = 0;
+		int transparent = -1;
+
+		while (cursor < end)
+		{
+			const BYTE block = *cursor++;
+			if (block == 0x21) // Extension.
+			{
+				if (cursor == end) break;
+				const BYTE label = *cursor++;
+				if (label == 0xF9 && end - cursor >= 6 && cursor[0] >= 4)
+				{
+					const BYTE flags = cursor[1];
+					disposal = (flags >> 2) & 0x07;
+					delayMs = (cursor[2] | (cursor[3] << 8)) * 10;
+					transparent = (flags & 0x01) ? cursor[4] : -1;
+				}
+				cursor = readSubBlocks(cursor, end, nullptr);
+				continue;
+			}
+			if (block != 0x2C || end - cursor < 10) break; // Trailer, or unknown block.
+
+			const UINT32 left = cursor[0] | (cursor[1] << 8);
+			const UINT32 top = cursor[2] | (cursor[3] << 8);
+			const UINT32 frameWidth = cursor[4] | (cursor[5] << 8);
+			const UINT32 frameHeight = cursor[6] | (cursor[7] << 8);
+			const BYTE flags = cursor[8];
+			cursor += 9;
+
+			const std::vector<Graphics::Pixel>* colors = &globalColors;
+			if (flags & 0x80)
+			{
+				const size_t count = 2ull << (flags & 0x07);
+				if (static_cast<size_t>(end - cursor) < count * 3) break;
+				localColors.clear();
+				for (size_t i = 0; i < count; i++) localColors.push_back(Graphics::Pixel(cursor[i * 3], cursor[i * 3 + 1], cursor[i * 3 + 2]));
+				colors = &localColors;
+				cursor += count * 3;
+			}
+
+			if (cursor == end) break;
+			const UINT32 minCodeSize = *cursor++;
+			if (minCodeSize < 1 || minCodeSize > 11) break;
+			codes.clear();
+			cursor = readSubBlocks(cursor, end, &codes);
+
+			indices.resize(static_cast<size_t>(frameWidth) * frameHeight);
+			const size_t decoded = decodeLzw(codes.data(), codes.size(), minCodeSize, indices.data(), indices.size());
+
+			if (disposal == 3) saved = canvas;
+
+			// Interlaced rows come in 4 passes: every 8th row from 0, every 8th from 4, every 4th from 2, every 2nd from 1.
+			const bool isInterlaced = (flags & 0x40) != 0;
+			constexpr UINT32 ROW_START[4] = { 0, 4, 2, 1 };
+			constexpr UINT32 ROW_STEP[4] = { 8, 8, 4, 2 };
+			UINT32 pass = 0;
+			UINT32 row = 0;
+			const size_t colorCount = colors->size();
+			for (UINT32 j = 0; j < frameHeight && static_cast<size_t>(j) * frameWidth < decoded; j++)
+			{
+				if (isInterlaced)
+				{
+					while (pass < 4 && ROW_START[pass] + row * ROW_STEP[pass] >= frameHeight)
+					{
+						pass++;
+						row = 0;
+					}
+					if (pass == 4) break;
+				}
+				const UINT32 y = top + (isInterlaced ? ROW_START[pass] + row++ * ROW_STEP[pass] : j);
+				if (y >= height) continue;
+
+				const BYTE* source = indices.data() + static_cast<size_t>(j) * frameWidth;
+				const UINT32 count = static_cast<UINT32>((std::min)(static_cast<size_t>(frameWidth), decoded - static_cast<size_t>(j) * frameWidth));
+				const UINT32 visible = left < width ? (std::min)(count, width - left) : 0;
+				Graphics::Pixel* destination = canvas.data() + static_cast<size_t>(y) * width + left;
+				for (UINT32 x = 0; x < visible; x++)
+				{
+					const UINT32 index = source[x];
+					if (static_cast<int>(index) != transparent && index < colorCount) destination[x] = (*colors)[index];
+				}
+			}
+
+			image.frames.push_back({ canvas, delayMs });
+			if (!allFrames) break;
+
+			if (disposal == 2)
+			{
+				// Back to the background, drawn transparent.
+				for (UINT32 y = top; y < (std::min)(top + frameHeight, height); y++)
+					for (UINT32 x = left; x < (std::min)(left + frameWidth, width); x++)
+						canvas[static_cast<size_t>(y) * width + x] = Graphics::Pixel(0x00, 0x00);
+			}
+			else if (disposal == 3)
+			{
+				canvas.swap(saved);
+			}
+			disposal = 0;
+			delayMs = 0;
+			transparent = -1;
+		}
+
+		if (image.frames.empty())
+		{
+			image = {};
+			return false;
+		}
+		return true;
+	}
+
+
+
+	/************************/
+	/*		  Loading		*/
+	/************************/
+
+
+	ImageFormat detectFormat(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size) noexcept
+	{
+		if (size >= sizeof(PNG_SIGNATURE) && std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0) return ImageFormat::Png;
+		if (size >= 6 && (std::memcmp(data, "GIF87a", 6) == 0 || std::memcmp(data, "GIF89a", 6) == 0)) return ImageFormat::Gif;
+		return ImageFormat::Unknown;
+	}
+
+	bool readImageSize(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ UINT32& width, _Out_ UINT32& height) noexcept
+	{
+		width = 0;
+		height = 0;
+		switch (detectFormat(data, size))
+		{
+		case ImageFormat::Png:
+			// The IHDR chunk comes first, after its length and type.
+			if (size < sizeof(PNG_SIGNATURE) + 16 || std::memcmp(data + sizeof(PNG_SIGNATURE) + 4, "IHDR", 4) != 0) return false;
+			width = readBigEndian(data + sizeof(PNG_SIGNATURE) + 8);
+			height = readBigEndian(data + sizeof(PNG_SIGNATURE) + 12);
+			return true;
+		case ImageFormat::Gif:
+			if (size < 10) return false;
+			width = data[6] | (data[7] << 8);
+			height = data[8] | (data[9] << 8);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool isSizeSupported(_In_ UINT32 width, _In_ UINT32 height) noexcept
+	{
+		return width != 0 && height != 0 && static_cast<UINT64>(width) * height <= MAX_PIXELS;
+	}
+
+	bool decodeImage(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image, _In_opt_ bool allFrames)
+	{
+		try
+		{
+			switch (detectFormat(data, size))
+			{
+			case ImageFormat::Png:
+				return decodePng(data, size, image);
+			case ImageFormat::Gif:
+				return decodeGif(data, size, image, allFrames);
+			default:
+				image = {};
+				return false;
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			image = {};
+			return false;
+		}
+	}
+
+	bool loadImage(_In_ const wchar_t* path, _Out_ DecodedImage& image, _In_opt_ bool allFrames)
+	{
+		PROFILE_ZONE("loadImage");
+		image = {};
+		try
+		{
+			std::ifstream file(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+			if (!file) return false;
+			const std::streamoff size = file.tellg();
+			if (size <= 0) return false;
+
+			std::vector<BYTE> data(static_cast<size_t>(size));
+			file.seekg(0);
+			if (!file.read(reinterpret_cast<char*>(data.data()), size)) return false;
+			return decodeImage(data.data(), data.size(), image, allFrames);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+	}
+
+} // namespace Codec
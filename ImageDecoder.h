@@ -0,0 +1,126 @@
+#pragma once
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <Windows.h>
+#include <minwindef.h> // BYTE
+
+#include <vector>
+
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	struct Pixel;
+} // namespace Graphics
+
+
+namespace Codec
+{
+	enum class ImageFormat : BYTE
+	{
+		Unknown,
+		Png,
+		Gif,
+	};
+
+	/**
+	 * @brief A frame of a decoded image, as large as the image.
+	 */
+	struct DecodedFrame
+	{
+		std::vector<Graphics::Pixel> pixels;	// width * height premultiplied B8G8R8A8 pixels.
+		UINT32 delayMs = 0;						// How long the frame is shown, zero for still images.
+	};
+
+	/**
+	 * @brief The frames of a decoded image.
+	 *
+	 * @note A PNG has one frame. Each frame of a GIF is composited over the previous ones as the
+	 *       disposal methods ask: every frame is a full picture.
+	 */
+	struct DecodedImage
+	{
+		ImageFormat format = ImageFormat::Unknown;
+		UINT32 width = 0;
+		UINT32 height = 0;
+		std::vector<DecodedFrame> frames;
+	};
+
+	/**
+	 * @brief Recognize an image from its first bytes.
+	 */
+	ImageFormat detectFormat(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size) noexcept;
+
+	/**
+	 * @brief Read the size of a PNG or a GIF from its header, without decoding it.
+	 *
+	 * @retval bool
+	 * @return True if the format is known and the header holds the size.
+	 */
+	bool readImageSize(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ UINT32& width, _Out_ UINT32& height) noexcept;
+
+	/**
+	 * @brief Return whether the decoders accept an image of this size: at most 1 << 28 pixels, 16384 x 16384.
+	 *
+	 * @note Larger images fail to decode from their header, before anything is allocated.
+	 */
+	bool isSizeSupported(_In_ UINT32 width, _In_ UINT32 height) noexcept;
+
+	/**
+	 * @brief Decompress a zlib stream (RFC 1950 / 1951) into a buffer of known size.
+	 *
+	 * @note The checksum is not verified.
+	 *
+	 * @param[in] data		The compressed stream.
+	 * @param[in] size		Its size, in bytes.
+	 * @param[out] output	Receives the decompressed bytes.
+	 * @param[in] capacity	The size of output: the stream must not decompress to more.
+	 *
+	 * @retval size_t
+	 * @return The number of bytes decompressed, or SIZE_MAX if the stream is corrupted or too large.
+	 */
+	size_t inflateZlib(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_writes_bytes_(capacity) BYTE* output, _In_ size_t capacity);
+
+	/**
+	 * @brief Decode a PNG: every color type and bit depth, palettes, transparency chunks and Adam7 interlacing.
+	 *
+	 * @note 16 bit samples keep their high byte. The gamma and color profile chunks are ignored, like the checksums.
+	 *
+	 * @retval bool
+	 * @return True if the image has been decoded, false if the data is not a valid PNG.
+	 */
+	bool decodePng(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image);
+
+	/**
+	 * @brief Decode a GIF, 87a or 89a.
+	 *
+	 * @param[in] allFrames False to decode the first frame only.
+	 *
+	 * @retval bool
+	 * @return True if at least one frame has been decoded, false if the data is not a valid GIF.
+	 */
+	bool decodeGif(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image, _In_opt_ bool allFrames = true);
+
+	/**
+	 * @brief Decode a PNG or a GIF, recognized from its first bytes.
+	 *
+	 * @retval bool
+	 * @return True if the image has been decoded, false if the format is unknown, the data invalid, or memory is missing.
+	 */
+	bool decodeImage(_In_reads_bytes_(size) const BYTE* data, _In_ size_t size, _Out_ DecodedImage& image, _In_opt_ bool allFrames = true);
+
+	/**
+	 * @brief Read and decode an image file.
+	 *
+	 * @param[in] path The image's path, relative or absolute.
+	 *
+	 * @retval bool
+	 * @return True if the image has been decoded, false otherwise.
+	 */
+	bool loadImage(_In_ const wchar_t* path, _Out_ DecodedImage& image, _In_opt_ bool allFrames = true);
+
+} // namespace Codec
+
+#endif // IMAGE_DECODER_H
@@ -0,0 +1,492 @@
+#include "LargeImage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "ImageDecoder.h"
+#include "Profiler.h"
+#include "WindowClass.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	/****************************/
+	/*		PixelTileSource		*/
+	/****************************/
+
+
+	/**** Constructors ****/
+
+	PixelTileSource::PixelTileSource(_In_ std::vector<Pixel>&& pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ UINT32 smallestSize)
+	{
+		PROFILE_ZONE("PixelTileSource::buildLevels");
+		smallestSize = (std::max)(smallestSize, 1u);
+		m_levels.push_back(std::move(pixels));
+		m_sizes.push_back({ width, height });
+
+		while (m_sizes.back().width > smallestSize || m_sizes.back().height > smallestSize)
+		{
+			// Each pixel averages 2x2 pixels of the previous level, the last column and row repeated for odd sizes.
+			const D2D1_SIZE_U size = m_sizes.back();
+			const D2D1_SIZE_U half = { (size.width + 1) / 2, (size.height + 1) / 2 };
+			const Pixel* previous = m_levels.back().data();
+			std::vector<Pixel> level(static_cast<size_t>(half.width) * half.height, Pixel(0x00, 0x00));
+
+			for (UINT32 y = 0; y < half.height; y++)
+			{
+				const Pixel* top = previous + static_cast<size_t>(2 * y) * size.width;
+				const Pixel* bottom = previous + static_cast<size_t>((std::min)(2 * y + 1, size.height - 1)) * size.width;
+				Pixel* destination = level.data() + static_cast<size_t>(y) * half.width;
+				for (UINT32 x = 0; x < half.width; x++)
+				{
+					const UINT32 left = 2 * x, right = (std::min)(2 * x + 1, size.width - 1);
+					destination[x].b = static_cast<BYTE>((top[left].b + top[right].b + bottom[left].b + bottom[right].b + 2) >> 2);
+					destination[x].g = static_cast<BYTE>((top[left].g + top[right].g + bottom[left].g + bottom[right].g + 2) >> 2);
+					destination[x].r = static_cast<BYTE>((top[left].r + top[right].r + bottom[left].r + bottom[right].r + 2) >> 2);
+					destination[x].a = static_cast<BYTE>((top[left].a + top[right].a + bottom[left].a + bottom[right].a + 2) >> 2);
+				}
+			}
+			m_levels.push_back(std::move(level));
+			m_sizes.push_back(half);
+		}
+	}
+
+	/**** Methods ****/
+
+	bool PixelTileSource::decode(_In_ UINT32 level, _In_ const D2D1_RECT_U& region, _Out_ Pixel* pixels)
+	{
+		if (level >= m_levels.size()) return false;
+
+		const UINT32 width = m_sizes[level].width;
+		const Pixel* source = m_levels[level].data();
+		for (UINT32 y = region.top; y < region.bottom; y++)
+		{
+			const Pixel* row = source + static_cast<size_t>(y) * width;
+			pixels = std::copy(row + region.left, row + region.right, pixels);
+		}
+		return true;
+	}
+
+
+
+	/****************************/
+	/*		  LargeImage		*/
+	/****************************/
+
+
+	namespace
+	{
+		std::unique_ptr<TileSource> loadSource(_In_ const wchar_t* imageName, _In_ UINT32 tileSize)
+		{
+			// Checked from the header, before the whole file is read: past the decoder limit, the image would silently stay transparent.
+			if (imageName)
+			{
+				BYTE header[32] = {};
+				std::ifstream file(std::filesystem::path(imageName), std::ios::binary);
+				file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+				UINT32 width, height;
+				if (Codec::readImageSize(header, static_cast<size_t>(file.gcount()), width, height) && width != 0 && height != 0
+					&& !Codec::isSizeSupported(width, height))
+					throw std::length_error("The image is larger than the 16384 x 16384 pixels the decoder accepts: construct the LargeImage from a TileSource.");
+			}
+
+			Codec::DecodedImage decoded;
+			if (imageName && Codec::loadImage(imageName, decoded, false))
+				return std::make_unique<PixelTileSource>(std::move(decoded.frames.front().pixels), decoded.width, decoded.height, tileSize);
+
+			// A single transparent tile when the file cannot be read or decoded.
+			tileSize = (std::max)(tileSize, 1u);
+			std::vector<Pixel> placeholder(static_cast<size_t>(tileSize) * tileSize, Pixel(0x00, 0x00));
+			return std::make_unique<PixelTileSource>(std::move(placeholder), tileSize, tileSize, tileSize);
+		}
+	} // namespace
+
+
+	/**** Constructors ****/
+
+	LargeImage::LargeImage(_In_ const D2D1_POINT_2F& pos, _In_ std::unique_ptr<TileSource> source, _In_opt_ UINT32 tileSize, _In_opt_ UINT32 threadCount)
+		:m_source(std::move(source)), m_tileSize((std::max)(tileSize, 1u)), m_threadCount((std::max)(threadCount, 1u))
+	{
+		__super::setPos(pos);
+		buildLevels();
+	}
+
+	LargeImage::LargeImage(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName, _In_opt_ UINT32 tileSize, _In_opt_ UINT32 threadCount)
+		:LargeImage(pos, loadSource(imageName, tileSize), tileSize, threadCount)
+	{}
+
+	/**** Methods ****/
+
+	bool LargeImage::initialize(void* window) noexcept
+	{
+		if (!__super::initialize(window)) return false;
+
+		if (m_slots.empty()) registerSlots();
+		setBoundsSize(getSize());
+		return true;
+	}
+
+	void LargeImage::buildLevels()
+	{
+		UINT32 width = m_source->getWidth(), height = m_source->getHeight();
+		UINT32 firstTile = 0;
+		while (true)
+		{
+			const UINT32 columns = (width + m_tileSize - 1) / m_tileSize;
+			const UINT32 rows = (height + m_tileSize - 1) / m_tileSize;
+			m_levels.push_back({ width, height, columns, rows, firstTile });
+			firstTile += columns * rows;
+
+			if (width <= m_tileSize && height <= m_tileSize) break;
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+		m_tileSlots.assign(firstTile, INVALID_SLOT);
+	}
+
+	D2D1_RECT_U LargeImage::getTileRegion(_In_ UINT32 tile, _Out_opt_ UINT32* level) const noexcept
+	{
+		UINT32 index = 0;
+		while (index + 1 < m_levels.size() && tile >= m_levels[index + 1].firstTile) index++;
+		if (level) *level = index;
+
+		const Level& info = m_levels[index];
+		const UINT32 column = (tile - info.firstTile) % info.columns;
+		const UINT32 row = (tile - info.firstTile) / info.columns;
+		return D2D1::RectU(column * m_tileSize, row * m_tileSize,
+			(std::min)((column + 1) * m_tileSize, info.width), (std::min)((row + 1) * m_tileSize, info.height));
+	}
+
+	void LargeImage::decoderLoop()
+	{
+		while (true)
+		{
+			UINT32 slotIndex;
+			UINT32 level;
+			D2D1_RECT_U region;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_decodeAvailable.wait(lock, [this]() { return !m_queue.empty() || !m_isDecoding; });
+				if (!m_isDecoding) break;
+
+				slotIndex = m_queue.back();
+				m_queue.pop_back();
+				TileSlot& slot = m_slots[slotIndex];
+				slot.state = SlotState::Decoding;
+				if (slot.pixels.empty()) slot.pixels.resize(static_cast<size_t>(m_tileSize) * m_tileSize, Pixel(0x00, 0x00));
+				region = getTileRegion(slot.tile, &level);
+				m_decodingCount++;
+			}
+
+			// The slot belongs to this thread until it is marked decoded.
+			PROFILE_ZONE("LargeImage::decodeTile");
+			TileSlot& slot = m_slots[slotIndex];
+			const size_t count = static_cast<size_t>(region.right - region.left) * (region.bottom - region.top);
+			bool isDecoded = false;
+			try
+			{
+				isDecoded = m_source->decode(level, region, slot.pixels.data());
+			}
+			catch (...)
+			{
+				isDecoded = false;
+			}
+			if (!isDecoded) std::fill(slot.pixels.begin(), slot.pixels.begin() + count, Pixel(0x00, 0x00));
+			const bool isOpaque = isDecoded && std::all_of(slot.pixels.begin(), slot.pixels.begin() + count, [](const Pixel& pixel) { return pixel.a == 0xFF; });
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				slot.isOpaque = isOpaque;
+				slot.state = SlotState::Decoded;
+				m_decodingCount--;
+			}
+			m_decodeDone.notify_all();
+		}
+	}
+
+	void LargeImage::stopDecoders() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isDecoding = false;
+		}
+		m_decodeAvailable.notify_all();
+		for (std::thread& decoder : m_decoders)
+			decoder.join();
+		m_decoders.clear();
+	}
+
+	void LargeImage::waitDecodes(_Inout_ std::unique_lock<std::mutex>& lock) noexcept
+	{
+		m_decodeDone.wait(lock, [this]() { return m_decodingCount == 0; });
+	}
+
+	void LargeImage::registerSlots()
+	{
+		// Registered once, here on the main thread: recording only updates them, so the image records in parallel with the other layers.
+		const size_t tileBytes = static_cast<size_t>(m_tileSize) * m_tileSize * sizeof(Pixel);
+		const size_t count = (std::min)((std::max)(m_cacheBudget / tileBytes, static_cast<size_t>(1)), m_tileSlots.size());
+
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		m_slots.resize(count);
+		for (TileSlot& slot : m_slots)
+			slot.resource = resources.registerBitmap(nullptr, 0, 0);
+	}
+
+	void LargeImage::unregisterSlots() noexcept
+	{
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		for (TileSlot& slot : m_slots)
+		{
+			if (slot.tile != INVALID_SLOT) m_tileSlots[slot.tile] = INVALID_SLOT;
+			resources.unregisterBitmap(slot.resource);
+		}
+		m_slots.clear();
+	}
+
+	void LargeImage::setCacheBudget(_In_ size_t bytes)
+	{
+		m_cacheBudget = bytes;
+		if (m_window == nullptr || m_slots.empty()) return;
+
+		// No decoding thread may write into the slots while they are replaced.
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queue.clear();
+			waitDecodes(lock);
+		}
+		unregisterSlots();
+		registerSlots();
+	}
+
+	size_t LargeImage::getCacheMemory() const noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t bytes = 0;
+		for (const TileSlot& slot : m_slots) bytes += slot.pixels.capacity() * sizeof(Pixel);
+		return bytes;
+	}
+
+	UINT32 LargeImage::acquireSlot() noexcept
+	{
+		// A free slot, or the least recently seen decoded one whose tile is not used in this frame.
+		UINT32 oldest = INVALID_SLOT;
+		for (UINT32 i = 0; i < m_slots.size(); i++)
+		{
+			const TileSlot& slot = m_slots[i];
+			if (slot.state == SlotState::Free) return i;
+			if (slot.state == SlotState::Ready && slot.lastUse < m_frame && (oldest == INVALID_SLOT || slot.lastUse < m_slots[oldest].lastUse)) oldest = i;
+		}
+		if (oldest == INVALID_SLOT) return INVALID_SLOT;
+
+		// The bitmap stops pointing to the pixels before a decoding thread writes the next tile into them.
+		TileSlot& evicted = m_slots[oldest];
+		reinterpret_cast<BaseWindow*>(m_window)->getResources().updateBitmap(evicted.resource, nullptr, 0, 0);
+		m_tileSlots[evicted.tile] = INVALID_SLOT;
+		evicted.tile = INVALID_SLOT;
+		evicted.state = SlotState::Free;
+		m_stats.evictedTiles++;
+		return oldest;
+	}
+
+	void LargeImage::requestTile(_In_ UINT32 tile)
+	{
+		UINT32 slotIndex = m_tileSlots[tile];
+		if (slotIndex == INVALID_SLOT)
+		{
+			slotIndex = acquireSlot();
+			if (slotIndex == INVALID_SLOT) return; // Every slot is used in this frame.
+
+			m_slots[slotIndex].tile = tile;
+			m_slots[slotIndex].state = SlotState::Queued;
+			m_tileSlots[tile] = slotIndex;
+		}
+
+		TileSlot& slot = m_slots[slotIndex];
+		if (slot.state == SlotState::Queued && slot.lastUse < m_frame) m_requests.push_back(slotIndex);
+		slot.lastUse = m_frame;
+	}
+
+	bool LargeImage::recordFallback(_Inout_ Render::CommandList& commands, _In_ UINT32 level, _In_ UINT32 column, _In_ UINT32 row, _In_ const D2D1_RECT_F& destination)
+	{
+		const Level& info = m_levels[level];
+		const UINT32 width = (std::min)(m_tileSize, info.width - column * m_tileSize);
+		const UINT32 height = (std::min)(m_tileSize, info.height - row * m_tileSize);
+
+		for (UINT32 coarser = level + 1; coarser < m_levels.size(); coarser++)
+		{
+			const UINT32 shift = coarser - level;
+			const Level& coarserInfo = m_levels[coarser];
+			const UINT32 slotIndex = m_tileSlots[coarserInfo.firstTile + (row >> shift) * coarserInfo.columns + (column >> shift)];
+			if (slotIndex == INVALID_SLOT || m_slots[slotIndex].state != SlotState::Ready) continue;
+
+			// The part of the coarser tile covering the tile, in the coarser tile's pixels.
+			TileSlot& slot = m_slots[slotIndex];
+			const float factor = 1.0f / static_cast<float>(1u << shift);
+			const float left = static_cast<float>(column * m_tileSize) * factor - static_cast<float>((column >> shift) * m_tileSize);
+			const float top = static_cast<float>(row * m_tileSize) * factor - static_cast<float>((row >> shift) * m_tileSize);
+			const D2D1_RECT_F source = D2D1::RectF(left, top, left + width * factor, top + height * factor);
+
+			slot.lastUse = m_frame;
+			commands.drawBitmap(slot.resource, destination, source, m_opacity);
+			if (slot.isOpaque && m_opacity >= 1.0f) commands.occlude(destination);
+			return true;
+		}
+		return false;
+	}
+
+	void LargeImage::record(_Inout_ Render::CommandList& commands)
+	{
+		m_frame++;
+		m_stats.lastFrameVisible = 0;
+		m_stats.lastFrameFallback = 0;
+		m_stats.lastFrameMissing = 0;
+		if (m_window == nullptr || m_slots.empty()) return;
+
+		D2D1_RECT_F viewport = m_viewport;
+		if (viewport.right <= viewport.left || viewport.bottom <= viewport.top)
+		{
+			RECT client;
+			GetClientRect(reinterpret_cast<BaseWindow*>(m_window)->getHwnd(), &client);
+			viewport = D2D1::RectF(0.0f, 0.0f, static_cast<float>(client.right - client.left), static_cast<float>(client.bottom - client.top));
+		}
+
+		const D2D1_POINT_2F origin = getWorldPos();
+		const D2D1_SIZE_F scale = getWorldScale();
+		const float pixelScale = (std::max)(scale.width, scale.height);
+		if (!(pixelScale > 0.0f)) return;
+
+		// The coarsest level whose pixels are still no larger than a client pixel.
+		UINT32 level = 0;
+		while (level + 1 < m_levels.size() && pixelScale * static_cast<float>(1u << (level + 1)) <= 1.0f) level++;
+		m_stats.lastFrameLevel = level;
+
+		const Level& info = m_levels[level];
+		const float levelScaleX = scale.width * static_cast<float>(1u << level);
+		const float levelScaleY = scale.height * static_cast<float>(1u << level);
+		const float tileWidth = m_tileSize * levelScaleX, tileHeight = m_tileSize * levelScaleY;
+
+		// The tiles intersecting the viewport, clamped to the level before leaving the floats.
+		const float columns = static_cast<float>(info.columns), rows = static_cast<float>(info.rows);
+		const UINT32 firstColumn = static_cast<UINT32>((std::clamp)(std::floor((viewport.left - origin.x) / tileWidth), 0.0f, columns));
+		const UINT32 lastColumn = static_cast<UINT32>((std::clamp)(std::ceil((viewport.right - origin.x) / tileWidth), 0.0f, columns));
+		const UINT32 firstRow = static_cast<UINT32>((std::clamp)(std::floor((viewport.top - origin.y) / tileHeight), 0.0f, rows));
+		const UINT32 lastRow = static_cast<UINT32>((std::clamp)(std::ceil((viewport.bottom - origin.y) / tileHeight), 0.0f, rows));
+
+		// Closest to the center of the viewport first.
+		const float centerX = ((viewport.left + viewport.right) * 0.5f - origin.x) / tileWidth - 0.5f;
+		const float centerY = ((viewport.top + viewport.bottom) * 0.5f - origin.y) / tileHeight - 0.5f;
+		m_visible.clear();
+		for (UINT32 row = firstRow; row < lastRow; row++)
+			for (UINT32 column = firstColumn; column < lastColumn; column++)
+			{
+				const float dx = column - centerX, dy = row - centerY;
+				m_visible.push_back({ dx * dx + dy * dy, info.firstTile + row * info.columns + column });
+			}
+		std::sort(m_visible.begin(), m_visible.end());
+		m_stats.lastFrameVisible = m_visible.size();
+
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// The tiles decoded since the last frame. Drops the device copies: the upload queue creates them again.
+		m_stats.lastFrameResidentBytes = 0;
+		for (TileSlot& slot : m_slots)
+		{
+			if (slot.state == SlotState::Decoded)
+			{
+				const D2D1_RECT_U region = getTileRegion(slot.tile);
+				resources.updateBitmap(slot.resource, slot.pixels.data(), region.right - region.left, region.bottom - region.top);
+				slot.state = SlotState::Ready;
+				m_stats.decodedTiles++;
+			}
+			if (slot.state == SlotState::Ready) m_stats.lastFrameResidentBytes += slot.pixels.size() * sizeof(Pixel);
+		}
+		m_stats.peakResidentBytes = (std::max)(m_stats.peakResidentBytes, m_stats.lastFrameResidentBytes);
+
+		// The coarsest level is queued first, so that every visible tile soon has something to show.
+		const UINT32 coarsest = static_cast<UINT32>(m_levels.size() - 1);
+		const Level& coarsestInfo = m_levels[coarsest];
+		for (const auto& [distance, tile] : m_visible)
+		{
+			const UINT32 shift = coarsest - level;
+			const UINT32 column = (tile - info.firstTile) % info.columns, row = (tile - info.firstTile) / info.columns;
+			requestTile(coarsestInfo.firstTile + (row >> shift) * coarsestInfo.columns + (column >> shift));
+		}
+
+		for (const auto& [distance, tile] : m_visible)
+		{
+			requestTile(tile);
+
+			const UINT32 column = (tile - info.firstTile) % info.columns, row = (tile - info.firstTile) / info.columns;
+			const D2D1_RECT_U region = getTileRegion(tile);
+			const D2D1_RECT_F destination = D2D1::RectF(origin.x + region.left * levelScaleX, origin.y + region.top * levelScaleY,
+				origin.x + region.right * levelScaleX, origin.y + region.bottom * levelScaleY);
+
+			const UINT32 slotIndex = m_tileSlots[tile];
+			if (slotIndex != INVALID_SLOT && m_slots[slotIndex].state == SlotState::Ready)
+			{
+				const TileSlot& slot = m_slots[slotIndex];
+				commands.drawBitmap(slot.resource, destination, m_opacity);
+				if (slot.isOpaque && m_opacity >= 1.0f) commands.occlude(destination);
+			}
+			else if (recordFallback(commands, level, column, row, destination))
+			{
+				m_stats.lastFrameFallback++;
+			}
+			else
+			{
+				m_stats.lastFrameMissing++;
+			}
+		}
+
+		// The tiles queued but not requested in this frame left the view: their slots are given back.
+		for (TileSlot& slot : m_slots)
+		{
+			if (slot.state != SlotState::Queued || slot.lastUse == m_frame) continue;
+			m_tileSlots[slot.tile] = INVALID_SLOT;
+			slot.tile = INVALID_SLOT;
+			slot.state = SlotState::Free;
+			m_stats.cancelledTiles++;
+		}
+
+		m_queue.assign(m_requests.rbegin(), m_requests.rend());
+		m_requests.clear();
+		m_stats.lastFramePending = m_queue.size() + m_decodingCount;
+		const bool hasQueue = !m_queue.empty();
+		if (hasQueue && m_decoders.empty())
+		{
+			// Started on first use: an image entirely out of view costs no thread.
+			m_isDecoding = true;
+			for (UINT32 i = 0; i < m_threadCount; i++)
+				m_decoders.emplace_back(&LargeImage::decoderLoop, this);
+		}
+		lock.unlock();
+		if (hasQueue) m_decodeAvailable.notify_all();
+	}
+
+	void LargeImage::reconstruct() noexcept
+	{
+		// The device bitmaps are owned by the window's resource table.
+	}
+
+	void LargeImage::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
+	}
+
+	LargeImage::~LargeImage()
+	{
+		stopDecoders();
+		if (m_window == nullptr || m_slots.empty()) return;
+
+		unregisterSlots();
+	}
+
+} // namespace Graphics
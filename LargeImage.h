@@ -0,0 +1,259 @@
+#pragma once
+#ifndef LARGE_IMAGE_H
+#define LARGE_IMAGE_H
+
+#include <Windows.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	/**
+	 * @brief The pixels of a large image, decoded one region at a time.
+	 *
+	 * @note The image is seen as a pyramid: level 0 is the full image, each next level half the size of
+	 *       the previous one, rounded up, until a level fits in a single tile.
+	 */
+	class TileSource
+	{
+	public:
+		virtual ~TileSource() = default;
+
+		virtual UINT32 getWidth() const noexcept = 0;
+		virtual UINT32 getHeight() const noexcept = 0;
+
+		/**
+		 * @brief Decode a region of a level of the pyramid.
+		 *
+		 * @note Called from the decoding threads, several at a time.
+		 *
+		 * @param[in] level		The level, 0 for the full image.
+		 * @param[in] region	The region, in the pixels of the level and inside of it.
+		 * @param[out] pixels	The region's width * height premultiplied B8G8R8A8 pixels.
+		 *
+		 * @retval bool
+		 * @return False if the region could not be decoded: its tile stays transparent.
+		 */
+		virtual bool decode(_In_ UINT32 level, _In_ const D2D1_RECT_U& region, _Out_ Pixel* pixels) = 0;
+	};
+
+
+	/**
+	 * @brief A tile source over decoded pixels, for an image that fits in memory but not in a device bitmap.
+	 *
+	 * @note The levels below the full image are built at construction, each pixel the average of 2x2
+	 *       pixels of the previous level: they take a third of the memory of the full image.
+	 */
+	class PixelTileSource : public TileSource
+	{
+	private:
+		std::vector<std::vector<Pixel>> m_levels;
+		std::vector<D2D1_SIZE_U> m_sizes;
+
+	public:
+		/**
+		 * @param[in] pixels		The width * height premultiplied B8G8R8A8 pixels of the full image.
+		 * @param[in] width			The image width in pixels.
+		 * @param[in] height		The image height in pixels.
+		 * @param[in] smallestSize	The size at which the levels stop: the last level fits in it.
+		 */
+		PixelTileSource(_In_ std::vector<Pixel>&& pixels, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ UINT32 smallestSize = 256);
+
+		inline UINT32 getWidth() const noexcept override { return m_sizes.front().width; }
+		inline UINT32 getHeight() const noexcept override { return m_sizes.front().height; }
+
+		bool decode(_In_ UINT32 level, _In_ const D2D1_RECT_U& region, _Out_ Pixel* pixels) override;
+	};
+
+
+	/**
+	 * @brief Counters of a large image.
+	 */
+	struct LargeImageStats
+	{
+		UINT64 decodedTiles = 0;	// Tiles decoded and uploaded since the beginning.
+		UINT64 evictedTiles = 0;	// Tiles dropped to make room since the beginning.
+		UINT64 cancelledTiles = 0;	// Tiles queued then left out of view before being decoded, since the beginning.
+		size_t peakResidentBytes = 0;	// The most memory of the decoded tiles in a frame since the beginning, in bytes.
+
+		UINT32 lastFrameLevel = 0;		// The level drawn in the last frame.
+		size_t lastFrameVisible = 0;	// Tiles of the level intersecting the viewport in the last frame.
+		size_t lastFrameFallback = 0;	// Of them, those drawn from a coarser level because they were not decoded yet.
+		size_t lastFrameMissing = 0;	// Of them, those not drawn because no level covering them was decoded.
+		size_t lastFramePending = 0;	// Tiles queued or decoding at the end of the last frame.
+		size_t lastFrameResidentBytes = 0;	// The memory of the decoded tiles held in the last frame, in bytes.
+	};
+
+
+	/**
+	 * @brief Class for a large image component: an image too large to be held decoded or drawn as one bitmap.
+	 *
+	 * @note The image is split into tiles of tileSize x tileSize pixels at each level of its pyramid. Each frame
+	 *       draws the level with about one pixel per client pixel, and only its tiles intersecting the viewport.
+	 *       Those not decoded yet are queued, closest to the center of the viewport first, for the decoding threads,
+	 *       and the tiles queued but no longer visible are dropped from the queue. Until a tile is decoded, the part
+	 *       of the closest coarser level tile decoded is drawn in its place. The decoded tiles live in a fixed number
+	 *       of slots, registered once, which bounds their memory: the tiles of the least recently seen slots are
+	 *       evicted for the tiles coming into view.
+	 */
+	class LargeImage : public DrawableComponent
+	{
+	private:
+		static constexpr UINT32 INVALID_SLOT = 0xFFFFFFFF;
+
+		enum class SlotState : BYTE
+		{
+			Free,		// No tile.
+			Queued,		// Waiting for a decoding thread, dropped if its tile leaves the view.
+			Decoding,	// Its pixels are written by a decoding thread.
+			Decoded,	// Its pixels are ready to be uploaded.
+			Ready,		// Its bitmap is up to date.
+		};
+
+		/**
+		 * @brief A tile bitmap.
+		 */
+		struct TileSlot
+		{
+			std::vector<Pixel> pixels;	// Allocated on first use, for a whole tile.
+			Render::ResourceId resource = Render::INVALID_RESOURCE;
+			UINT32 tile = INVALID_SLOT;	// The tile it holds, INVALID_SLOT for none.
+			UINT64 lastUse = 0;			// The last frame its tile was drawn or requested.
+			SlotState state = SlotState::Free;
+			bool isOpaque = false;		// Every pixel has a full alpha.
+		};
+
+		/**
+		 * @brief A level of the pyramid.
+		 */
+		struct Level
+		{
+			UINT32 width;
+			UINT32 height;
+			UINT32 columns;
+			UINT32 rows;
+			UINT32 firstTile;	// The index of its first tile, the tiles of all the levels following each other.
+		};
+
+		std::unique_ptr<TileSource> m_source;
+		std::vector<Level> m_levels;
+		UINT32 m_tileSize;
+		UINT32 m_threadCount;
+
+		std::vector<TileSlot> m_slots;
+		std::vector<UINT32> m_tileSlots;	// The slot of each tile, INVALID_SLOT if it has none.
+		std::vector<UINT32> m_requests;		// The slots queued in the current frame, in priority order.
+		std::vector<std::pair<float, UINT32>> m_visible; // The visible tiles and their distance to the center of the viewport.
+		size_t m_cacheBudget = 64 << 20;
+		UINT64 m_frame = 0;
+
+		// Background decoding, m_mutex guards the queue and the state of the slots.
+		std::vector<std::thread> m_decoders;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_decodeAvailable;
+		std::condition_variable m_decodeDone;
+		std::vector<UINT32> m_queue;		// The slots to decode, the next one at the back.
+		size_t m_decodingCount = 0;
+		bool m_isDecoding = false;
+
+		D2D1_RECT_F m_viewport = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float m_opacity = 1.0f;
+		LargeImageStats m_stats;
+
+		void buildLevels();
+		void decoderLoop();
+		void stopDecoders() noexcept;
+		void waitDecodes(_Inout_ std::unique_lock<std::mutex>& lock) noexcept;
+		void registerSlots();
+		void unregisterSlots() noexcept;
+		UINT32 acquireSlot() noexcept;
+		void requestTile(_In_ UINT32 tile);
+		bool recordFallback(_Inout_ Render::CommandList& commands, _In_ UINT32 level, _In_ UINT32 column, _In_ UINT32 row, _In_ const D2D1_RECT_F& destination);
+		D2D1_RECT_U getTileRegion(_In_ UINT32 tile, _Out_opt_ UINT32* level = nullptr) const noexcept;
+
+	public:
+		/**
+		 * @brief Constructor for a large image.
+		 *
+		 * @param[in] pos			The position of the image's top left corner, in client dependent pixel.
+		 * @param[in] source		The source of its pixels.
+		 * @param[in] tileSize		The width and height of a tile, in pixels.
+		 * @param[in] threadCount	The number of decoding threads.
+		 */
+		LargeImage(_In_ const D2D1_POINT_2F& pos, _In_ std::unique_ptr<TileSource> source, _In_opt_ UINT32 tileSize = 256, _In_opt_ UINT32 threadCount = 2);
+
+		/**
+		 * @brief Constructor for a large image decoded from a file, kept whole in memory.
+		 *
+		 * @note The decoder accepts up to 1 << 28 pixels, 16384 x 16384: larger images need a TileSource
+		 *       decoding one region at a time. A file that cannot be read or decoded shows a transparent tile.
+		 *
+		 * @param[in] pos			The position of the image's top left corner, in client dependent pixel.
+		 * @param[in] imageName		The image's path, relative or absolute.
+		 * @param[in] tileSize		The width and height of a tile, in pixels.
+		 * @param[in] threadCount	The number of decoding threads.
+		 *
+		 * @throw std::length_error When the image is larger than the decoder accepts.
+		 */
+		LargeImage(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* imageName, _In_opt_ UINT32 tileSize = 256, _In_opt_ UINT32 threadCount = 2);
+
+		LargeImage(LargeImage&) = delete;
+		LargeImage& operator=(const LargeImage&) = delete;
+
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
+		void reconstruct() noexcept override;
+
+		/**
+		 * @brief Set the part of the client area the image is drawn in, in client pixels. Empty for the whole client area.
+		 */
+		inline void setViewport(_In_ const D2D1_RECT_F& viewport) noexcept { m_viewport = viewport; }
+
+		/**
+		 * @brief Set the memory of the tile bitmaps, in bytes: at least one tile is kept.
+		 *
+		 * @note The tiles decoded are dropped, once the tiles decoding are done.
+		 */
+		void setCacheBudget(_In_ size_t bytes);
+		inline size_t getCacheBudget() const noexcept { return m_cacheBudget; }
+
+		/**
+		 * @brief Return the memory of the tile bitmaps decoded so far, in bytes.
+		 */
+		size_t getCacheMemory() const noexcept;
+
+		/**
+		 * @brief Return whether every tile of the last frame was drawn at the level it needed.
+		 */
+		inline bool isComplete() const noexcept { return m_stats.lastFrameFallback == 0 && m_stats.lastFrameMissing == 0; }
+
+		inline D2D1_SIZE_F getSize() const noexcept { return { static_cast<float>(m_source->getWidth()), static_cast<float>(m_source->getHeight()) }; }
+		inline UINT32 getLevelCount() const noexcept { return static_cast<UINT32>(m_levels.size()); }
+		inline UINT32 getTileSize() const noexcept { return m_tileSize; }
+		inline const LargeImageStats& getStats() const noexcept { return m_stats; }
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
+
+		~LargeImage();
+	};
+
+} // namespace Graphics
+
+#endif // LARGE_IMAGE_H
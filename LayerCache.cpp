@@ -0,0 +1,174 @@
+#include "LayerCache.h"
+
+#include <windows.h>
+#include <d2d1.h>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+
+	/**
+	 * @brief Version of the resource as drawn: the lowest bit tells whether it was drawn uploaded or as a placeholder.
+	 */
+	inline UINT32 getResourceVersion(_In_ const ResourceTable& resources, _In_ ResourceId id) noexcept
+	{
+		const BitmapResource* bitmap = resources.getBitmap(id);
+		return bitmap ? (bitmap->version << 1) | (bitmap->pBitmap != nullptr ? 1 : 0) : 0xFFFFFFFF;
+	}
+
+	bool LayerCache::isUpToDate(_In_ const Entry& entry, _In_ const CommandList& commands, _In_ const ResourceTable& resources) const noexcept
+	{
+		const std::vector<Command>& current = commands.getCommands();
+		if (current.size() != entry.snapshot.size()) return false;
+
+		for (size_t i = 0; i < current.size(); i++)
+		{
+			if (!(current[i] == entry.snapshot[i])) return false;
+			// The sprites of a batch are not in the snapshot: particles move every frame anyway.
+			if (current[i].type == CommandType::DrawSprites) return false;
+			if (usesBitmap(current[i]) && getResourceVersion(resources, current[i].resource) != entry.versions[i]) return false;
+		}
+		return true;
+	}
+
+	void LayerCache::releaseEntry(_Inout_ Entry& entry) noexcept
+	{
+		if (entry.pTarget == nullptr) return;
+
+		entry.pTarget->Release();
+		entry.pTarget = nullptr;
+		m_memoryUsage -= static_cast<size_t>(entry.size.width) * entry.size.height * 4;
+		entry.size = { 0, 0 };
+		entry.snapshot.clear();
+	}
+
+	/**
+	 * @brief Evict the least recently used bitmaps until bytes fit in the budget, only the ones not used since the given clock.
+	 */
+	bool LayerCache::makeRoom(_In_ size_t bytes, _In_ UINT64 usedSince) noexcept
+	{
+		if (bytes > m_memoryBudget) return false;
+
+		while (m_memoryUsage + bytes > m_memoryBudget)
+		{
+			Entry* oldest = nullptr;
+			for (auto& [layer, entry] : m_entries)
+			{
+				if (entry.lastUse > usedSince || entry.pTarget == nullptr) continue;
+				if (oldest == nullptr || entry.lastUse < oldest->lastUse) oldest = &entry;
+			}
+			if (oldest == nullptr) return false;
+
+			releaseEntry(*oldest);
+			oldest->stats.evictions++;
+		}
+		return true;
+	}
+
+	void LayerCache::setLayerCached(_In_ Layer layer, _In_ bool cached)
+	{
+		auto it = m_entries.find(layer);
+		if (cached)
+		{
+			if (it == m_entries.end()) m_entries[layer];
+		}
+		else if (it != m_entries.end())
+		{
+			releaseEntry(it->second);
+			m_entries.erase(it);
+		}
+	}
+
+	void LayerCache::invalidateLayer(_In_ Layer layer) noexcept
+	{
+		if (auto it = m_entries.find(layer); it != m_entries.end())
+			it->second.snapshot.clear();
+	}
+
+	void LayerCache::setMemoryBudget(_In_ size_t bytes) noexcept
+	{
+		m_memoryBudget = bytes;
+		makeRoom(0, m_clock); // Evict until the bitmaps fit in the new budget.
+	}
+
+	const LayerCacheStats* LayerCache::getStats(_In_ Layer layer) const noexcept
+	{
+		auto it = m_entries.find(layer);
+		return it == m_entries.end() ? nullptr : &it->second.stats;
+	}
+
+	void LayerCache::drawLayer(_In_ Layer layer, _In_ const CommandList& commands, _Inout_ D2D1Backend& backend, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		Entry& entry = m_entries[layer];
+		entry.lastUse = ++m_clock;
+
+		const D2D1_SIZE_U size = renderTarget->GetPixelSize();
+		const bool isSameSize = entry.size.width == size.width && entry.size.height == size.height;
+
+		if (entry.pTarget && isSameSize && isUpToDate(entry, commands, resources))
+		{
+			entry.stats.hits++;
+		}
+		else
+		{
+			if (entry.pTarget && !isSameSize) releaseEntry(entry);
+
+			const size_t bytes = static_cast<size_t>(size.width) * size.height * 4;
+			if (entry.pTarget == nullptr)
+			{
+				if (!makeRoom(bytes, m_frameStart) || FAILED(renderTarget->CreateCompatibleRenderTarget(renderTarget->GetSize(), &entry.pTarget)))
+				{
+					// Does not fit: draw the layer directly.
+					entry.pTarget = nullptr;
+					entry.stats.uncached++;
+					backend.executeLayer(commands, resources, renderTarget);
+					return;
+				}
+				entry.size = size;
+				m_memoryUsage += bytes;
+			}
+
+			entry.pTarget->BeginDraw();
+			entry.pTarget->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+			backend.executeLayer(commands, resources, entry.pTarget);
+			if (FAILED(entry.pTarget->EndDraw()))
+			{
+				releaseEntry(entry);
+				entry.stats.uncached++;
+				backend.executeLayer(commands, resources, renderTarget);
+				return;
+			}
+
+			entry.snapshot = commands.getCommands();
+			entry.versions.resize(entry.snapshot.size());
+			for (size_t i = 0; i < entry.snapshot.size(); i++)
+				entry.versions[i] = usesBitmap(entry.snapshot[i]) ? getResourceVersion(resources, entry.snapshot[i].resource) : 0;
+			entry.stats.misses++;
+		}
+
+		if (commands.empty()) return;
+
+		ID2D1Bitmap* pBitmap = nullptr;
+		if (FAILED(entry.pTarget->GetBitmap(&pBitmap))) return;
+		D2D1_SIZE_F dipSize = renderTarget->GetSize();
+		renderTarget->DrawBitmap(pBitmap, D2D1::RectF(0.0f, 0.0f, dipSize.width, dipSize.height), 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+		pBitmap->Release();
+	}
+
+	void LayerCache::releaseDeviceResources() noexcept
+	{
+		for (auto& [layer, entry] : m_entries)
+			releaseEntry(entry);
+	}
+
+	LayerCache::~LayerCache()
+	{
+		releaseDeviceResources();
+	}
+
+} // namespace Render
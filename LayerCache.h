@@ -0,0 +1,139 @@
+#pragma once
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include <Windows.h>
+
+#include <map>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	/**
+	 * @brief Usage counters of a cached layer.
+	 */
+	struct LayerCacheStats
+	{
+		UINT64 hits = 0;		// Frames drawn with a single blit of the cached bitmap.
+		UINT64 misses = 0;		// Frames where the cached bitmap was (re)built.
+		UINT64 uncached = 0;	// Frames drawn directly: the layer did not fit in the memory budget.
+		UINT64 evictions = 0;	// Times the cached bitmap was dropped for another layer.
+
+		inline double getHitRate() const noexcept
+		{
+			const UINT64 total = hits + misses + uncached;
+			return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+		}
+	};
+
+
+	/**
+	 * @brief Keeps rarely changing layers in offscreen bitmaps.
+	 *
+	 * @note A cached layer is rebuilt only when its commands differ from the ones used to build it,
+	 *       that is when one of its components moved, changed, was added or removed,
+	 *       or when one of the bitmaps it draws was updated or finished uploading.
+	 *       The offscreen bitmaps are bounded by a memory budget, the least recently used are evicted.
+	 *       A bitmap drawn this frame is never evicted for another layer of the frame, which is drawn directly instead:
+	 *       the layers are drawn in the same order every frame, each one would evict the next.
+	 */
+	class LayerCache
+	{
+	private:
+		struct Entry
+		{
+			ID2D1BitmapRenderTarget* pTarget = nullptr;
+			D2D1_SIZE_U size = { 0, 0 };
+			std::vector<Command> snapshot;	// Commands the bitmap was built with.
+			std::vector<UINT32> versions;	// Versions of the resources the bitmap was built with.
+			UINT64 lastUse = 0;
+			LayerCacheStats stats;
+		};
+
+		std::map<Layer, Entry> m_entries; // Only the cached layers.
+		size_t m_memoryBudget = 64ull * 1024 * 1024;
+		size_t m_memoryUsage = 0;
+		UINT64 m_clock = 0;
+		UINT64 m_frameStart = 0; // Clock at the start of the frame.
+
+		bool isUpToDate(_In_ const Entry& entry, _In_ const CommandList& commands, _In_ const ResourceTable& resources) const noexcept;
+		void releaseEntry(_Inout_ Entry& entry) noexcept;
+		bool makeRoom(_In_ size_t bytes, _In_ UINT64 usedSince) noexcept;
+
+	public:
+		LayerCache() = default;
+		LayerCache(LayerCache&) = delete;
+		LayerCache& operator=(const LayerCache&) = delete;
+
+		/**
+		 * @brief Enable or disable the caching of a layer.
+		 *
+		 * @param[in] layer		The layer's z-index.
+		 * @param[in] cached	True to cache the layer.
+		 */
+		void setLayerCached(_In_ Layer layer, _In_ bool cached);
+
+		inline bool isLayerCached(_In_ Layer layer) const noexcept { return m_entries.find(layer) != m_entries.end(); }
+
+		/**
+		 * @brief Force the rebuild of a cached layer.
+		 *
+		 * @note Only needed when a component changes its look without changing its commands.
+		 */
+		void invalidateLayer(_In_ Layer layer) noexcept;
+
+		/**
+		 * @brief Set the maximum memory used by the offscreen bitmaps, evicting if needed.
+		 *
+		 * @param[in] bytes The budget, in bytes.
+		 */
+		void setMemoryBudget(_In_ size_t bytes) noexcept;
+
+		inline size_t getMemoryBudget() const noexcept { return m_memoryBudget; }
+		inline size_t getMemoryUsage() const noexcept { return m_memoryUsage; }
+
+		/**
+		 * @brief Return the counters of a cached layer.
+		 *
+		 * @retval LayerCacheStats*
+		 * @return The layer's counters, or nullptr if the layer is not cached.
+		 */
+		const LayerCacheStats* getStats(_In_ Layer layer) const noexcept;
+
+		/**
+		 * @brief Start a frame: the bitmaps drawn from now on are kept until the next one.
+		 */
+		inline void beginFrame() noexcept { m_frameStart = m_clock; }
+
+		/**
+		 * @brief Draw a cached layer, rebuilding its bitmap if needed.
+		 * @note  renderTarget->BeginDraw() Must have been called.
+		 *
+		 * @param[in] layer			The layer's z-index.
+		 * @param[in] commands		The commands recorded for the layer this frame.
+		 * @param[in] backend		The backend used to build the bitmap.
+		 * @param[in] resources		The resources referenced by the commands.
+		 * @param[in] renderTarget	The render target to draw on.
+		 */
+		void drawLayer(_In_ Layer layer, _In_ const CommandList& commands, _Inout_ D2D1Backend& backend, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget);
+
+		/**
+		 * @brief Release every offscreen bitmap.
+		 * @note  Must be called whenever the render target is destroyed.
+		 */
+		void releaseDeviceResources() noexcept;
+
+		~LayerCache();
+	};
+
+} // namespace Render
+
+#endif // LAYER_CACHE_H
@@ -20,8 +20,7 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance ,
 	BaseWindow baseWindow = BaseWindow(hInstance, L"heheheha", L"Saluté");
 	baseWindow.show(nCmdShow);
 
-	Graphics::Image im({ 100.0f, 100.0f }, L"Images\\gif.gif");
-	baseWindow.addComponent(std::make_unique<Graphics::Image>(std::move(im)));
+	baseWindow.emplaceComponent<Graphics::Image>(0, D2D1::Point2F(100.0f, 100.0f), L"Images\\gif.gif");
 
 	baseWindow.mainLoop();
 	
@@ -0,0 +1,135 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "LayerCache.h"
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Render
+{
+
+	/**
+	 * @brief Return the bits [first, end) of a 64 bit word.
+	 */
+	inline UINT64 bitRange(_In_ UINT32 first, _In_ UINT32 end) noexcept
+	{
+		const UINT64 high = end >= 64 ? ~0ull : (1ull << end) - 1;
+		return high & ~((1ull << first) - 1);
+	}
+
+	void OcclusionCuller::cover(_In_ const D2D1_RECT_F& rect) noexcept
+	{
+		// Only the cells fully inside the rectangle, the cells cut by the screen's edges count as inside.
+		const float width = static_cast<float>(m_columns * CELL_SIZE);
+		const float height = static_cast<float>(m_rows * CELL_SIZE);
+		const UINT32 firstColumn = rect.left <= 0.0f ? 0 : static_cast<UINT32>(std::ceil(rect.left / CELL_SIZE));
+		const UINT32 firstRow = rect.top <= 0.0f ? 0 : static_cast<UINT32>(std::ceil(rect.top / CELL_SIZE));
+		const UINT32 endColumn = rect.right >= width ? m_columns : static_cast<UINT32>((std::max)(std::floor(rect.right / CELL_SIZE), 0.0f));
+		const UINT32 endRow = rect.bottom >= height ? m_rows : static_cast<UINT32>((std::max)(std::floor(rect.bottom / CELL_SIZE), 0.0f));
+		if (firstColumn >= endColumn || firstRow >= endRow) return;
+
+		for (UINT32 row = firstRow; row < endRow; row++)
+		{
+			UINT64* words = m_mask.data() + static_cast<size_t>(row) * m_wordsPerRow;
+			for (UINT32 column = firstColumn; column < endColumn; column = (column | 63) + 1)
+			{
+				const UINT32 end = (std::min)(endColumn, (column | 63) + 1);
+				words[column >> 6] |= bitRange(column & 63, end - (column & ~63u));
+			}
+		}
+	}
+
+	bool OcclusionCuller::isCovered(_In_ LONG left, _In_ LONG top, _In_ LONG right, _In_ LONG bottom) const noexcept
+	{
+		const UINT32 firstColumn = static_cast<UINT32>(left) / CELL_SIZE;
+		const UINT32 firstRow = static_cast<UINT32>(top) / CELL_SIZE;
+		const UINT32 endColumn = static_cast<UINT32>(right - 1) / CELL_SIZE + 1;
+		const UINT32 endRow = static_cast<UINT32>(bottom - 1) / CELL_SIZE + 1;
+
+		for (UINT32 row = firstRow; row < endRow; row++)
+		{
+			const UINT64* words = m_mask.data() + static_cast<size_t>(row) * m_wordsPerRow;
+			for (UINT32 column = firstColumn; column < endColumn; column = (column | 63) + 1)
+			{
+				const UINT32 end = (std::min)(endColumn, (column | 63) + 1);
+				const UINT64 bits = bitRange(column & 63, end - (column & ~63u));
+				if ((words[column >> 6] & bits) != bits) return false;
+			}
+		}
+		return true;
+	}
+
+	void OcclusionCuller::cull(_Inout_ CommandBuffer& commands, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ const LayerCache* cache)
+	{
+		PROFILE_ZONE("OcclusionCuller::cull");
+		const auto begin = std::chrono::steady_clock::now();
+
+		m_stats = {};
+		m_culledBitmaps.clear();
+		m_stats.screenPixels = static_cast<double>(width) * height;
+		m_columns = (width + CELL_SIZE - 1) / CELL_SIZE;
+		m_rows = (height + CELL_SIZE - 1) / CELL_SIZE;
+		m_wordsPerRow = (m_columns + 63) / 64;
+		m_mask.assign(static_cast<size_t>(m_rows) * m_wordsPerRow, 0);
+
+		// Front to back: the highest layer first, and in each layer the last command recorded first.
+		for (auto it = commands.getLayers().rbegin(); it != commands.getLayers().rend(); it++)
+		{
+			CommandList& list = it->second;
+			const std::vector<Command>& all = list.getCommands();
+			const std::vector<Occluder>& occluders = list.getOccluders();
+			const bool isCached = cache != nullptr && cache->isLayerCached(it->first);
+
+			m_stats.commandCount += all.size();
+			m_stats.occluderCount += occluders.size();
+			m_removed.assign(all.size(), 0);
+			size_t removedCount = 0;
+
+			size_t next = occluders.size(); // The occluders [0, next) are not in the mask yet.
+			for (size_t i = all.size(); i-- > 0;)
+			{
+				// The opaque commands drawn after this one hide it.
+				for (; next > 0 && occluders[next - 1].position > i; next--)
+					if (m_isEnabled) cover(occluders[next - 1].rect);
+
+				// The pixels the command may touch, with a margin for the filtering of scaled bitmaps.
+				const D2D1_RECT_F& destination = all[i].destination;
+				const LONG left = (std::max)(static_cast<LONG>(std::floor(destination.left)) - 1, 0L);
+				const LONG top = (std::max)(static_cast<LONG>(std::floor(destination.top)) - 1, 0L);
+				const LONG right = (std::min)(static_cast<LONG>(std::ceil(destination.right)) + 1, static_cast<LONG>(width));
+				const LONG bottom = (std::min)(static_cast<LONG>(std::ceil(destination.bottom)) + 1, static_cast<LONG>(height));
+				const bool isOnScreen = left < right && top < bottom;
+				const double area = isOnScreen ? static_cast<double>(right - left) * static_cast<double>(bottom - top) : 0.0;
+				m_stats.recordedPixels += area;
+
+				if (m_isEnabled && !isCached && (!isOnScreen || isCovered(left, top, right, bottom)))
+				{
+					m_removed[i] = 1;
+					removedCount++;
+					if (usesBitmap(all[i])) m_culledBitmaps.push_back(all[i].resource);
+				}
+				else
+				{
+					m_stats.drawnPixels += area;
+				}
+			}
+
+			// The first command's occluders only hide the lower layers.
+			for (; next > 0; next--)
+				if (m_isEnabled) cover(occluders[next - 1].rect);
+
+			if (removedCount > 0)
+			{
+				list.removeCommands(m_removed);
+				m_stats.culledCount += removedCount;
+			}
+		}
+
+		m_stats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+} // namespace Render
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include <d2d1.h>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	class LayerCache;
+
+	/**
+	 * @brief Counters of the last culled frame.
+	 *
+	 * @note The pixels written are the areas of the commands on screen, transparent pixels included.
+	 */
+	struct OcclusionStats
+	{
+		size_t commandCount = 0;		// Commands recorded.
+		size_t culledCount = 0;			// Commands removed: hidden or off screen.
+		size_t occluderCount = 0;
+		double screenPixels = 0.0;
+		double recordedPixels = 0.0;	// Written by the commands recorded.
+		double drawnPixels = 0.0;		// Written by the commands kept.
+		double cullMs = 0.0;
+
+		inline double getOverdraw() const noexcept { return screenPixels == 0.0 ? 0.0 : drawnPixels / screenPixels; }
+		inline double getOverdrawWithoutCulling() const noexcept { return screenPixels == 0.0 ? 0.0 : recordedPixels / screenPixels; }
+	};
+
+
+	/**
+	 * @brief Remove the commands hidden behind opaque occluders of the layers above them.
+	 *
+	 * @note The commands are visited front to back, while the occluders fill a coverage mask of 8x8 pixel cells.
+	 *       An occluder only covers the cells it fully contains, and a command is removed only if every cell it
+	 *       may touch is covered: the culling is conservative, the frame drawn stays the same.
+	 *       The commands of cached layers are kept, removing them would rebuild the cache whenever an occluder moves.
+	 *       Their occluders still hide the lower layers.
+	 */
+	class OcclusionCuller
+	{
+	private:
+		static constexpr UINT32 CELL_SIZE = 8;
+
+		std::vector<UINT64> m_mask;		// A bit per covered cell, row by row.
+		std::vector<BYTE> m_removed;	// Reused between layers.
+		std::vector<ResourceId> m_culledBitmaps;
+		UINT32 m_columns = 0;
+		UINT32 m_rows = 0;
+		UINT32 m_wordsPerRow = 0;
+		bool m_isEnabled = false;
+
+		OcclusionStats m_stats;
+
+		void cover(_In_ const D2D1_RECT_F& rect) noexcept;
+		bool isCovered(_In_ LONG left, _In_ LONG top, _In_ LONG right, _In_ LONG bottom) const noexcept;
+
+	public:
+		OcclusionCuller() = default;
+		OcclusionCuller(OcclusionCuller&) = delete;
+		OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+		inline void setEnabled(_In_ bool enable) noexcept { m_isEnabled = enable; }
+		inline bool isEnabled() const noexcept { return m_isEnabled; }
+
+		/**
+		 * @brief Remove the hidden and off screen commands of a frame, if enabled.
+		 * @note  Must be called after recording and before uploading or executing the commands.
+		 *
+		 * @param[in] commands	The commands of the frame.
+		 * @param[in] width		The width of the area drawn, in pixels.
+		 * @param[in] height	The height of the area drawn, in pixels.
+		 * @param[in] cache		The layer cache of the backend, whose cached layers are kept whole.
+		 */
+		void cull(_Inout_ CommandBuffer& commands, _In_ UINT32 width, _In_ UINT32 height, _In_opt_ const LayerCache* cache = nullptr);
+
+		inline const OcclusionStats& getStats() const noexcept { return m_stats; }
+
+		/**
+		 * @brief Return the bitmaps of the commands removed by the last cull: not worth uploading for this frame.
+		 * @note  A bitmap may be listed more than once, and also be drawn by a command kept.
+		 */
+		inline const std::vector<ResourceId>& getCulledBitmaps() const noexcept { return m_culledBitmaps; }
+	};
+
+} // namespace Render
+
+#endif // OCCLUSION_CULLER_H
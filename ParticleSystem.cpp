@@ -0,0 +1,335 @@
+#include "ParticleSystem.h"
+
+#include <emmintrin.h> // SSE2
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Profiler.h"
+#include "Replay.h"
+#include "WindowClass.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	static_assert(sizeof(Render::Sprite) == 4 * sizeof(float), "The sprites are written as rows of 4 floats.");
+
+	constexpr UINT32 DEFAULT_SPRITE_SIZE = 16;
+
+	/**
+	 * @brief Return a channel of a 0xAARRGGBB color, as a float.
+	 */
+	inline float getChannel(_In_ UINT32 argb, _In_ UINT32 shift) noexcept
+	{
+		return static_cast<float>((argb >> shift) & 0xFF);
+	}
+
+	/**
+	 * @brief Write the sprites of the particles [begin, end) and return their bounds.
+	 *
+	 * @note Four particles at a time: the four arrays of left, top, size and color are transposed
+	 *       into four sprites. The color channels are interpolated as floats, rounded and packed.
+	 */
+	D2D1_RECT_F packSprites(_In_ size_t begin, _In_ size_t end, _In_ const float* __restrict x, _In_ const float* __restrict y, _In_ const float* __restrict age,
+		_In_ const D2D1_POINT_2F& origin, _In_ const D2D1_SIZE_F& scale, _In_ float startSize, _In_ float endSize, _In_ UINT32 startColor, _In_ UINT32 endColor,
+		_Out_ Render::Sprite* __restrict sprites) noexcept
+	{
+		const float sizeScale = scale.width;
+		const __m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y);
+		const __m128 scaleX = _mm_set1_ps(scale.width), scaleY = _mm_set1_ps(scale.height);
+		const __m128 size0 = _mm_set1_ps(startSize * sizeScale), sizeDelta = _mm_set1_ps((endSize - startSize) * sizeScale);
+		const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+
+		__m128 channel0[4], channelDelta[4];
+		for (UINT32 c = 0; c < 4; c++)
+		{
+			channel0[c] = _mm_set1_ps(getChannel(startColor, c * 8));
+			channelDelta[c] = _mm_set1_ps(getChannel(endColor, c * 8) - getChannel(startColor, c * 8));
+		}
+
+		__m128 minX = _mm_set1_ps((std::numeric_limits<float>::max)()), minY = minX;
+		__m128 maxX = _mm_set1_ps(std::numeric_limits<float>::lowest()), maxY = maxX;
+
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 t = _mm_loadu_ps(age + i);
+			__m128 size = _mm_max_ps(_mm_add_ps(size0, _mm_mul_ps(t, sizeDelta)), zero);
+			const __m128 offset = _mm_mul_ps(size, half);
+			__m128 left = _mm_sub_ps(_mm_add_ps(originX, _mm_mul_ps(_mm_loadu_ps(x + i), scaleX)), offset);
+			__m128 top = _mm_sub_ps(_mm_add_ps(originY, _mm_mul_ps(_mm_loadu_ps(y + i), scaleY)), offset);
+
+			// b, g, r and a, each rounded to the nearest integer, in the bytes of 0xAARRGGBB.
+			__m128i color = _mm_cvtps_epi32(_mm_add_ps(channel0[0], _mm_mul_ps(t, channelDelta[0])));
+			for (UINT32 c = 1; c < 4; c++)
+			{
+				const __m128i channel = _mm_cvtps_epi32(_mm_add_ps(channel0[c], _mm_mul_ps(t, channelDelta[c])));
+				color = _mm_or_si128(color, _mm_slli_epi32(channel, static_cast<int>(c * 8)));
+			}
+
+			minX = _mm_min_ps(minX, left);
+			minY = _mm_min_ps(minY, top);
+			maxX = _mm_max_ps(maxX, _mm_add_ps(left, size));
+			maxY = _mm_max_ps(maxY, _mm_add_ps(top, size));
+
+			__m128 packed = _mm_castsi128_ps(color);
+			_MM_TRANSPOSE4_PS(left, top, size, packed);
+			float* out = reinterpret_cast<float*>(sprites + i);
+			_mm_storeu_ps(out, left);
+			_mm_storeu_ps(out + 4, top);
+			_mm_storeu_ps(out + 8, size);
+			_mm_storeu_ps(out + 12, packed);
+		}
+
+		alignas(16) float lanes[4][4];
+		_mm_store_ps(lanes[0], minX);
+		_mm_store_ps(lanes[1], minY);
+		_mm_store_ps(lanes[2], maxX);
+		_mm_store_ps(lanes[3], maxY);
+		D2D1_RECT_F bounds = {
+			(std::min)((std::min)(lanes[0][0], lanes[0][1]), (std::min)(lanes[0][2], lanes[0][3])),
+			(std::min)((std::min)(lanes[1][0], lanes[1][1]), (std::min)(lanes[1][2], lanes[1][3])),
+			(std::max)((std::max)(lanes[2][0], lanes[2][1]), (std::max)(lanes[2][2], lanes[2][3])),
+			(std::max)((std::max)(lanes[3][0], lanes[3][1]), (std::max)(lanes[3][2], lanes[3][3]))
+		};
+
+		for (; i < end; i++)
+		{
+			const float t = age[i];
+			const float size = (std::max)(startSize * sizeScale + t * (endSize - startSize) * sizeScale, 0.0f);
+			Render::Sprite& sprite = sprites[i];
+			sprite.left = origin.x + x[i] * scale.width - size * 0.5f;
+			sprite.top = origin.y + y[i] * scale.height - size * 0.5f;
+			sprite.size = size;
+			sprite.color = 0;
+			for (UINT32 c = 0; c < 4; c++)
+			{
+				const float channel = getChannel(startColor, c * 8) + t * (getChannel(endColor, c * 8) - getChannel(startColor, c * 8));
+				sprite.color |= static_cast<UINT32>(std::lround(channel)) << (c * 8);
+			}
+
+			bounds.left = (std::min)(bounds.left, sprite.left);
+			bounds.top = (std::min)(bounds.top, sprite.top);
+			bounds.right = (std::max)(bounds.right, sprite.left + size);
+			bounds.bottom = (std::max)(bounds.bottom, sprite.top + size);
+		}
+		return bounds;
+	}
+
+
+
+	/************************/
+	/*	  ParticleSystem	*/
+	/************************/
+
+
+	ParticleSystem::ParticleSystem(_In_ const D2D1_POINT_2F& pos, _In_opt_ size_t capacity)
+		:m_capacity(0)
+	{
+		__super::setPos(pos);
+		setCapacity(capacity);
+
+		// A soft disc: full coverage at the center, fading to nothing at the edge.
+		m_spriteWidth = m_spriteHeight = DEFAULT_SPRITE_SIZE;
+		m_sprite.assign(static_cast<size_t>(DEFAULT_SPRITE_SIZE) * DEFAULT_SPRITE_SIZE, Pixel(0x00, 0x00));
+		const float radius = DEFAULT_SPRITE_SIZE * 0.5f;
+		for (UINT32 row = 0; row < DEFAULT_SPRITE_SIZE; row++)
+			for (UINT32 column = 0; column < DEFAULT_SPRITE_SIZE; column++)
+			{
+				const float dx = (static_cast<float>(column) + 0.5f - radius) / radius;
+				const float dy = (static_cast<float>(row) + 0.5f - radius) / radius;
+				const float d = (std::min)(std::sqrt(dx * dx + dy * dy), 1.0f);
+				const float coverage = 1.0f - d * d * (3.0f - 2.0f * d);
+				const BYTE alpha = static_cast<BYTE>(std::lround(coverage * 255.0f));
+				m_sprite[static_cast<size_t>(row) * DEFAULT_SPRITE_SIZE + column] = Pixel(alpha, alpha);
+			}
+	}
+
+	/**** Methods ****/
+
+	bool ParticleSystem::initialize(void* window) noexcept
+	{
+		if (!__super::initialize(window)) return false;
+
+		if (m_resource == Render::INVALID_RESOURCE)
+			m_resource = reinterpret_cast<BaseWindow*>(window)->getResources().registerBitmap(m_sprite.data(), m_spriteWidth, m_spriteHeight);
+		m_lastUpdate = Replay::now();
+		return true;
+	}
+
+	void ParticleSystem::setAutoUpdate(_In_ bool enable) noexcept
+	{
+		// The time spent without automatic updates is not simulated when they resume.
+		if (enable && !m_isAutoUpdate) m_lastUpdate = Replay::now();
+		m_isAutoUpdate = enable;
+	}
+
+	void ParticleSystem::setCapacity(_In_ size_t capacity)
+	{
+		m_x.resize(capacity);
+		m_y.resize(capacity);
+		m_velocityX.resize(capacity);
+		m_velocityY.resize(capacity);
+		m_age.resize(capacity);
+		m_invLife.resize(capacity);
+		m_capacity = capacity;
+		m_count = (std::min)(m_count, capacity);
+	}
+
+	size_t ParticleSystem::addEmitter(_In_ const ParticleEmitter& emitter)
+	{
+		m_emitters.push_back(emitter);
+		m_pending.push_back(0.0f);
+		return m_emitters.size() - 1;
+	}
+
+	void ParticleSystem::burst(_In_ size_t index, _In_ size_t count)
+	{
+		const ParticleEmitter& emitter = m_emitters[index];
+		const size_t end = (std::min)(m_count + count, m_capacity);
+
+		for (size_t i = m_count; i < end; i++)
+		{
+			const float angle = emitter.direction + (random() - 0.5f) * emitter.spread;
+			const float speed = emitter.minSpeed + random() * (emitter.maxSpeed - emitter.minSpeed);
+			const float life = emitter.minLife + random() * (emitter.maxLife - emitter.minLife);
+
+			m_x[i] = emitter.position.x + random() * emitter.area.width;
+			m_y[i] = emitter.position.y + random() * emitter.area.height;
+			m_velocityX[i] = std::cos(angle) * speed;
+			m_velocityY[i] = std::sin(angle) * speed;
+			m_age[i] = 0.0f;
+			m_invLife[i] = 1.0f / (std::max)(life, 1e-3f);
+		}
+		m_count = end;
+	}
+
+	void ParticleSystem::emit(_In_ float seconds)
+	{
+		for (size_t e = 0; e < m_emitters.size(); e++)
+		{
+			if (!m_emitters[e].isActive) continue;
+
+			// The fraction left is spawned by the next updates, so low rates at high frame rates still emit.
+			m_pending[e] += m_emitters[e].rate * seconds;
+			const float whole = std::floor(m_pending[e]);
+			m_pending[e] -= whole;
+			if (whole >= 1.0f) burst(e, static_cast<size_t>(whole));
+		}
+	}
+
+	void ParticleSystem::removeDead() noexcept
+	{
+		// The last live particle takes the place of each dead one: the order is not kept.
+		size_t i = 0;
+		while (i < m_count)
+		{
+			if (m_age[i] < 1.0f)
+			{
+				i++;
+				continue;
+			}
+			const size_t last = --m_count;
+			m_x[i] = m_x[last];
+			m_y[i] = m_y[last];
+			m_velocityX[i] = m_velocityX[last];
+			m_velocityY[i] = m_velocityY[last];
+			m_age[i] = m_age[last];
+			m_invLife[i] = m_invLife[last];
+		}
+	}
+
+	void ParticleSystem::update(_In_ float seconds)
+	{
+		PROFILE_ZONE("ParticleSystem::update");
+		if (seconds <= 0.0f) return;
+
+		float* __restrict x = m_x.data();
+		float* __restrict y = m_y.data();
+		float* __restrict velocityX = m_velocityX.data();
+		float* __restrict velocityY = m_velocityY.data();
+		float* __restrict age = m_age.data();
+		const float* __restrict invLife = m_invLife.data();
+		const float gravityX = m_gravity.x * seconds, gravityY = m_gravity.y * seconds;
+
+		forEachChunk([=](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) velocityX[i] += gravityX;
+			for (size_t i = begin; i < end; i++) velocityY[i] += gravityY;
+			for (size_t i = begin; i < end; i++) x[i] += velocityX[i] * seconds;
+			for (size_t i = begin; i < end; i++) y[i] += velocityY[i] * seconds;
+			for (size_t i = begin; i < end; i++) age[i] += invLife[i] * seconds;
+		});
+
+		removeDead();
+		emit(seconds);
+	}
+
+	void ParticleSystem::record(_Inout_ Render::CommandList& commands)
+	{
+		if (m_isAutoUpdate)
+		{
+			const ticker::time_point now = Replay::now();
+			const float elapsed = std::chrono::duration<float>(now - m_lastUpdate).count();
+			m_lastUpdate = now;
+			update((std::min)(elapsed, MAX_STEP));
+		}
+		if (m_count == 0 || m_resource == Render::INVALID_RESOURCE) return;
+
+		PROFILE_ZONE("ParticleSystem::record");
+		const D2D1_POINT_2F origin = getWorldPos();
+		const D2D1_SIZE_F scale = getWorldScale();
+		Render::Sprite* sprites = commands.drawSprites(m_resource, D2D1::RectF(), m_count, m_opacity);
+
+		const float* x = m_x.data();
+		const float* y = m_y.data();
+		const float* age = m_age.data();
+		m_chunkBounds.resize(getChunkCount());
+		D2D1_RECT_F* chunkBounds = m_chunkBounds.data();
+
+		forEachChunk([&, x, y, age, sprites, chunkBounds](size_t chunk, size_t begin, size_t end) {
+			chunkBounds[chunk] = packSprites(begin, end, x, y, age, origin, scale, m_startSize, m_endSize, m_startColor, m_endColor, sprites);
+		});
+
+		D2D1_RECT_F bounds = m_chunkBounds.front();
+		for (const D2D1_RECT_F& chunk : m_chunkBounds)
+		{
+			bounds.left = (std::min)(bounds.left, chunk.left);
+			bounds.top = (std::min)(bounds.top, chunk.top);
+			bounds.right = (std::max)(bounds.right, chunk.right);
+			bounds.bottom = (std::max)(bounds.bottom, chunk.bottom);
+		}
+		commands.setSpritesBounds(bounds);
+	}
+
+	void ParticleSystem::reconstruct() noexcept
+	{
+		// The device bitmap of the sprite is owned by the window's resource table.
+	}
+
+	void ParticleSystem::setSprite(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		// Only the alpha is used: made white, the sprite batches tint it as FillOpacityMask would.
+		m_sprite.clear();
+		for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+			m_sprite.emplace_back(pixels[i].a, pixels[i].a);
+		m_spriteWidth = width;
+		m_spriteHeight = height;
+		if (m_window && m_resource != Render::INVALID_RESOURCE)
+			reinterpret_cast<BaseWindow*>(m_window)->getResources().updateBitmap(m_resource, m_sprite.data(), m_spriteWidth, m_spriteHeight);
+	}
+
+	void ParticleSystem::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
+	}
+
+	ParticleSystem::~ParticleSystem()
+	{
+		if (m_window && m_resource != Render::INVALID_RESOURCE)
+			reinterpret_cast<BaseWindow*>(m_window)->getResources().unregisterBitmap(m_resource);
+	}
+
+} // namespace Graphics
@@ -0,0 +1,228 @@
+#pragma once
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+#include "ThreadPool.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	/**
+	 * @brief Where and how a particle system spawns its particles.
+	 *
+	 * @note Positions are relative to the particle system. Angles are in radians, 0 towards +x and pi / 2 towards +y (down).
+	 */
+	struct ParticleEmitter
+	{
+		D2D1_POINT_2F position = { 0.0f, 0.0f };	// Top left corner of the spawning area.
+		D2D1_SIZE_F area = { 0.0f, 0.0f };			// The particles spawn at random in it, at the position when empty.
+		float rate = 100.0f;						// Particles per second.
+		float minLife = 1.0f;						// Seconds.
+		float maxLife = 2.0f;
+		float minSpeed = 50.0f;						// Pixels per second.
+		float maxSpeed = 100.0f;
+		float direction = -1.5707964f;				// Of the initial velocity: up.
+		float spread = 6.2831855f;					// Full angle around the direction: all around.
+		bool isActive = true;
+	};
+
+
+	/**
+	 * @brief Class for a particle system component: up to a million particles drawn with a single command.
+	 *
+	 * @note The particles are kept in structure of arrays: the update is a few plain loops over floats, without
+	 *       branches, that the compiler vectorizes, split in chunks over a thread pool if one is given.
+	 *       Each particle is drawn as a square of the shared sprite, whose alpha is the coverage, filled with
+	 *       the color interpolated over its life. The particles are relative to the component's position.
+	 */
+	class ParticleSystem : public DrawableComponent
+	{
+	private:
+		typedef std::chrono::steady_clock ticker;
+
+		static constexpr float MAX_STEP = 0.1f; // Seconds simulated at most by a single automatic update.
+		static constexpr size_t CHUNK_SIZE = 1 << 14; // Particles per parallel task.
+
+		// The live particles are [0, m_count), the storage is allocated for the capacity.
+		std::vector<float> m_x;
+		std::vector<float> m_y;
+		std::vector<float> m_velocityX;
+		std::vector<float> m_velocityY;
+		std::vector<float> m_age;		// From 0 at birth to 1 at death.
+		std::vector<float> m_invLife;	// 1 / lifetime in seconds.
+		size_t m_count = 0;
+		size_t m_capacity;
+
+		std::vector<ParticleEmitter> m_emitters;
+		std::vector<float> m_pending; // Fraction of a particle left to spawn by each emitter.
+		UINT32 m_random = 0x9E3779B9;
+
+		D2D1_POINT_2F m_gravity = { 0.0f, 0.0f };
+		UINT32 m_startColor = 0xFFFFFFFF;
+		UINT32 m_endColor = 0x00FFFFFF;
+		float m_startSize = 4.0f;
+		float m_endSize = 4.0f;
+		float m_opacity = 1.0f;
+
+		std::vector<Pixel> m_sprite;
+		UINT32 m_spriteWidth = 0;
+		UINT32 m_spriteHeight = 0;
+		Render::ResourceId m_resource = Render::INVALID_RESOURCE;
+
+		ThreadPool* m_pPool = nullptr;
+		bool m_isAutoUpdate = true;
+		ticker::time_point m_lastUpdate;
+
+		std::vector<D2D1_RECT_F> m_chunkBounds; // Reused between frames.
+
+		inline float random() noexcept
+		{
+			// xorshift32, to the [0, 1) range.
+			m_random ^= m_random << 13;
+			m_random ^= m_random >> 17;
+			m_random ^= m_random << 5;
+			return static_cast<float>(m_random >> 8) * (1.0f / 16777216.0f);
+		}
+
+		void emit(_In_ float seconds);
+		void removeDead() noexcept;
+
+		inline size_t getChunkCount() const noexcept { return (m_count + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+		/**
+		 * @brief Call function(chunk, begin, end) on the chunks of the live particles, in parallel if there is a pool.
+		 */
+		template <class F>
+		void forEachChunk(_In_ F&& function)
+		{
+			const size_t count = m_count;
+			if (m_pPool == nullptr)
+			{
+				for (size_t chunk = 0; chunk < getChunkCount(); chunk++)
+					function(chunk, chunk * CHUNK_SIZE, (std::min)(count, (chunk + 1) * CHUNK_SIZE));
+				return;
+			}
+			m_pPool->parallelFor(getChunkCount(), [&function, count](size_t chunk) {
+				function(chunk, chunk * CHUNK_SIZE, (std::min)(count, (chunk + 1) * CHUNK_SIZE));
+			});
+		}
+
+	public:
+		/**
+		 * @brief Constructor for a particle system.
+		 *
+		 * @param[in] pos		The position of the system, in client dependent pixel. The particles are relative to it.
+		 * @param[in] capacity	The maximum number of live particles: the emitters wait while it is reached.
+		 */
+		ParticleSystem(_In_ const D2D1_POINT_2F& pos, _In_opt_ size_t capacity = 65536);
+
+		ParticleSystem(ParticleSystem&) = delete;
+		ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
+		void reconstruct() noexcept override;
+
+		/**
+		 * @brief Move the particles, age them and remove the dead ones, then spawn the new ones.
+		 *
+		 * @param[in] seconds The time to simulate.
+		 */
+		void update(_In_ float seconds);
+
+		/**
+		 * @brief Update the system when it is recorded, with the time elapsed since the last update, MAX_STEP at most.
+		 *
+		 * @note Enabled by default. Disable it to call update yourself, at a fixed step for instance.
+		 */
+		void setAutoUpdate(_In_ bool enable) noexcept;
+		inline bool isAutoUpdate() const noexcept { return m_isAutoUpdate; }
+
+		/**
+		 * @brief Update and record the particles on a thread pool, nullptr to do it on the calling thread.
+		 *
+		 * @note The pool must outlive the system, or be reset before it is destroyed.
+		 */
+		inline void setThreadPool(_In_opt_ ThreadPool* pool) noexcept { m_pPool = pool; }
+
+		/**
+		 * @brief Add an emitter.
+		 *
+		 * @retval size_t
+		 * @return Its index, for getEmitter.
+		 */
+		size_t addEmitter(_In_ const ParticleEmitter& emitter);
+		inline ParticleEmitter& getEmitter(_In_ size_t index) noexcept { return m_emitters[index]; }
+		inline size_t getEmitterCount() const noexcept { return m_emitters.size(); }
+
+		/**
+		 * @brief Spawn particles from an emitter at once, whether it is active or not.
+		 *
+		 * @param[in] index	The emitter.
+		 * @param[in] count	The number of particles, fewer if the capacity is reached.
+		 */
+		void burst(_In_ size_t index, _In_ size_t count);
+
+		/**
+		 * @brief Remove all the live particles.
+		 */
+		inline void clear() noexcept { m_count = 0; }
+
+		/**
+		 * @brief Set the maximum number of live particles, the particles over it are removed.
+		 */
+		void setCapacity(_In_ size_t capacity);
+		inline size_t getCapacity() const noexcept { return m_capacity; }
+		inline size_t getCount() const noexcept { return m_count; }
+
+		/**
+		 * @brief Set the acceleration of every particle, in pixels per second squared.
+		 */
+		inline void setGravity(_In_ const D2D1_POINT_2F& gravity) noexcept { m_gravity = gravity; }
+		inline const D2D1_POINT_2F& getGravity() const noexcept { return m_gravity; }
+
+		/**
+		 * @brief Set the color of the particles at birth and at death, as 0xAARRGGBB, interpolated in between.
+		 */
+		inline void setColorOverLife(_In_ UINT32 start, _In_ UINT32 end) noexcept { m_startColor = start; m_endColor = end; }
+
+		/**
+		 * @brief Set the size of the particles at birth and at death, in unscaled pixels, interpolated in between.
+		 */
+		inline void setSizeOverLife(_In_ float start, _In_ float end) noexcept { m_startSize = start; m_endSize = end; }
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		/**
+		 * @brief Replace the sprite drawn for each particle. Only its alpha is used.
+		 *
+		 * @note The default sprite is a soft disc.
+		 *
+		 * @param[in] pixels	The width * height premultiplied B8G8R8A8 pixels, copied.
+		 * @param[in] width		The sprite width in pixels.
+		 * @param[in] height	The sprite height in pixels.
+		 */
+		void setSprite(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
+
+		~ParticleSystem();
+	};
+
+} // namespace Graphics
+
+#endif // PARTICLE_SYSTEM_H
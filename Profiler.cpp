@@ -0,0 +1,155 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <windows.h>
+
+
+namespace Profiler
+{
+
+	constexpr UINT64 BUFFER_CAPACITY = 1 << 16; // Zones kept per thread, must be a power of two.
+
+	struct ThreadBuffer
+	{
+		DWORD threadId = 0;
+		std::atomic<UINT64> head = 0; // Number of zones ever written.
+		ZoneEvent zones[BUFFER_CAPACITY];
+	};
+
+	std::atomic<bool> isCapturing = false;
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry; // Buffers are kept until the end of the process.
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+
+	// The capture is started by the main thread, and its frames marked by the render thread.
+	std::mutex captureMutex;
+	TICKS captureBegin = 0;
+	TICKS captureEnd = 0;
+	ticker::time_point captureBeginTime;	// Used to convert the ticks to time.
+	ticker::time_point captureEndTime;
+	TICKS frameBegin = 0;
+	unsigned int remainingFrames = 0;
+
+
+	ThreadBuffer* registerThread()
+	{
+		std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+		buffer->threadId = GetCurrentThreadId();
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.push_back(std::move(buffer));
+		return registry.back().get();
+	}
+
+	void pushZone(_In_ const ZoneEvent& zone) noexcept
+	{
+		if (threadBuffer == nullptr)
+		{
+			try { threadBuffer = registerThread(); }
+			catch (...) { return; }
+		}
+
+		const UINT64 head = threadBuffer->head.load(std::memory_order_relaxed);
+		threadBuffer->zones[head & (BUFFER_CAPACITY - 1)] = zone;
+		threadBuffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	void beginCapture(_In_ unsigned int frameCount) noexcept
+	{
+		if (frameCount == 0) return;
+
+		std::lock_guard<std::mutex> lock(captureMutex);
+		const TICKS begin = now();
+		captureBeginTime = ticker::now();
+		captureBegin = begin;
+		captureEnd = (std::numeric_limits<TICKS>::max)();
+		frameBegin = begin;
+		remainingFrames = frameCount;
+		isCapturing = true;
+	}
+
+	void markFrame() noexcept
+	{
+		if (!isCapturing.load(std::memory_order_relaxed)) return;
+
+		std::lock_guard<std::mutex> lock(captureMutex);
+		if (!isCapturing) return; // Ended by another thread meanwhile.
+		const TICKS end = now();
+		pushZone({ "Frame", frameBegin, end });
+		frameBegin = end;
+
+		if (--remainingFrames == 0)
+		{
+			captureEndTime = ticker::now();
+			captureEnd = end;
+			isCapturing = false;
+		}
+	}
+
+	void writeEscaped(_Inout_ std::ofstream& file, _In_ const char* text)
+	{
+		for (; *text; text++)
+		{
+			if (*text == '"' || *text == '\\') file << '\\';
+			file << *text;
+		}
+	}
+
+	bool exportChromeTrace(_In_ const wchar_t* path)
+	{
+		TICKS begin, end;
+		double captureMicroseconds;
+		{
+			std::lock_guard<std::mutex> lock(captureMutex);
+			begin = captureBegin;
+			end = captureEnd;
+			captureMicroseconds = std::chrono::duration<double, std::micro>(captureEndTime - captureBeginTime).count();
+		}
+
+		// Checked before opening: opening truncates an existing trace.
+		if (isCapturing || end <= begin) return false;
+
+		std::ofstream file{ std::filesystem::path(path) };
+		if (!file) return false;
+
+		const double microsecondsPerTick = captureMicroseconds / static_cast<double>(end - begin);
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool isFirst = true;
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : registry)
+		{
+			const UINT64 head = buffer->head.load(std::memory_order_acquire);
+			const UINT64 first = head > BUFFER_CAPACITY ? head - BUFFER_CAPACITY : 0;
+
+			for (UINT64 i = first; i < head; i++)
+			{
+				const ZoneEvent& zone = buffer->zones[i & (BUFFER_CAPACITY - 1)];
+				if (zone.begin < begin || zone.end > end) continue;
+
+				file << (isFirst ? "\n" : ",\n") << "{\"name\":\"";
+				writeEscaped(file, zone.name);
+				file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"ts\":" << static_cast<double>(zone.begin - begin) * microsecondsPerTick
+					<< ",\"dur\":" << static_cast<double>(zone.end - zone.begin) * microsecondsPerTick << "}";
+				isFirst = false;
+			}
+		}
+
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+} // namespace Profiler
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Windows.h>
+
+#include <intrin.h> // __rdtsc
+
+#include <atomic>
+#include <chrono>
+
+
+/**
+ * Scoped zones are compiled only when ENABLE_PROFILER is defined: otherwise the macros expand to nothing.
+ *
+ * PROFILE_ZONE(name)	Measure the enclosing scope. name must outlive the capture (a literal, typeid(x).name()...).
+ * PROFILE_FRAME()		Mark the end of a frame.
+ */
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::markFrame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+#endif
+
+
+namespace Profiler
+{
+	typedef std::chrono::steady_clock ticker;
+	typedef long long TICKS;
+
+	/**
+	 * @brief A measured zone.
+	 */
+	struct ZoneEvent
+	{
+		const char* name;
+		TICKS begin;
+		TICKS end;
+	};
+
+	extern std::atomic<bool> isCapturing;
+
+	/**
+	 * @brief Append a zone to the calling thread's ring buffer.
+	 *
+	 * @note Lock free: each thread only writes in its own buffer. The oldest zones are overwritten when full.
+	 */
+	void pushZone(_In_ const ZoneEvent& zone) noexcept;
+
+	/**
+	 * @brief Read the time stamp counter, converted to time when exporting.
+	 */
+	inline TICKS now() noexcept { return static_cast<TICKS>(__rdtsc()); }
+
+	/**
+	 * @brief Measure the scope it is declared in, while a capture is running.
+	 */
+	class Zone
+	{
+	private:
+		const char* m_name;
+		TICKS m_begin;
+
+	public:
+		inline explicit Zone(_In_ const char* name) noexcept
+			:m_name(isCapturing.load(std::memory_order_relaxed) ? name : nullptr), m_begin(m_name ? now() : 0)
+		{}
+
+		inline ~Zone()
+		{
+			if (m_name) pushZone({ m_name, m_begin, now() });
+		}
+
+		Zone(Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+
+	/**
+	 * @brief Start capturing the zones of the next frames.
+	 *
+	 * @note The zones of the previous capture are discarded. May be called while another thread marks the frames.
+	 *
+	 * @param[in] frameCount The number of frames to capture.
+	 */
+	void beginCapture(_In_ unsigned int frameCount) noexcept;
+
+	/**
+	 * @brief Mark the end of a frame, ending the capture after the requested number of frames.
+	 */
+	void markFrame() noexcept;
+
+	/**
+	 * @brief Export the zones of the last capture in the Chrome trace event format, also read by Perfetto.
+	 *
+	 * @note Must be called once the capture is over, isCapturing is then false.
+	 *
+	 * @param[in] path The output json file.
+	 *
+	 * @retval bool
+	 * @return True if the file has been written, false otherwise: the file is left untouched if there is no finished capture.
+	 */
+	bool exportChromeTrace(_In_ const wchar_t* path);
+
+} // namespace Profiler
+
+#endif // PROFILER_H
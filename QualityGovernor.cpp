@@ -0,0 +1,127 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+
+#include "fctdef.h"
+
+
+namespace Render
+{
+	QualityGovernor::QualityGovernor()
+		:m_levels(getDefaultLevels()), m_samples(m_thresholds.sampleCount, 0.0)
+	{}
+
+	std::vector<QualitySettings> QualityGovernor::getDefaultLevels()
+	{
+		constexpr D2D1_BITMAP_INTERPOLATION_MODE LINEAR = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
+		constexpr D2D1_BITMAP_INTERPOLATION_MODE NEAREST = D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR;
+		return {
+			{ 1.0f,  LINEAR,  0, 1, false },
+			{ 1.0f,  LINEAR,  1, 2, false },
+			{ 1.0f,  NEAREST, 1, 2, false },
+			{ 0.75f, NEAREST, 2, 2, false },
+			{ 0.75f, NEAREST, 2, 3, true },
+			{ 0.5f,  NEAREST, 3, 4, true },
+		};
+	}
+
+	void QualityGovernor::setLevels(_In_ const std::vector<QualitySettings>& levels)
+	{
+		m_levels = levels;
+		if (m_levels.empty()) m_levels.push_back({});
+		m_level = 0;
+		m_backoff = 1;
+		m_wasLastUp = false;
+		clearSamples();
+	}
+
+	void QualityGovernor::setThresholds(_In_ const QualityThresholds& thresholds)
+	{
+		m_thresholds = thresholds;
+		m_thresholds.sampleCount = (std::max)(m_thresholds.sampleCount, 1u);
+		m_thresholds.maxBackoff = (std::max)(m_thresholds.maxBackoff, 1u);
+		m_samples.assign(m_thresholds.sampleCount, 0.0);
+		clearSamples();
+	}
+
+	void QualityGovernor::setEnabled(_In_ bool enable)
+	{
+		m_isEnabled = enable;
+		if (!enable && m_level != 0) setLevel(0, 0.0, 0.0);
+		clearSamples();
+	}
+
+	void QualityGovernor::clearSamples() noexcept
+	{
+		m_sampleIndex = 0;
+		m_sampleCount = 0;
+		m_sampleSum = 0.0;
+		m_overFrames = 0;
+		m_headroomFrames = 0;
+	}
+
+	bool QualityGovernor::update(_In_ double frameMs, _In_ double targetMs)
+	{
+		m_frame++;
+		if (!m_isEnabled) return false;
+
+		// Running sum over the ring, the oldest sample replaced.
+		const size_t capacity = m_samples.size();
+		if (m_sampleCount == capacity) m_sampleSum -= m_samples[m_sampleIndex];
+		else m_sampleCount++;
+		m_samples[m_sampleIndex] = frameMs;
+		m_sampleSum += frameMs;
+		m_sampleIndex = (m_sampleIndex + 1) % capacity;
+
+		// Until the window is full, the samples may still be of the previous level.
+		if (m_sampleCount < capacity) return false;
+		const double averageMs = m_sampleSum / static_cast<double>(capacity);
+
+		if (averageMs > targetMs * m_thresholds.downRatio)
+		{
+			m_overFrames++;
+			m_headroomFrames = 0;
+		}
+		else if (averageMs < targetMs * m_thresholds.upRatio)
+		{
+			m_headroomFrames++;
+			m_overFrames = 0;
+		}
+		else
+		{
+			m_overFrames = 0;
+			m_headroomFrames = 0;
+		}
+
+		if (m_overFrames >= m_thresholds.downFrames && m_level + 1 < m_levels.size())
+		{
+			// The level reached by stepping up did not hold: wait longer before trying it again.
+			if (m_wasLastUp && m_frame - m_lastUpFrame <= static_cast<UINT64>(m_thresholds.upFrames) + capacity)
+				m_backoff = (std::min)(m_backoff * 2, m_thresholds.maxBackoff);
+			m_wasLastUp = false;
+			setLevel(m_level + 1, averageMs, targetMs);
+			return true;
+		}
+		if (m_headroomFrames >= m_thresholds.upFrames * m_backoff && m_level > 0)
+		{
+			m_wasLastUp = true;
+			m_lastUpFrame = m_frame;
+			setLevel(m_level - 1, averageMs, targetMs);
+			if (m_level == 0) m_backoff = 1;
+			return true;
+		}
+		return false;
+	}
+
+	void QualityGovernor::setLevel(_In_ UINT32 level, _In_ double averageMs, _In_ double targetMs)
+	{
+		const QualityDecision decision = { m_frame, m_level, level, averageMs, targetMs };
+		m_level = level;
+		clearSamples();
+
+		m_decisions.push_back(decision);
+		if (m_decisions.size() > MAX_DECISIONS) m_decisions.pop_front();
+		if (m_callback) m_callback(decision, m_callbackContext);
+	}
+
+} // namespace Render
@@ -0,0 +1,169 @@
+#pragma once
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <Windows.h>
+
+#include <deque>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	/**
+	 * @brief The levers of a quality level, each cheaper than the previous level's.
+	 */
+	struct QualitySettings
+	{
+		float resolutionScale = 1.0f;	// Of the render target, stretched to the window when presented.
+		D2D1_BITMAP_INTERPOLATION_MODE interpolation = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
+		UINT32 uploadBudgetShift = 0;	// The upload queue's budget is divided by 2^shift.
+		UINT32 animationInterval = 1;	// Frames per animation update.
+		bool skipLowPriorityLayers = false;
+	};
+
+	/**
+	 * @brief A change of quality level.
+	 */
+	struct QualityDecision
+	{
+		UINT64 frame = 0;
+		UINT32 fromLevel = 0;
+		UINT32 toLevel = 0;
+		double averageMs = 0.0;	// Frame time over the sample window that triggered the change.
+		double targetMs = 0.0;
+	};
+
+	/**
+	 * @brief When the governor changes level.
+	 *
+	 * @note The frame time is averaged over sampleCount frames. It is over budget above targetMs * downRatio,
+	 *       and has headroom below targetMs * upRatio. The level goes down after downFrames over budget in a row,
+	 *       and back up after upFrames with headroom in a row.
+	 */
+	struct QualityThresholds
+	{
+		UINT32 sampleCount = 16;
+		double downRatio = 1.0;
+		double upRatio = 0.7;
+		UINT32 downFrames = 4;
+		UINT32 upFrames = 90;
+		UINT32 maxBackoff = 8;	// Limit of the factor applied to upFrames after a level that did not hold.
+	};
+
+	/**
+	 * @brief Called after each change of level.
+	 *
+	 * @param[in] decision	The change.
+	 * @param[in] context	The context given with the callback.
+	 */
+	typedef void(*QUALITYFCT)(_In_ const QualityDecision& decision, _Inout_opt_ void* context);
+
+
+	/**
+	 * @brief Lower the rendering quality when the frames miss their budget, and raise it back when there is headroom.
+	 *
+	 * @note Level 0 is the full quality, each next level is cheaper. Stepping down is quick and stepping up is slow:
+	 *       after a change the samples start over, so the next decision measures the new level. When a level reached
+	 *       by stepping up is left right away, the wait before the next step up doubles, which stops the oscillations
+	 *       between two levels. Going back to level 0 resets it.
+	 */
+	class QualityGovernor
+	{
+	private:
+		static constexpr size_t MAX_DECISIONS = 64;
+
+		std::vector<QualitySettings> m_levels;
+		QualityThresholds m_thresholds;
+		std::vector<double> m_samples;	// Ring of the last frame times.
+		size_t m_sampleIndex = 0;
+		size_t m_sampleCount = 0;
+		double m_sampleSum = 0.0;
+
+		UINT32 m_level = 0;
+		UINT32 m_overFrames = 0;
+		UINT32 m_headroomFrames = 0;
+		UINT32 m_backoff = 1;
+		UINT64 m_frame = 0;
+		UINT64 m_lastUpFrame = 0;
+		bool m_wasLastUp = false;
+		bool m_isEnabled = false;
+
+		std::deque<QualityDecision> m_decisions;
+		QUALITYFCT m_callback = nullptr;
+		void* m_callbackContext = nullptr;
+
+		void setLevel(_In_ UINT32 level, _In_ double averageMs, _In_ double targetMs);
+		void clearSamples() noexcept;
+
+	public:
+		/**
+		 * @brief Constructor for QualityGovernor, with the default levels.
+		 */
+		QualityGovernor();
+		QualityGovernor(QualityGovernor&) = delete;
+		QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+		/**
+		 * @brief Return the default levels: fewer uploads and animation updates first, then nearest neighbour
+		 *        sampling, then 75% resolution, then the low priority layers skipped, then 50% resolution.
+		 */
+		static std::vector<QualitySettings> getDefaultLevels();
+
+		/**
+		 * @brief Replace the levels, from the full quality to the cheapest.
+		 *
+		 * @note Restarts at level 0. An empty list is replaced by a single full quality level.
+		 */
+		void setLevels(_In_ const std::vector<QualitySettings>& levels);
+		inline const std::vector<QualitySettings>& getLevels() const noexcept { return m_levels; }
+
+		/**
+		 * @brief Set when the level changes, the samples start over.
+		 */
+		void setThresholds(_In_ const QualityThresholds& thresholds);
+		inline const QualityThresholds& getThresholds() const noexcept { return m_thresholds; }
+
+		/**
+		 * @brief Enable the governor. Disabled, it stays at level 0.
+		 */
+		void setEnabled(_In_ bool enable);
+		inline bool isEnabled() const noexcept { return m_isEnabled; }
+
+		/**
+		 * @brief Set the function called after each change of level.
+		 *
+		 * @param[in] callback	The function, nullptr for none.
+		 * @param[in] context	Given to the function.
+		 */
+		inline void setCallback(_In_opt_ QUALITYFCT callback, _In_opt_ void* context = nullptr) noexcept { m_callback = callback; m_callbackContext = context; }
+
+		/**
+		 * @brief Add the time of a frame and change the level if needed.
+		 *
+		 * @param[in] frameMs	How long the frame took, in milliseconds.
+		 * @param[in] targetMs	The time budget of a frame, in milliseconds.
+		 *
+		 * @retval bool
+		 * @return True if the level changed.
+		 */
+		bool update(_In_ double frameMs, _In_ double targetMs);
+
+		inline UINT32 getLevel() const noexcept { return m_level; }
+		inline const QualitySettings& getSettings() const noexcept { return m_levels[m_level]; }
+
+		/**
+		 * @brief Return the last changes of level, oldest first.
+		 */
+		inline const std::deque<QualityDecision>& getDecisions() const noexcept { return m_decisions; }
+	};
+
+} // namespace Render
+
+#endif // QUALITY_GOVERNOR_H
@@ -0,0 +1,484 @@
+#include "RenderCommands.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <windows.h>
+#include <d2d1.h>
+
+#include "GraphicComponents.h"
+#include "LayerCache.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+
+
+	/****************************/
+	/*		 CommandList		*/
+	/****************************/
+
+
+	void CommandList::removeCommands(_In_ const std::vector<BYTE>& removed)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < m_commands.size(); i++)
+		{
+			if (i < removed.size() && removed[i]) continue;
+			m_commands[kept++] = m_commands[i];
+		}
+		m_commands.resize(kept);
+		m_occluders.clear();
+	}
+
+
+
+	/****************************/
+	/*		CommandBuffer		*/
+	/****************************/
+
+
+	void CommandBuffer::reset() noexcept
+	{
+		for (auto& [layer, commands] : m_layers)
+			commands.reset();
+	}
+
+	size_t CommandBuffer::size() const noexcept
+	{
+		size_t size = 0;
+		for (const auto& [layer, commands] : m_layers)
+			size += commands.size();
+		return size;
+	}
+
+
+
+	/****************************/
+	/*		ResourceTable		*/
+	/****************************/
+
+
+	ResourceId ResourceTable::allocateId()
+	{
+		if (!m_freeIds.empty())
+		{
+			const ResourceId id = m_freeIds.back();
+			m_freeIds.pop_back();
+			return id;
+		}
+
+		m_bitmaps.push_back({});
+		return static_cast<ResourceId>(m_bitmaps.size()); // Ids start at 1, 0 is INVALID_RESOURCE.
+	}
+
+	void ResourceTable::addRecent(_In_ ResourceId id) noexcept
+	{
+		// The animated bitmaps are updated every frame: kept once.
+		if (std::find(m_recentIds.begin(), m_recentIds.end(), id) != m_recentIds.end()) return;
+		if (m_recentIds.size() == RECENT_BITMAP_COUNT) m_recentIds.erase(m_recentIds.begin());
+		m_recentIds.push_back(id);
+	}
+
+	ResourceId ResourceTable::registerBitmap(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const ResourceId id = allocateId();
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		bitmap.pixels = pixels;
+		bitmap.width = width;
+		bitmap.height = height;
+		bitmap.pBitmap = nullptr;
+		bitmap.isUsed = true;
+		if (pixels != nullptr) addRecent(id);
+		return id;
+	}
+
+	ResourceId ResourceTable::registerCompressedBitmap(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const TextureId texture = m_textures.add(pixels, width, height);
+		const ResourceId id = allocateId();
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		bitmap.pixels = nullptr;
+		bitmap.texture = texture;
+		bitmap.width = width;
+		bitmap.height = height;
+		bitmap.pBitmap = nullptr;
+		bitmap.isUsed = true;
+		addRecent(id);
+		return id;
+	}
+
+	void ResourceTable::updateBitmap(_In_ ResourceId id, _In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex); // Another layer may grow the table meanwhile.
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return;
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		if (bitmap.pBitmap) m_dropped.push_back(bitmap.pBitmap);
+		m_textures.remove(bitmap.texture);
+		bitmap.texture = INVALID_TEXTURE;
+		bitmap.pixels = pixels;
+		bitmap.width = width;
+		bitmap.height = height;
+		bitmap.pBitmap = nullptr;
+		bitmap.version++;
+		bitmap.retryStamp = 0; // New pixels are worth a new try.
+		bitmap.failureCount = 0;
+		if (pixels != nullptr) addRecent(id);
+	}
+
+	void ResourceTable::unregisterBitmap(_In_ ResourceId id) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return;
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		if (!bitmap.isUsed) return;
+
+		if (bitmap.pBitmap) m_dropped.push_back(bitmap.pBitmap);
+		m_textures.remove(bitmap.texture);
+		const UINT32 version = bitmap.version;
+		bitmap = {};
+		bitmap.version = version + 1; // The id may be reused by another bitmap.
+		m_freeIds.push_back(id);
+	}
+
+	const BitmapResource* ResourceTable::getBitmap(_In_ ResourceId id) const noexcept
+	{
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return nullptr;
+
+		const BitmapResource& bitmap = m_bitmaps[id - 1];
+		return bitmap.isUsed ? &bitmap : nullptr;
+	}
+
+	const Graphics::Pixel* ResourceTable::getPixels(_In_ ResourceId id) const
+	{
+		const BitmapResource* bitmap = getBitmap(id);
+		if (bitmap == nullptr) return nullptr;
+		return bitmap->texture != INVALID_TEXTURE ? m_textures.decode(bitmap->texture) : bitmap->pixels;
+	}
+
+	void ResourceTable::pruneRecentBitmaps() noexcept
+	{
+		std::erase_if(m_recentIds, [this](ResourceId id) {
+			const BitmapResource* bitmap = getBitmap(id);
+			return bitmap == nullptr || bitmap->pBitmap != nullptr || !bitmap->hasPixels();
+		});
+	}
+
+	ID2D1Bitmap* ResourceTable::getResidentBitmap(_In_ ResourceId id) const noexcept
+	{
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return nullptr;
+		return m_bitmaps[id - 1].pBitmap;
+	}
+
+	HRESULT ResourceTable::uploadBitmap(_In_ ResourceId id, _In_ ID2D1RenderTarget* renderTarget) noexcept
+	{
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return E_INVALIDARG;
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		if (!bitmap.isUsed || !bitmap.hasPixels() || bitmap.pBitmap != nullptr) return S_FALSE;
+
+		// Compressed bitmaps are decoded here, the device copy is then used until the target is lost.
+		const Graphics::Pixel* pixels = nullptr;
+		try
+		{
+			pixels = getPixels(id);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return E_OUTOFMEMORY;
+		}
+		if (pixels == nullptr) return S_FALSE;
+
+		D2D1_BITMAP_PROPERTIES properties = D2D1::BitmapProperties();
+		properties.pixelFormat.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+		properties.pixelFormat.alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED;
+		returnOnFail(renderTarget->CreateBitmap({ bitmap.width, bitmap.height }, reinterpret_cast<const void*>(pixels), bitmap.width * sizeof(Graphics::Pixel), properties, &bitmap.pBitmap));
+		bitmap.failureCount = 0;
+		return S_OK;
+	}
+
+	bool ResourceTable::stampUpload(_In_ ResourceId id, _In_ UINT64 frame) noexcept
+	{
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return false;
+
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		if (bitmap.uploadStamp == frame || frame < bitmap.retryStamp) return false;
+		bitmap.uploadStamp = frame;
+		return true;
+	}
+
+	void ResourceTable::deferUpload(_In_ ResourceId id, _In_ UINT64 frame) noexcept
+	{
+		if (id == INVALID_RESOURCE || id > m_bitmaps.size()) return;
+
+		// 2, 4, 8... frames, at most 256.
+		BitmapResource& bitmap = m_bitmaps[id - 1];
+		bitmap.failureCount++;
+		bitmap.retryStamp = frame + (1ull << (std::min)(bitmap.failureCount, 8u));
+	}
+
+	void ResourceTable::releaseDropped() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (ID2D1Bitmap* pBitmap : m_dropped)
+				pBitmap->Release();
+			m_dropped.clear();
+		}
+		m_geometries.releaseDropped();
+	}
+
+	void ResourceTable::releaseDeviceResources() noexcept
+	{
+		releaseDropped();
+		for (BitmapResource& bitmap : m_bitmaps)
+		{
+			if (bitmap.pBitmap) bitmap.pBitmap->Release();
+			bitmap.pBitmap = nullptr;
+			bitmap.retryStamp = 0; // The next render target may succeed.
+			bitmap.failureCount = 0;
+		}
+
+		// Every bitmap has to be uploaded again: the last ones registered are prefetched, the others wait to be drawn.
+		m_recentIds.clear();
+		for (ResourceId id = static_cast<ResourceId>(m_bitmaps.size()); id > 0 && m_recentIds.size() < RECENT_BITMAP_COUNT; id--)
+			if (m_bitmaps[id - 1].isUsed && m_bitmaps[id - 1].hasPixels()) m_recentIds.push_back(id);
+		std::reverse(m_recentIds.begin(), m_recentIds.end());
+	}
+
+	ResourceTable::~ResourceTable()
+	{
+		releaseDeviceResources();
+	}
+
+
+
+	/****************************/
+	/*		 D2D1Backend		*/
+	/****************************/
+
+
+	inline D2D1_COLOR_F toColorF(_In_ UINT32 argb) noexcept
+	{
+		return D2D1::ColorF(
+			static_cast<float>((argb >> 16) & 0xFF) / 255.0f,
+			static_cast<float>((argb >> 8) & 0xFF) / 255.0f,
+			static_cast<float>(argb & 0xFF) / 255.0f,
+			static_cast<float>((argb >> 24) & 0xFF) / 255.0f
+		);
+	}
+
+	inline bool isRectEmpty(_In_ const D2D1_RECT_F& rect) noexcept
+	{
+		return rect.right <= rect.left || rect.bottom <= rect.top;
+	}
+
+	void D2D1Backend::execute(_In_ const CommandBuffer& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget, _Inout_opt_ LayerCache* layerCache)
+	{
+		if (layerCache) layerCache->beginFrame();
+		for (const auto& [layer, list] : commands.getLayers())
+		{
+			if (layerCache && layerCache->isLayerCached(layer))
+				layerCache->drawLayer(layer, list, *this, resources, renderTarget);
+			else if (!list.empty())
+				executeLayer(list, resources, renderTarget);
+		}
+	}
+
+	void D2D1Backend::executeLayer(_In_ const CommandList& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		const std::vector<Command>& layerCommands = commands.getCommands();
+
+		// Order of execution: recording order, or grouped by resource to limit bitmap switches.
+		m_order.resize(layerCommands.size());
+		std::iota(m_order.begin(), m_order.end(), 0);
+		if (m_batchByResource)
+		{
+			std::stable_sort(m_order.begin(), m_order.end(), [&layerCommands](UINT32 a, UINT32 b) -> bool {
+				return layerCommands[a].resource < layerCommands[b].resource;
+			});
+		}
+
+		for (UINT32 index : m_order)
+		{
+			const Command& command = layerCommands[index];
+			switch (command.type)
+			{
+			case CommandType::DrawBitmap:
+			{
+				ID2D1Bitmap* pBitmap = resources.getResidentBitmap(command.resource);
+				if (pBitmap == nullptr)
+				{
+					// Still in the upload queue.
+					if (m_placeholderColor != 0 && resources.getBitmap(command.resource))
+						fillRect(command.destination, m_placeholderColor, renderTarget);
+					break;
+				}
+				const D2D1_RECT_F* source = isRectEmpty(command.source) ? nullptr : &command.source;
+				renderTarget->DrawBitmap(pBitmap, command.destination, command.opacity, m_interpolation, source);
+				break;
+			}
+
+			case CommandType::FillRect:
+				fillRect(command.destination, command.color, renderTarget);
+				break;
+
+			case CommandType::DrawMask:
+			{
+				// Not drawn while in the upload queue: a placeholder per glyph would be noise.
+				ID2D1Bitmap* pMask = resources.getResidentBitmap(command.resource);
+				if (pMask) fillMask(command, pMask, renderTarget);
+				break;
+			}
+
+			case CommandType::FillGeometry:
+				fillGeometry(command, resources.getGeometries(), renderTarget);
+				break;
+
+			case CommandType::DrawSprites:
+			{
+				ID2D1Bitmap* pMask = resources.getResidentBitmap(command.resource);
+				if (pMask) fillSprites(command, commands, pMask, renderTarget);
+				break;
+			}
+			}
+		}
+	}
+
+	void D2D1Backend::fillRect(_In_ const D2D1_RECT_F& rect, _In_ UINT32 color, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		if (m_pBrush == nullptr)
+			throwOnFail(renderTarget->CreateSolidColorBrush(toColorF(color), &m_pBrush));
+		m_pBrush->SetColor(toColorF(color));
+		renderTarget->FillRectangle(rect, m_pBrush);
+	}
+
+	void D2D1Backend::fillMask(_In_ const Command& command, _In_ ID2D1Bitmap* pMask, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		if (m_pBrush == nullptr)
+			throwOnFail(renderTarget->CreateSolidColorBrush(toColorF(command.color), &m_pBrush));
+		m_pBrush->SetColor(toColorF(command.color));
+		m_pBrush->SetOpacity(command.opacity);
+
+		// FillOpacityMask requires aliased rendering.
+		const D2D1_RECT_F* source = isRectEmpty(command.source) ? nullptr : &command.source;
+		renderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+		renderTarget->FillOpacityMask(pMask, m_pBrush, D2D1_OPACITY_MASK_CONTENT_GRAPHICS, &command.destination, source);
+		renderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+		m_pBrush->SetOpacity(1.0f);
+	}
+
+	void D2D1Backend::fillSprites(_In_ const Command& command, _In_ const CommandList& commands, _In_ ID2D1Bitmap* pMask, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		size_t count = 0;
+		const Sprite* sprites = commands.getSprites(command, &count);
+		if (count == 0) return;
+
+		// Since Windows 10 1607, a single draw for the whole batch.
+		ID2D1DeviceContext3* pContext = nullptr;
+		if (SUCCEEDED(renderTarget->QueryInterface(&pContext)))
+		{
+			const HRESULT hr = drawSpriteBatch(command, sprites, count, pMask, pContext);
+			pContext->Release();
+			if (SUCCEEDED(hr)) return;
+		}
+
+		// Otherwise an opacity mask per sprite.
+		if (m_pBrush == nullptr)
+			throwOnFail(renderTarget->CreateSolidColorBrush(toColorF(sprites->color), &m_pBrush));
+		m_pBrush->SetOpacity(command.opacity);
+
+		const D2D1_RECT_F* source = isRectEmpty(command.source) ? nullptr : &command.source;
+		renderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+		for (size_t i = 0; i < count; i++)
+		{
+			const Sprite& sprite = sprites[i];
+			const D2D1_RECT_F destination = D2D1::RectF(sprite.left, sprite.top, sprite.left + sprite.size, sprite.top + sprite.size);
+			m_pBrush->SetColor(toColorF(sprite.color));
+			renderTarget->FillOpacityMask(pMask, m_pBrush, D2D1_OPACITY_MASK_CONTENT_GRAPHICS, &destination, source);
+		}
+		renderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+		m_pBrush->SetOpacity(1.0f);
+	}
+
+	HRESULT D2D1Backend::drawSpriteBatch(_In_ const Command& command, _In_ const Sprite* sprites, _In_ size_t count, _In_ ID2D1Bitmap* pMask, _In_ ID2D1DeviceContext3* pContext)
+	{
+		if (m_pSpriteBatch == nullptr) returnOnFail(pContext->CreateSpriteBatch(&m_pSpriteBatch));
+
+		// The masks are white: tinted by the colors, they give the pixels of FillOpacityMask.
+		m_spriteRects.resize(count);
+		m_spriteColors.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const Sprite& sprite = sprites[i];
+			m_spriteRects[i] = D2D1::RectF(sprite.left, sprite.top, sprite.left + sprite.size, sprite.top + sprite.size);
+			m_spriteColors[i] = toColorF(sprite.color);
+			m_spriteColors[i].a *= command.opacity;
+		}
+
+		// A stride of zero gives every sprite the same source, and no transform.
+		const D2D1_RECT_U source = {
+			static_cast<UINT32>(command.source.left), static_cast<UINT32>(command.source.top),
+			static_cast<UINT32>(command.source.right), static_cast<UINT32>(command.source.bottom)
+		};
+		m_pSpriteBatch->Clear();
+		returnOnFail(m_pSpriteBatch->AddSprites(static_cast<UINT32>(count), m_spriteRects.data(), isRectEmpty(command.source) ? nullptr : &source,
+			m_spriteColors.data(), nullptr, sizeof(D2D1_RECT_F), 0, sizeof(D2D1_COLOR_F), 0));
+
+		// Sprite batches require aliased rendering.
+		pContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+		pContext->DrawSpriteBatch(m_pSpriteBatch, pMask, m_interpolation);
+		pContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+		return S_OK;
+	}
+
+	void D2D1Backend::fillGeometry(_In_ const Command& command, _Inout_ GeometryCache& geometries, _In_ ID2D1RenderTarget* renderTarget)
+	{
+		ID2D1Factory* pFactory = nullptr;
+		renderTarget->GetFactory(&pFactory);
+		ID2D1PathGeometry* pGeometry = geometries.getDeviceGeometry(command.resource, pFactory);
+		if (pFactory) pFactory->Release();
+		if (pGeometry == nullptr) return;
+
+		if (m_pBrush == nullptr)
+			throwOnFail(renderTarget->CreateSolidColorBrush(toColorF(command.color), &m_pBrush));
+		m_pBrush->SetColor(toColorF(command.color));
+		m_pBrush->SetOpacity(command.opacity);
+
+		// The geometry is relative to the shape's position: move its bounds to the destination.
+		const D2D1_RECT_F bounds = geometries.getBounds(command.resource);
+		D2D1::Matrix3x2F transform;
+		renderTarget->GetTransform(&transform);
+		renderTarget->SetTransform(D2D1::Matrix3x2F::Translation(command.destination.left - bounds.left, command.destination.top - bounds.top) * transform);
+
+		const float strokeWidth = geometries.getStrokeWidth(command.resource);
+		if (strokeWidth > 0.0f) renderTarget->DrawGeometry(pGeometry, m_pBrush, strokeWidth);
+		else renderTarget->FillGeometry(pGeometry, m_pBrush);
+
+		renderTarget->SetTransform(transform);
+		m_pBrush->SetOpacity(1.0f);
+	}
+
+	void D2D1Backend::releaseDeviceResources() noexcept
+	{
+		if (m_pBrush) m_pBrush->Release();
+		m_pBrush = nullptr;
+		if (m_pSpriteBatch) m_pSpriteBatch->Release();
+		m_pSpriteBatch = nullptr;
+	}
+
+	D2D1Backend::~D2D1Backend()
+	{
+		releaseDeviceResources();
+	}
+
+} // namespace Render
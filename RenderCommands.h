@@ -0,0 +1,551 @@
+#pragma once
+#ifndef RENDER_COMMANDS_H
+#define RENDER_COMMANDS_H
+
+#include <Windows.h>
+#include <minwindef.h> // BYTE
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <d2d1.h>
+#include <d2d1_3.h> // Sprite batches.
+
+#include "GeometryCache.h"
+#include "TextureStore.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	struct Pixel;
+} // namespace Graphics
+
+
+namespace Render
+{
+	typedef unsigned int ResourceId;
+	typedef int Layer;
+
+	constexpr ResourceId INVALID_RESOURCE = 0;
+
+	enum class CommandType : BYTE
+	{
+		DrawBitmap,	// Draw (a part of) a bitmap resource in the destination rectangle.
+		FillRect,	// Fill the destination rectangle with a solid color.
+		DrawMask,	// Fill the destination rectangle with a solid color, through the alpha of (a part of) a bitmap resource.
+		FillGeometry,	// Fill a cached geometry with a solid color, its bounds placed at the destination rectangle.
+		DrawSprites,	// DrawMask for each sprite of a batch, with the sprite's square and color. The destination bounds them all.
+	};
+
+	/**
+	 * @brief A single recorded draw command.
+	 *
+	 * @note Commands are plain data: they can be copied, sorted and replayed freely.
+	 */
+	struct Command
+	{
+		CommandType type;
+		ResourceId resource;	// Bitmap to draw, geometry for FillGeometry, INVALID_RESOURCE otherwise.
+		UINT32 color;			// 0xAARRGGBB, used by FillRect, DrawMask and FillGeometry. The batch index for DrawSprites.
+		float opacity;
+		D2D1_RECT_F destination;
+		D2D1_RECT_F source;		// Source rectangle in bitmap pixels, empty for the whole bitmap.
+	};
+
+	/**
+	 * @brief Return whether the resource of a command is a bitmap of the resource table.
+	 */
+	inline bool usesBitmap(_In_ const Command& command) noexcept
+	{
+		return command.type == CommandType::DrawBitmap || command.type == CommandType::DrawMask || command.type == CommandType::DrawSprites;
+	}
+
+	inline bool operator==(_In_ const D2D1_RECT_F& a, _In_ const D2D1_RECT_F& b) noexcept
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	inline bool operator==(_In_ const Command& a, _In_ const Command& b) noexcept
+	{
+		return a.type == b.type && a.resource == b.resource && a.color == b.color && a.opacity == b.opacity
+			&& a.destination == b.destination && a.source == b.source;
+	}
+
+
+	/**
+	 * @brief A square drawn by a DrawSprites command.
+	 */
+	struct Sprite
+	{
+		float left;
+		float top;
+		float size;		// Width and height, in client pixels.
+		UINT32 color;	// 0xAARRGGBB.
+
+		Sprite() noexcept {} // Left uninitialized: the sprites handed out by drawSprites are all written by their caller.
+	};
+
+	/**
+	 * @brief The sprites of a DrawSprites command, in the sprites of its list.
+	 */
+	struct SpriteBatch
+	{
+		size_t first;
+		size_t count;
+	};
+
+
+	/**
+	 * @brief A rectangle fully covered with opaque pixels by the commands recorded before it.
+	 */
+	struct Occluder
+	{
+		D2D1_RECT_F rect;
+		size_t position;	// Index of the opaque command in its list.
+	};
+
+
+	/**
+	 * @brief The commands recorded for a single layer.
+	 *
+	 * @note The storage is kept between frames: once warmed up, recording does not allocate.
+	 */
+	class CommandList
+	{
+	private:
+		std::vector<Command> m_commands;
+		std::vector<Occluder> m_occluders;
+		std::vector<Sprite> m_sprites;
+		std::vector<SpriteBatch> m_batches;
+
+	public:
+		/**
+		 * @brief Record a bitmap draw.
+		 *
+		 * @param[in] resource		The bitmap to draw.
+		 * @param[in] destination	Where to draw the bitmap, in client pixels.
+		 * @param[in] opacity		Opacity of the bitmap, from 0 to 1.
+		 */
+		inline void drawBitmap(_In_ ResourceId resource, _In_ const D2D1_RECT_F& destination, _In_opt_ float opacity = 1.0f)
+		{
+			m_commands.push_back({ CommandType::DrawBitmap, resource, 0, opacity, destination, { .0f, .0f, .0f, .0f } });
+		}
+
+		/**
+		 * @brief Record a partial bitmap draw.
+		 *
+		 * @param[in] resource		The bitmap to draw.
+		 * @param[in] destination	Where to draw the bitmap, in client pixels.
+		 * @param[in] source		The part of the bitmap to draw, in bitmap pixels.
+		 * @param[in] opacity		Opacity of the bitmap, from 0 to 1.
+		 */
+		inline void drawBitmap(_In_ ResourceId resource, _In_ const D2D1_RECT_F& destination, _In_ const D2D1_RECT_F& source, _In_opt_ float opacity = 1.0f)
+		{
+			m_commands.push_back({ CommandType::DrawBitmap, resource, 0, opacity, destination, source });
+		}
+
+		/**
+		 * @brief Record a solid rectangle fill.
+		 *
+		 * @param[in] destination	The rectangle to fill, in client pixels.
+		 * @param[in] color			The color, as 0xAARRGGBB.
+		 */
+		inline void fillRect(_In_ const D2D1_RECT_F& destination, _In_ UINT32 color)
+		{
+			m_commands.push_back({ CommandType::FillRect, INVALID_RESOURCE, color, 1.0f, destination, { .0f, .0f, .0f, .0f } });
+		}
+
+		/**
+		 * @brief Record a solid color draw through the alpha of a bitmap, used for glyphs.
+		 *
+		 * @param[in] resource		The bitmap whose alpha is the coverage.
+		 * @param[in] destination	Where to draw, in client pixels.
+		 * @param[in] source		The part of the bitmap to use, in bitmap pixels.
+		 * @param[in] color			The color, as 0xAARRGGBB.
+		 * @param[in] opacity		Opacity, from 0 to 1.
+		 */
+		inline void drawMask(_In_ ResourceId resource, _In_ const D2D1_RECT_F& destination, _In_ const D2D1_RECT_F& source, _In_ UINT32 color, _In_opt_ float opacity = 1.0f)
+		{
+			m_commands.push_back({ CommandType::DrawMask, resource, color, opacity, destination, source });
+		}
+
+		/**
+		 * @brief Record a solid color fill of a cached geometry, used for shapes.
+		 *
+		 * @param[in] geometry		The geometry to fill, from the geometry cache.
+		 * @param[in] destination	Where its bounds are drawn, in client pixels. Only the position is used.
+		 * @param[in] color			The color, as 0xAARRGGBB.
+		 * @param[in] opacity		Opacity, from 0 to 1.
+		 */
+		inline void fillGeometry(_In_ GeometryId geometry, _In_ const D2D1_RECT_F& destination, _In_ UINT32 color, _In_opt_ float opacity = 1.0f)
+		{
+			m_commands.push_back({ CommandType::FillGeometry, geometry, color, opacity, destination, { .0f, .0f, .0f, .0f } });
+		}
+
+		/**
+		 * @brief Record a batch of sprites sharing a mask: each fills its square with its color through the alpha of the mask.
+		 *
+		 * @note Used for particles: a single command, whatever the number of sprites.
+		 *       Its destination must then be set to the bounds of the sprites with setSpritesBounds.
+		 *
+		 * @param[in] resource	The bitmap whose alpha is the coverage.
+		 * @param[in] source	The part of the bitmap to use, in bitmap pixels, empty for the whole bitmap.
+		 * @param[in] count		The number of sprites.
+		 * @param[in] opacity	Opacity of every sprite, from 0 to 1.
+		 *
+		 * @retval Sprite*
+		 * @return The sprites to write, valid until the next batch is recorded in this list.
+		 */
+		inline Sprite* drawSprites(_In_ ResourceId resource, _In_ const D2D1_RECT_F& source, _In_ size_t count, _In_opt_ float opacity = 1.0f)
+		{
+			const size_t first = m_sprites.size();
+			m_sprites.resize(first + count);
+			m_commands.push_back({ CommandType::DrawSprites, resource, static_cast<UINT32>(m_batches.size()), opacity, D2D1::RectF(), source });
+			m_batches.push_back({ first, count });
+			return m_sprites.data() + first;
+		}
+
+		/**
+		 * @brief Set the destination of the last command, a DrawSprites, to a rectangle containing all its sprites.
+		 */
+		inline void setSpritesBounds(_In_ const D2D1_RECT_F& bounds) noexcept { m_commands.back().destination = bounds; }
+
+		/**
+		 * @brief Return the first sprite of a DrawSprites command of this list, and their number.
+		 */
+		inline const Sprite* getSprites(_In_ const Command& command, _Out_ size_t* count) const noexcept
+		{
+			const SpriteBatch& batch = m_batches[command.color];
+			*count = batch.count;
+			return m_sprites.data() + batch.first;
+		}
+
+		/**
+		 * @brief Declare that the last command recorded covers a rectangle with opaque pixels.
+		 *
+		 * @note The occlusion culling then skips the commands below it, in this list and in the lower layers.
+		 *
+		 * @param[in] rect The opaque rectangle, in client pixels.
+		 */
+		inline void occlude(_In_ const D2D1_RECT_F& rect)
+		{
+			if (!m_commands.empty()) m_occluders.push_back({ rect, m_commands.size() - 1 });
+		}
+
+		/**
+		 * @brief Remove the flagged commands, keeping the order of the others.
+		 *
+		 * @note The occluders are dropped with them: their positions no longer match.
+		 *
+		 * @param[in] removed A flag per command, non zero to remove it.
+		 */
+		void removeCommands(_In_ const std::vector<BYTE>& removed);
+
+		/**
+		 * @brief Remove all the commands, keeping the storage for the next frame.
+		 */
+		inline void reset() noexcept { m_commands.clear(); m_occluders.clear(); m_sprites.clear(); m_batches.clear(); }
+
+		inline const std::vector<Command>& getCommands() const noexcept { return m_commands; }
+		inline const std::vector<Occluder>& getOccluders() const noexcept { return m_occluders; }
+		inline size_t size() const noexcept { return m_commands.size(); }
+		inline bool empty() const noexcept { return m_commands.empty(); }
+	};
+
+
+	/**
+	 * @brief All the commands of a frame, grouped by layer.
+	 *
+	 * @note Each layer owns its own list, so layers may be recorded concurrently.
+	 *       Layers are never erased: a layer that becomes empty keeps its storage.
+	 */
+	class CommandBuffer
+	{
+	private:
+		std::map<Layer, CommandList> m_layers;
+
+	public:
+		/**
+		 * @brief Get the command list of a layer, creating it if needed.
+		 *
+		 * @note Not thread safe: create the layers before recording them in parallel.
+		 */
+		inline CommandList& getLayer(_In_ Layer layer) { return m_layers[layer]; }
+
+		inline const std::map<Layer, CommandList>& getLayers() const noexcept { return m_layers; }
+		inline std::map<Layer, CommandList>& getLayers() noexcept { return m_layers; }
+
+		/**
+		 * @brief Reset every layer, keeping the storage.
+		 */
+		void reset() noexcept;
+
+		/**
+		 * @brief Return the number of commands recorded in every layer.
+		 */
+		size_t size() const noexcept;
+	};
+
+
+	/**
+	 * @brief A bitmap known by the renderer: its pixels and its device copy.
+	 */
+	struct BitmapResource
+	{
+		const Graphics::Pixel* pixels = nullptr;	// Premultiplied B8G8R8A8 pixels, owned by the component.
+		TextureId texture = INVALID_TEXTURE;		// Or compressed in the table's texture store.
+		UINT32 width = 0;
+		UINT32 height = 0;
+		ID2D1Bitmap* pBitmap = nullptr;				// Device copy, created on first use.
+		UINT32 version = 0;							// Incremented whenever the pixels change.
+		UINT64 uploadStamp = 0;						// The last upload frame that queued it, to queue it once per frame.
+		UINT64 retryStamp = 0;						// After a failed upload, the first upload frame that may try again.
+		UINT32 failureCount = 0;					// Uploads failed in a row since the pixels last changed.
+		bool isUsed = false;
+
+		inline bool hasPixels() const noexcept { return pixels != nullptr || texture != INVALID_TEXTURE; }
+	};
+
+
+	/**
+	 * @brief Owns the device bitmaps and the geometries referenced by the commands.
+	 *
+	 * @note Registering, updating and unregistering bitmaps are thread safe: the texts, tile maps and large images
+	 *       do it while recording in parallel. The other methods are called between recordings.
+	 *       The device copies dropped by updates and unregistrations are only released by releaseDropped:
+	 *       the render thread presents without the lock, and Direct2D may still use them.
+	 */
+	class ResourceTable
+	{
+	private:
+		static constexpr size_t RECENT_BITMAP_COUNT = 256;
+
+		std::vector<BitmapResource> m_bitmaps;	// Indexed by ResourceId - 1.
+		std::vector<ResourceId> m_freeIds;
+		std::vector<ResourceId> m_recentIds;	// Given pixels lately and maybe not uploaded yet, oldest first.
+		std::vector<ID2D1Bitmap*> m_dropped;	// Device copies of replaced or unregistered pixels, released by the render thread.
+		std::mutex m_mutex;						// Held while the bitmaps are registered, updated or unregistered.
+		GeometryCache m_geometries;
+		mutable TextureStore m_textures; // Decodes on demand, for the const users too.
+
+		ResourceId allocateId();
+		void addRecent(_In_ ResourceId id) noexcept;
+
+	public:
+		ResourceTable() = default;
+		ResourceTable(ResourceTable&) = delete;
+		ResourceTable& operator=(const ResourceTable&) = delete;
+
+		/**
+		 * @brief Register a bitmap.
+		 *
+		 * @param[in] pixels	The bitmap pixels. Must stay valid until unregistered or updated.
+		 * @param[in] width		The bitmap width in pixels.
+		 * @param[in] height	The bitmap height in pixels.
+		 *
+		 * @retval ResourceId
+		 * @return The id to use in the commands.
+		 */
+		ResourceId registerBitmap(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+		/**
+		 * @brief Register a bitmap kept compressed by the table.
+		 *
+		 * @note The pixels are copied: the caller can free them. They are decoded when uploaded or read with getPixels.
+		 *
+		 * @param[in] pixels	The bitmap pixels.
+		 * @param[in] width		The bitmap width in pixels.
+		 * @param[in] height	The bitmap height in pixels.
+		 *
+		 * @retval ResourceId
+		 * @return The id to use in the commands.
+		 */
+		ResourceId registerCompressedBitmap(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+		/**
+		 * @brief Point a registered bitmap to new pixels, dropping its device copy until releaseDropped.
+		 */
+		void updateBitmap(_In_ ResourceId id, _In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height) noexcept;
+
+		/**
+		 * @brief Unregister a bitmap, dropping its device copy until releaseDropped.
+		 */
+		void unregisterBitmap(_In_ ResourceId id) noexcept;
+
+		/**
+		 * @brief Return the resource binded to the id, or nullptr if the id is not registered.
+		 */
+		const BitmapResource* getBitmap(_In_ ResourceId id) const noexcept;
+
+		/**
+		 * @brief Return the pixels of a bitmap, decoding them if it is compressed.
+		 *
+		 * @note The decoded pixels stay valid until the texture store is trimmed. Not thread safe.
+		 *
+		 * @retval Pixel*
+		 * @return The bitmap's pixels, or nullptr if the id is not registered.
+		 */
+		const Graphics::Pixel* getPixels(_In_ ResourceId id) const;
+
+		/**
+		 * @brief Return the number of ids, used or not. Valid ids are in [1, getIdCount()].
+		 */
+		inline size_t getIdCount() const noexcept { return m_bitmaps.size(); }
+
+		/**
+		 * @brief Return the bitmaps registered or given new pixels lately, oldest first: the ones worth uploading before they are drawn.
+		 *
+		 * @note At most the last 256: the older ones are uploaded when drawn. May hold ids uploaded, emptied or unregistered
+		 *       since, until pruneRecentBitmaps.
+		 */
+		inline const std::vector<ResourceId>& getRecentBitmaps() const noexcept { return m_recentIds; }
+
+		/**
+		 * @brief Drop the recent bitmaps that are uploaded, have no pixels, or are no longer registered.
+		 */
+		void pruneRecentBitmaps() noexcept;
+
+		/**
+		 * @brief Return the device bitmap binded to the id, without creating it.
+		 *
+		 * @retval ID2D1Bitmap*
+		 * @return The device bitmap, or nullptr if it has not been uploaded yet.
+		 */
+		ID2D1Bitmap* getResidentBitmap(_In_ ResourceId id) const noexcept;
+
+		/**
+		 * @brief Create the device bitmap binded to the id from its pixels.
+		 *
+		 * @retval HRESULT
+		 * @return S_OK if the bitmap has been created, S_FALSE if there was nothing to upload, the error otherwise.
+		 */
+		HRESULT uploadBitmap(_In_ ResourceId id, _In_ ID2D1RenderTarget* renderTarget) noexcept;
+
+		/**
+		 * @brief Stamp a bitmap as queued for an upload frame.
+		 *
+		 * @retval bool
+		 * @return False if it was already queued in this frame, or if it waits after a failed upload.
+		 */
+		bool stampUpload(_In_ ResourceId id, _In_ UINT64 frame) noexcept;
+
+		/**
+		 * @brief Make a bitmap which upload failed wait before the next try, twice as long after each failure in a row.
+		 */
+		void deferUpload(_In_ ResourceId id, _In_ UINT64 frame) noexcept;
+
+		inline GeometryCache& getGeometries() noexcept { return m_geometries; }
+		inline const GeometryCache& getGeometries() const noexcept { return m_geometries; }
+
+		/**
+		 * @brief Returns the store of the compressed bitmaps.
+		 * @note  Its trim method must be called between frames, to evict the decoded pixels over its budget.
+		 */
+		inline TextureStore& getTextures() noexcept { return m_textures; }
+		inline const TextureStore& getTextures() const noexcept { return m_textures; }
+
+		/**
+		 * @brief Release the device bitmaps and geometries dropped since the last call.
+		 * @note  Called by the thread presenting the frames, once Direct2D is done with the previous one.
+		 */
+		void releaseDropped() noexcept;
+
+		/**
+		 * @brief Release every device bitmap.
+		 * @note  Must be called whenever the render target is destroyed.
+		 */
+		void releaseDeviceResources() noexcept;
+
+		~ResourceTable();
+	};
+
+
+	class LayerCache;
+
+	/**
+	 * @brief Execute command buffers on a Direct2D render target.
+	 */
+	class D2D1Backend
+	{
+	private:
+		ID2D1SolidColorBrush* m_pBrush = nullptr;
+		ID2D1SpriteBatch* m_pSpriteBatch = nullptr;
+		std::vector<D2D1_RECT_F> m_spriteRects;		// Reused between batches.
+		std::vector<D2D1_COLOR_F> m_spriteColors;	// Reused between batches.
+		std::vector<UINT32> m_order; // Reused between frames.
+		bool m_batchByResource = false;
+		UINT32 m_placeholderColor = 0x40C0C0C0;
+		D2D1_BITMAP_INTERPOLATION_MODE m_interpolation = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
+
+		void fillRect(_In_ const D2D1_RECT_F& rect, _In_ UINT32 color, _In_ ID2D1RenderTarget* renderTarget);
+		void fillMask(_In_ const Command& command, _In_ ID2D1Bitmap* pMask, _In_ ID2D1RenderTarget* renderTarget);
+		void fillGeometry(_In_ const Command& command, _Inout_ GeometryCache& geometries, _In_ ID2D1RenderTarget* renderTarget);
+		void fillSprites(_In_ const Command& command, _In_ const CommandList& commands, _In_ ID2D1Bitmap* pMask, _In_ ID2D1RenderTarget* renderTarget);
+		HRESULT drawSpriteBatch(_In_ const Command& command, _In_ const Sprite* sprites, _In_ size_t count, _In_ ID2D1Bitmap* pMask, _In_ ID2D1DeviceContext3* pContext);
+
+	public:
+		D2D1Backend() = default;
+		D2D1Backend(D2D1Backend&) = delete;
+		D2D1Backend& operator=(const D2D1Backend&) = delete;
+
+		/**
+		 * @brief Execute all the commands, layer by layer.
+		 * @note  renderTarget->BeginDraw() Must have been called.
+		 *
+		 * @param[in] commands		The commands to execute.
+		 * @param[in] resources		The resources referenced by the commands.
+		 * @param[in] renderTarget	The render target to draw on.
+		 * @param[in] layerCache	The cache of the static layers, if any.
+		 */
+		void execute(_In_ const CommandBuffer& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget, _Inout_opt_ LayerCache* layerCache = nullptr);
+
+		/**
+		 * @brief Execute the commands of a single layer.
+		 * @note  renderTarget->BeginDraw() Must have been called.
+		 *
+		 * @param[in] commands		The commands to execute.
+		 * @param[in] resources		The resources referenced by the commands.
+		 * @param[in] renderTarget	The render target to draw on.
+		 */
+		void executeLayer(_In_ const CommandList& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget);
+
+		/**
+		 * @brief Allow reordering the commands of a layer by resource.
+		 *
+		 * @note Commands using the same resource keep their relative order,
+		 *       but overlapping commands of the same layer may be drawn in another order.
+		 */
+		inline void setBatchByResource(_In_ bool batch) noexcept { m_batchByResource = batch; }
+		inline bool isBatchByResource() const noexcept { return m_batchByResource; }
+
+		/**
+		 * @brief Set the color drawn instead of the bitmaps that are not uploaded yet.
+		 *
+		 * @param[in] color The color, as 0xAARRGGBB. Zero draws nothing.
+		 */
+		inline void setPlaceholderColor(_In_ UINT32 color) noexcept { m_placeholderColor = color; }
+
+		/**
+		 * @brief Set how the bitmaps are sampled when scaled.
+		 *
+		 * @param[in] mode Linear by default, nearest neighbour is cheaper.
+		 */
+		inline void setInterpolationMode(_In_ D2D1_BITMAP_INTERPOLATION_MODE mode) noexcept { m_interpolation = mode; }
+		inline D2D1_BITMAP_INTERPOLATION_MODE getInterpolationMode() const noexcept { return m_interpolation; }
+
+		/**
+		 * @brief Release the device dependent objects.
+		 * @note  Must be called whenever the render target is destroyed.
+		 */
+		void releaseDeviceResources() noexcept;
+
+		~D2D1Backend();
+	};
+
+} // namespace Render
+
+#endif // RENDER_COMMANDS_H
@@ -0,0 +1,440 @@
+#include "Replay.h"
+
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <windows.h>
+
+#include "EventHandler.h"
+#include "GraphicComponents.h"
+#include "Profiler.h"
+#include "SoftwareRenderer.h"
+#include "WindowClass.h"
+#include "fctdef.h"
+
+
+namespace Replay
+{
+
+	typedef std::chrono::steady_clock ticker;
+
+	constexpr BYTE LOG_MAGIC[4] = { 'G', 'D', 'R', 'P' };
+	constexpr BYTE LOG_VERSION = 1;
+	constexpr size_t FLUSH_SIZE = 64 * 1024; // Bytes buffered before writing to the file.
+
+	std::atomic<bool> isVirtualTime = false;
+	std::atomic<ticker::rep> virtualTime = 0;
+
+
+	TimePoint now() noexcept
+	{
+		if (isVirtualTime.load(std::memory_order_acquire))
+			return TimePoint(ticker::duration(virtualTime.load(std::memory_order_relaxed)));
+		return ticker::now();
+	}
+
+	void setVirtualTime(_In_ TimePoint time) noexcept
+	{
+		virtualTime.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+		isVirtualTime.store(true, std::memory_order_release);
+	}
+
+	void clearVirtualTime() noexcept
+	{
+		isVirtualTime.store(false, std::memory_order_release);
+	}
+
+
+
+	/************************/
+	/*		 Encoding		*/
+	/************************/
+
+
+	inline void writeVarint(_Inout_ std::vector<BYTE>& buffer, _In_ UINT64 value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back(static_cast<BYTE>(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back(static_cast<BYTE>(value));
+	}
+
+	/**
+	 * @brief Write a signed value, small negative values staying short.
+	 */
+	inline void writeSigned(_Inout_ std::vector<BYTE>& buffer, _In_ INT64 value)
+	{
+		writeVarint(buffer, (static_cast<UINT64>(value) << 1) ^ static_cast<UINT64>(value >> 63));
+	}
+
+	/**
+	 * @brief Read the values of a log, failing on truncation.
+	 */
+	struct Reader
+	{
+		const BYTE* position;
+		const BYTE* end;
+
+		inline bool readByte(_Out_ BYTE* value) noexcept
+		{
+			if (position == end) return false;
+			*value = *position++;
+			return true;
+		}
+
+		inline bool readVarint(_Out_ UINT64* value) noexcept
+		{
+			*value = 0;
+			for (UINT32 shift = 0; shift < 64; shift += 7)
+			{
+				BYTE byte;
+				if (!readByte(&byte)) return false;
+				*value |= static_cast<UINT64>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) return true;
+			}
+			return false;
+		}
+
+		inline bool readSigned(_Out_ INT64* value) noexcept
+		{
+			UINT64 encoded;
+			if (!readVarint(&encoded)) return false;
+			*value = static_cast<INT64>(encoded >> 1) ^ -static_cast<INT64>(encoded & 1);
+			return true;
+		}
+	};
+
+
+
+	/************************/
+	/*		 Recorder		*/
+	/************************/
+
+
+	/**
+	 * @brief Return true for the messages whose parameters are values: the input, the timers and the custom messages.
+	 *
+	 * @note The other system messages may carry pointers, meaningless once replayed, and only make sense to DefWindowProc.
+	 */
+	inline bool isReplayable(_In_ UINT uMsg) noexcept
+	{
+		return (uMsg >= WM_KEYFIRST && uMsg <= WM_KEYLAST) || (uMsg >= WM_MOUSEFIRST && uMsg <= WM_MOUSELAST)
+			|| uMsg == WM_TIMER || uMsg >= WM_USER; // CM_*, WM_APP and the registered messages.
+	}
+
+	void Recorder::onMessage(_In_ HWND /*hwnd*/, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+	{
+		if (isReplayable(uMsg)) reinterpret_cast<Recorder*>(context)->recordMessage(uMsg, wParam, lParam);
+	}
+
+	bool Recorder::start(_In_ const wchar_t* path)
+	{
+		stop();
+
+		m_file.open(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+		if (!m_file) return false;
+
+		m_buffer.assign(std::begin(LOG_MAGIC), std::end(LOG_MAGIC));
+		m_buffer.push_back(LOG_VERSION);
+		m_start = now();
+		m_lastTime = 0;
+		m_recordCount = 0;
+		m_isCapturing = true;
+		EventHandler::setMessageHook(onMessage, this);
+		return true;
+	}
+
+	void Recorder::stop()
+	{
+		if (!m_isCapturing) return;
+
+		EventHandler::setMessageHook(nullptr);
+		m_isCapturing = false;
+		flush();
+		m_file.close();
+	}
+
+	void Recorder::beginRecord(_In_ RecordType type)
+	{
+		const UINT64 time = static_cast<UINT64>(std::chrono::duration_cast<std::chrono::microseconds>(now() - m_start).count());
+		m_buffer.push_back(static_cast<BYTE>(type));
+		writeVarint(m_buffer, time - m_lastTime);
+		m_lastTime = time;
+		m_recordCount++;
+	}
+
+	void Recorder::flush()
+	{
+		PROFILE_ZONE("Recorder::flush");
+		m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+		m_buffer.clear();
+	}
+
+	void Recorder::recordMessage(_In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+	{
+		if (!m_isCapturing) return;
+
+		beginRecord(RecordType::Message);
+		writeVarint(m_buffer, uMsg);
+		writeVarint(m_buffer, static_cast<UINT64>(wParam));
+		writeSigned(m_buffer, static_cast<INT64>(lParam));
+		if (m_buffer.size() >= FLUSH_SIZE) flush();
+	}
+
+	void Recorder::recordAddComponent(_In_ const Graphics::Component& component, _In_ ComponentId componentId, _In_ ZIndex zIndex)
+	{
+		if (!m_isCapturing) return;
+
+		const char* type = typeid(component).name();
+		const size_t length = strlen(type);
+
+		beginRecord(RecordType::AddComponent);
+		writeVarint(m_buffer, componentId);
+		writeSigned(m_buffer, zIndex);
+		writeVarint(m_buffer, length);
+		m_buffer.insert(m_buffer.end(), type, type + length);
+		if (m_buffer.size() >= FLUSH_SIZE) flush();
+	}
+
+	void Recorder::recordRemoveComponent(_In_ ComponentId componentId)
+	{
+		if (!m_isCapturing) return;
+
+		beginRecord(RecordType::RemoveComponent);
+		writeVarint(m_buffer, componentId);
+		if (m_buffer.size() >= FLUSH_SIZE) flush();
+	}
+
+	void Recorder::recordSetZIndex(_In_ ComponentId componentId, _In_ ZIndex zIndex)
+	{
+		if (!m_isCapturing) return;
+
+		beginRecord(RecordType::SetZIndex);
+		writeVarint(m_buffer, componentId);
+		writeSigned(m_buffer, zIndex);
+		if (m_buffer.size() >= FLUSH_SIZE) flush();
+	}
+
+	Recorder::~Recorder()
+	{
+		stop();
+	}
+
+	bool readLog(_In_ const wchar_t* path, _Out_ std::vector<Record>* records)
+	{
+		records->clear();
+
+		std::ifstream file(std::filesystem::path(path), std::ios::binary);
+		if (!file) return false;
+		const std::vector<BYTE> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (content.size() < sizeof(LOG_MAGIC) + 1 || !std::equal(std::begin(LOG_MAGIC), std::end(LOG_MAGIC), content.begin())) return false;
+		if (content[sizeof(LOG_MAGIC)] != LOG_VERSION) return false;
+
+		Reader reader = { content.data() + sizeof(LOG_MAGIC) + 1, content.data() + content.size() };
+		UINT64 time = 0;
+		while (reader.position != reader.end)
+		{
+			Record record;
+			BYTE type;
+			UINT64 delta, value;
+			INT64 signedValue;
+			if (!reader.readByte(&type) || !reader.readVarint(&delta)) return false;
+			time += delta;
+			record.type = static_cast<RecordType>(type);
+			record.time = time;
+
+			switch (record.type)
+			{
+			case RecordType::Message:
+				if (!reader.readVarint(&value)) return false;
+				record.uMsg = static_cast<UINT>(value);
+				if (!reader.readVarint(&value)) return false;
+				record.wParam = static_cast<WPARAM>(value);
+				if (!reader.readSigned(&signedValue)) return false;
+				record.lParam = static_cast<LPARAM>(signedValue);
+				break;
+
+			case RecordType::AddComponent:
+				if (!reader.readVarint(&value) || !reader.readSigned(&signedValue)) return false;
+				record.componentId = static_cast<ComponentId>(value);
+				record.zIndex = static_cast<ZIndex>(signedValue);
+				if (!reader.readVarint(&value)) return false;
+				if (value > static_cast<UINT64>(reader.end - reader.position)) return false;
+				record.componentType.assign(reinterpret_cast<const char*>(reader.position), static_cast<size_t>(value));
+				reader.position += value;
+				break;
+
+			case RecordType::RemoveComponent:
+				if (!reader.readVarint(&value)) return false;
+				record.componentId = static_cast<ComponentId>(value);
+				break;
+
+			case RecordType::SetZIndex:
+				if (!reader.readVarint(&value) || !reader.readSigned(&signedValue)) return false;
+				record.componentId = static_cast<ComponentId>(value);
+				record.zIndex = static_cast<ZIndex>(signedValue);
+				break;
+
+			default:
+				return false;
+			}
+			records->push_back(std::move(record));
+		}
+		return true;
+	}
+
+
+
+	/************************/
+	/*		  Replay		*/
+	/************************/
+
+
+	UINT64 hashFramebuffer(_In_ const Render::Framebuffer& target) noexcept
+	{
+		UINT64 hash = 0xCBF29CE484222325;
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(target.pixels.data());
+		const size_t size = target.pixels.size() * sizeof(Graphics::Pixel);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001B3;
+		}
+		return hash;
+	}
+
+	inline double elapsedMs(_In_ ticker::time_point begin, _In_ ticker::time_point end) noexcept
+	{
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	}
+
+	void replay(_In_ const std::vector<Record>& records, _Inout_ BaseWindow& window, _Inout_ Render::SoftwareRenderer& renderer, _Inout_ Render::Framebuffer& target,
+		_In_opt_ COMPONENTFCT factory, _Inout_opt_ void* context, _Out_ Report* report)
+	{
+		PROFILE_ZONE("Replay::replay");
+		*report = {};
+		std::unordered_map<ComponentId, ComponentId> ids; // Captured id to replayed id.
+
+		// Real timings are measured with the steady clock, the window only sees the virtual one.
+		const ticker::time_point begin = ticker::now();
+		const TimePoint origin = begin;
+		setVirtualTime(origin);
+		window.resetAnimationClock();
+		window.getTimers().rebase(origin);
+
+		for (const Record& record : records)
+		{
+			setVirtualTime(origin + std::chrono::microseconds(record.time));
+
+			switch (record.type)
+			{
+			case RecordType::Message:
+			{
+				if (record.uMsg != CM_UPDATEFRAME)
+				{
+					// Logs of older builds may hold any message. Without events, handleMessage would give it to DefWindowProc.
+					if (isReplayable(record.uMsg) && EventHandler::hasEvent(record.uMsg))
+					{
+						report->messages++;
+						EventHandler::handleMessage(window.getHwnd(), record.uMsg, record.wParam, record.lParam);
+					}
+					// As the main loop does after each message.
+					window.updateTimers();
+					window.updateTasks();
+					break;
+				}
+
+				// Same steps as painting a frame, drawn in memory.
+				FrameResult frame = { report->frames.size(), record.time, 0.0, 0.0, 0.0, 0 };
+				const ticker::time_point start = ticker::now();
+				window.updateAnimations();
+				const ticker::time_point updated = ticker::now();
+				window.recordFrame();
+				window.cullFrame(target.width, target.height);
+				window.getGlyphCache().flush();
+				const ticker::time_point recorded = ticker::now();
+				renderer.render(window.getCommandBuffer(), window.getResources(), target);
+				const ticker::time_point rendered = ticker::now();
+
+				frame.updateMs = elapsedMs(start, updated);
+				frame.recordMs = elapsedMs(updated, recorded);
+				frame.renderMs = elapsedMs(recorded, rendered);
+				frame.hash = hashFramebuffer(target);
+				window.getResources().getTextures().trim();
+				report->frames.push_back(frame);
+				window.getTasks().advanceFrame();
+				window.updateTimers();
+				window.updateTasks();
+				break;
+			}
+
+			case RecordType::AddComponent:
+			{
+				std::unique_ptr<Graphics::Component> component = factory ? (*factory)(record, context) : nullptr;
+				if (component == nullptr) break;
+				ids[record.componentId] = window.addComponent(std::move(component), record.zIndex);
+				report->addedComponents++;
+				break;
+			}
+
+			case RecordType::RemoveComponent:
+			{
+				auto it = ids.find(record.componentId);
+				if (it == ids.end()) break;
+				window.removeComponent(it->second);
+				ids.erase(it);
+				report->removedComponents++;
+				break;
+			}
+
+			case RecordType::SetZIndex:
+			{
+				auto it = ids.find(record.componentId);
+				if (it != ids.end()) window.setComponentZIndex(it->second, record.zIndex);
+				break;
+			}
+			}
+		}
+
+		clearVirtualTime();
+		report->totalMs = elapsedMs(begin, ticker::now());
+	}
+
+	bool writeJson(_In_ const Report& report, _In_ const wchar_t* path)
+	{
+		std::ofstream file{ std::filesystem::path(path) };
+		if (!file) return false;
+
+		file << std::setprecision(6) << "{\"messages\":" << report.messages
+			<< ",\"added_components\":" << report.addedComponents
+			<< ",\"removed_components\":" << report.removedComponents
+			<< ",\"total_ms\":" << report.totalMs << ",\"frames\":[";
+		for (size_t i = 0; i < report.frames.size(); i++)
+		{
+			const FrameResult& frame = report.frames[i];
+			std::ostringstream hash;
+			hash << std::hex << std::setw(16) << std::setfill('0') << frame.hash;
+
+			file << (i == 0 ? "\n" : ",\n") << "{\"index\":" << frame.index
+				<< ",\"time_us\":" << frame.time
+				<< ",\"update_ms\":" << frame.updateMs
+				<< ",\"record_ms\":" << frame.recordMs
+				<< ",\"render_ms\":" << frame.renderMs
+				<< ",\"hash\":\"" << hash.str() << "\"}";
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+} // namespace Replay
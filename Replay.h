@@ -0,0 +1,209 @@
+#pragma once
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Windows.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GraphicComponents.h"
+#include "SoftwareRenderer.h"
+#include "WindowClass.h"
+#include "fctdef.h"
+
+
+namespace Replay
+{
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	/**
+	 * @brief Return the time used by the windows: the virtual time while replaying, the steady clock otherwise.
+	 */
+	TimePoint now() noexcept;
+
+	/**
+	 * @brief Freeze the time returned by now, until the next call or clearVirtualTime.
+	 */
+	void setVirtualTime(_In_ TimePoint time) noexcept;
+	void clearVirtualTime() noexcept;
+
+
+	enum class RecordType : BYTE
+	{
+		Message,			// A message given to EventHandler::handleMessage.
+		AddComponent,		// A component added to a window.
+		RemoveComponent,	// A component removed from a window.
+		SetZIndex,			// A component moved to another z-index.
+	};
+
+	/**
+	 * @brief An entry of a capture log.
+	 */
+	struct Record
+	{
+		RecordType type = RecordType::Message;
+		UINT64 time = 0;				// Microseconds since the start of the capture.
+
+		// Message.
+		UINT uMsg = 0;
+		WPARAM wParam = 0;
+		LPARAM lParam = 0;
+
+		// AddComponent, RemoveComponent and SetZIndex.
+		ComponentId componentId = 0;	// The id given by the capturing window.
+		ZIndex zIndex = 0;
+		std::string componentType;		// The type name of the component, for AddComponent.
+	};
+
+
+	/**
+	 * @brief Capture the messages and the component changes of a window into a binary log.
+	 *
+	 * @note Records are varint encoded and delta timed: a mouse move takes about 8 bytes.
+	 *       They are buffered in memory and written by blocks, so capturing stays cheap.
+	 *       Give the recorder to the window with BaseWindow::setRecorder to capture its components.
+	 */
+	class Recorder
+	{
+	private:
+		std::ofstream m_file;
+		std::vector<BYTE> m_buffer;
+		TimePoint m_start;
+		UINT64 m_lastTime = 0;
+		UINT64 m_recordCount = 0;
+		bool m_isCapturing = false;
+
+		static void onMessage(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context);
+
+		void beginRecord(_In_ RecordType type);
+		void flush();
+
+	public:
+		Recorder() = default;
+		Recorder(Recorder&) = delete;
+		Recorder& operator=(const Recorder&) = delete;
+
+		/**
+		 * @brief Start capturing the handled messages whose parameters are values: the input, the timers and the custom messages.
+		 *
+		 * @param[in] path The log to write, replaced if it exists.
+		 *
+		 * @retval bool
+		 * @return True if the log has been created, false otherwise.
+		 */
+		bool start(_In_ const wchar_t* path);
+
+		/**
+		 * @brief Stop capturing and write the end of the log.
+		 */
+		void stop();
+
+		inline bool isCapturing() const noexcept { return m_isCapturing; }
+		inline UINT64 getRecordCount() const noexcept { return m_recordCount; }
+
+		/**
+		 * @brief Capture a message. Called by the message hook, or directly for messages not going through the event handler.
+		 */
+		void recordMessage(_In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
+
+		/**
+		 * @brief Capture a component added to the window.
+		 */
+		void recordAddComponent(_In_ const Graphics::Component& component, _In_ ComponentId componentId, _In_ ZIndex zIndex);
+
+		/**
+		 * @brief Capture a component removed from the window.
+		 */
+		void recordRemoveComponent(_In_ ComponentId componentId);
+
+		/**
+		 * @brief Capture a component moved to another z-index.
+		 */
+		void recordSetZIndex(_In_ ComponentId componentId, _In_ ZIndex zIndex);
+
+		~Recorder();
+	};
+
+	/**
+	 * @brief Read a log written by a recorder.
+	 *
+	 * @retval bool
+	 * @return True if the whole log has been read, false if it is missing, corrupted or truncated.
+	 */
+	bool readLog(_In_ const wchar_t* path, _Out_ std::vector<Record>* records);
+
+
+	/**
+	 * @brief A window without HWND nor render target, to replay logs offscreen.
+	 */
+	class HeadlessWindow : public BaseWindow
+	{
+	public:
+		HeadlessWindow() = default;
+	};
+
+	/**
+	 * @brief Create the component of an AddComponent record.
+	 *
+	 * @retval std::unique_ptr<Component>
+	 * @return The component to add, or nullptr to skip the record.
+	 */
+	typedef std::unique_ptr<Graphics::Component>(*COMPONENTFCT)(_In_ const Record& record, _Inout_opt_ void* context);
+
+	struct FrameResult
+	{
+		UINT64 index;
+		UINT64 time;		// Virtual time of the frame, in microseconds since the start of the capture.
+		double updateMs;	// Animations.
+		double recordMs;	// Recording the commands and the glyphs.
+		double renderMs;	// Software rendering.
+		UINT64 hash;		// Of the rendered pixels.
+	};
+
+	struct Report
+	{
+		std::vector<FrameResult> frames;
+		UINT64 messages = 0;
+		UINT64 addedComponents = 0;
+		UINT64 removedComponents = 0;
+		double totalMs = 0.0;
+	};
+
+	/**
+	 * @brief Return the FNV-1a hash of the pixels of a framebuffer.
+	 */
+	UINT64 hashFramebuffer(_In_ const Render::Framebuffer& target) noexcept;
+
+	/**
+	 * @brief Feed a log to a window with a virtual clock, rendering a frame at each CM_UPDATEFRAME.
+	 *
+	 * @note The other messages go through EventHandler::handleMessage, like when captured, if they have events.
+	 *       The frames are rendered by the software renderer: their hashes only depend on the log,
+	 *       so two runs of the same build must match, whatever the machine and the thread count.
+	 *
+	 * @param[in] records	The log to replay.
+	 * @param[in] window	The window to feed, usually a HeadlessWindow.
+	 * @param[in] renderer	The renderer drawing the frames.
+	 * @param[in] target	The framebuffer to draw on, its size is the area drawn.
+	 * @param[in] factory	The function creating the components of the AddComponent records.
+	 * @param[in] context	The context given to the factory.
+	 * @param[out] report	The timings and the hashes of the frames.
+	 */
+	void replay(_In_ const std::vector<Record>& records, _Inout_ BaseWindow& window, _Inout_ Render::SoftwareRenderer& renderer, _Inout_ Render::Framebuffer& target,
+		_In_opt_ COMPONENTFCT factory, _Inout_opt_ void* context, _Out_ Report* report);
+
+	/**
+	 * @brief Write a replay report as json.
+	 *
+	 * @retval bool
+	 * @return True if the file has been written, false otherwise.
+	 */
+	bool writeJson(_In_ const Report& report, _In_ const wchar_t* path);
+
+} // namespace Replay
+
+#endif // REPLAY_H
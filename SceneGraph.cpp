@@ -0,0 +1,283 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <windows.h>
+
+
+namespace Graphics
+{
+
+	inline Affine toAffine(_In_ const LocalTransform& local) noexcept
+	{
+		const float c = std::cos(local.rotation);
+		const float s = std::sin(local.rotation);
+		return {
+			local.scale.width * c,		local.scale.width * s,
+			-local.scale.height * s,	local.scale.height * c,
+			local.position.x,			local.position.y
+		};
+	}
+
+	/**
+	 * @brief Split a transform into a scale, a rotation and a position.
+	 *
+	 * @note Exact for the products of local transforms but the shear a non-uniform scale gives to a rotated child.
+	 */
+	inline LocalTransform toLocal(_In_ const Affine& affine) noexcept
+	{
+		LocalTransform local;
+		local.position = { affine.dx, affine.dy };
+		local.scale.width = std::hypot(affine.m11, affine.m12);
+		local.rotation = std::atan2(affine.m12, affine.m11);
+		local.scale.height = local.scale.width > 0.0f ? (affine.m11 * affine.m22 - affine.m12 * affine.m21) / local.scale.width : std::hypot(affine.m21, affine.m22);
+		return local;
+	}
+
+	void SceneGraph::unlink(_In_ NodeId id) noexcept
+	{
+		Links& links = m_links[id];
+		NodeId& first = links.parent == INVALID_NODE ? m_firstRoot : m_links[links.parent].firstChild;
+		NodeId& last = links.parent == INVALID_NODE ? m_lastRoot : m_links[links.parent].lastChild;
+
+		if (links.previousSibling != INVALID_NODE) m_links[links.previousSibling].nextSibling = links.nextSibling;
+		else first = links.nextSibling;
+
+		if (links.nextSibling != INVALID_NODE) m_links[links.nextSibling].previousSibling = links.previousSibling;
+		else last = links.previousSibling;
+
+		links.parent = links.previousSibling = links.nextSibling = INVALID_NODE;
+	}
+
+	void SceneGraph::link(_In_ NodeId id, _In_ NodeId parent) noexcept
+	{
+		NodeId& first = parent == INVALID_NODE ? m_firstRoot : m_links[parent].firstChild;
+		NodeId& last = parent == INVALID_NODE ? m_lastRoot : m_links[parent].lastChild;
+
+		Links& links = m_links[id];
+		links.parent = parent;
+		links.previousSibling = last;
+		links.nextSibling = INVALID_NODE;
+
+		if (last != INVALID_NODE) m_links[last].nextSibling = id;
+		else first = id;
+		last = id;
+	}
+
+	void SceneGraph::markDirty(_In_ NodeId id)
+	{
+		if (m_isDirty[id]) return;
+		m_isDirty[id] = true;
+		m_dirtyNodes.push_back(id);
+	}
+
+	NodeId SceneGraph::create(_In_ NodeId parent, _In_ const LocalTransform& local, _In_opt_ void* userData)
+	{
+		NodeId id;
+		if (!m_freeIds.empty())
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		else
+		{
+			id = static_cast<NodeId>(m_links.size());
+			m_links.push_back({});
+			m_slotOf.push_back(0);
+			m_isDirty.push_back(false);
+		}
+
+		// Appended at the end of the storage, put in place by the next update.
+		const UINT32 slot = static_cast<UINT32>(m_ids.size());
+		m_ids.push_back(id);
+		m_parentSlot.push_back(INVALID_NODE);
+		m_subtreeEnd.push_back(slot + 1);
+		m_local.push_back(local);
+		m_size.push_back({ 0.0f, 0.0f });
+		m_userData.push_back(userData);
+		m_world.push_back(toAffine(local));
+
+		m_slotOf[id] = slot;
+		m_links[id] = {};
+		m_links[id].isUsed = true;
+		link(id, parent);
+
+		m_isOrderDirty = true;
+		markDirty(id);
+		return id;
+	}
+
+	void SceneGraph::destroy(_In_ NodeId id)
+	{
+		if (id >= m_links.size() || !m_links[id].isUsed) return;
+
+		// The children keep their place on screen: the node's transform moves into theirs.
+		const NodeId parent = m_links[id].parent;
+		const Affine removed = toAffine(m_local[m_slotOf[id]]);
+		while (m_links[id].firstChild != INVALID_NODE)
+		{
+			const NodeId child = m_links[id].firstChild;
+			LocalTransform& local = m_local[m_slotOf[child]];
+			local = toLocal(multiply(toAffine(local), removed));
+			unlink(child);
+			link(child, parent);
+			markDirty(child);
+		}
+		unlink(id);
+
+		// The slot is dropped by the next update.
+		const UINT32 slot = m_slotOf[id];
+		m_userData[slot] = nullptr;
+		m_size[slot] = { 0.0f, 0.0f };
+		m_ids[slot] = INVALID_NODE;
+
+		m_links[id].isUsed = false;
+		m_freeIds.push_back(id);
+		m_isOrderDirty = true;
+	}
+
+	bool SceneGraph::setParent(_In_ NodeId id, _In_ NodeId parent)
+	{
+		for (NodeId ancestor = parent; ancestor != INVALID_NODE; ancestor = m_links[ancestor].parent)
+			if (ancestor == id) return false;
+
+		unlink(id);
+		link(id, parent);
+		m_isOrderDirty = true;
+		markDirty(id);
+		return true;
+	}
+
+	void SceneGraph::setLocal(_In_ NodeId id, _In_ const LocalTransform& local)
+	{
+		m_local[m_slotOf[id]] = local;
+		markDirty(id);
+	}
+
+	void SceneGraph::setPosition(_In_ NodeId id, _In_ const D2D1_POINT_2F& position)
+	{
+		m_local[m_slotOf[id]].position = position;
+		markDirty(id);
+	}
+
+	void SceneGraph::rebuildOrder()
+	{
+		const size_t count = m_links.size() - m_freeIds.size();
+
+		std::vector<NodeId> ids;
+		std::vector<UINT32> parentSlot;
+		std::vector<LocalTransform> local;
+		std::vector<D2D1_SIZE_F> size;
+		std::vector<void*> userData;
+		std::vector<Affine> world;
+		ids.reserve(count); parentSlot.reserve(count); local.reserve(count);
+		size.reserve(count); userData.reserve(count); world.reserve(count);
+
+		// Depth first, children in order: push the siblings from the last one.
+		std::vector<UINT32>& stack = m_scratch;
+		stack.clear();
+		for (NodeId root = m_lastRoot; root != INVALID_NODE; root = m_links[root].previousSibling)
+			stack.push_back(root);
+
+		while (!stack.empty())
+		{
+			const NodeId id = stack.back();
+			stack.pop_back();
+
+			const UINT32 oldSlot = m_slotOf[id];
+			const NodeId parent = m_links[id].parent;
+			ids.push_back(id);
+			parentSlot.push_back(parent == INVALID_NODE ? INVALID_NODE : m_slotOf[parent]); // Parents are visited first: already renumbered.
+			local.push_back(m_local[oldSlot]);
+			size.push_back(m_size[oldSlot]);
+			userData.push_back(m_userData[oldSlot]);
+			world.push_back(m_world[oldSlot]);
+			m_slotOf[id] = static_cast<UINT32>(ids.size() - 1);
+
+			for (NodeId child = m_links[id].lastChild; child != INVALID_NODE; child = m_links[child].previousSibling)
+				stack.push_back(child);
+		}
+
+		m_subtreeEnd.resize(ids.size());
+		for (UINT32 slot = 0; slot < ids.size(); slot++)
+			m_subtreeEnd[slot] = slot + 1;
+		for (size_t slot = ids.size(); slot-- > 0;)
+			if (parentSlot[slot] != INVALID_NODE)
+				m_subtreeEnd[parentSlot[slot]] = (std::max)(m_subtreeEnd[parentSlot[slot]], m_subtreeEnd[slot]);
+
+		m_ids = std::move(ids);
+		m_parentSlot = std::move(parentSlot);
+		m_local = std::move(local);
+		m_size = std::move(size);
+		m_userData = std::move(userData);
+		m_world = std::move(world);
+		m_isOrderDirty = false;
+	}
+
+	void SceneGraph::update()
+	{
+		if (m_isOrderDirty) rebuildOrder();
+		if (m_dirtyNodes.empty()) return;
+
+		std::vector<UINT32>& slots = m_scratch;
+		slots.clear();
+		for (NodeId id : m_dirtyNodes)
+		{
+			m_isDirty[id] = false;
+			if (m_links[id].isUsed) slots.push_back(m_slotOf[id]);
+		}
+		m_dirtyNodes.clear();
+		std::sort(slots.begin(), slots.end());
+
+		// A dirty node inside an already updated subtree is already up to date.
+		UINT32 updatedEnd = 0;
+		for (UINT32 slot : slots)
+		{
+			if (slot < updatedEnd) continue;
+
+			updatedEnd = m_subtreeEnd[slot];
+			for (UINT32 i = slot; i < updatedEnd; i++)
+			{
+				const Affine local = toAffine(m_local[i]);
+				m_world[i] = m_parentSlot[i] == INVALID_NODE ? local : multiply(local, m_world[m_parentSlot[i]]);
+			}
+		}
+	}
+
+	bool SceneGraph::contains(_In_ UINT32 slot, _In_ const D2D1_POINT_2F& point) const noexcept
+	{
+		if (m_userData[slot] == nullptr || m_size[slot].width <= 0.0f || m_size[slot].height <= 0.0f) return false;
+
+		const Affine& world = m_world[slot];
+		const float determinant = world.m11 * world.m22 - world.m12 * world.m21;
+		if (std::fabs(determinant) < 1e-12f) return false;
+
+		// Back to the node's local space.
+		const float px = point.x - world.dx;
+		const float py = point.y - world.dy;
+		const float x = (px * world.m22 - py * world.m21) / determinant;
+		const float y = (py * world.m11 - px * world.m12) / determinant;
+
+		return x >= 0.0f && y >= 0.0f && x < m_size[slot].width && y < m_size[slot].height;
+	}
+
+	void* SceneGraph::hitTest(_In_ const D2D1_POINT_2F& point) const noexcept
+	{
+		for (UINT32 slot = static_cast<UINT32>(m_ids.size()); slot-- > 0;)
+		{
+			if (contains(slot, point)) return m_userData[slot];
+		}
+		return nullptr;
+	}
+
+	void SceneGraph::hitTestAll(_In_ const D2D1_POINT_2F& point, _Out_ std::vector<void*>* hits) const
+	{
+		hits->clear();
+		for (UINT32 slot = 0; slot < m_ids.size(); slot++)
+		{
+			if (contains(slot, point)) hits->push_back(m_userData[slot]);
+		}
+	}
+
+} // namespace Graphics
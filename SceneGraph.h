@@ -0,0 +1,184 @@
+#pragma once
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include <d2d1.h>
+
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	typedef UINT32 NodeId;
+
+	constexpr NodeId INVALID_NODE = 0xFFFFFFFF;
+
+	/**
+	 * @brief A 2D affine transform, applied to row vectors: p' = p * M, like D2D1_MATRIX_3X2_F.
+	 */
+	struct Affine
+	{
+		float m11 = 1.0f, m12 = 0.0f;
+		float m21 = 0.0f, m22 = 1.0f;
+		float dx = 0.0f, dy = 0.0f;
+
+		inline D2D1_POINT_2F apply(_In_ const D2D1_POINT_2F& p) const noexcept { return { p.x * m11 + p.y * m21 + dx, p.x * m12 + p.y * m22 + dy }; }
+	};
+
+	/**
+	 * @brief Return a then b.
+	 */
+	inline Affine multiply(_In_ const Affine& a, _In_ const Affine& b) noexcept
+	{
+		return {
+			a.m11 * b.m11 + a.m12 * b.m21,	a.m11 * b.m12 + a.m12 * b.m22,
+			a.m21 * b.m11 + a.m22 * b.m21,	a.m21 * b.m12 + a.m22 * b.m22,
+			a.dx * b.m11 + a.dy * b.m21 + b.dx,	a.dx * b.m12 + a.dy * b.m22 + b.dy
+		};
+	}
+
+	/**
+	 * @brief A transform relative to the parent node.
+	 */
+	struct LocalTransform
+	{
+		D2D1_POINT_2F position = { 0.0f, 0.0f };
+		D2D1_SIZE_F scale = { 1.0f, 1.0f };
+		float rotation = 0.0f; // Radians, clockwise.
+	};
+
+
+	/**
+	 * @brief Parent/child hierarchy of transforms with cached world transforms.
+	 *
+	 * @note The nodes are stored in depth-first order, so a node's subtree is the range following it.
+	 *       Changing a local transform only marks the node: update() then recomputes the world
+	 *       transforms of the marked subtrees, once each, in a linear pass over their ranges.
+	 *       Structural changes (create, destroy, setParent) reorder the storage on the next update().
+	 */
+	class SceneGraph
+	{
+	private:
+		struct Links
+		{
+			NodeId parent = INVALID_NODE;
+			NodeId firstChild = INVALID_NODE;
+			NodeId lastChild = INVALID_NODE;
+			NodeId previousSibling = INVALID_NODE;
+			NodeId nextSibling = INVALID_NODE;
+			bool isUsed = false;
+		};
+
+		// Per node id, stable.
+		std::vector<Links> m_links;
+		std::vector<UINT32> m_slotOf;		// Position of the node in the depth-first storage.
+		std::vector<NodeId> m_freeIds;
+		NodeId m_firstRoot = INVALID_NODE;
+		NodeId m_lastRoot = INVALID_NODE;
+
+		// Per slot, in depth-first order.
+		std::vector<NodeId> m_ids;
+		std::vector<UINT32> m_parentSlot;	// INVALID_NODE for roots.
+		std::vector<UINT32> m_subtreeEnd;	// Slot following the node's subtree.
+		std::vector<LocalTransform> m_local;
+		std::vector<D2D1_SIZE_F> m_size;
+		std::vector<void*> m_userData;
+		std::vector<Affine> m_world;
+
+		std::vector<NodeId> m_dirtyNodes;
+		std::vector<bool> m_isDirty;		// Per node id.
+		bool m_isOrderDirty = false;
+
+		std::vector<UINT32> m_scratch;		// Reused by update.
+
+		void unlink(_In_ NodeId id) noexcept;
+		void link(_In_ NodeId id, _In_ NodeId parent) noexcept;
+		void markDirty(_In_ NodeId id);
+		void rebuildOrder();
+		bool contains(_In_ UINT32 slot, _In_ const D2D1_POINT_2F& point) const noexcept;
+
+	public:
+		SceneGraph() = default;
+		SceneGraph(SceneGraph&) = delete;
+		SceneGraph& operator=(const SceneGraph&) = delete;
+
+		/**
+		 * @brief Create a node.
+		 *
+		 * @param[in] parent	The parent node, INVALID_NODE for a root.
+		 * @param[in] local		The transform relative to the parent.
+		 * @param[in] userData	Data returned by hitTest, usually the component.
+		 *
+		 * @retval NodeId
+		 * @return The id of the node.
+		 */
+		NodeId create(_In_ NodeId parent, _In_ const LocalTransform& local, _In_opt_ void* userData = nullptr);
+
+		/**
+		 * @brief Destroy a node. Its children are given to its parent, their local transforms combined with the node's.
+		 */
+		void destroy(_In_ NodeId id);
+
+		/**
+		 * @brief Move a node and its subtree under another parent.
+		 *
+		 * @retval bool
+		 * @return False if the parent is the node itself or one of its descendants, true otherwise.
+		 */
+		bool setParent(_In_ NodeId id, _In_ NodeId parent);
+
+		inline NodeId getParent(_In_ NodeId id) const noexcept { return m_links[id].parent; }
+
+		inline const LocalTransform& getLocal(_In_ NodeId id) const noexcept { return m_local[m_slotOf[id]]; }
+		void setLocal(_In_ NodeId id, _In_ const LocalTransform& local);
+		void setPosition(_In_ NodeId id, _In_ const D2D1_POINT_2F& position);
+
+		/**
+		 * @brief Set the unscaled size of the node, used by hitTest.
+		 */
+		inline void setSize(_In_ NodeId id, _In_ const D2D1_SIZE_F& size) noexcept { m_size[m_slotOf[id]] = size; }
+
+		/**
+		 * @brief Return the world transform computed by the last update.
+		 */
+		inline const Affine& getWorld(_In_ NodeId id) const noexcept { return m_world[m_slotOf[id]]; }
+
+		/**
+		 * @brief Recompute the order if needed, then the world transforms of the changed subtrees.
+		 */
+		void update();
+
+		/**
+		 * @brief Find the node under a point, using the world transforms of the last update.
+		 *
+		 * @note The last node in depth-first order wins: children are above their parent.
+		 *
+		 * @param[in] point The point in client pixels.
+		 *
+		 * @retval void*
+		 * @return The user data of the node hit, or nullptr if there is none.
+		 */
+		void* hitTest(_In_ const D2D1_POINT_2F& point) const noexcept;
+
+		/**
+		 * @brief Find every node under a point, using the world transforms of the last update.
+		 *
+		 * @note For a caller with its own drawing order: the scene graph only knows the hierarchy.
+		 *
+		 * @param[in] point	The point in client pixels.
+		 * @param[out] hits	The user data of the nodes hit, in depth-first order.
+		 */
+		void hitTestAll(_In_ const D2D1_POINT_2F& point, _Out_ std::vector<void*>* hits) const;
+
+		inline size_t getCount() const noexcept { return m_ids.size(); }
+	};
+
+} // namespace Graphics
+
+#endif // SCENE_GRAPH_H
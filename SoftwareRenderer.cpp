@@ -0,0 +1,365 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <windows.h>
+
+#include "GeometryCache.h"
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+#include "ThreadPool.h"
+
+
+namespace Render
+{
+
+	/**
+	 * @brief Pixels covered by a rectangle: those whose center is inside it.
+	 */
+	struct PixelSpan
+	{
+		LONG left, top, right, bottom; // right and bottom excluded.
+	};
+
+	inline PixelSpan toPixelSpan(_In_ const D2D1_RECT_F& rect) noexcept
+	{
+		return {
+			static_cast<LONG>(std::ceil(rect.left - 0.5f)),
+			static_cast<LONG>(std::ceil(rect.top - 0.5f)),
+			static_cast<LONG>(std::ceil(rect.right - 0.5f)),
+			static_cast<LONG>(std::ceil(rect.bottom - 0.5f))
+		};
+	}
+
+	/**
+	 * @brief Pixels that may be touched by a geometry: those partially covered by its bounds included.
+	 */
+	inline PixelSpan toGeometrySpan(_In_ const D2D1_RECT_F& rect) noexcept
+	{
+		return {
+			static_cast<LONG>(std::floor(rect.left)) - 1,
+			static_cast<LONG>(std::floor(rect.top)) - 1,
+			static_cast<LONG>(std::ceil(rect.right)) + 1,
+			static_cast<LONG>(std::ceil(rect.bottom)) + 1
+		};
+	}
+
+	inline PixelSpan clipSpan(_In_ const PixelSpan& span, _In_ const PixelSpan& clip) noexcept
+	{
+		return {
+			(std::max)(span.left, clip.left),
+			(std::max)(span.top, clip.top),
+			(std::min)(span.right, clip.right),
+			(std::min)(span.bottom, clip.bottom)
+		};
+	}
+
+	inline Graphics::Pixel scalePixel(_In_ const Graphics::Pixel& pixel, _In_ UINT32 alpha) noexcept
+	{
+		return Graphics::Pixel(
+			static_cast<BYTE>((pixel.r * alpha + 0x7F) / 0xFF),
+			static_cast<BYTE>((pixel.g * alpha + 0x7F) / 0xFF),
+			static_cast<BYTE>((pixel.b * alpha + 0x7F) / 0xFF),
+			static_cast<BYTE>((pixel.a * alpha + 0x7F) / 0xFF)
+		);
+	}
+
+	void fillSpan(_In_ const PixelSpan& span, _In_ const Graphics::Pixel& color, _Inout_ Framebuffer& target) noexcept
+	{
+		for (LONG y = span.top; y < span.bottom; y++)
+		{
+			Graphics::Pixel* row = &target.at(0, y);
+			for (LONG x = span.left; x < span.right; x++)
+				blendPixel(row[x], color);
+		}
+	}
+
+	inline D2D1_RECT_F getSourceRect(_In_ const Command& command, _In_ const BitmapResource& bitmap) noexcept
+	{
+		const bool isWhole = command.source.right <= command.source.left || command.source.bottom <= command.source.top;
+		return isWhole ? D2D1::RectF(0.0f, 0.0f, static_cast<float>(bitmap.width), static_cast<float>(bitmap.height)) : command.source;
+	}
+
+	void drawBitmapSpan(_In_ const PixelSpan& span, _In_ const Command& command, _In_ const BitmapResource& bitmap, _In_ const Graphics::Pixel* pixels, _Inout_ Framebuffer& target) noexcept
+	{
+		const D2D1_RECT_F& dst = command.destination;
+		const D2D1_RECT_F src = getSourceRect(command, bitmap);
+
+		const float scaleX = (src.right - src.left) / (dst.right - dst.left);
+		const float scaleY = (src.bottom - src.top) / (dst.bottom - dst.top);
+		const UINT32 alpha = static_cast<UINT32>(std::lround((std::clamp)(command.opacity, 0.0f, 1.0f) * 255.0f));
+		const LONG maxX = static_cast<LONG>(bitmap.width) - 1;
+		const LONG maxY = static_cast<LONG>(bitmap.height) - 1;
+
+		// Nearest neighbour sampling, at the center of each destination pixel.
+		for (LONG y = span.top; y < span.bottom; y++)
+		{
+			LONG sy = static_cast<LONG>(std::floor(src.top + (static_cast<float>(y) + 0.5f - dst.top) * scaleY));
+			sy = (std::clamp)(sy, 0L, maxY);
+			const Graphics::Pixel* sourceRow = pixels + static_cast<size_t>(sy) * bitmap.width;
+			Graphics::Pixel* row = &target.at(0, y);
+
+			for (LONG x = span.left; x < span.right; x++)
+			{
+				LONG sx = static_cast<LONG>(std::floor(src.left + (static_cast<float>(x) + 0.5f - dst.left) * scaleX));
+				sx = (std::clamp)(sx, 0L, maxX);
+				if (alpha == 0xFF) blendPixel(row[x], sourceRow[sx]);
+				else blendPixel(row[x], scalePixel(sourceRow[sx], alpha));
+			}
+		}
+	}
+
+	inline void fillMaskSpan(_In_ const PixelSpan& span, _In_ const D2D1_RECT_F& dst, _In_ const D2D1_RECT_F& src, _In_ const BitmapResource& bitmap, _In_ const Graphics::Pixel* pixels, _In_ const Graphics::Pixel& color, _Inout_ Framebuffer& target) noexcept
+	{
+		const float scaleX = (src.right - src.left) / (dst.right - dst.left);
+		const float scaleY = (src.bottom - src.top) / (dst.bottom - dst.top);
+		const LONG maxX = static_cast<LONG>(bitmap.width) - 1;
+		const LONG maxY = static_cast<LONG>(bitmap.height) - 1;
+
+		// Same sampling as drawBitmapSpan, only the alpha of the mask is used.
+		for (LONG y = span.top; y < span.bottom; y++)
+		{
+			LONG sy = static_cast<LONG>(std::floor(src.top + (static_cast<float>(y) + 0.5f - dst.top) * scaleY));
+			sy = (std::clamp)(sy, 0L, maxY);
+			const Graphics::Pixel* sourceRow = pixels + static_cast<size_t>(sy) * bitmap.width;
+			Graphics::Pixel* row = &target.at(0, y);
+
+			for (LONG x = span.left; x < span.right; x++)
+			{
+				LONG sx = static_cast<LONG>(std::floor(src.left + (static_cast<float>(x) + 0.5f - dst.left) * scaleX));
+				sx = (std::clamp)(sx, 0L, maxX);
+				const UINT32 coverage = sourceRow[sx].a;
+				if (coverage == 0xFF) blendPixel(row[x], color);
+				else if (coverage != 0) blendPixel(row[x], scalePixel(color, coverage));
+			}
+		}
+	}
+
+	void drawMaskSpan(_In_ const PixelSpan& span, _In_ const Command& command, _In_ const BitmapResource& bitmap, _In_ const Graphics::Pixel* pixels, _Inout_ Framebuffer& target) noexcept
+	{
+		const UINT32 alpha = static_cast<UINT32>(std::lround((std::clamp)(command.opacity, 0.0f, 1.0f) * 255.0f));
+		fillMaskSpan(span, command.destination, getSourceRect(command, bitmap), bitmap, pixels, scalePixel(toPremultipliedPixel(command.color), alpha), target);
+	}
+
+	inline D2D1_RECT_F toSpriteRect(_In_ const Sprite& sprite) noexcept
+	{
+		return D2D1::RectF(sprite.left, sprite.top, sprite.left + sprite.size, sprite.top + sprite.size);
+	}
+
+	void drawSpritesSpan(_In_ const PixelSpan& tile, _In_ const Command& command, _In_ const Sprite* sprites, _In_ UINT32 count, _In_ const BitmapResource& bitmap, _In_ const Graphics::Pixel* pixels, _Inout_ Framebuffer& target) noexcept
+	{
+		const D2D1_RECT_F src = getSourceRect(command, bitmap);
+		const UINT32 alpha = static_cast<UINT32>(std::lround((std::clamp)(command.opacity, 0.0f, 1.0f) * 255.0f));
+
+		for (UINT32 i = 0; i < count; i++)
+		{
+			const Sprite& sprite = sprites[i];
+			const D2D1_RECT_F dst = toSpriteRect(sprite);
+			const Graphics::Pixel color = alpha == 0xFF ? toPremultipliedPixel(sprite.color) : scalePixel(toPremultipliedPixel(sprite.color), alpha);
+			fillMaskSpan(clipSpan(toPixelSpan(dst), tile), dst, src, bitmap, pixels, color, target);
+		}
+	}
+
+
+
+	void fillGeometrySpans(_In_ const PixelSpan& tile, _In_ const Command& command, _In_ const GeometrySpans& geometry, _Inout_ Framebuffer& target) noexcept
+	{
+		const D2D1_RECT_F& bounds = geometry.bounds;
+
+		// Moved by whole pixels, so the spans rasterized once fit every position.
+		const LONG offsetX = std::lround(command.destination.left - bounds.left);
+		const LONG offsetY = std::lround(command.destination.top - bounds.top);
+		const UINT32 alpha = static_cast<UINT32>(std::lround((std::clamp)(command.opacity, 0.0f, 1.0f) * 255.0f));
+		const Graphics::Pixel color = scalePixel(toPremultipliedPixel(command.color), alpha);
+
+		// Spans are sorted by row: skip to the first row of the tile.
+		auto it = std::lower_bound(geometry.spans.begin(), geometry.spans.end(), tile.top - offsetY, [](const CoverageSpan& span, LONG y) {
+			return span.y < y;
+		});
+		for (; it != geometry.spans.end() && it->y + offsetY < tile.bottom; it++)
+		{
+			const LONG x = it->x + offsetX;
+			const LONG left = (std::max)(x, tile.left);
+			const LONG right = (std::min)(x + static_cast<LONG>(it->length), tile.right);
+			if (right <= left) continue;
+
+			Graphics::Pixel* row = &target.at(0, it->y + offsetY);
+			if (it->coverage == FULL_COVERAGE)
+			{
+				for (LONG px = left; px < right; px++)
+					blendPixel(row[px], color);
+				continue;
+			}
+
+			const BYTE* coverage = geometry.coverage.data() + it->coverage - x;
+			for (LONG px = left; px < right; px++)
+				blendPixel(row[px], scalePixel(color, coverage[px]));
+		}
+	}
+
+
+
+	/********************************/
+	/*		SoftwareRenderer		*/
+	/********************************/
+
+
+	SoftwareRenderer::SoftwareRenderer(_In_opt_ unsigned int threadCount)
+		:m_pool(threadCount)
+	{}
+
+	void SoftwareRenderer::binCommands(_In_ const CommandBuffer& commands, _In_ const ResourceTable& resources, _In_ const Framebuffer& target)
+	{
+		m_tileColumns = (target.width + TILE_SIZE - 1) / TILE_SIZE;
+		m_tileRows = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+
+		const size_t tileCount = static_cast<size_t>(m_tileColumns) * m_tileRows;
+		if (m_bins.size() < tileCount) m_bins.resize(tileCount);
+		for (auto& bin : m_bins) bin.clear();
+		if (m_spriteBins.size() < tileCount) m_spriteBins.resize(tileCount);
+		for (auto& bin : m_spriteBins) bin.clear();
+		m_spriteStarts.resize(tileCount);
+
+		const PixelSpan screen = { 0, 0, static_cast<LONG>(target.width), static_cast<LONG>(target.height) };
+
+		// Layers are visited in order, so each bin keeps the drawing order.
+		for (const auto& [layer, list] : commands.getLayers())
+		{
+			for (const Command& command : list.getCommands())
+			{
+				const bool isGeometry = command.type == CommandType::FillGeometry;
+				PixelSpan span = clipSpan(isGeometry ? toGeometrySpan(command.destination) : toPixelSpan(command.destination), screen);
+				if (span.right <= span.left || span.bottom <= span.top) continue;
+
+				// Rasterized here on first use, before the tiles are, so the tiles only read the spans.
+				const GeometrySpans* spans = isGeometry ? resources.getGeometries().getSpans(command.resource) : nullptr;
+				if (isGeometry && spans == nullptr) continue;
+
+				// Same for the compressed bitmaps, decoded once per frame at most.
+				const Graphics::Pixel* pixels = usesBitmap(command) ? resources.getPixels(command.resource) : nullptr;
+				if (usesBitmap(command) && pixels == nullptr) continue;
+
+				if (command.type == CommandType::DrawSprites)
+				{
+					binSprites(command, list, pixels, span, screen);
+					continue;
+				}
+
+				const UINT32 firstColumn = span.left / TILE_SIZE, lastColumn = (span.right - 1) / TILE_SIZE;
+				const UINT32 firstRow = span.top / TILE_SIZE, lastRow = (span.bottom - 1) / TILE_SIZE;
+				for (UINT32 row = firstRow; row <= lastRow; row++)
+					for (UINT32 column = firstColumn; column <= lastColumn; column++)
+						m_bins[static_cast<size_t>(row) * m_tileColumns + column].push_back({ &command, spans, pixels });
+			}
+		}
+	}
+
+	void SoftwareRenderer::binSprites(_In_ const Command& command, _In_ const CommandList& list, _In_ const Graphics::Pixel* pixels, _In_ const PixelSpan& bounds, _In_ const PixelSpan& screen)
+	{
+		const UINT32 firstColumn = bounds.left / TILE_SIZE, lastColumn = (bounds.right - 1) / TILE_SIZE;
+		const UINT32 firstRow = bounds.top / TILE_SIZE, lastRow = (bounds.bottom - 1) / TILE_SIZE;
+		for (UINT32 row = firstRow; row <= lastRow; row++)
+			for (UINT32 column = firstColumn; column <= lastColumn; column++)
+			{
+				const size_t tile = static_cast<size_t>(row) * m_tileColumns + column;
+				m_spriteStarts[tile] = static_cast<UINT32>(m_spriteBins[tile].size());
+			}
+
+		// Each sprite copied in the bins of the tiles it touches, most of them in a single one:
+		// the tiles then read their sprites in order, instead of gathering them from the whole batch.
+		size_t count = 0;
+		const Sprite* sprites = list.getSprites(command, &count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const PixelSpan span = clipSpan(toPixelSpan(toSpriteRect(sprites[i])), screen);
+			if (span.right <= span.left || span.bottom <= span.top) continue;
+
+			const UINT32 spriteFirstColumn = span.left / TILE_SIZE, spriteLastColumn = (span.right - 1) / TILE_SIZE;
+			const UINT32 spriteFirstRow = span.top / TILE_SIZE, spriteLastRow = (span.bottom - 1) / TILE_SIZE;
+			for (UINT32 row = spriteFirstRow; row <= spriteLastRow; row++)
+				for (UINT32 column = spriteFirstColumn; column <= spriteLastColumn; column++)
+					m_spriteBins[static_cast<size_t>(row) * m_tileColumns + column].push_back(sprites[i]);
+		}
+
+		// A single binned command per tile, for all the sprites of the batch touching it.
+		for (UINT32 row = firstRow; row <= lastRow; row++)
+			for (UINT32 column = firstColumn; column <= lastColumn; column++)
+			{
+				const size_t tile = static_cast<size_t>(row) * m_tileColumns + column;
+				const UINT32 first = m_spriteStarts[tile];
+				const UINT32 added = static_cast<UINT32>(m_spriteBins[tile].size()) - first;
+				if (added > 0) m_bins[tile].push_back({ &command, nullptr, pixels, first, added });
+			}
+	}
+
+	void SoftwareRenderer::rasterizeTile(_In_ size_t tile, _In_ const ResourceTable& resources, _In_ UINT32 clearColor, _Inout_ Framebuffer& target) const
+	{
+		const LONG left = static_cast<LONG>((tile % m_tileColumns) * TILE_SIZE);
+		const LONG top = static_cast<LONG>((tile / m_tileColumns) * TILE_SIZE);
+		const PixelSpan tileSpan = {
+			left, top,
+			(std::min)(left + static_cast<LONG>(TILE_SIZE), static_cast<LONG>(target.width)),
+			(std::min)(top + static_cast<LONG>(TILE_SIZE), static_cast<LONG>(target.height))
+		};
+
+		const Graphics::Pixel background = toPremultipliedPixel(clearColor);
+		for (LONG y = tileSpan.top; y < tileSpan.bottom; y++)
+			std::fill(&target.at(tileSpan.left, y), &target.at(0, y) + tileSpan.right, background);
+
+		for (const BinnedCommand& binned : m_bins[tile])
+		{
+			const Command* command = binned.command;
+			const Graphics::Pixel* pixels = binned.pixels;
+			const PixelSpan span = clipSpan(toPixelSpan(command->destination), tileSpan);
+
+			switch (command->type)
+			{
+			case CommandType::DrawBitmap:
+			{
+				const BitmapResource* bitmap = resources.getBitmap(command->resource);
+				if (bitmap == nullptr || bitmap->width == 0 || bitmap->height == 0) break;
+				drawBitmapSpan(span, *command, *bitmap, pixels, target);
+				break;
+			}
+
+			case CommandType::FillRect:
+				fillSpan(span, toPremultipliedPixel(command->color), target);
+				break;
+
+			case CommandType::DrawMask:
+			{
+				const BitmapResource* bitmap = resources.getBitmap(command->resource);
+				if (bitmap == nullptr || bitmap->width == 0 || bitmap->height == 0) break;
+				drawMaskSpan(span, *command, *bitmap, pixels, target);
+				break;
+			}
+
+			case CommandType::FillGeometry:
+				fillGeometrySpans(tileSpan, *command, *binned.spans, target);
+				break;
+
+			case CommandType::DrawSprites:
+			{
+				const BitmapResource* bitmap = resources.getBitmap(command->resource);
+				if (bitmap == nullptr || bitmap->width == 0 || bitmap->height == 0) break;
+				drawSpritesSpan(tileSpan, *command, m_spriteBins[tile].data() + binned.firstSprite, binned.spriteCount, *bitmap, pixels, target);
+				break;
+			}
+			}
+		}
+	}
+
+	void SoftwareRenderer::render(_In_ const CommandBuffer& commands, _In_ const ResourceTable& resources, _Inout_ Framebuffer& target, _In_opt_ UINT32 clearColor)
+	{
+		if (target.width == 0 || target.height == 0) return;
+
+		binCommands(commands, resources, target);
+
+		const size_t tileCount = static_cast<size_t>(m_tileColumns) * m_tileRows;
+		m_pool.parallelFor(tileCount, [this, &resources, clearColor, &target](size_t tile) {
+			rasterizeTile(tile, resources, clearColor, target);
+		});
+	}
+
+} // namespace Render
@@ -0,0 +1,132 @@
+#pragma once
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include <d2d1.h>
+
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+#include "ThreadPool.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	constexpr UINT32 TILE_SIZE = 64; // Width and height of a tile, in pixels.
+
+	struct PixelSpan;
+
+	/**
+	 * @brief A B8G8R8A8 premultiplied image in memory.
+	 */
+	struct Framebuffer
+	{
+		std::vector<Graphics::Pixel> pixels;
+		UINT32 width = 0;
+		UINT32 height = 0;
+
+		Framebuffer() = default;
+		Framebuffer(_In_ UINT32 w, _In_ UINT32 h)
+			:pixels(static_cast<size_t>(w) * h, Graphics::Pixel(0x00, 0x00)), width(w), height(h)
+		{}
+
+		inline Graphics::Pixel& at(_In_ UINT32 x, _In_ UINT32 y) noexcept { return pixels[static_cast<size_t>(y) * width + x]; }
+		inline const Graphics::Pixel& at(_In_ UINT32 x, _In_ UINT32 y) const noexcept { return pixels[static_cast<size_t>(y) * width + x]; }
+	};
+
+
+	/**
+	 * @brief Execute command buffers in memory, on the CPU.
+	 *
+	 * @note The framebuffer is split in TILE_SIZE x TILE_SIZE tiles: the commands are binned
+	 *       into the tiles they touch, then the tiles are rasterized in parallel.
+	 *       Every pixel is computed by a single tile, in the recording order,
+	 *       so the output does not depend on the number of threads.
+	 */
+	class SoftwareRenderer
+	{
+	private:
+		/**
+		 * @brief A command touching a tile, with the spans of its geometry if it fills one.
+		 */
+		struct BinnedCommand
+		{
+			const Command* command;
+			const GeometrySpans* spans;
+			const Graphics::Pixel* pixels;	// Of the bitmap, decoded while binning if it is compressed.
+			UINT32 firstSprite = 0;			// The sprites of a DrawSprites command touching the tile, in the tile's sprite bin.
+			UINT32 spriteCount = 0;
+		};
+
+		ThreadPool m_pool;
+		std::vector<std::vector<BinnedCommand>> m_bins; // Commands touching each tile, reused between frames.
+		std::vector<std::vector<Sprite>> m_spriteBins; // Copies of the sprites touching each tile, read in order. Reused between frames.
+		std::vector<UINT32> m_spriteStarts; // Size of each sprite bin before the current batch.
+
+		UINT32 m_tileColumns = 0;
+		UINT32 m_tileRows = 0;
+
+		void binCommands(_In_ const CommandBuffer& commands, _In_ const ResourceTable& resources, _In_ const Framebuffer& target);
+		void binSprites(_In_ const Command& command, _In_ const CommandList& list, _In_ const Graphics::Pixel* pixels, _In_ const PixelSpan& bounds, _In_ const PixelSpan& screen);
+		void rasterizeTile(_In_ size_t tile, _In_ const ResourceTable& resources, _In_ UINT32 clearColor, _Inout_ Framebuffer& target) const;
+
+	public:
+		/**
+		 * @brief Constructor for SoftwareRenderer.
+		 *
+		 * @param[in] threadCount The number of rasterizing threads, zero for one per hardware thread.
+		 */
+		explicit SoftwareRenderer(_In_opt_ unsigned int threadCount = 0);
+
+		SoftwareRenderer(SoftwareRenderer&) = delete;
+		SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+		/**
+		 * @brief Clear the target and execute all the commands on it.
+		 *
+		 * @param[in] commands		The commands to execute.
+		 * @param[in] resources		The resources referenced by the commands. Their pixels must be in memory.
+		 * @param[in] target		The framebuffer to draw on.
+		 * @param[in] clearColor	The background color, as 0xAARRGGBB.
+		 */
+		void render(_In_ const CommandBuffer& commands, _In_ const ResourceTable& resources, _Inout_ Framebuffer& target, _In_opt_ UINT32 clearColor = 0xFFF0FFFF);
+
+		inline unsigned int getThreadCount() const noexcept { return m_pool.getThreadCount(); }
+	};
+
+
+	/**
+	 * @brief Blend a premultiplied source pixel over a destination pixel.
+	 */
+	inline void blendPixel(_Inout_ Graphics::Pixel& destination, _In_ const Graphics::Pixel& source) noexcept
+	{
+		const UINT32 inverseAlpha = 0xFF - source.a;
+		destination.b = static_cast<BYTE>(source.b + (destination.b * inverseAlpha + 0x7F) / 0xFF);
+		destination.g = static_cast<BYTE>(source.g + (destination.g * inverseAlpha + 0x7F) / 0xFF);
+		destination.r = static_cast<BYTE>(source.r + (destination.r * inverseAlpha + 0x7F) / 0xFF);
+		destination.a = static_cast<BYTE>(source.a + (destination.a * inverseAlpha + 0x7F) / 0xFF);
+	}
+
+	/**
+	 * @brief Convert a 0xAARRGGBB color into a premultiplied pixel.
+	 */
+	inline Graphics::Pixel toPremultipliedPixel(_In_ UINT32 argb) noexcept
+	{
+		const UINT32 a = (argb >> 24) & 0xFF;
+		return Graphics::Pixel(
+			static_cast<BYTE>((((argb >> 16) & 0xFF) * a + 0x7F) / 0xFF),
+			static_cast<BYTE>((((argb >> 8) & 0xFF) * a + 0x7F) / 0xFF),
+			static_cast<BYTE>(((argb & 0xFF) * a + 0x7F) / 0xFF),
+			static_cast<BYTE>(a)
+		);
+	}
+
+} // namespace Render
+
+#endif // SOFTWARE_RENDERER_H
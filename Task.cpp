@@ -0,0 +1,413 @@
+#include "Task.h"
+
+#include <algorithm>
+
+#include <windows.h>
+#include <combaseapi.h>
+
+#include "EventHandler.h"
+#include "GraphicComponents.h"
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Tasks
+{
+
+
+	/************************/
+	/*		 FramePool		*/
+	/************************/
+
+
+	void* FramePool::allocate(_In_ size_t size)
+	{
+		const size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY;
+		if (sizeClass == 0 || sizeClass > CLASS_COUNT) return ::operator new(size);
+
+		FreeBlock*& freeList = m_freeLists[sizeClass - 1];
+		if (freeList == nullptr)
+		{
+			// Carve a new chunk into blocks of this class.
+			const size_t blockSize = sizeClass * GRANULARITY;
+			m_chunks.push_back(std::make_unique<BYTE[]>(blockSize * BLOCKS_PER_CHUNK));
+			m_reservedBytes += blockSize * BLOCKS_PER_CHUNK;
+			BYTE* chunk = m_chunks.back().get();
+			for (size_t i = BLOCKS_PER_CHUNK; i > 0; i--)
+			{
+				FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * blockSize);
+				block->next = freeList;
+				freeList = block;
+			}
+		}
+
+		FreeBlock* block = freeList;
+		freeList = block->next;
+		m_usedBlocks++;
+		return block;
+	}
+
+	void FramePool::deallocate(_In_ void* pointer, _In_ size_t size) noexcept
+	{
+		const size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY;
+		if (sizeClass == 0 || sizeClass > CLASS_COUNT)
+		{
+			::operator delete(pointer);
+			return;
+		}
+
+		FreeBlock* block = reinterpret_cast<FreeBlock*>(pointer);
+		block->next = m_freeLists[sizeClass - 1];
+		m_freeLists[sizeClass - 1] = block;
+		m_usedBlocks--;
+	}
+
+	FramePool& FramePool::get() noexcept
+	{
+		thread_local FramePool pool;
+		return pool;
+	}
+
+
+
+	/********************/
+	/*		 Task		*/
+	/********************/
+
+
+	Task& Task::operator=(Task&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_handle) m_handle.destroy();
+			m_handle = other.m_handle;
+			other.m_handle = nullptr;
+		}
+		return *this;
+	}
+
+	Task::~Task()
+	{
+		// Never spawned.
+		if (m_handle) m_handle.destroy();
+	}
+
+	LoadImage loadImage(_In_ const wchar_t* path)
+	{
+		std::shared_ptr<ImageLoad> load = std::make_shared<ImageLoad>();
+		load->path = path;
+		return { std::move(load) };
+	}
+
+
+
+	/****************************/
+	/*		TaskScheduler		*/
+	/****************************/
+
+
+	inline bool isLater(_In_ const TimePoint& aDue, _In_ UINT64 aSequence, _In_ const TimePoint& bDue, _In_ UINT64 bSequence) noexcept
+	{
+		return aDue > bDue || (aDue == bDue && aSequence > bSequence);
+	}
+
+	TaskScheduler::TaskScheduler()
+		:m_now(std::chrono::steady_clock::now())
+	{}
+
+	TaskId TaskScheduler::spawn(_In_ Task&& task, _In_opt_ const Graphics::Component* owner)
+	{
+		Task::Handle handle = task.release();
+		if (!handle) return INVALID_TASK;
+
+		UINT32 slot;
+		if (!m_freeSlots.empty())
+		{
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<UINT32>(m_slots.size());
+			m_slots.push_back({});
+		}
+
+		Slot& entry = m_slots[slot];
+		entry.handle = handle;
+		entry.owner = owner;
+		handle.promise().scheduler = this;
+		handle.promise().slot = slot;
+		handle.promise().generation = entry.generation;
+		m_count++;
+
+		const TaskId id = makeId(slot, entry.generation);
+		if (owner) m_owned.insert({ owner, id });
+
+		resume({ slot, entry.generation });
+		return isRunning(id) ? id : INVALID_TASK;
+	}
+
+	void TaskScheduler::resume(_In_ const Waiter& waiter)
+	{
+		if (!isAlive(waiter)) return; // Cancelled while waiting.
+
+		// The slots may move while the task runs, if it spawns others.
+		Task::Handle handle = m_slots[waiter.slot].handle;
+		handle.resume();
+		if (!handle.done()) return;
+
+		std::exception_ptr exception = handle.promise().exception;
+		destroy(waiter.slot);
+		if (exception) std::rethrow_exception(exception);
+	}
+
+	void TaskScheduler::destroy(_In_ UINT32 slot) noexcept
+	{
+		Slot& entry = m_slots[slot];
+		Task::Handle handle = entry.handle;
+		if (!handle) return;
+
+		if (entry.owner)
+		{
+			const TaskId id = makeId(slot, entry.generation);
+			auto range = m_owned.equal_range(entry.owner);
+			for (auto it = range.first; it != range.second; it++)
+			{
+				if (it->second == id)
+				{
+					m_owned.erase(it);
+					break;
+				}
+			}
+		}
+
+		entry.handle = nullptr;
+		entry.owner = nullptr;
+		if (++entry.generation == 0) entry.generation = 1; // Zero would make INVALID_TASK a valid id.
+		m_freeSlots.push_back(slot);
+		m_count--;
+
+		// Last: the destructors of the task's variables may use the scheduler.
+		handle.destroy();
+	}
+
+	void TaskScheduler::onCancelled() noexcept
+	{
+		// Amortized: a purge walks the waits of the running tasks, and of at least as many cancelled ones.
+		if (++m_cancelledCount >= (std::max)(PURGE_THRESHOLD, m_count)) purgeWaiters();
+	}
+
+	void TaskScheduler::purgeWaiters() noexcept
+	{
+		PROFILE_ZONE("TaskScheduler::purgeWaiters");
+		m_cancelledCount = 0;
+
+		auto later = [](const TimerWaiter& a, const TimerWaiter& b) { return isLater(a.due, a.sequence, b.due, b.sequence); };
+		std::erase_if(m_timers, [this](const TimerWaiter& timer) { return !isAlive(timer.waiter); });
+		std::make_heap(m_timers.begin(), m_timers.end(), later);
+
+		for (auto& [uMsg, source] : m_events)
+			std::erase_if(source->waiters, [this](const EventWaiter& waiter) { return !isAlive(waiter.waiter); });
+
+		// The loading thread keeps its own reference to the load.
+		std::erase_if(m_loads, [this](const LoadWaiter& waiter) { return !isAlive(waiter.waiter); });
+		std::erase_if(m_animationWaiters, [this](const AnimationWaiter& waiter) { return !isAlive(waiter.waiter); });
+	}
+
+	bool TaskScheduler::cancel(_In_ TaskId id) noexcept
+	{
+		if (!isRunning(id)) return false;
+		destroy(static_cast<UINT32>(id & 0xFFFFFFFF));
+		onCancelled();
+		return true;
+	}
+
+	void TaskScheduler::cancel(_In_ const Graphics::Component* owner) noexcept
+	{
+		for (auto it = m_owned.find(owner); it != m_owned.end(); it = m_owned.find(owner))
+		{
+			const UINT32 slot = static_cast<UINT32>(it->second & 0xFFFFFFFF);
+			m_owned.erase(it);
+			m_slots[slot].owner = nullptr;
+			destroy(slot);
+			onCancelled();
+		}
+	}
+
+	bool TaskScheduler::isRunning(_In_ TaskId id) const noexcept
+	{
+		const UINT32 slot = static_cast<UINT32>(id & 0xFFFFFFFF);
+		const UINT32 generation = static_cast<UINT32>(id >> 32);
+		return slot < m_slots.size() && isAlive({ slot, generation });
+	}
+
+	void TaskScheduler::advanceFrame()
+	{
+		m_frame++;
+		m_ready.insert(m_ready.end(), m_frameWaiters.begin(), m_frameWaiters.end());
+		m_frameWaiters.clear();
+	}
+
+	void TaskScheduler::update(_In_ TimePoint now)
+	{
+		PROFILE_ZONE("TaskScheduler::update");
+		m_now = now;
+
+		auto later = [](const TimerWaiter& a, const TimerWaiter& b) { return isLater(a.due, a.sequence, b.due, b.sequence); };
+		while (!m_timers.empty() && m_timers.front().due <= now)
+		{
+			std::pop_heap(m_timers.begin(), m_timers.end(), later);
+			m_ready.push_back(m_timers.back().waiter);
+			m_timers.pop_back();
+		}
+
+		for (size_t i = 0; i < m_loads.size();)
+		{
+			if (!m_loads[i].load->isDone.load(std::memory_order_acquire)) { i++; continue; }
+			m_ready.push_back(m_loads[i].waiter);
+			m_loads[i] = std::move(m_loads.back());
+			m_loads.pop_back();
+		}
+
+		for (size_t i = 0; i < m_animationWaiters.size();)
+		{
+			const AnimationWaiter& waiter = m_animationWaiters[i];
+			if (isAlive(waiter.waiter) && waiter.animations->isRunning(waiter.track)) { i++; continue; }
+			m_ready.push_back(waiter.waiter);
+			m_animationWaiters[i] = m_animationWaiters.back();
+			m_animationWaiters.pop_back();
+		}
+
+		// The tasks resumed now may wait again: they go in m_ready, for the next update.
+		m_resuming.swap(m_ready);
+		for (size_t i = 0; i < m_resuming.size(); i++)
+		{
+			try
+			{
+				resume(m_resuming[i]);
+			}
+			catch (...)
+			{
+				m_ready.insert(m_ready.end(), m_resuming.begin() + i + 1, m_resuming.end());
+				m_resuming.clear();
+				throw;
+			}
+		}
+		m_resuming.clear();
+	}
+
+	TimePoint TaskScheduler::getNextDeadline() const noexcept
+	{
+		// Until the next purge, the heap may keep the waiters of cancelled tasks: waking up for them costs one useless update.
+		return m_timers.empty() ? TimePoint::max() : m_timers.front().due;
+	}
+
+	void TaskScheduler::waitFrame(_In_ const Task::promise_type& promise)
+	{
+		m_frameWaiters.push_back({ promise.slot, promise.generation });
+	}
+
+	void TaskScheduler::waitUntil(_In_ const Task::promise_type& promise, _In_ TimePoint due)
+	{
+		m_timers.push_back({ due, m_timerSequence++, { promise.slot, promise.generation } });
+		std::push_heap(m_timers.begin(), m_timers.end(), [](const TimerWaiter& a, const TimerWaiter& b) {
+			return isLater(a.due, a.sequence, b.due, b.sequence);
+		});
+	}
+
+	LRESULT TaskScheduler::onEvent(_In_ HWND /*hwnd*/, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+	{
+		EventSource* source = reinterpret_cast<EventSource*>(context);
+		TaskScheduler* scheduler = source->scheduler;
+
+		for (const EventWaiter& waiter : source->waiters)
+		{
+			if (!scheduler->isAlive(waiter.waiter)) continue;
+			*waiter.args = { wParam, lParam };
+			scheduler->m_ready.push_back(waiter.waiter);
+		}
+		source->waiters.clear();
+		return S_OK;
+	}
+
+	void TaskScheduler::waitEvent(_In_ const Task::promise_type& promise, _In_ UINT uMsg, _Out_ EventArgs* args)
+	{
+		std::unique_ptr<EventSource>& source = m_events[uMsg];
+		if (source == nullptr)
+		{
+			// Registered on first wait, and kept for the next ones.
+			source = std::make_unique<EventSource>();
+			source->scheduler = this;
+			source->uMsg = uMsg;
+			source->eventId = EventHandler::registerEvent(uMsg, onEvent, source.get(), PRIORITY_LOWEST);
+		}
+		source->waiters.push_back({ { promise.slot, promise.generation }, args });
+	}
+
+	void TaskScheduler::loaderLoop()
+	{
+		const HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED); // For WIC.
+
+		while (true)
+		{
+			std::shared_ptr<ImageLoad> load;
+			{
+				std::unique_lock<std::mutex> lock(m_loadMutex);
+				m_loadAvailable.wait(lock, [this]() { return !m_loadQueue.empty() || !m_isLoaderRunning; });
+				if (!m_isLoaderRunning) break;
+				load = std::move(m_loadQueue.front());
+				m_loadQueue.pop_front();
+			}
+
+			PROFILE_ZONE("TaskScheduler::loadImage");
+			try
+			{
+				load->image = std::make_unique<Graphics::Image>(load->path.c_str());
+			}
+			catch (...)
+			{
+				load->image = nullptr;
+			}
+			load->isDone.store(true, std::memory_order_release);
+		}
+
+		if (SUCCEEDED(hr)) CoUninitialize();
+	}
+
+	void TaskScheduler::waitLoad(_In_ const Task::promise_type& promise, _In_ const std::shared_ptr<ImageLoad>& load)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_loadMutex);
+			if (!m_isLoaderRunning)
+			{
+				m_isLoaderRunning = true;
+				m_loader = std::thread(&TaskScheduler::loaderLoop, this);
+			}
+			m_loadQueue.push_back(load);
+		}
+		m_loadAvailable.notify_one();
+		m_loads.push_back({ { promise.slot, promise.generation }, load });
+	}
+
+	void TaskScheduler::waitAnimation(_In_ const Task::promise_type& promise, _In_ const Graphics::AnimationEngine& animations, _In_ Graphics::TrackId track)
+	{
+		m_animationWaiters.push_back({ { promise.slot, promise.generation }, &animations, track });
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_loadMutex);
+			m_isLoaderRunning = false;
+		}
+		m_loadAvailable.notify_one();
+		if (m_loader.joinable()) m_loader.join();
+
+		for (UINT32 slot = 0; slot < m_slots.size(); slot++)
+			destroy(slot);
+
+		for (const auto& [uMsg, source] : m_events)
+			EventHandler::unregisterEvent(source->eventId);
+	}
+
+} // namespace Tasks
@@ -0,0 +1,421 @@
+#pragma once
+#ifndef TASK_H
+#define TASK_H
+
+#include <Windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Animation.h"
+#include "EventHandler.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	class Component;
+	class Image;
+} // namespace Graphics
+
+
+namespace Tasks
+{
+	typedef UINT64 TaskId;
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	constexpr TaskId INVALID_TASK = 0;
+
+	class TaskScheduler;
+
+	/**
+	 * @brief Allocate the coroutine frames from per size free lists.
+	 *
+	 * @note Frames are recycled instead of freed: once warmed up, starting a task does not reach the heap.
+	 *       The pool is per thread, tasks must be created and destroyed on the same thread.
+	 */
+	class FramePool
+	{
+	private:
+		static constexpr size_t GRANULARITY = 64;		// Bytes between two size classes.
+		static constexpr size_t CLASS_COUNT = 32;		// Larger frames use the heap.
+		static constexpr size_t BLOCKS_PER_CHUNK = 64;
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		FreeBlock* m_freeLists[CLASS_COUNT] = {};
+		std::vector<std::unique_ptr<BYTE[]>> m_chunks;
+		size_t m_usedBlocks = 0;
+		size_t m_reservedBytes = 0;
+
+	public:
+		FramePool() = default;
+		FramePool(FramePool&) = delete;
+		FramePool& operator=(const FramePool&) = delete;
+
+		void* allocate(_In_ size_t size);
+		void deallocate(_In_ void* pointer, _In_ size_t size) noexcept;
+
+		inline size_t getUsedBlocks() const noexcept { return m_usedBlocks; }
+		inline size_t getReservedBytes() const noexcept { return m_reservedBytes; }
+
+		/**
+		 * @brief Return the pool of the calling thread.
+		 */
+		static FramePool& get() noexcept;
+	};
+
+
+	/**
+	 * @brief A coroutine run by a TaskScheduler.
+	 *
+	 * @note Tasks start suspended: they only run once spawned. For example:
+	 *
+	 *       Tasks::Task intro(BaseWindow& window, Graphics::Image& image)
+	 *       {
+	 *           Graphics::AnimationEngine& animations = window.getAnimations();
+	 *           co_await Tasks::waitAnimation(animations, animations.add(image, Graphics::AnimatedProperty::Opacity, 0.0f, 1.0f, 0.5f));
+	 *           co_await Tasks::delay(2.0f);
+	 *           std::unique_ptr<Graphics::Image> next = co_await Tasks::loadImage(L"Images\\next.png");
+	 *           ...
+	 *       }
+	 *
+	 *       window.getTasks().spawn(intro(window, image), &image);
+	 */
+	class Task
+	{
+	public:
+		struct promise_type
+		{
+			TaskScheduler* scheduler = nullptr;
+			UINT32 slot = 0;
+			UINT32 generation = 0;
+			std::exception_ptr exception;
+
+			inline Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			inline std::suspend_always initial_suspend() const noexcept { return {}; }
+			inline std::suspend_always final_suspend() const noexcept { return {}; } // Destroyed by the scheduler.
+			inline void return_void() const noexcept {}
+			inline void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+			inline static void* operator new(size_t size) { return FramePool::get().allocate(size); }
+			inline static void operator delete(void* pointer, size_t size) noexcept { FramePool::get().deallocate(pointer, size); }
+		};
+
+		typedef std::coroutine_handle<promise_type> Handle;
+
+	private:
+		Handle m_handle;
+
+		explicit Task(_In_ Handle handle) noexcept : m_handle(handle) {}
+
+	public:
+		Task(Task&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+		Task& operator=(Task&& other) noexcept;
+
+		Task(Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		/**
+		 * @brief Give the coroutine to the scheduler.
+		 */
+		inline Handle release() noexcept
+		{
+			Handle handle = m_handle;
+			m_handle = nullptr;
+			return handle;
+		}
+
+		~Task();
+	};
+
+
+	/**
+	 * @brief The parameters of the message a task waited for.
+	 */
+	struct EventArgs
+	{
+		WPARAM wParam = 0;
+		LPARAM lParam = 0;
+	};
+
+	/**
+	 * @brief The result of an image loaded in the background.
+	 */
+	struct ImageLoad
+	{
+		std::wstring path;
+		std::unique_ptr<Graphics::Image> image;
+		std::atomic<bool> isDone = false;
+	};
+
+
+	/**
+	 * @brief Resume the coroutine tasks of a window when what they wait for happens.
+	 *
+	 * @note Waiting does not allocate: the waits are stored in the scheduler's vectors, reused between frames.
+	 *       A cancelled task is destroyed at once, the waits it left are skipped when they come. The delays and
+	 *       events may never come: their waits are purged once the cancellations outnumber the running tasks.
+	 *       Tasks are resumed on the thread calling update, never from within a message handler.
+	 */
+	class TaskScheduler
+	{
+	private:
+		static constexpr size_t PURGE_THRESHOLD = 64; // Least cancellations before a purge.
+
+		struct Slot
+		{
+			Task::Handle handle = nullptr;
+			const Graphics::Component* owner = nullptr;
+			UINT32 generation = 1;
+		};
+
+		struct Waiter
+		{
+			UINT32 slot;
+			UINT32 generation;
+		};
+
+		struct TimerWaiter
+		{
+			TimePoint due;
+			UINT64 sequence;	// Keeps the order of the timers due at the same time.
+			Waiter waiter;
+		};
+
+		struct EventWaiter
+		{
+			Waiter waiter;
+			EventArgs* args;	// In the frame of the waiting task.
+		};
+
+		struct EventSource
+		{
+			TaskScheduler* scheduler;
+			UINT uMsg;
+			EventHandler::EVENTID eventId;
+			std::vector<EventWaiter> waiters;
+		};
+
+		struct LoadWaiter
+		{
+			Waiter waiter;
+			std::shared_ptr<ImageLoad> load;
+		};
+
+		struct AnimationWaiter
+		{
+			Waiter waiter;
+			const Graphics::AnimationEngine* animations;
+			Graphics::TrackId track;
+		};
+
+		std::vector<Slot> m_slots;
+		std::vector<UINT32> m_freeSlots;
+		std::unordered_multimap<const Graphics::Component*, TaskId> m_owned;
+		size_t m_count = 0;
+
+		std::vector<Waiter> m_frameWaiters;		// Resumed after the next frame.
+		std::vector<Waiter> m_ready;			// Resumed by the next update.
+		std::vector<Waiter> m_resuming;			// Swapped with m_ready while resuming.
+		std::vector<TimerWaiter> m_timers;		// Min heap on the due time.
+		UINT64 m_timerSequence = 0;
+		std::unordered_map<UINT, std::unique_ptr<EventSource>> m_events;
+		std::vector<LoadWaiter> m_loads;
+		std::vector<AnimationWaiter> m_animationWaiters;
+		TimePoint m_now;
+		UINT64 m_frame = 0;
+		size_t m_cancelledCount = 0;			// Since the last purge.
+
+		// Background image loading.
+		std::thread m_loader;
+		std::mutex m_loadMutex;
+		std::condition_variable m_loadAvailable;
+		std::deque<std::shared_ptr<ImageLoad>> m_loadQueue;
+		bool m_isLoaderRunning = false;
+
+		static LRESULT onEvent(_In_ HWND hwnd, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context);
+
+		inline static TaskId makeId(_In_ UINT32 slot, _In_ UINT32 generation) noexcept { return (static_cast<TaskId>(generation) << 32) | slot; }
+		inline bool isAlive(_In_ const Waiter& waiter) const noexcept { return m_slots[waiter.slot].generation == waiter.generation && m_slots[waiter.slot].handle; }
+
+		void resume(_In_ const Waiter& waiter);
+		void destroy(_In_ UINT32 slot) noexcept;
+		void onCancelled() noexcept;
+		void purgeWaiters() noexcept;
+		void loaderLoop();
+
+	public:
+		TaskScheduler();
+		TaskScheduler(TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		/**
+		 * @brief Start a task: it runs until its first co_await.
+		 *
+		 * @param[in] task	The task to run.
+		 * @param[in] owner	The component the task works on, cancelled with it. nullptr for none.
+		 *
+		 * @retval TaskId
+		 * @return The id of the task, INVALID_TASK if it finished without waiting.
+		 *
+		 * @throw The exception thrown by the task before its first co_await.
+		 */
+		TaskId spawn(_In_ Task&& task, _In_opt_ const Graphics::Component* owner = nullptr);
+
+		/**
+		 * @brief Destroy a task, with its local variables.
+		 *
+		 * @retval bool
+		 * @return True if the task was running, false otherwise.
+		 */
+		bool cancel(_In_ TaskId id) noexcept;
+
+		/**
+		 * @brief Destroy the tasks owned by a component.
+		 */
+		void cancel(_In_ const Graphics::Component* owner) noexcept;
+
+		bool isRunning(_In_ TaskId id) const noexcept;
+
+		inline size_t getCount() const noexcept { return m_count; }
+
+		/**
+		 * @brief Mark the end of a frame: the tasks waiting for the next frame are resumed by the next update.
+		 */
+		void advanceFrame();
+		inline UINT64 getFrame() const noexcept { return m_frame; }
+
+		/**
+		 * @brief Resume the tasks whose wait is over.
+		 *
+		 * @param[in] now The time of the frame clock.
+		 *
+		 * @throw The exception thrown by a task. The task is destroyed first.
+		 */
+		void update(_In_ TimePoint now);
+
+		inline TimePoint getTime() const noexcept { return m_now; }
+
+		/**
+		 * @brief Returns when the earliest delay ends, or TimePoint::max() if no task is delayed.
+		 *
+		 * @note Used by the main loop to know how long it can sleep.
+		 */
+		TimePoint getNextDeadline() const noexcept;
+
+		// Used by the awaitables.
+		void waitFrame(_In_ const Task::promise_type& promise);
+		void waitUntil(_In_ const Task::promise_type& promise, _In_ TimePoint due);
+		void waitEvent(_In_ const Task::promise_type& promise, _In_ UINT uMsg, _Out_ EventArgs* args);
+		void waitLoad(_In_ const Task::promise_type& promise, _In_ const std::shared_ptr<ImageLoad>& load);
+		void waitAnimation(_In_ const Task::promise_type& promise, _In_ const Graphics::AnimationEngine& animations, _In_ Graphics::TrackId track);
+
+		~TaskScheduler();
+	};
+
+
+	/**
+	 * @brief Awaitable resuming the task after the next frame.
+	 */
+	struct NextFrame
+	{
+		inline bool await_ready() const noexcept { return false; }
+		inline void await_suspend(_In_ Task::Handle handle) const { handle.promise().scheduler->waitFrame(handle.promise()); }
+		inline void await_resume() const noexcept {}
+	};
+
+	/**
+	 * @brief Awaitable resuming the task once a duration has elapsed on the frame clock.
+	 */
+	struct Delay
+	{
+		std::chrono::steady_clock::duration duration;
+
+		inline bool await_ready() const noexcept { return duration.count() <= 0; }
+		inline void await_suspend(_In_ Task::Handle handle) const
+		{
+			TaskScheduler* scheduler = handle.promise().scheduler;
+			scheduler->waitUntil(handle.promise(), scheduler->getTime() + duration);
+		}
+		inline void await_resume() const noexcept {}
+	};
+
+	/**
+	 * @brief Awaitable resuming the task when a message is handled, returning its parameters.
+	 */
+	struct WaitEvent
+	{
+		UINT uMsg;
+		EventArgs args;
+
+		inline bool await_ready() const noexcept { return false; }
+		inline void await_suspend(_In_ Task::Handle handle) { handle.promise().scheduler->waitEvent(handle.promise(), uMsg, &args); }
+		inline EventArgs await_resume() const noexcept { return args; }
+	};
+
+	/**
+	 * @brief Awaitable loading an image on the scheduler's loading thread, returning it.
+	 */
+	struct LoadImage
+	{
+		std::shared_ptr<ImageLoad> load;
+
+		inline bool await_ready() const noexcept { return false; }
+		inline void await_suspend(_In_ Task::Handle handle) const { handle.promise().scheduler->waitLoad(handle.promise(), load); }
+		inline std::unique_ptr<Graphics::Image> await_resume() const noexcept { return std::move(load->image); }
+	};
+
+	/**
+	 * @brief Awaitable resuming the task once an animation track has finished or been cancelled.
+	 */
+	struct WaitAnimation
+	{
+		const Graphics::AnimationEngine& animations;
+		Graphics::TrackId track;
+
+		inline bool await_ready() const noexcept { return !animations.isRunning(track); }
+		inline void await_suspend(_In_ Task::Handle handle) const { handle.promise().scheduler->waitAnimation(handle.promise(), animations, track); }
+		inline void await_resume() const noexcept {}
+	};
+
+	inline NextFrame nextFrame() noexcept { return {}; }
+
+	/**
+	 * @brief Wait for a duration, in seconds.
+	 */
+	inline Delay delay(_In_ float seconds) noexcept
+	{
+		return { std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(seconds)) };
+	}
+
+	inline WaitEvent waitEvent(_In_ UINT uMsg) noexcept { return { uMsg, {} }; }
+
+	/**
+	 * @brief Load an image in the background.
+	 *
+	 * @note The only await allocating: the load outlives the task if it is cancelled meanwhile.
+	 */
+	LoadImage loadImage(_In_ const wchar_t* path);
+
+	/**
+	 * @brief Wait for an animation track.
+	 */
+	inline WaitAnimation waitAnimation(_In_ const Graphics::AnimationEngine& animations, _In_ Graphics::TrackId track) noexcept { return { animations, track }; }
+
+} // namespace Tasks
+
+#endif // TASK_H
@@ -0,0 +1,323 @@
+#include "TextureStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#include "GraphicComponents.h"
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Render
+{
+	static_assert(sizeof(Graphics::Pixel) == 4, "The pixels are copied as B8G8R8A8 bytes.");
+
+	constexpr size_t MAX_LITERALS = 128;
+	constexpr size_t MIN_RUN = 3;
+	constexpr size_t MAX_RUN = 130;
+
+
+	/************************/
+	/*		 Encoding		*/
+	/************************/
+
+
+	size_t CompressedTexture::getCompressedBytes() const noexcept
+	{
+		return data.size() + palette.size() * sizeof(Graphics::Pixel);
+	}
+
+	inline UINT32 toKey(_In_ const Graphics::Pixel& pixel) noexcept
+	{
+		return static_cast<UINT32>(pixel.b) | (static_cast<UINT32>(pixel.g) << 8) | (static_cast<UINT32>(pixel.r) << 16) | (static_cast<UINT32>(pixel.a) << 24);
+	}
+
+	template <class T>
+	void writeLiterals(_In_ const T* values, _In_ size_t begin, _In_ size_t end, _Inout_ std::vector<BYTE>& data)
+	{
+		while (begin < end)
+		{
+			const size_t count = (std::min)(end - begin, MAX_LITERALS);
+			data.push_back(static_cast<BYTE>(count - 1));
+			const size_t offset = data.size();
+			data.resize(offset + count * sizeof(T));
+			std::memcpy(data.data() + offset, values + begin, count * sizeof(T));
+			begin += count;
+		}
+	}
+
+	template <class T>
+	void encodeRuns(_In_ const T* values, _In_ size_t count, _Inout_ std::vector<BYTE>& data)
+	{
+		size_t literals = 0; // First value not written yet.
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t run = 1;
+			while (i + run < count && run < MAX_RUN && values[i + run] == values[i]) run++;
+
+			if (run < MIN_RUN)
+			{
+				i += run;
+				continue;
+			}
+
+			writeLiterals(values, literals, i, data);
+			data.push_back(static_cast<BYTE>(run + MAX_LITERALS - MIN_RUN));
+			const size_t offset = data.size();
+			data.resize(offset + sizeof(T));
+			std::memcpy(data.data() + offset, values + i, sizeof(T));
+			i += run;
+			literals = i;
+		}
+		writeLiterals(values, literals, count, data);
+	}
+
+	CompressedTexture compressTexture(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		PROFILE_ZONE("compressTexture");
+		CompressedTexture texture;
+		texture.width = width;
+		texture.height = height;
+
+		const size_t count = static_cast<size_t>(width) * height;
+		const size_t rawBytes = texture.getRawBytes();
+
+		std::vector<UINT32> keys(count);
+		for (size_t i = 0; i < count; i++) keys[i] = toKey(pixels[i]);
+
+		// Indexed, if the colors fit in a palette.
+		std::vector<BYTE> indices(count);
+		std::unordered_map<UINT32, BYTE> palette;
+		bool isIndexed = true;
+		UINT32 lastKey = count > 0 ? ~keys[0] : 0;
+		BYTE lastIndex = 0;
+		for (size_t i = 0; i < count && isIndexed; i++)
+		{
+			if (keys[i] != lastKey)
+			{
+				auto it = palette.find(keys[i]);
+				if (it == palette.end())
+				{
+					if (palette.size() == 256)
+					{
+						isIndexed = false;
+						break;
+					}
+					it = palette.insert({ keys[i], static_cast<BYTE>(palette.size()) }).first;
+					texture.palette.push_back(pixels[i]);
+				}
+				lastKey = keys[i];
+				lastIndex = it->second;
+			}
+			indices[i] = lastIndex;
+		}
+
+		if (isIndexed)
+		{
+			encodeRuns(indices.data(), count, texture.data);
+			texture.format = TextureFormat::Indexed;
+		}
+		else
+		{
+			texture.palette.clear();
+		}
+
+		// Run length pixels, kept if smaller.
+		if (!isIndexed || texture.getCompressedBytes() > rawBytes / 4)
+		{
+			std::vector<BYTE> runs;
+			encodeRuns(keys.data(), count, runs);
+			if (!isIndexed || runs.size() < texture.getCompressedBytes())
+			{
+				texture.format = TextureFormat::RunLength;
+				texture.palette.clear();
+				texture.data = std::move(runs);
+			}
+		}
+
+		if (texture.getCompressedBytes() >= rawBytes)
+		{
+			texture.format = TextureFormat::Raw;
+			texture.palette.clear();
+			texture.data.resize(rawBytes);
+			std::memcpy(texture.data.data(), pixels, rawBytes);
+		}
+
+		texture.palette.shrink_to_fit();
+		texture.data.shrink_to_fit();
+		return texture;
+	}
+
+	void decodeTexture(_In_ const CompressedTexture& texture, _Out_ Graphics::Pixel* pixels) noexcept
+	{
+		const size_t count = static_cast<size_t>(texture.width) * texture.height;
+		const BYTE* data = texture.data.data();
+		const BYTE* end = data + texture.data.size();
+
+		if (texture.format == TextureFormat::Raw)
+		{
+			std::memcpy(pixels, data, (std::min)(texture.data.size(), count * sizeof(Graphics::Pixel)));
+			return;
+		}
+
+		const bool isIndexed = texture.format == TextureFormat::Indexed;
+		const size_t valueSize = isIndexed ? 1 : sizeof(Graphics::Pixel);
+		const Graphics::Pixel* palette = texture.palette.data();
+		const size_t paletteSize = texture.palette.size();
+
+		size_t i = 0;
+		while (i < count && data < end)
+		{
+			const BYTE control = *data++;
+			if (control < MAX_LITERALS)
+			{
+				const size_t literals = (std::min)({ static_cast<size_t>(control) + 1, count - i, static_cast<size_t>(end - data) / valueSize });
+				if (isIndexed)
+				{
+					for (size_t j = 0; j < literals; j++)
+						pixels[i + j] = data[j] < paletteSize ? palette[data[j]] : Graphics::Pixel(0x00, 0x00);
+				}
+				else
+				{
+					std::memcpy(pixels + i, data, literals * sizeof(Graphics::Pixel));
+				}
+				data += literals * valueSize;
+				i += literals;
+			}
+			else
+			{
+				if (static_cast<size_t>(end - data) < valueSize) break;
+				const size_t run = (std::min)(static_cast<size_t>(control) - MAX_LITERALS + MIN_RUN, count - i);
+
+				Graphics::Pixel value(0x00, 0x00);
+				if (isIndexed)
+				{
+					if (*data < paletteSize) value = palette[*data];
+				}
+				else
+				{
+					std::memcpy(&value, data, sizeof(Graphics::Pixel));
+				}
+				std::fill(pixels + i, pixels + i + run, value);
+				data += valueSize;
+				i += run;
+			}
+		}
+
+		// Truncated data: the rest is transparent.
+		std::fill(pixels + i, pixels + count, Graphics::Pixel(0x00, 0x00));
+	}
+
+
+
+	/****************************/
+	/*		TextureStore		*/
+	/****************************/
+
+
+	TextureId TextureStore::add(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		TextureId id;
+		if (!m_freeIds.empty())
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		else
+		{
+			m_entries.push_back({});
+			id = static_cast<TextureId>(m_entries.size());
+		}
+
+		Entry& entry = m_entries[id - 1];
+		entry.texture = compressTexture(pixels, width, height);
+		entry.isUsed = true;
+
+		m_stats.textureCount++;
+		m_stats.rawBytes += entry.texture.getRawBytes();
+		m_stats.compressedBytes += entry.texture.getCompressedBytes();
+		return id;
+	}
+
+	void TextureStore::evict(_Inout_ Entry& entry) noexcept
+	{
+		m_stats.decodedBytes -= entry.decoded.size() * sizeof(Graphics::Pixel);
+		entry.decoded.clear();
+		entry.decoded.shrink_to_fit();
+	}
+
+	void TextureStore::remove(_In_ TextureId id) noexcept
+	{
+		if (id == INVALID_TEXTURE || id > m_entries.size() || !m_entries[id - 1].isUsed) return;
+
+		Entry& entry = m_entries[id - 1];
+		if (!entry.decoded.empty())
+		{
+			evict(entry);
+			m_decodedIds.erase(std::find(m_decodedIds.begin(), m_decodedIds.end(), id));
+		}
+
+		m_stats.textureCount--;
+		m_stats.rawBytes -= entry.texture.getRawBytes();
+		m_stats.compressedBytes -= entry.texture.getCompressedBytes();
+		entry.texture = {};
+		entry.isUsed = false;
+		m_freeIds.push_back(id);
+	}
+
+	const CompressedTexture* TextureStore::get(_In_ TextureId id) const noexcept
+	{
+		if (id == INVALID_TEXTURE || id > m_entries.size()) return nullptr;
+		const Entry& entry = m_entries[id - 1];
+		return entry.isUsed ? &entry.texture : nullptr;
+	}
+
+	const Graphics::Pixel* TextureStore::decode(_In_ TextureId id)
+	{
+		if (id == INVALID_TEXTURE || id > m_entries.size() || !m_entries[id - 1].isUsed) return nullptr;
+
+		Entry& entry = m_entries[id - 1];
+		entry.lastUse = ++m_clock;
+
+		const size_t count = static_cast<size_t>(entry.texture.width) * entry.texture.height;
+		if (count == 0) return nullptr;
+
+		if (!entry.decoded.empty())
+		{
+			m_stats.hits++;
+			return entry.decoded.data();
+		}
+
+		PROFILE_ZONE("TextureStore::decode");
+		const auto begin = std::chrono::steady_clock::now();
+		entry.decoded.resize(count, Graphics::Pixel(0x00, 0x00));
+		decodeTexture(entry.texture, entry.decoded.data());
+		const auto end = std::chrono::steady_clock::now();
+
+		m_decodedIds.push_back(id);
+		m_stats.decodeCount++;
+		m_stats.decodedPixels += count;
+		m_stats.decodeMs += std::chrono::duration<double, std::milli>(end - begin).count();
+		m_stats.decodedBytes += count * sizeof(Graphics::Pixel);
+		m_stats.peakDecodedBytes = (std::max)(m_stats.peakDecodedBytes, m_stats.decodedBytes);
+		return entry.decoded.data();
+	}
+
+	void TextureStore::trim() noexcept
+	{
+		while (m_stats.decodedBytes > m_decodedBudget && !m_decodedIds.empty())
+		{
+			auto oldest = std::min_element(m_decodedIds.begin(), m_decodedIds.end(), [this](TextureId a, TextureId b) {
+				return m_entries[a - 1].lastUse < m_entries[b - 1].lastUse;
+			});
+			evict(m_entries[*oldest - 1]);
+			*oldest = m_decodedIds.back();
+			m_decodedIds.pop_back();
+			m_stats.evictions++;
+		}
+	}
+
+} // namespace Render
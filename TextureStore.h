@@ -0,0 +1,167 @@
+#pragma once
+#ifndef TEXTURE_STORE_H
+#define TEXTURE_STORE_H
+
+#include <Windows.h>
+#include <minwindef.h> // BYTE
+
+#include <vector>
+
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	struct Pixel;
+} // namespace Graphics
+
+
+namespace Render
+{
+	typedef UINT32 TextureId;
+
+	constexpr TextureId INVALID_TEXTURE = 0;
+
+	enum class TextureFormat : BYTE
+	{
+		Raw,		// The pixels as they are: the encodings did not pay off.
+		Indexed,	// At most 256 colors: a palette, and the run length encoded index of each pixel.
+		RunLength,	// Run length encoded pixels.
+	};
+
+	/**
+	 * @brief The pixels of a bitmap, as kept in memory between two decodes.
+	 *
+	 * @note The runs are PackBits like: a control byte c < 128 is followed by c + 1 literal values,
+	 *       a control byte c >= 128 by one value repeated c - 125 times. A value is a palette index
+	 *       for Indexed textures, a B8G8R8A8 pixel for RunLength ones. Runs go across the rows.
+	 */
+	struct CompressedTexture
+	{
+		TextureFormat format = TextureFormat::Raw;
+		UINT32 width = 0;
+		UINT32 height = 0;
+		std::vector<Graphics::Pixel> palette;	// Indexed only.
+		std::vector<BYTE> data;
+
+		inline size_t getRawBytes() const noexcept { return static_cast<size_t>(width) * height * 4; }
+		size_t getCompressedBytes() const noexcept;
+	};
+
+	/**
+	 * @brief Compress pixels in the smallest format.
+	 */
+	CompressedTexture compressTexture(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+	/**
+	 * @brief Decode a texture into width * height pixels.
+	 */
+	void decodeTexture(_In_ const CompressedTexture& texture, _Out_ Graphics::Pixel* pixels) noexcept;
+
+
+	/**
+	 * @brief Memory and decoding counters of a texture store.
+	 */
+	struct TextureStats
+	{
+		size_t textureCount = 0;
+		size_t rawBytes = 0;			// What the textures would take decoded.
+		size_t compressedBytes = 0;		// What they take compressed.
+		size_t decodedBytes = 0;		// Taken by the decoded buffers kept.
+		size_t peakDecodedBytes = 0;
+
+		UINT64 decodeCount = 0;
+		UINT64 decodedPixels = 0;
+		double decodeMs = 0.0;			// Spent decoding since the beginning.
+		UINT64 hits = 0;				// Decoded buffers found in the cache.
+		UINT64 evictions = 0;
+
+		inline double getCompressionRatio() const noexcept
+		{
+			return compressedBytes == 0 ? 1.0 : static_cast<double>(rawBytes) / static_cast<double>(compressedBytes);
+		}
+
+		inline double getNsPerPixel() const noexcept
+		{
+			return decodedPixels == 0 ? 0.0 : decodeMs * 1000000.0 / static_cast<double>(decodedPixels);
+		}
+	};
+
+
+	/**
+	 * @brief Keeps bitmaps compressed, and decodes them when their pixels are needed.
+	 *
+	 * @note The decoded buffers are kept within a memory budget, the least recently used are evicted by trim.
+	 *       A buffer is never evicted while decoding others, so the pointers given during a frame stay valid
+	 *       until the next trim, whatever the budget.
+	 */
+	class TextureStore
+	{
+	private:
+		struct Entry
+		{
+			CompressedTexture texture;
+			std::vector<Graphics::Pixel> decoded;	// Empty while evicted.
+			UINT64 lastUse = 0;
+			bool isUsed = false;
+		};
+
+		std::vector<Entry> m_entries;	// Indexed by TextureId - 1.
+		std::vector<TextureId> m_freeIds;
+		std::vector<TextureId> m_decodedIds;
+		size_t m_decodedBudget = 32ull * 1024 * 1024;
+		UINT64 m_clock = 0;
+		TextureStats m_stats;
+
+		void evict(_Inout_ Entry& entry) noexcept;
+
+	public:
+		TextureStore() = default;
+		TextureStore(TextureStore&) = delete;
+		TextureStore& operator=(const TextureStore&) = delete;
+
+		/**
+		 * @brief Compress and keep a copy of pixels.
+		 *
+		 * @retval TextureId
+		 * @return The texture's id.
+		 */
+		TextureId add(_In_ const Graphics::Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+		/**
+		 * @brief Drop a texture and its decoded buffer.
+		 */
+		void remove(_In_ TextureId id) noexcept;
+
+		/**
+		 * @brief Return the compressed texture binded to the id, or nullptr if the id is not used.
+		 */
+		const CompressedTexture* get(_In_ TextureId id) const noexcept;
+
+		/**
+		 * @brief Return the decoded pixels of a texture, decoding them if they are not cached.
+		 *
+		 * @note Valid until the next trim or remove.
+		 *
+		 * @retval Pixel*
+		 * @return The width * height premultiplied B8G8R8A8 pixels, or nullptr if the id is not used.
+		 */
+		const Graphics::Pixel* decode(_In_ TextureId id);
+
+		/**
+		 * @brief Evict the least recently used decoded buffers until they fit in the budget.
+		 */
+		void trim() noexcept;
+
+		/**
+		 * @brief Set the memory kept for decoded buffers, applied by the next trim.
+		 */
+		inline void setDecodedBudget(_In_ size_t bytes) noexcept { m_decodedBudget = bytes; }
+		inline size_t getDecodedBudget() const noexcept { return m_decodedBudget; }
+
+		inline const TextureStats& getStats() const noexcept { return m_stats; }
+	};
+
+} // namespace Render
+
+#endif // TEXTURE_STORE_H
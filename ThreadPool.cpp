@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+
+ThreadPool::ThreadPool(_In_opt_ unsigned int threadCount)
+{
+	if (threadCount == 0) threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_queues.push_back(std::make_unique<TaskQueue>());
+
+	// The calling thread is the last runner: it does not need a worker.
+	for (unsigned int i = 0; i + 1 < threadCount; i++)
+		m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+void ThreadPool::pushTasks(_In_ TASKFCT taskFunction, _Inout_ void* context, _In_ size_t count, _Inout_ std::atomic<size_t>* remaining)
+{
+	// Spread the tasks over the queues by contiguous blocks: neighbour indexes usually share data.
+	const size_t queueCount = m_queues.size();
+	for (size_t q = 0; q < queueCount; q++)
+	{
+		size_t begin = count * q / queueCount;
+		size_t end = count * (q + 1) / queueCount;
+
+		std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+		for (size_t i = begin; i < end; i++)
+			m_queues[q]->tasks.push_back({ taskFunction, context, i, remaining });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_pendingTasks += count;
+	}
+	m_wakeUp.notify_all();
+}
+
+bool ThreadPool::runTask(_In_ size_t queueIndex)
+{
+	Task task{};
+	bool found = false;
+
+	// Own queue first, newest task.
+	{
+		TaskQueue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			found = true;
+		}
+	}
+
+	// Then steal the oldest task of another queue.
+	for (size_t i = 1; !found && i < m_queues.size(); i++)
+	{
+		TaskQueue& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found) return false;
+
+	m_pendingTasks--;
+	(*task.taskFunction)(task.context, task.index);
+	task.remaining->fetch_sub(1, std::memory_order_acq_rel);
+	return true;
+}
+
+void ThreadPool::workerLoop(_In_ size_t queueIndex)
+{
+	while (true)
+	{
+		if (runTask(queueIndex)) continue;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeUp.wait(lock, [this]() { return !m_isRunning || m_pendingTasks > 0; });
+		if (!m_isRunning) return;
+	}
+}
+
+void ThreadPool::wait(_In_ std::atomic<size_t>& remaining)
+{
+	const size_t callerQueue = m_queues.size() - 1;
+	while (remaining.load(std::memory_order_acquire) != 0)
+	{
+		if (!runTask(callerQueue))
+			std::this_thread::yield(); // The last tasks are running on other threads.
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_isRunning = false;
+	}
+	m_wakeUp.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <Windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/**
+ * @brief A pool of worker threads sharing work by stealing.
+ *
+ * @note Each thread owns a queue: it pops its own tasks from the back and,
+ *       once empty, steals the oldest tasks of the other queues.
+ */
+class ThreadPool
+{
+private:
+	typedef void(*TASKFCT)(_Inout_ void* context, _In_ size_t index);
+
+	struct Task
+	{
+		TASKFCT taskFunction;
+		void* context;
+		size_t index;
+		std::atomic<size_t>* remaining;
+	};
+
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<TaskQueue>> m_queues; // One per worker, the last one is the caller's.
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeUp;
+	std::atomic<size_t> m_pendingTasks = 0;
+	bool m_isRunning = true;
+
+	void workerLoop(_In_ size_t queueIndex);
+	bool runTask(_In_ size_t queueIndex);
+	void pushTasks(_In_ TASKFCT taskFunction, _Inout_ void* context, _In_ size_t count, _Inout_ std::atomic<size_t>* remaining);
+	void wait(_In_ std::atomic<size_t>& remaining);
+
+public:
+	/**
+	 * @brief Constructor for ThreadPool.
+	 *
+	 * @param[in] threadCount	The number of threads running the tasks, including the calling thread.
+	 *							Zero means one per hardware thread.
+	 */
+	explicit ThreadPool(_In_opt_ unsigned int threadCount = 0);
+
+	ThreadPool(ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool();
+
+	/**
+	 * @brief Return the number of threads running the tasks, including the calling thread.
+	 */
+	inline unsigned int getThreadCount() const noexcept { return static_cast<unsigned int>(m_workers.size() + 1); }
+
+	/**
+	 * @brief Call function(index) for every index in [0, count) and wait for all of them.
+	 *
+	 * @note The calling thread runs tasks as well while waiting.
+	 *
+	 * @param[in] count		The number of indexes.
+	 * @param[in] function	The function to call, must be callable from any thread.
+	 */
+	template <class F>
+	void parallelFor(_In_ size_t count, _In_ F&& function)
+	{
+		if (count == 0) return;
+		if (m_workers.empty())
+		{
+			for (size_t i = 0; i < count; i++) function(i);
+			return;
+		}
+
+		std::atomic<size_t> remaining = count;
+		TASKFCT trampoline = [](void* context, size_t index) { (*reinterpret_cast<std::remove_reference_t<F>*>(context))(index); };
+		pushTasks(trampoline, reinterpret_cast<void*>(&function), count, &remaining);
+		wait(remaining);
+	}
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,345 @@
+#include "TileMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ImageDecoder.h"
+#include "Profiler.h"
+#include "WindowClass.h"
+#include "fctdef.h"
+
+
+namespace Graphics
+{
+	TileMap::TileMap(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* tilesetName, _In_ UINT32 tileWidth, _In_ UINT32 tileHeight,
+		_In_ UINT32 columns, _In_ UINT32 rows, _In_opt_ UINT32 chunkTiles)
+		:m_columns(columns), m_rows(rows), m_tileWidth((std::max)(tileWidth, 1u)), m_tileHeight((std::max)(tileHeight, 1u)),
+		m_chunkTiles((std::max)(chunkTiles, 1u))
+	{
+		PROFILE_ZONE("TileMap::load");
+		__super::setPos(pos);
+
+		m_chunkColumns = (m_columns + m_chunkTiles - 1) / m_chunkTiles;
+		m_chunkRows = (m_rows + m_chunkTiles - 1) / m_chunkTiles;
+		m_tiles.assign(static_cast<size_t>(m_columns) * m_rows, EMPTY_TILE);
+		m_chunkSlots.assign(static_cast<size_t>(m_chunkColumns) * m_chunkRows, INVALID_SLOT);
+
+		Codec::DecodedImage decoded;
+		if (tilesetName && Codec::loadImage(tilesetName, decoded, false))
+		{
+			m_tilesetWidth = decoded.width;
+			m_tilesetHeight = decoded.height;
+			m_tileset = std::move(decoded.frames.front().pixels);
+		}
+		else
+		{
+			// A single transparent tile when the file cannot be read or decoded.
+			m_tilesetWidth = m_tileWidth;
+			m_tilesetHeight = m_tileHeight;
+			m_tileset.assign(static_cast<size_t>(m_tileWidth) * m_tileHeight, Pixel(0x00, 0x00));
+		}
+		indexTileset();
+	}
+
+	/**** Methods ****/
+
+	bool TileMap::initialize(void* window) noexcept
+	{
+		if (!__super::initialize(window)) return false;
+
+		if (m_tilesetResource == Render::INVALID_RESOURCE)
+		{
+			m_tilesetResource = reinterpret_cast<BaseWindow*>(window)->getResources().registerBitmap(m_tileset.data(), m_tilesetWidth, m_tilesetHeight);
+			registerSlots();
+		}
+		setBoundsSize(getSize());
+		return true;
+	}
+
+	void TileMap::indexTileset()
+	{
+		m_tilesetColumns = m_tilesetWidth / m_tileWidth;
+		const UINT32 tilesetRows = m_tilesetHeight / m_tileHeight;
+		m_tileCount = (std::min)(m_tilesetColumns * tilesetRows, static_cast<UINT32>(EMPTY_TILE));
+
+		m_opaqueTiles.assign(m_tileCount, 1);
+		for (UINT32 tile = 0; tile < m_tileCount; tile++)
+		{
+			const Pixel* first = m_tileset.data() + static_cast<size_t>(tile / m_tilesetColumns) * m_tileHeight * m_tilesetWidth + (tile % m_tilesetColumns) * m_tileWidth;
+			for (UINT32 y = 0; y < m_tileHeight && m_opaqueTiles[tile]; y++)
+			{
+				const Pixel* row = first + static_cast<size_t>(y) * m_tilesetWidth;
+				if (!std::all_of(row, row + m_tileWidth, [](const Pixel& pixel) { return pixel.a == 0xFF; }))
+					m_opaqueTiles[tile] = 0;
+			}
+		}
+	}
+
+	void TileMap::setTileset(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height)
+	{
+		m_tileset.assign(pixels, pixels + static_cast<size_t>(width) * height);
+		m_tilesetWidth = width;
+		m_tilesetHeight = height;
+		indexTileset();
+
+		if (m_window && m_tilesetResource != Render::INVALID_RESOURCE)
+			reinterpret_cast<BaseWindow*>(m_window)->getResources().updateBitmap(m_tilesetResource, m_tileset.data(), m_tilesetWidth, m_tilesetHeight);
+		dropChunks();
+	}
+
+	void TileMap::dropChunks() noexcept
+	{
+		// The slots stay registered: their chunks are composed again when next visible.
+		for (ChunkSlot& slot : m_slots)
+		{
+			if (slot.chunk == INVALID_SLOT) continue;
+			m_chunkSlots[slot.chunk] = INVALID_SLOT;
+			slot.chunk = INVALID_SLOT;
+		}
+	}
+
+	void TileMap::registerSlots()
+	{
+		// Registered once, here on the main thread: recording only updates them, so the map records in parallel with the other layers.
+		const size_t chunkBytes = static_cast<size_t>(m_chunkTiles) * m_tileWidth * m_chunkTiles * m_tileHeight * sizeof(Pixel);
+		const size_t count = (std::min)((std::max)(m_cacheBudget / chunkBytes, static_cast<size_t>(1)), m_chunkSlots.size());
+
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		m_slots.resize(count);
+		for (ChunkSlot& slot : m_slots)
+			slot.resource = resources.registerBitmap(nullptr, 0, 0);
+	}
+
+	void TileMap::unregisterSlots() noexcept
+	{
+		dropChunks();
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		for (ChunkSlot& slot : m_slots)
+			resources.unregisterBitmap(slot.resource);
+		m_slots.clear();
+	}
+
+	void TileMap::setCacheBudget(_In_ size_t bytes)
+	{
+		m_cacheBudget = bytes;
+		if (m_window == nullptr || m_tilesetResource == Render::INVALID_RESOURCE) return;
+
+		unregisterSlots();
+		registerSlots();
+	}
+
+	size_t TileMap::getCacheMemory() const noexcept
+	{
+		size_t bytes = 0;
+		for (const ChunkSlot& slot : m_slots) bytes += slot.pixels.capacity() * sizeof(Pixel);
+		return bytes;
+	}
+
+	D2D1_SIZE_U TileMap::getChunkSize(_In_ UINT32 chunk) const noexcept
+	{
+		// The chunks of the last column and row may be cut by the edges of the map.
+		const UINT32 firstColumn = (chunk % m_chunkColumns) * m_chunkTiles;
+		const UINT32 firstRow = (chunk / m_chunkColumns) * m_chunkTiles;
+		return {
+			(std::min)(m_chunkTiles, m_columns - firstColumn) * m_tileWidth,
+			(std::min)(m_chunkTiles, m_rows - firstRow) * m_tileHeight
+		};
+	}
+
+	UINT32 TileMap::acquireSlot() noexcept
+	{
+		// A free slot, or the least recently seen one whose chunk is not visible in this frame.
+		UINT32 oldest = INVALID_SLOT;
+		for (UINT32 i = 0; i < m_slots.size(); i++)
+		{
+			const ChunkSlot& slot = m_slots[i];
+			if (slot.chunk == INVALID_SLOT) return i;
+			if (slot.lastUse < m_frame && (oldest == INVALID_SLOT || slot.lastUse < m_slots[oldest].lastUse)) oldest = i;
+		}
+		if (oldest == INVALID_SLOT) return INVALID_SLOT;
+
+		ChunkSlot& evicted = m_slots[oldest];
+		m_chunkSlots[evicted.chunk] = INVALID_SLOT;
+		evicted.chunk = INVALID_SLOT;
+		m_stats.evictedChunks++;
+		return oldest;
+	}
+
+	void TileMap::copyTile(_Inout_ ChunkSlot& slot, _In_ UINT32 stride, _In_ UINT32 column, _In_ UINT32 row) noexcept
+	{
+		const TileIndex tile = m_tiles[static_cast<size_t>(row) * m_columns + column];
+		Pixel* destination = slot.pixels.data() + static_cast<size_t>(row % m_chunkTiles) * m_tileHeight * stride + (column % m_chunkTiles) * m_tileWidth;
+
+		if (tile >= m_tileCount)
+		{
+			for (UINT32 y = 0; y < m_tileHeight; y++)
+				std::fill(destination + static_cast<size_t>(y) * stride, destination + static_cast<size_t>(y) * stride + m_tileWidth, Pixel(0x00, 0x00));
+			slot.isOpaque = false;
+			return;
+		}
+
+		const Pixel* source = m_tileset.data() + static_cast<size_t>(tile / m_tilesetColumns) * m_tileHeight * m_tilesetWidth + (tile % m_tilesetColumns) * m_tileWidth;
+		for (UINT32 y = 0; y < m_tileHeight; y++)
+			std::copy(source + static_cast<size_t>(y) * m_tilesetWidth, source + static_cast<size_t>(y) * m_tilesetWidth + m_tileWidth, destination + static_cast<size_t>(y) * stride);
+		if (!m_opaqueTiles[tile]) slot.isOpaque = false;
+	}
+
+	void TileMap::renderChunk(_Inout_ ChunkSlot& slot, _In_ UINT32 chunk)
+	{
+		PROFILE_ZONE("TileMap::renderChunk");
+		const D2D1_SIZE_U size = getChunkSize(chunk);
+		const size_t chunkPixels = static_cast<size_t>(m_chunkTiles) * m_tileWidth * m_chunkTiles * m_tileHeight;
+		if (slot.pixels.size() < chunkPixels) slot.pixels.resize(chunkPixels, Pixel(0x00, 0x00));
+
+		slot.chunk = chunk;
+		slot.isOpaque = true;
+		const UINT32 firstColumn = (chunk % m_chunkColumns) * m_chunkTiles;
+		const UINT32 firstRow = (chunk / m_chunkColumns) * m_chunkTiles;
+		for (UINT32 row = firstRow; row < firstRow + size.height / m_tileHeight; row++)
+			for (UINT32 column = firstColumn; column < firstColumn + size.width / m_tileWidth; column++)
+				copyTile(slot, size.width, column, row);
+
+		slot.isDirty = true;
+		m_stats.renderedChunks++;
+		m_stats.lastFrameRendered++;
+	}
+
+	bool TileMap::setTile(_In_ UINT32 column, _In_ UINT32 row, _In_ TileIndex tile) noexcept
+	{
+		if (column >= m_columns || row >= m_rows) return false;
+
+		TileIndex& cell = m_tiles[static_cast<size_t>(row) * m_columns + column];
+		if (cell == tile) return true;
+		cell = tile;
+
+		// A cached chunk gets the single tile, its bitmap is updated when it is next recorded.
+		const UINT32 chunk = (row / m_chunkTiles) * m_chunkColumns + column / m_chunkTiles;
+		const UINT32 slotIndex = m_chunkSlots[chunk];
+		if (slotIndex != INVALID_SLOT)
+		{
+			ChunkSlot& slot = m_slots[slotIndex];
+			copyTile(slot, getChunkSize(chunk).width, column, row);
+			slot.isDirty = true;
+			m_stats.editedTiles++;
+		}
+		return true;
+	}
+
+	bool TileMap::setTiles(_In_ const std::vector<TileIndex>& tiles)
+	{
+		if (tiles.size() != m_tiles.size()) return false;
+		m_tiles = tiles;
+		dropChunks();
+		return true;
+	}
+
+	void TileMap::recordTiles(_Inout_ Render::CommandList& commands, _In_ UINT32 chunk, _In_ const D2D1_POINT_2F& origin, _In_ const D2D1_SIZE_F& scale)
+	{
+		const D2D1_SIZE_U size = getChunkSize(chunk);
+		const UINT32 firstColumn = (chunk % m_chunkColumns) * m_chunkTiles;
+		const UINT32 firstRow = (chunk / m_chunkColumns) * m_chunkTiles;
+		const float tileWidth = m_tileWidth * scale.width, tileHeight = m_tileHeight * scale.height;
+
+		for (UINT32 row = firstRow; row < firstRow + size.height / m_tileHeight; row++)
+			for (UINT32 column = firstColumn; column < firstColumn + size.width / m_tileWidth; column++)
+			{
+				const TileIndex tile = m_tiles[static_cast<size_t>(row) * m_columns + column];
+				if (tile >= m_tileCount) continue;
+
+				const float left = origin.x + column * tileWidth, top = origin.y + row * tileHeight;
+				const float sourceLeft = static_cast<float>((tile % m_tilesetColumns) * m_tileWidth);
+				const float sourceTop = static_cast<float>((tile / m_tilesetColumns) * m_tileHeight);
+				const D2D1_RECT_F destination = D2D1::RectF(left, top, left + tileWidth, top + tileHeight);
+				commands.drawBitmap(m_tilesetResource, destination, D2D1::RectF(sourceLeft, sourceTop, sourceLeft + m_tileWidth, sourceTop + m_tileHeight), m_opacity);
+				if (m_opaqueTiles[tile] && m_opacity >= 1.0f) commands.occlude(destination);
+			}
+	}
+
+	void TileMap::record(_Inout_ Render::CommandList& commands)
+	{
+		m_frame++;
+		m_stats.lastFrameVisible = 0;
+		m_stats.lastFrameRendered = 0;
+		m_stats.lastFrameFallback = 0;
+		if (m_window == nullptr || m_chunkSlots.empty()) return;
+
+		D2D1_RECT_F viewport = m_viewport;
+		if (viewport.right <= viewport.left || viewport.bottom <= viewport.top)
+		{
+			RECT client;
+			GetClientRect(reinterpret_cast<BaseWindow*>(m_window)->getHwnd(), &client);
+			viewport = D2D1::RectF(0.0f, 0.0f, static_cast<float>(client.right - client.left), static_cast<float>(client.bottom - client.top));
+		}
+
+		const D2D1_POINT_2F origin = getWorldPos();
+		const D2D1_SIZE_F scale = getWorldScale();
+		const float chunkWidth = static_cast<float>(m_chunkTiles * m_tileWidth) * scale.width;
+		const float chunkHeight = static_cast<float>(m_chunkTiles * m_tileHeight) * scale.height;
+		if (!(chunkWidth > 0.0f) || !(chunkHeight > 0.0f)) return;
+
+		// The chunks intersecting the viewport, clamped to the map before leaving the floats.
+		const float columns = static_cast<float>(m_chunkColumns), rows = static_cast<float>(m_chunkRows);
+		const UINT32 firstColumn = static_cast<UINT32>((std::clamp)(std::floor((viewport.left - origin.x) / chunkWidth), 0.0f, columns));
+		const UINT32 lastColumn = static_cast<UINT32>((std::clamp)(std::ceil((viewport.right - origin.x) / chunkWidth), 0.0f, columns));
+		const UINT32 firstRow = static_cast<UINT32>((std::clamp)(std::floor((viewport.top - origin.y) / chunkHeight), 0.0f, rows));
+		const UINT32 lastRow = static_cast<UINT32>((std::clamp)(std::ceil((viewport.bottom - origin.y) / chunkHeight), 0.0f, rows));
+
+		Render::ResourceTable& resources = reinterpret_cast<BaseWindow*>(m_window)->getResources();
+		for (UINT32 row = firstRow; row < lastRow; row++)
+			for (UINT32 column = firstColumn; column < lastColumn; column++)
+			{
+				const UINT32 chunk = row * m_chunkColumns + column;
+				m_stats.lastFrameVisible++;
+
+				UINT32 slotIndex = m_chunkSlots[chunk];
+				if (slotIndex == INVALID_SLOT)
+				{
+					slotIndex = acquireSlot();
+					if (slotIndex == INVALID_SLOT)
+					{
+						// Every slot holds a visible chunk.
+						recordTiles(commands, chunk, origin, scale);
+						m_stats.lastFrameFallback++;
+						continue;
+					}
+					m_chunkSlots[chunk] = slotIndex;
+					renderChunk(m_slots[slotIndex], chunk);
+				}
+
+				ChunkSlot& slot = m_slots[slotIndex];
+				slot.lastUse = m_frame;
+				const D2D1_SIZE_U size = getChunkSize(chunk);
+				if (slot.isDirty)
+				{
+					// Drops the device copy: the upload queue creates it again.
+					resources.updateBitmap(slot.resource, slot.pixels.data(), size.width, size.height);
+					slot.isDirty = false;
+				}
+
+				const float left = origin.x + column * chunkWidth, top = origin.y + row * chunkHeight;
+				const D2D1_RECT_F rect = D2D1::RectF(left, top, left + size.width * scale.width, top + size.height * scale.height);
+				commands.drawBitmap(slot.resource, rect, m_opacity);
+				if (slot.isOpaque && m_opacity >= 1.0f) commands.occlude(rect);
+			}
+	}
+
+	void TileMap::reconstruct() noexcept
+	{
+		// The device bitmaps are owned by the window's resource table.
+	}
+
+	void TileMap::setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept
+	{
+		if (property == AnimatedProperty::Opacity)
+			m_opacity = (std::min)((std::max)(value, 0.0f), 1.0f);
+	}
+
+	TileMap::~TileMap()
+	{
+		if (m_window == nullptr || m_tilesetResource == Render::INVALID_RESOURCE) return;
+
+		unregisterSlots();
+		reinterpret_cast<BaseWindow*>(m_window)->getResources().unregisterBitmap(m_tilesetResource);
+	}
+
+} // namespace Graphics
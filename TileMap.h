@@ -0,0 +1,194 @@
+#pragma once
+#ifndef TILE_MAP_H
+#define TILE_MAP_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include <d2d1.h>
+
+#include "GraphicComponents.h"
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	typedef UINT16 TileIndex;	// Index of a tile in the tileset, left to right then top to bottom.
+	constexpr TileIndex EMPTY_TILE = 0xFFFF;
+
+	/**
+	 * @brief Counters of a tile map.
+	 */
+	struct TileMapStats
+	{
+		UINT64 renderedChunks = 0;	// Chunk bitmaps composed since the beginning.
+		UINT64 evictedChunks = 0;	// Chunk bitmaps dropped to make room since the beginning.
+		UINT64 editedTiles = 0;		// Tiles copied into a cached chunk by setTile since the beginning.
+
+		size_t lastFrameVisible = 0;	// Chunks intersecting the viewport in the last frame.
+		size_t lastFrameRendered = 0;	// Of them, those composed in the last frame.
+		size_t lastFrameFallback = 0;	// Of them, those drawn tile by tile because the cache was full.
+	};
+
+
+	/**
+	 * @brief Class for a tile map component: a grid of tiles from a single tileset image.
+	 *
+	 * @note The tiles are stored as 16 bit indexes, and the map is split in chunks of chunkTiles x chunkTiles tiles.
+	 *       Each chunk in the viewport is composed into a bitmap of its own, drawn with a single command, and
+	 *       composed again only when one of its tiles changes. The chunk bitmaps live in a fixed number of slots,
+	 *       registered once, which bounds their memory: the chunks of the least recently seen slots are evicted
+	 *       for the chunks coming into view. If the viewport needs more chunks than there are slots, the others
+	 *       are drawn tile by tile from the tileset.
+	 */
+	class TileMap : public DrawableComponent
+	{
+	private:
+		static constexpr UINT32 INVALID_SLOT = 0xFFFFFFFF;
+
+		/**
+		 * @brief A chunk bitmap.
+		 */
+		struct ChunkSlot
+		{
+			std::vector<Pixel> pixels;	// Allocated on first use, for a whole chunk.
+			Render::ResourceId resource = Render::INVALID_RESOURCE;
+			UINT32 chunk = INVALID_SLOT;	// The chunk it holds, INVALID_SLOT for none.
+			UINT64 lastUse = 0;				// The last frame its chunk was visible.
+			bool isDirty = false;			// Tiles were copied in since its bitmap was last updated.
+			bool isOpaque = false;			// Every pixel has a full alpha. May be false for an opaque chunk after an edit.
+		};
+
+		std::vector<TileIndex> m_tiles;	// m_columns * m_rows, row by row.
+		UINT32 m_columns;
+		UINT32 m_rows;
+		UINT32 m_tileWidth;
+		UINT32 m_tileHeight;
+		UINT32 m_chunkTiles;
+		UINT32 m_chunkColumns;
+		UINT32 m_chunkRows;
+
+		std::vector<Pixel> m_tileset;
+		UINT32 m_tilesetWidth = 0;
+		UINT32 m_tilesetHeight = 0;
+		UINT32 m_tilesetColumns = 0;
+		UINT32 m_tileCount = 0;
+		std::vector<BYTE> m_opaqueTiles;	// Whether each tile of the tileset is opaque.
+		Render::ResourceId m_tilesetResource = Render::INVALID_RESOURCE;
+
+		std::vector<ChunkSlot> m_slots;
+		std::vector<UINT32> m_chunkSlots;	// The slot of each chunk, INVALID_SLOT if it is not cached.
+		size_t m_cacheBudget = 64 << 20;
+		UINT64 m_frame = 0;
+
+		D2D1_RECT_F m_viewport = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float m_opacity = 1.0f;
+		TileMapStats m_stats;
+
+		void indexTileset();
+		void dropChunks() noexcept;
+		void registerSlots();
+		void unregisterSlots() noexcept;
+		UINT32 acquireSlot() noexcept;
+		void renderChunk(_Inout_ ChunkSlot& slot, _In_ UINT32 chunk);
+		void copyTile(_Inout_ ChunkSlot& slot, _In_ UINT32 stride, _In_ UINT32 column, _In_ UINT32 row) noexcept;
+		void recordTiles(_Inout_ Render::CommandList& commands, _In_ UINT32 chunk, _In_ const D2D1_POINT_2F& origin, _In_ const D2D1_SIZE_F& scale);
+		D2D1_SIZE_U getChunkSize(_In_ UINT32 chunk) const noexcept;
+
+	public:
+		/**
+		 * @brief Constructor for a tile map, every tile empty.
+		 *
+		 * @param[in] pos			The position of the map's top left corner, in client dependent pixel.
+		 * @param[in] tilesetName	The tileset image's path, relative or absolute.
+		 * @param[in] tileWidth		The width of a tile, in pixels.
+		 * @param[in] tileHeight	The height of a tile, in pixels.
+		 * @param[in] columns		The number of tiles of the map, horizontally.
+		 * @param[in] rows			The number of tiles of the map, vertically.
+		 * @param[in] chunkTiles	The width and height of a chunk, in tiles.
+		 */
+		TileMap(_In_ const D2D1_POINT_2F& pos, _In_ const wchar_t* tilesetName, _In_ UINT32 tileWidth, _In_ UINT32 tileHeight,
+			_In_ UINT32 columns, _In_ UINT32 rows, _In_opt_ UINT32 chunkTiles = 32);
+
+		TileMap(TileMap&) = delete;
+		TileMap& operator=(const TileMap&) = delete;
+
+		bool initialize(void* window) noexcept override;
+		void record(_Inout_ Render::CommandList& commands) override;
+		void reconstruct() noexcept override;
+
+		/**
+		 * @brief Replace the tileset. Every cached chunk is composed again when next visible.
+		 *
+		 * @param[in] pixels	The width * height premultiplied B8G8R8A8 pixels, copied.
+		 * @param[in] width		The tileset width in pixels.
+		 * @param[in] height	The tileset height in pixels.
+		 */
+		void setTileset(_In_ const Pixel* pixels, _In_ UINT32 width, _In_ UINT32 height);
+
+		/**
+		 * @brief Return the tile at a cell, EMPTY_TILE outside of the map.
+		 */
+		inline TileIndex getTile(_In_ UINT32 column, _In_ UINT32 row) const noexcept
+		{
+			return column < m_columns && row < m_rows ? m_tiles[static_cast<size_t>(row) * m_columns + column] : EMPTY_TILE;
+		}
+
+		/**
+		 * @brief Change the tile at a cell.
+		 *
+		 * @note If its chunk is cached, only the tile is copied into the chunk bitmap, which is uploaded again.
+		 *
+		 * @retval bool
+		 * @return False if the cell is outside of the map.
+		 */
+		bool setTile(_In_ UINT32 column, _In_ UINT32 row, _In_ TileIndex tile) noexcept;
+
+		/**
+		 * @brief Set every tile of the map. Every cached chunk is composed again when next visible.
+		 *
+		 * @param[in] tiles	The columns * rows tiles, row by row.
+		 *
+		 * @retval bool
+		 * @return False if there are not columns * rows tiles.
+		 */
+		bool setTiles(_In_ const std::vector<TileIndex>& tiles);
+
+		/**
+		 * @brief Set the part of the client area the map is drawn in, in client pixels. Empty for the whole client area.
+		 */
+		inline void setViewport(_In_ const D2D1_RECT_F& viewport) noexcept { m_viewport = viewport; }
+
+		/**
+		 * @brief Set the memory of the chunk bitmaps, in bytes: at least one chunk is kept.
+		 *
+		 * @note The chunks cached are dropped.
+		 */
+		void setCacheBudget(_In_ size_t bytes);
+		inline size_t getCacheBudget() const noexcept { return m_cacheBudget; }
+
+		/**
+		 * @brief Return the memory of the chunk bitmaps composed so far, in bytes.
+		 */
+		size_t getCacheMemory() const noexcept;
+
+		inline UINT32 getColumns() const noexcept { return m_columns; }
+		inline UINT32 getRows() const noexcept { return m_rows; }
+		inline D2D1_SIZE_F getSize() const noexcept { return { static_cast<float>(m_columns) * m_tileWidth, static_cast<float>(m_rows) * m_tileHeight }; }
+		inline const TileMapStats& getStats() const noexcept { return m_stats; }
+
+		inline float getOpacity() const noexcept { return m_opacity; }
+		inline void setOpacity(_In_ float opacity) noexcept { m_opacity = opacity; }
+
+		void setAnimatedValue(_In_ AnimatedProperty property, _In_ float value) noexcept override;
+
+		~TileMap();
+	};
+
+} // namespace Graphics
+
+#endif // TILE_MAP_H
@@ -0,0 +1,283 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "Profiler.h"
+#include "fctdef.h"
+
+
+namespace Timers
+{
+
+	TimerWheel::TimerWheel(_In_ TimePoint origin)
+		:m_origin(origin)
+	{
+		std::fill(std::begin(m_heads), std::end(m_heads), NONE);
+	}
+
+	void TimerWheel::link(_In_ UINT32 index)
+	{
+		Timer& timer = m_timers[index];
+
+		// The next tick handled: a timer already due fires on it.
+		const UINT64 base = m_current + 1;
+		UINT64 due = (std::max)(timer.due, base);
+		UINT64 delta = due - base;
+
+		UINT32 slot;
+		if (delta < ROOT_SLOTS)
+		{
+			slot = static_cast<UINT32>(due & (ROOT_SLOTS - 1));
+		}
+		else
+		{
+			if (delta > MAX_DELTA)
+			{
+				// Beyond the last level: moved down when reached, then placed again from its real due tick.
+				due = base + MAX_DELTA;
+				delta = MAX_DELTA;
+			}
+
+			UINT32 level = 1;
+			while (delta >= (1ull << (ROOT_BITS + level * LEVEL_BITS))) level++;
+			const UINT32 shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+			slot = ROOT_SLOTS + (level - 1) * LEVEL_SLOTS + static_cast<UINT32>((due >> shift) & (LEVEL_SLOTS - 1));
+		}
+
+		timer.slot = static_cast<UINT16>(slot);
+		timer.prev = NONE;
+		timer.next = m_heads[slot];
+		if (timer.next != NONE) m_timers[timer.next].prev = index;
+		m_heads[slot] = index;
+		m_occupied[slot >> 6] |= 1ull << (slot & 63);
+	}
+
+	void TimerWheel::unlink(_In_ UINT32 index) noexcept
+	{
+		Timer& timer = m_timers[index];
+		const UINT32 slot = timer.slot;
+
+		if (timer.prev != NONE) m_timers[timer.prev].next = timer.next;
+		else m_heads[slot] = timer.next;
+		if (timer.next != NONE) m_timers[timer.next].prev = timer.prev;
+
+		if (m_heads[slot] == NONE) m_occupied[slot >> 6] &= ~(1ull << (slot & 63));
+		timer.slot = UNLINKED;
+	}
+
+	void TimerWheel::release(_In_ UINT32 index) noexcept
+	{
+		Timer& timer = m_timers[index];
+		timer.isArmed = false;
+		timer.callback = nullptr;
+		if (++timer.generation == 0) timer.generation = 1; // Zero would make INVALID_TIMER a valid id.
+		m_freeTimers.push_back(index);
+		m_count--;
+	}
+
+	UINT32 TimerWheel::findSlot(_In_ UINT32 first, _In_ UINT32 end) const noexcept
+	{
+		for (UINT32 i = first; i < end; i = (i | 63) + 1)
+		{
+			const UINT64 word = m_occupied[i >> 6] >> (i & 63);
+			if (word) return (std::min)(i + static_cast<UINT32>(std::countr_zero(word)), end);
+		}
+		return end;
+	}
+
+	void TimerWheel::cascade(_In_ UINT32 level, _In_ UINT32 slot)
+	{
+		const UINT32 list = ROOT_SLOTS + (level - 1) * LEVEL_SLOTS + slot;
+		UINT32 index = m_heads[list];
+		m_heads[list] = NONE;
+		m_occupied[list >> 6] &= ~(1ull << (list & 63));
+
+		while (index != NONE)
+		{
+			const UINT32 next = m_timers[index].next;
+			link(index);
+			index = next;
+		}
+	}
+
+	void TimerWheel::expire(_In_ UINT32 slot, _In_ HWND hwnd)
+	{
+		// Detach the whole slot first: the functions may schedule or cancel timers.
+		m_expired.clear();
+		for (UINT32 index = m_heads[slot]; index != NONE; index = m_timers[index].next)
+		{
+			m_timers[index].slot = UNLINKED;
+			m_expired.push_back(makeId(index, m_timers[index].generation));
+		}
+		m_heads[slot] = NONE;
+		m_occupied[slot >> 6] &= ~(1ull << (slot & 63));
+
+		if (m_expired.size() > 1)
+		{
+			std::sort(m_expired.begin(), m_expired.end(), [this](TimerId a, TimerId b) {
+				const Timer& timerA = m_timers[static_cast<UINT32>(a & 0xFFFFFFFF)];
+				const Timer& timerB = m_timers[static_cast<UINT32>(b & 0xFFFFFFFF)];
+				if (timerA.priority != timerB.priority) return timerA.priority > timerB.priority;
+				return timerA.sequence < timerB.sequence;
+			});
+		}
+
+		for (size_t i = 0; i < m_expired.size(); i++)
+		{
+			const TimerId id = m_expired[i];
+			if (!isArmed(id)) continue; // Cancelled by a previous function.
+
+			const UINT32 index = static_cast<UINT32>(id & 0xFFFFFFFF);
+			Timer& timer = m_timers[index];
+			const EventHandler::EVENTFCT callback = timer.callback;
+			void* const context = timer.context;
+
+			UINT64 periods = 1;
+			if (timer.period != 0)
+			{
+				// Late by several periods at the end of the advance: one call, and back on the original beat.
+				periods += (m_target - (std::min)(timer.due, m_target)) / timer.period;
+				timer.due += periods * timer.period;
+				link(index);
+			}
+			else
+			{
+				release(index);
+			}
+
+			// The timers can grow while calling: nothing refers to them past this point.
+			callback(hwnd, static_cast<WPARAM>(id), static_cast<LPARAM>(periods), context);
+		}
+		m_expired.clear();
+	}
+
+	TimerId TimerWheel::schedule(_In_ UINT64 delay, _In_ UINT64 period, _In_ EventHandler::EVENTFCT callback, _In_opt_ void* context,
+		_In_opt_ EventHandler::PRIORITY priority)
+	{
+		if (callback == nullptr) return INVALID_TIMER;
+
+		UINT32 index;
+		if (!m_freeTimers.empty())
+		{
+			index = m_freeTimers.back();
+			m_freeTimers.pop_back();
+		}
+		else
+		{
+			index = static_cast<UINT32>(m_timers.size());
+			m_timers.push_back({});
+		}
+
+		Timer& timer = m_timers[index];
+		timer.due = m_current + delay;
+		timer.period = period;
+		timer.sequence = m_sequence++;
+		timer.callback = callback;
+		timer.context = context;
+		timer.priority = priority;
+		timer.isArmed = true;
+		link(index);
+		m_count++;
+
+		return makeId(index, timer.generation);
+	}
+
+	bool TimerWheel::cancel(_In_ TimerId id) noexcept
+	{
+		if (!isArmed(id)) return false;
+
+		const UINT32 index = static_cast<UINT32>(id & 0xFFFFFFFF);
+		if (m_timers[index].slot != UNLINKED) unlink(index); // Unlinked while its slot expires.
+		release(index);
+		return true;
+	}
+
+	bool TimerWheel::isArmed(_In_ TimerId id) const noexcept
+	{
+		const UINT32 index = static_cast<UINT32>(id & 0xFFFFFFFF);
+		const UINT32 generation = static_cast<UINT32>(id >> 32);
+		return index < m_timers.size() && m_timers[index].generation == generation && m_timers[index].isArmed;
+	}
+
+	void TimerWheel::advance(_In_ TimePoint now, _In_opt_ HWND hwnd)
+	{
+		PROFILE_ZONE("TimerWheel::advance");
+		if (now <= m_origin) return;
+		const UINT64 target = static_cast<UINT64>(std::chrono::duration_cast<std::chrono::milliseconds>(now - m_origin).count());
+		m_target = target;
+
+		while (m_current < target)
+		{
+			if (m_count == 0)
+			{
+				m_current = target;
+				break;
+			}
+
+			const UINT64 tick = m_current + 1;
+			const UINT32 index = static_cast<UINT32>(tick & (ROOT_SLOTS - 1));
+			if (index == 0)
+			{
+				// A new turn of the root level: move down the timers of the next slot of each level that turned too.
+				for (UINT32 level = 1; level < LEVEL_COUNT; level++)
+				{
+					const UINT32 slot = static_cast<UINT32>((tick >> (ROOT_BITS + (level - 1) * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+					cascade(level, slot);
+					if (slot != 0) break;
+				}
+			}
+
+			// Jump to the next non empty slot of this turn.
+			const UINT32 slot = findSlot(index, ROOT_SLOTS);
+			if (slot == ROOT_SLOTS)
+			{
+				m_current = (std::min)(target, tick | (ROOT_SLOTS - 1));
+				continue;
+			}
+
+			const UINT64 due = tick - index + slot;
+			if (due > target)
+			{
+				m_current = target;
+				break;
+			}
+
+			m_current = due;
+			expire(slot, hwnd);
+		}
+	}
+
+	void TimerWheel::rebase(_In_ TimePoint now) noexcept
+	{
+		m_origin = now - std::chrono::milliseconds(m_current);
+	}
+
+	TimePoint TimerWheel::getNextDeadline() const noexcept
+	{
+		if (m_count == 0) return TimePoint::max();
+
+		const UINT64 tick = m_current + 1;
+		const UINT32 index = static_cast<UINT32>(tick & (ROOT_SLOTS - 1));
+		const bool hasUpperTimers = (m_occupied[ROOT_SLOTS / 64] | m_occupied[ROOT_SLOTS / 64 + 1] | m_occupied[ROOT_SLOTS / 64 + 2]) != 0;
+
+		UINT64 due;
+		if (index == 0 && hasUpperTimers)
+		{
+			due = tick; // Timers are moved down on this tick.
+		}
+		else if (const UINT32 slot = findSlot(index, ROOT_SLOTS); slot != ROOT_SLOTS)
+		{
+			due = tick - index + slot;
+		}
+		else
+		{
+			// The next turn: moving the timers down, or the first timer of the root level if nothing is above.
+			due = (tick | (ROOT_SLOTS - 1)) + 1;
+			if (!hasUpperTimers) due += findSlot(0, index);
+		}
+
+		return m_origin + std::chrono::milliseconds(due);
+	}
+
+} // namespace Timers
@@ -0,0 +1,151 @@
+#pragma once
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <Windows.h>
+
+#include <chrono>
+#include <vector>
+
+#include "EventHandler.h"
+#include "fctdef.h"
+
+
+namespace Timers
+{
+	typedef UINT64 TimerId;
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	constexpr TimerId INVALID_TIMER = 0;
+
+	/**
+	 * @brief Timers of millisecond resolution, in a hierarchical timing wheel.
+	 *
+	 * @note Scheduling and cancelling are O(1): a timer is linked in the slot of its level, and moved
+	 *       down one level when the wheel reaches the slot, at most three times in its life.
+	 *       Advancing skips the empty slots, so a long sleep costs no more than the timers it fires.
+	 *
+	 *       Level	Slots	Tick per slot	Range
+	 *       0		256		1 ms			256 ms
+	 *       1		64		256 ms			16 s
+	 *       2		64		16 s			17 min
+	 *       3		64		17 min			18 h, farther timers are moved down again when reached
+	 *
+	 *       A timer calls an EventHandler function with the window, its id as wParam and the number of
+	 *       periods elapsed as lParam. The timers due on the same tick are called by priority, then in
+	 *       scheduling order, like the events of a message.
+	 */
+	class TimerWheel
+	{
+	private:
+		static constexpr UINT32 ROOT_BITS = 8;
+		static constexpr UINT32 LEVEL_BITS = 6;
+		static constexpr UINT32 LEVEL_COUNT = 4;
+		static constexpr UINT32 ROOT_SLOTS = 1 << ROOT_BITS;
+		static constexpr UINT32 LEVEL_SLOTS = 1 << LEVEL_BITS;
+		static constexpr UINT32 SLOT_COUNT = ROOT_SLOTS + (LEVEL_COUNT - 1) * LEVEL_SLOTS;
+		static constexpr UINT64 MAX_DELTA = (1ull << (ROOT_BITS + (LEVEL_COUNT - 1) * LEVEL_BITS)) - 1;
+		static constexpr UINT32 NONE = 0xFFFFFFFF;
+		static constexpr UINT16 UNLINKED = 0xFFFF;
+
+		struct Timer
+		{
+			UINT64 due = 0;			// Tick.
+			UINT64 period = 0;		// Ticks, zero for a one-shot timer.
+			UINT64 sequence = 0;
+			EventHandler::EVENTFCT callback = nullptr;
+			void* context = nullptr;
+			UINT32 prev = NONE;
+			UINT32 next = NONE;
+			UINT32 generation = 1;
+			UINT16 slot = UNLINKED;
+			EventHandler::PRIORITY priority = PRIORITY_NORMAL;
+			bool isArmed = false;
+		};
+
+		std::vector<Timer> m_timers;
+		std::vector<UINT32> m_freeTimers;
+		UINT32 m_heads[SLOT_COUNT];
+		UINT64 m_occupied[SLOT_COUNT / 64] = {};	// A bit per non empty slot.
+		std::vector<TimerId> m_expired;
+
+		TimePoint m_origin;
+		UINT64 m_current = 0;	// Last tick handled.
+		UINT64 m_target = 0;	// Tick the running advance goes to.
+		UINT64 m_sequence = 0;
+		size_t m_count = 0;
+
+		static inline TimerId makeId(_In_ UINT32 index, _In_ UINT32 generation) noexcept { return (static_cast<TimerId>(generation) << 32) | index; }
+
+		void link(_In_ UINT32 index);
+		void unlink(_In_ UINT32 index) noexcept;
+		void release(_In_ UINT32 index) noexcept;
+		void cascade(_In_ UINT32 level, _In_ UINT32 slot);
+		void expire(_In_ UINT32 slot, _In_ HWND hwnd);
+		UINT32 findSlot(_In_ UINT32 first, _In_ UINT32 end) const noexcept;
+
+	public:
+		/**
+		 * @param[in] origin The time of the tick zero.
+		 */
+		TimerWheel(_In_ TimePoint origin = std::chrono::steady_clock::now());
+		TimerWheel(TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/**
+		 * @brief Arm a timer.
+		 *
+		 * @note The delay counts from the last advance. A repeating timer late by several periods is called once,
+		 *       with the number of periods elapsed as lParam, and stays on its original beat.
+		 *
+		 * @param[in] delay		Milliseconds before the first call.
+		 * @param[in] period	Milliseconds between the next calls, zero for a one-shot timer.
+		 * @param[in] callback	The function to call.
+		 * @param[in] context	The context given to the function.
+		 * @param[in] priority	Among the timers due on the same tick, the higher the priority, the sooner the call.
+		 *
+		 * @retval TimerId
+		 * @return The timer's id.
+		 */
+		TimerId schedule(_In_ UINT64 delay, _In_ UINT64 period, _In_ EventHandler::EVENTFCT callback, _In_opt_ void* context = nullptr,
+			_In_opt_ EventHandler::PRIORITY priority = PRIORITY_NORMAL);
+
+		/**
+		 * @brief Disarm a timer. Can be called from a timer's function, even for itself.
+		 *
+		 * @retval bool
+		 * @return True if the timer was armed, false if it has already fired or been cancelled.
+		 */
+		bool cancel(_In_ TimerId id) noexcept;
+
+		bool isArmed(_In_ TimerId id) const noexcept;
+
+		inline size_t getCount() const noexcept { return m_count; }
+
+		/**
+		 * @brief Call the timers due until now.
+		 *
+		 * @param[in] now	The time of the frame clock.
+		 * @param[in] hwnd	The window given to the timers' functions.
+		 */
+		void advance(_In_ TimePoint now, _In_opt_ HWND hwnd = NULL);
+
+		/**
+		 * @brief Make the last tick handled happen at the given time. The armed timers keep their remaining delay.
+		 *
+		 * @note Used when the frame clock jumps, like when a replay starts.
+		 */
+		void rebase(_In_ TimePoint now) noexcept;
+
+		/**
+		 * @brief Returns when the wheel must be advanced next, or TimePoint::max() if no timer is armed.
+		 *
+		 * @note Exact when the next timer is less than a slot of level 1 away, otherwise the time the wheel
+		 *       moves it down: the main loop wakes up at most every 256 ms for far timers.
+		 */
+		TimePoint getNextDeadline() const noexcept;
+	};
+
+} // namespace Timers
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,112 @@
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <windows.h>
+
+#include "ThreadPool.h"
+
+
+namespace Graphics
+{
+
+	TransformIndex TransformStore::create(_In_ const D2D1_POINT_2F& position)
+	{
+		TransformIndex index;
+		if (!m_freeIndexes.empty())
+		{
+			index = m_freeIndexes.back();
+			m_freeIndexes.pop_back();
+		}
+		else
+		{
+			index = static_cast<TransformIndex>(m_x.size());
+			for (std::vector<float>* array : { &m_x, &m_y, &m_scaleX, &m_scaleY, &m_rotation, &m_width, &m_height,
+				&m_velocityX, &m_velocityY, &m_minX, &m_minY, &m_maxX, &m_maxY })
+				array->push_back(0.0f);
+		}
+
+		m_x[index] = position.x;
+		m_y[index] = position.y;
+		m_scaleX[index] = 1.0f;
+		m_scaleY[index] = 1.0f;
+		m_minX[index] = m_maxX[index] = position.x;
+		m_minY[index] = m_maxY[index] = position.y;
+		m_count++;
+		return index;
+	}
+
+	void TransformStore::destroy(_In_ TransformIndex index) noexcept
+	{
+		if (index >= m_x.size()) return;
+
+		// Neutral values: the batch operations keep running over the free slots.
+		m_x[index] = m_y[index] = 0.0f;
+		m_scaleX[index] = m_scaleY[index] = 1.0f;
+		m_rotation[index] = 0.0f;
+		m_width[index] = m_height[index] = 0.0f;
+		m_velocityX[index] = m_velocityY[index] = 0.0f;
+		m_freeIndexes.push_back(index);
+		m_count--;
+	}
+
+	void TransformStore::translateAll(_In_ float dx, _In_ float dy, _In_opt_ ThreadPool* pool)
+	{
+		float* __restrict x = m_x.data();
+		float* __restrict y = m_y.data();
+
+		forEachChunk(pool, [x, y, dx, dy](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) x[i] += dx;
+			for (size_t i = begin; i < end; i++) y[i] += dy;
+		});
+	}
+
+	void TransformStore::applyVelocity(_In_ float seconds, _In_opt_ ThreadPool* pool)
+	{
+		float* __restrict x = m_x.data();
+		float* __restrict y = m_y.data();
+		const float* __restrict vx = m_velocityX.data();
+		const float* __restrict vy = m_velocityY.data();
+
+		forEachChunk(pool, [x, y, vx, vy, seconds](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) x[i] += vx[i] * seconds;
+			for (size_t i = begin; i < end; i++) y[i] += vy[i] * seconds;
+		});
+	}
+
+	void TransformStore::computeBounds(_In_opt_ ThreadPool* pool)
+	{
+		const float* __restrict x = m_x.data();
+		const float* __restrict y = m_y.data();
+		const float* __restrict scaleX = m_scaleX.data();
+		const float* __restrict scaleY = m_scaleY.data();
+		const float* __restrict rotation = m_rotation.data();
+		const float* __restrict width = m_width.data();
+		const float* __restrict height = m_height.data();
+		float* __restrict minX = m_minX.data();
+		float* __restrict minY = m_minY.data();
+		float* __restrict maxX = m_maxX.data();
+		float* __restrict maxY = m_maxY.data();
+
+		forEachChunk(pool, [=](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				const float c = std::cos(rotation[i]);
+				const float s = std::sin(rotation[i]);
+				const float w = width[i] * scaleX[i];
+				const float h = height[i] * scaleY[i];
+
+				// Offsets of the rotated corners from the position, which is the (0, 0) corner.
+				const float wx = w * c, wy = w * s;
+				const float hx = -h * s, hy = h * c;
+
+				minX[i] = x[i] + (wx < 0.0f ? wx : 0.0f) + (hx < 0.0f ? hx : 0.0f);
+				maxX[i] = x[i] + (wx > 0.0f ? wx : 0.0f) + (hx > 0.0f ? hx : 0.0f);
+				minY[i] = y[i] + (wy < 0.0f ? wy : 0.0f) + (hy < 0.0f ? hy : 0.0f);
+				maxY[i] = y[i] + (wy > 0.0f ? wy : 0.0f) + (hy > 0.0f ? hy : 0.0f);
+			}
+		});
+	}
+
+} // namespace Graphics
@@ -0,0 +1,131 @@
+#pragma once
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <Windows.h>
+
+#include <vector>
+
+#include <d2d1.h>
+
+#include "ThreadPool.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Graphics
+{
+	typedef UINT32 TransformIndex;
+
+	constexpr TransformIndex INVALID_TRANSFORM = 0xFFFFFFFF;
+
+	/**
+	 * @brief Transforms of many components, stored as contiguous arrays.
+	 *
+	 * @note Each array holds one value per slot, so the batch operations are plain loops
+	 *       over floats that the compiler vectorizes. Free slots keep neutral values:
+	 *       batch operations may run over them harmlessly.
+	 */
+	class TransformStore
+	{
+	private:
+		std::vector<float> m_x, m_y;				// Position of the top left corner.
+		std::vector<float> m_scaleX, m_scaleY;
+		std::vector<float> m_rotation;				// Radians, clockwise, around the position.
+		std::vector<float> m_width, m_height;		// Unscaled size.
+		std::vector<float> m_velocityX, m_velocityY;	// Pixels per second.
+		std::vector<float> m_minX, m_minY, m_maxX, m_maxY; // Axis aligned bounds, see computeBounds.
+
+		std::vector<TransformIndex> m_freeIndexes;
+		size_t m_count = 0;
+
+		/**
+		 * @brief Call function(begin, end) on chunks of the slots, in parallel if a pool is given.
+		 */
+		template <class F>
+		void forEachChunk(_In_opt_ ThreadPool* pool, _In_ F&& function)
+		{
+			constexpr size_t CHUNK_SIZE = 1 << 14;
+			const size_t size = m_x.size();
+			if (pool == nullptr || size <= CHUNK_SIZE)
+			{
+				function(static_cast<size_t>(0), size);
+				return;
+			}
+			pool->parallelFor((size + CHUNK_SIZE - 1) / CHUNK_SIZE, [&function, size](size_t chunk) {
+				function(chunk * CHUNK_SIZE, (std::min)(size, (chunk + 1) * CHUNK_SIZE));
+			});
+		}
+
+	public:
+		TransformStore() = default;
+		TransformStore(TransformStore&) = delete;
+		TransformStore& operator=(const TransformStore&) = delete;
+
+		/**
+		 * @brief Allocate a slot.
+		 *
+		 * @param[in] position The initial position.
+		 *
+		 * @retval TransformIndex
+		 * @return The index of the slot, with a unit scale, no rotation, no size and no velocity.
+		 */
+		TransformIndex create(_In_ const D2D1_POINT_2F& position);
+
+		/**
+		 * @brief Free a slot, its index may be returned by a later create.
+		 */
+		void destroy(_In_ TransformIndex index) noexcept;
+
+		inline size_t getCount() const noexcept { return m_count; }
+		inline size_t getCapacity() const noexcept { return m_x.size(); }
+
+		inline D2D1_POINT_2F getPos(_In_ TransformIndex index) const noexcept { return { m_x[index], m_y[index] }; }
+		inline void setPos(_In_ TransformIndex index, _In_ const D2D1_POINT_2F& pos) noexcept { m_x[index] = pos.x; m_y[index] = pos.y; }
+
+		inline D2D1_SIZE_F getScale(_In_ TransformIndex index) const noexcept { return { m_scaleX[index], m_scaleY[index] }; }
+		inline void setScale(_In_ TransformIndex index, _In_ const D2D1_SIZE_F& scale) noexcept { m_scaleX[index] = scale.width; m_scaleY[index] = scale.height; }
+
+		inline float getRotation(_In_ TransformIndex index) const noexcept { return m_rotation[index]; }
+		inline void setRotation(_In_ TransformIndex index, _In_ float radians) noexcept { m_rotation[index] = radians; }
+
+		inline D2D1_SIZE_F getSize(_In_ TransformIndex index) const noexcept { return { m_width[index], m_height[index] }; }
+		inline void setSize(_In_ TransformIndex index, _In_ const D2D1_SIZE_F& size) noexcept { m_width[index] = size.width; m_height[index] = size.height; }
+
+		inline D2D1_POINT_2F getVelocity(_In_ TransformIndex index) const noexcept { return { m_velocityX[index], m_velocityY[index] }; }
+		inline void setVelocity(_In_ TransformIndex index, _In_ const D2D1_POINT_2F& velocity) noexcept { m_velocityX[index] = velocity.x; m_velocityY[index] = velocity.y; }
+
+		/**
+		 * @brief Return the bounds computed by the last call to computeBounds.
+		 */
+		inline D2D1_RECT_F getBounds(_In_ TransformIndex index) const noexcept { return { m_minX[index], m_minY[index], m_maxX[index], m_maxY[index] }; }
+
+		/**
+		 * @brief Move every slot.
+		 *
+		 * @param[in] dx	Horizontal offset, in pixels.
+		 * @param[in] dy	Vertical offset, in pixels.
+		 * @param[in] pool	Pool to split the work on, nullptr to run on the calling thread.
+		 */
+		void translateAll(_In_ float dx, _In_ float dy, _In_opt_ ThreadPool* pool = nullptr);
+
+		/**
+		 * @brief Move every slot by its velocity.
+		 *
+		 * @param[in] seconds	Elapsed time.
+		 * @param[in] pool		Pool to split the work on, nullptr to run on the calling thread.
+		 */
+		void applyVelocity(_In_ float seconds, _In_opt_ ThreadPool* pool = nullptr);
+
+		/**
+		 * @brief Compute the axis aligned bounds of every slot from its position, size, scale and rotation.
+		 *
+		 * @param[in] pool Pool to split the work on, nullptr to run on the calling thread.
+		 */
+		void computeBounds(_In_opt_ ThreadPool* pool = nullptr);
+	};
+
+} // namespace Graphics
+
+#endif // TRANSFORM_STORE_H
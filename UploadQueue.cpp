@@ -0,0 +1,102 @@
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <windows.h>
+#include <d2d1.h>
+
+#include "Profiler.h"
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+
+	typedef std::chrono::steady_clock ticker;
+
+	void UploadQueue::process(_In_ const CommandBuffer& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget, _In_opt_ const std::vector<ResourceId>* culled)
+	{
+		PROFILE_ZONE("UploadQueue::process");
+		const ticker::time_point start = ticker::now();
+
+		// Visible bitmaps, front z-indexes first, in recording order. The stamp keeps each one once.
+		m_frame++;
+		m_pending.clear();
+		const auto& layers = commands.getLayers();
+		for (auto it = layers.rbegin(); it != layers.rend(); it++)
+		{
+			for (const Command& command : it->second.getCommands())
+			{
+				if (!usesBitmap(command) || resources.getResidentBitmap(command.resource)) continue;
+				if (resources.getBitmap(command.resource) == nullptr) continue;
+				if (resources.stampUpload(command.resource, m_frame)) m_pending.push_back(command.resource);
+			}
+		}
+		const size_t visibleCount = m_pending.size();
+
+		if (m_isPrefetching)
+		{
+			// Stamped as queued, the culled bitmaps are skipped. The visible ones are already stamped.
+			if (culled != nullptr)
+				for (ResourceId id : *culled)
+					resources.stampUpload(id, m_frame);
+
+			// The bounded list of the recent bitmaps, rather than every id: the evicted tiles have no pixels and are pruned.
+			resources.pruneRecentBitmaps();
+			for (ResourceId id : resources.getRecentBitmaps())
+				if (resources.stampUpload(id, m_frame)) m_pending.push_back(id);
+		}
+
+		const size_t byteBudget = m_byteBudget >> m_budgetShift;
+		const double timeBudgetMs = m_timeBudgetMs / static_cast<double>(1u << m_budgetShift);
+
+		size_t bytes = 0;
+		size_t uploads = 0;
+		size_t uploadedVisible = 0;
+		double elapsedMs = 0.0;
+
+		for (size_t i = 0; i < m_pending.size(); i++)
+		{
+			const BitmapResource* bitmap = resources.getBitmap(m_pending[i]);
+			const size_t size = static_cast<size_t>(bitmap->width) * bitmap->height * 4;
+
+			// Always let one visible bitmap through, or a bitmap bigger than the budget would never show.
+			const bool isFirst = uploads == 0 && i < visibleCount;
+			if (!isFirst && (bytes + size > byteBudget || elapsedMs >= timeBudgetMs)) break;
+
+			HRESULT hr;
+			{
+				PROFILE_ZONE("uploadBitmap");
+				hr = resources.uploadBitmap(m_pending[i], renderTarget);
+			}
+			if (FAILED(hr))
+			{
+				resources.deferUpload(m_pending[i], m_frame);
+				m_stats.failureCount++;
+			}
+			else if (hr == S_OK)
+			{
+				bytes += size;
+				uploads++;
+				if (i < visibleCount) uploadedVisible++;
+			}
+
+			elapsedMs = std::chrono::duration<double, std::milli>(ticker::now() - start).count();
+		}
+
+		m_stats.uploadCount += uploads;
+		m_stats.uploadedBytes += bytes;
+		m_stats.lastFrameUploads = uploads;
+		m_stats.lastFrameBytes = bytes;
+		m_stats.lastFrameMs = uploads == 0 ? 0.0 : elapsedMs;
+		m_stats.pendingCount = visibleCount - uploadedVisible;
+		if (m_stats.pendingCount != 0) m_stats.backlogFrames++;
+		m_stats.peakFrameBytes = (std::max)(m_stats.peakFrameBytes, bytes);
+		m_stats.peakFrameMs = (std::max)(m_stats.peakFrameMs, m_stats.lastFrameMs);
+	}
+
+} // namespace Render
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <d2d1.h>
+
+#include "RenderCommands.h"
+#include "fctdef.h"
+
+#pragma comment(lib, "d2d1")
+
+
+namespace Render
+{
+	/**
+	 * @brief Upload counters, to spot the frames that spent too long creating bitmaps.
+	 */
+	struct UploadStats
+	{
+		UINT64 uploadCount = 0;		// Bitmaps created since the beginning.
+		UINT64 uploadedBytes = 0;	// Bytes uploaded since the beginning.
+		UINT64 failureCount = 0;	// Bitmaps which creation failed.
+		UINT64 backlogFrames = 0;	// Frames ended with visible bitmaps still waiting.
+
+		size_t lastFrameUploads = 0;
+		size_t lastFrameBytes = 0;
+		double lastFrameMs = 0.0;
+		size_t pendingCount = 0;	// Visible bitmaps still waiting after the last frame.
+
+		size_t peakFrameBytes = 0;	// Largest upload of a single frame.
+		double peakFrameMs = 0.0;	// Longest upload of a single frame.
+	};
+
+
+	/**
+	 * @brief Spread the creation of the device bitmaps over several frames.
+	 *
+	 * @note Each frame, the bitmaps drawn by the frame are uploaded first, front z-indexes first,
+	 *       then the bitmaps registered or updated lately, until the byte or time budget is spent.
+	 *       The bitmaps culled from the frame are not prefetched: their tiles or chunks were just hidden.
+	 *       The bitmaps that are not uploaded yet are drawn as placeholders by the backend.
+	 *       At least one visible bitmap is uploaded per frame, whatever its size. A bitmap which upload
+	 *       failed waits 2, 4, 8... frames, up to 256, before the next try.
+	 */
+	class UploadQueue
+	{
+	private:
+		std::vector<ResourceId> m_pending; // Reused between frames.
+		UINT64 m_frame = 0; // Stamped on the bitmaps queued, so that each is queued once per frame.
+
+		size_t m_byteBudget = 16ull * 1024 * 1024;
+		double m_timeBudgetMs = 4.0;
+		UINT32 m_budgetShift = 0;
+		bool m_isPrefetching = true;
+
+		UploadStats m_stats;
+
+	public:
+		UploadQueue() = default;
+		UploadQueue(UploadQueue&) = delete;
+		UploadQueue& operator=(const UploadQueue&) = delete;
+
+		/**
+		 * @brief Upload the bitmaps used by the frame within the budget.
+		 * @note  Must be called before executing the commands.
+		 *
+		 * @param[in] commands		The commands of the frame.
+		 * @param[in] resources		The resources referenced by the commands.
+		 * @param[in] renderTarget	The render target the bitmaps are created for.
+		 * @param[in] culled		The bitmaps of the commands culled from the frame, left out of the prefetch.
+		 */
+		void process(_In_ const CommandBuffer& commands, _Inout_ ResourceTable& resources, _In_ ID2D1RenderTarget* renderTarget, _In_opt_ const std::vector<ResourceId>* culled = nullptr);
+
+		/**
+		 * @brief Set the budget spent per frame.
+		 *
+		 * @param[in] bytes	Maximum bytes uploaded per frame.
+		 * @param[in] ms	Maximum time spent uploading per frame, in milliseconds.
+		 */
+		inline void setBudget(_In_ size_t bytes, _In_ double ms) noexcept { m_byteBudget = bytes; m_timeBudgetMs = ms; }
+
+		inline size_t getByteBudget() const noexcept { return m_byteBudget; }
+		inline double getTimeBudget() const noexcept { return m_timeBudgetMs; }
+
+		/**
+		 * @brief Divide the budget by 2^shift, keeping the budget set.
+		 *
+		 * @note Used by the quality governor to spread the uploads over more frames.
+		 */
+		inline void setBudgetShift(_In_ UINT32 shift) noexcept { m_budgetShift = (std::min)(shift, 16u); }
+		inline UINT32 getBudgetShift() const noexcept { return m_budgetShift; }
+
+		/**
+		 * @brief Allow uploading the bitmaps registered or updated lately, not drawn yet, with the budget left.
+		 */
+		inline void setPrefetching(_In_ bool prefetch) noexcept { m_isPrefetching = prefetch; }
+
+		inline const UploadStats& getStats() const noexcept { return m_stats; }
+		inline void resetStats() noexcept { m_stats = {}; }
+	};
+
+} // namespace Render
+
+#endif // UPLOAD_QUEUE_H
@@ -3,20 +3,36 @@
 #include <memory>
 #include <chrono>
 #include <map>
+#include <mutex>
+#include <algorithm>
+#include <execution>
+#include <thread>
+#include <typeinfo>
 
 #include <windows.h>
 #include <winbase.h>
 #include <winuser.h>
 #include <winerror.h>
+#include <timeapi.h>
 
 #include <d2d1.h>
 
 #include "WindowClass.h"
+#include "Animation.h"
 #include "EventHandler.h"
+#include "GlyphCache.h"
 #include "GraphicComponents.h"
+#include "Profiler.h"
+#include "RenderCommands.h"
+#include "Replay.h"
+#include "SoftwareRenderer.h"
+#include "Task.h"
+#include "TimerWheel.h"
+#include "UploadQueue.h"
 #include "fctdef.h"
 
 #pragma comment(lib, "d2d1")
+#pragma comment(lib, "winmm")
 
 
 typedef std::chrono::steady_clock ticker;
@@ -24,7 +40,7 @@ typedef std::chrono::steady_clock ticker;
 ticker::time_point lastUpdateTime = ticker::now();
 
 
-LRESULT onDestroy(_In_ HWND hwnd, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+LRESULT onDestroy(_In_ HWND /*hwnd*/, _In_ WPARAM /*wParam*/, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
 {
 	
 	BaseWindow* window = reinterpret_cast<BaseWindow*>(context);
@@ -33,51 +49,48 @@ LRESULT onDestroy(_In_ HWND hwnd, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout
 	return S_OK;
 }
 
-LRESULT onPaint(_In_ HWND hwnd, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+LRESULT onPaint(_In_ HWND hwnd, _In_ WPARAM /*wParam*/, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
 {
+	PROFILE_ZONE("onPaint");
 	BaseWindow* window = reinterpret_cast<BaseWindow*>(context);
 
-	PAINTSTRUCT ps;
-	HDC hdc = BeginPaint(hwnd, &ps);
-	
-	Graphics::D2D1RenderTools& rt = window->getRenderTools();
-	if(!rt.isRenderTargetValid()) rt.CreateRenderTarget(hwnd);
-
-	rt.pRenderTarget->BeginDraw();
-	
-	rt.pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Azure));
-
-	// Call draw method on all drawable components.
-	const ComponentMap& componentMap = window->getComponentList();
-	for (auto&[zIndex, components] : componentMap)
+	// The render thread draws: only record the frame and hand it over.
+	if (window->isThreadedRenderingEnabled())
 	{
-		for (auto&[component, id] : components) {
-			Graphics::DrawableComponent* drawComp = dynamic_cast<Graphics::DrawableComponent*>(component.get());
-			if (drawComp) drawComp->draw(hwnd, rt.pRenderTarget);
-		}
+		window->submitFrame();
+		return S_OK;
 	}
-	
-	HRESULT hr = rt.pRenderTarget->EndDraw();
 
-	// Call reconstruct method on all drawable components if the render target gets destroyed.
-	//TODO: maybe update componentMap.
-	if (hr == D2DERR_RECREATE_TARGET)
-	{
-		rt.DestroyRenderTarget();
-		window->reconstructDrawableComponents();
-	}
-	return hr;
+	PAINTSTRUCT ps;
+	BeginPaint(hwnd, &ps);
+	return window->paintFrame();
 }
 
-LRESULT onResize(_In_ HWND hwnd, _In_ WPARAM wParam, _In_ LPARAM lParam, _Inout_opt_ void* context)
+#ifdef ENABLE_PROFILER
+LRESULT onProfileKey(_In_ HWND /*hwnd*/, _In_ WPARAM wParam, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
 {
+	if (wParam != VK_F9) return S_OK;
 	BaseWindow* window = reinterpret_cast<BaseWindow*>(context);
-	Graphics::D2D1RenderTools& rt = window->getRenderTools();
-	rt.DestroyRenderTarget();
-	rt.CreateRenderTarget(hwnd);
-	window->reconstructDrawableComponents();
+	window->captureProfile(120, L"profile.json");
 	return S_OK;
 }
+#endif
+
+LRESULT onResize(_In_ HWND /*hwnd*/, _In_ WPARAM /*wParam*/, _In_ LPARAM /*lParam*/, _Inout_opt_ void* context)
+{
+	PROFILE_ZONE("onResize");
+	BaseWindow* window = reinterpret_cast<BaseWindow*>(context);
+	window->resizeRenderTarget();
+	return S_OK;
+}
+
+/**
+ * @brief Return true for the keyboard and mouse messages, whose latency is measured.
+ */
+inline bool isInputMessage(_In_ UINT message) noexcept
+{
+	return (message >= WM_KEYFIRST && message <= WM_KEYLAST) || (message >= WM_MOUSEFIRST && message <= WM_MOUSELAST);
+}
 
 
 BaseWindow::BaseWindow(_In_ const HINSTANCE hInstance, _In_ const LPCWSTR className, _In_ const LPCWSTR windowName)
@@ -115,12 +128,15 @@ void BaseWindow::show(_In_ const int nCmdShow = SW_SHOW)
 	EventHandler::registerEvent(WM_DESTROY, onDestroy, this, PRIORITY_HIGHEST);
 	EventHandler::registerEvent(CM_UPDATEFRAME, onPaint, this);
 	EventHandler::registerEvent(WM_EXITSIZEMOVE, onResize, this);
+#ifdef ENABLE_PROFILER
+	EventHandler::registerEvent(WM_KEYDOWN, onProfileKey, this);
+#endif
 	ShowWindow(m_hwnd, nCmdShow);
 }
 
 Graphics::Component* BaseWindow::getComponent(_In_ ComponentId componentId) const noexcept
 {
-	for (const auto& [zIndex, components] : m_components) // ZIndex zIndex, std::vector<std::pair<std::unique_ptr<Component>, ComponentId>> components.
+	for (const auto& [zIndex, components] : m_components) // ZIndex zIndex, std::vector<std::pair<ComponentPtr, ComponentId>> components.
 	{
 		for (auto it = components.begin(); it < components.end(); it++)
 		{
@@ -133,11 +149,14 @@ Graphics::Component* BaseWindow::getComponent(_In_ ComponentId componentId) cons
 	return nullptr;
 }
 
-ComponentId BaseWindow::addComponent(_In_ std::unique_ptr<Graphics::Component>&& component, _In_opt_ int zIndex)
+ComponentId BaseWindow::addComponent(_In_ Graphics::ComponentPtr&& component, _In_opt_ int zIndex)
 {
+	if (m_useTransformStore) component->attachTransform(m_transforms);
+
 	if (component->initialize(this))
 	{
 		m_lastIdUsed++;
+		if (m_pRecorder) m_pRecorder->recordAddComponent(*component, m_lastIdUsed, zIndex);
 		m_components[zIndex].push_back({std::move(component), m_lastIdUsed });
 	}
 
@@ -146,6 +165,11 @@ ComponentId BaseWindow::addComponent(_In_ std::unique_ptr<Graphics::Component>&&
 
 inline void BaseWindow::reconstructDrawableComponents() noexcept
 {
+	PROFILE_ZONE("reconstructDrawableComponents");
+	m_layerCache.releaseDeviceResources();
+	m_resources.releaseDeviceResources();
+	m_renderBackend.releaseDeviceResources();
+
 	for (auto& [zIndex, components] : m_components)
 	{
 		for (auto& [component, id] : components) {
@@ -155,16 +179,323 @@ inline void BaseWindow::reconstructDrawableComponents() noexcept
 	}
 }
 
-std::unique_ptr<Graphics::Component>&& BaseWindow::removeComponent(_In_ ComponentId componentId) noexcept
+void recordComponents(_In_ const std::vector<IndexedComponent>& components, _Inout_ Render::CommandList& commands)
+{
+	for (auto& [component, id] : components)
+	{
+		Graphics::DrawableComponent* drawComp = dynamic_cast<Graphics::DrawableComponent*>(component.get());
+		if (drawComp)
+		{
+			PROFILE_ZONE(typeid(*drawComp).name());
+			drawComp->record(commands);
+		}
+	}
+}
+
+void BaseWindow::updateAnimations()
+{
+	// The skipped frames leave the clock behind: the next update catches up, the tweens still end on time.
+	const UINT32 interval = m_quality.getSettings().animationInterval;
+	if (interval > 1 && ++m_animationFrame % interval != 0) return;
+
+	ticker::time_point currentTime = Replay::now(); // Virtual while replaying a capture.
+	std::chrono::duration<float> elapsed = currentTime - m_lastAnimationTime;
+	m_lastAnimationTime = currentTime;
+	m_animations.update(elapsed.count());
+}
+
+void BaseWindow::updateTasks()
+{
+	m_tasks.update(Replay::now());
+}
+
+void BaseWindow::updateTimers()
+{
+	m_timers.advance(Replay::now(), m_hwnd);
+}
+
+void BaseWindow::resetAnimationClock() noexcept
+{
+	m_lastAnimationTime = Replay::now();
+}
+
+void BaseWindow::recordFrame()
+{
+	PROFILE_ZONE("recordFrame");
+	m_scene.update(); // The components draw at their world position.
+	m_commandBuffer.reset();
+
+	// Create the layers first: the command buffer can't be modified while recording in parallel.
+	// The low priority z-indexes keep an empty list when the quality level skips them.
+	const bool skipLowPriority = m_quality.getSettings().skipLowPriorityLayers;
+	m_recordJobs.clear();
+	for (auto& [zIndex, components] : m_components)
+	{
+		Render::CommandList& commands = m_commandBuffer.getLayer(zIndex);
+		if (skipLowPriority && m_lowPriorityLayers.count(zIndex) != 0 && !m_layerCache.isLayerCached(zIndex)) continue;
+		m_recordJobs.push_back({ &components, &commands });
+	}
+
+	if (m_parallelRecording)
+	{
+		std::for_each(std::execution::par, m_recordJobs.begin(), m_recordJobs.end(), [](auto& job) {
+			recordComponents(*job.first, *job.second);
+		});
+	}
+	else
+	{
+		for (auto& [components, commands] : m_recordJobs)
+			recordComponents(*components, *commands);
+	}
+}
+
+bool BaseWindow::setComponentParent(_In_ ComponentId childId, _In_ ComponentId parentId)
 {
-	for (auto& [zIndex, components] : m_components) // ZIndex zIndex, std::vector<std::pair<std::unique_ptr<Component>, ComponentId>> components.
+	Graphics::Component* child = getComponent(childId);
+	if (child == nullptr) return false;
+
+	Graphics::NodeId parentNode = Graphics::INVALID_NODE;
+	if (parentId != 0)
+	{
+		Graphics::Component* parent = getComponent(parentId);
+		if (parent == nullptr || parent == child) return false;
+		if (parent->getScene() != &m_scene) parent->attachToScene(m_scene);
+		parentNode = parent->getSceneNode();
+	}
+
+	if (child->getScene() != &m_scene)
+	{
+		child->attachToScene(m_scene, parentNode);
+		return true;
+	}
+	return m_scene.setParent(child->getSceneNode(), parentNode);
+}
+
+Graphics::Component* BaseWindow::hitTest(_In_ const D2D1_POINT_2F& point) noexcept
+{
+	m_scene.hitTestAll(point, &m_hits);
+	if (m_hits.empty()) return nullptr;
+
+	// The scene graph only knows the hierarchy: the components are drawn by z-index, then in the order they were added.
+	// Only the window's components are returned: a node may belong to a component attached by its owner.
+	for (auto zIt = m_components.rbegin(); zIt != m_components.rend(); zIt++)
+	{
+		for (auto it = zIt->second.rbegin(); it != zIt->second.rend(); it++)
+		{
+			if (std::find(m_hits.begin(), m_hits.end(), it->first.get()) != m_hits.end()) return it->first.get();
+		}
+	}
+	return nullptr;
+}
+
+HRESULT BaseWindow::paintFrame()
+{
+	const ticker::time_point start = ticker::now();
+	updateAnimations();
+
+	// Record the commands of all drawable components before drawing anything.
+	recordFrame();
+
+	// Glyphs rasterized while recording.
+	m_glyphs.flush();
+
+	const HRESULT hr = presentFrame();
+
+	// Waiting for the vsync is not work: at the refresh rate, it would fill the budget of an idle frame.
+	const double frameMs = std::chrono::duration<double, std::milli>(ticker::now() - start).count();
+	updateQuality(frameMs - m_presentStats.lastPresentWaitMs);
+
+	// The tasks waiting for the next frame run on the next update.
+	m_tasks.advanceFrame();
+	return hr;
+}
+
+void BaseWindow::submitFrame()
+{
+	PROFILE_ZONE("submitFrame");
+	const ticker::time_point start = ticker::now();
+	updateAnimations();
+	recordFrame();
+	m_glyphs.flush();
+
+	// The slowest of the two threads sets the frame rate, the render thread's wait for the vsync aside.
+	const double recordMs = std::chrono::duration<double, std::milli>(ticker::now() - start).count();
+	updateQuality((std::max)(recordMs, m_presentStats.lastPresentMs - m_presentStats.lastPresentWaitMs));
+
+	// The recorded commands become the snapshot, the command buffer gets the storage of an old one.
+	Render::FrameSnapshot& snapshot = m_snapshots.getBack();
+	std::swap(snapshot.commands, m_commandBuffer);
+	snapshot.frame = ++m_frameCount;
+	snapshot.recordTime = ticker::now();
+	snapshot.inputTime = m_pendingInputTime;
+	m_pendingInputTime = ticker::time_point();
+
+	m_presentStats.framesRecorded++;
+	if (m_snapshots.publish()) m_presentStats.framesDropped++;
+	m_publishedCount.fetch_add(1, std::memory_order_release);
+	m_publishedCount.notify_one();
+
+	// The tasks waiting for the next frame run on the next update.
+	m_tasks.advanceFrame();
+}
+
+HRESULT BaseWindow::presentFrame()
+{
+	m_frameCount++;
+	m_presentStats.framesRecorded++;
+	const ticker::time_point inputTime = m_pendingInputTime;
+	m_pendingInputTime = ticker::time_point();
+	return presentCommands(m_commandBuffer, inputTime);
+}
+
+HRESULT BaseWindow::presentCommands(_Inout_ Render::CommandBuffer& commands, _In_ ticker::time_point inputTime)
+{
+	PROFILE_ZONE("presentCommands");
+	std::unique_lock<std::mutex> lock(m_resourceLock, std::defer_lock);
+	if (m_threadedRendering) lock.lock();
+
+	const ticker::time_point start = ticker::now();
+	Graphics::D2D1RenderTools& rt = m_renderTools;
+	if (m_isResizePending.exchange(false))
+	{
+		rt.DestroyRenderTarget();
+		reconstructDrawableComponents();
+	}
+	if (!rt.isRenderTargetValid())
+	{
+		rt.CreateRenderTarget(m_hwnd);
+		m_appliedScale = 1.0f;
+	}
+
+	// The levers of the quality level, changed by the main loop while it holds the lock.
+	const Render::QualitySettings& quality = m_quality.getSettings();
+	applyResolutionScale();
+	m_renderBackend.setInterpolationMode(quality.interpolation);
+	m_uploadQueue.setBudgetShift(quality.uploadBudgetShift);
+
+	// Drop what the opaque components hide before uploading anything for it.
+	RECT client;
+	GetClientRect(m_hwnd, &client);
+	m_culler.cull(commands, static_cast<UINT32>(client.right - client.left), static_cast<UINT32>(client.bottom - client.top), &m_layerCache);
+
+	// Create the device bitmaps this frame can afford, the others are drawn as placeholders.
+	m_uploadQueue.process(commands, m_resources, rt.pRenderTarget, &m_culler.getCulledBitmaps());
+
+	rt.pRenderTarget->BeginDraw();
+
+	rt.pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Azure));
+
+	{
+		PROFILE_ZONE("execute");
+		m_renderBackend.execute(commands, m_resources, rt.pRenderTarget, &m_layerCache);
+	}
+
+	// The main loop runs while the frame is presented: it only drops device resources, released after EndDraw.
+	if (lock.owns_lock()) lock.unlock();
+	HRESULT hr;
+	const ticker::time_point presentStart = ticker::now();
+	{
+		PROFILE_ZONE("EndDraw");
+		hr = rt.pRenderTarget->EndDraw();
+	}
+	const ticker::time_point presentEnd = ticker::now();
+	PROFILE_FRAME();
+	if (m_threadedRendering) lock.lock();
+
+	// The pixels decoded for this frame are no longer referenced, nor the device resources dropped while it was drawn.
+	m_resources.getTextures().trim();
+	m_resources.releaseDropped();
+
+	const ticker::time_point end = ticker::now();
+	m_presentStats.framesPresented++;
+	m_presentStats.lastPresentMs = std::chrono::duration<double, std::milli>(end - start).count();
+	m_presentStats.lastPresentWaitMs = std::chrono::duration<double, std::milli>(presentEnd - presentStart).count();
+	if (inputTime != ticker::time_point())
+	{
+		const double latency = std::chrono::duration<double, std::milli>(end - inputTime).count();
+		m_presentStats.latencyCount++;
+		m_presentStats.latencyMs += latency;
+		m_presentStats.maxLatencyMs = (std::max)(m_presentStats.maxLatencyMs, latency);
+	}
+
+	// Call reconstruct method on all drawable components if the render target gets destroyed.
+	//TODO: maybe update componentMap.
+	if (hr == D2DERR_RECREATE_TARGET)
+	{
+		rt.DestroyRenderTarget();
+		reconstructDrawableComponents();
+	}
+	return hr;
+}
+
+void BaseWindow::applyResolutionScale()
+{
+	const float scale = m_quality.getSettings().resolutionScale;
+	if (scale == m_appliedScale) return;
+
+	// A smaller target at a lower dpi: the commands keep their client coordinates, the window stretches the result.
+	RECT client;
+	GetClientRect(m_hwnd, &client);
+	const UINT32 width = (std::max)(static_cast<UINT32>(static_cast<float>(client.right - client.left) * scale), 1u);
+	const UINT32 height = (std::max)(static_cast<UINT32>(static_cast<float>(client.bottom - client.top) * scale), 1u);
+	if (FAILED(m_renderTools.pRenderTarget->Resize(D2D1::SizeU(width, height)))) return;
+	m_renderTools.pRenderTarget->SetDpi(96.0f * scale, 96.0f * scale);
+	m_appliedScale = scale;
+}
+
+void BaseWindow::renderLoop()
+{
+	UINT64 seen = 0;
+	while (m_isRendering.load(std::memory_order_acquire))
+	{
+		m_publishedCount.wait(seen, std::memory_order_acquire);
+		seen = m_publishedCount.load(std::memory_order_acquire);
+
+		if (!m_snapshots.acquire()) continue;
+		Render::FrameSnapshot& snapshot = m_snapshots.getFront();
+		presentCommands(snapshot.commands, snapshot.inputTime);
+	}
+}
+
+void BaseWindow::resizeRenderTarget()
+{
+	// The render thread owns the render target while it runs.
+	if (m_isRendering.load(std::memory_order_acquire))
+	{
+		m_isResizePending = true;
+		return;
+	}
+	m_renderTools.DestroyRenderTarget();
+	m_renderTools.CreateRenderTarget(m_hwnd);
+	m_appliedScale = 1.0f;
+	reconstructDrawableComponents();
+}
+
+void BaseWindow::renderOffscreen(_Inout_ Render::SoftwareRenderer& renderer, _Inout_ Render::Framebuffer& target)
+{
+	recordFrame();
+	cullFrame(target.width, target.height);
+	renderer.render(m_commandBuffer, m_resources, target);
+	m_resources.getTextures().trim();
+}
+
+Graphics::ComponentPtr BaseWindow::removeComponent(_In_ ComponentId componentId) noexcept
+{
+	for (auto& [zIndex, components] : m_components) // ZIndex zIndex, std::vector<std::pair<ComponentPtr, ComponentId>> components.
 	{
 		for (auto it = components.begin(); it < components.end(); it++)
 		{
 			if (it->second == componentId)
 			{
-				components.erase(it); //TODO: delete unique_ptr ? Might be a bug here.
-				return std::move(it->first);
+				if (m_pRecorder) m_pRecorder->recordRemoveComponent(componentId);
+				m_tasks.cancel(it->first.get());
+				Graphics::ComponentPtr component = std::move(it->first);
+				components.erase(it);
+
+				// The scene and the transform store are the window's: the component may outlive it.
+				component->detachFromScene();
+				component->detachTransform();
+				return component;
 			}
 		}
 	}
@@ -173,17 +504,30 @@ std::unique_ptr<Graphics::Component>&& BaseWindow::removeComponent(_In_ Componen
 
 bool BaseWindow::setComponentZIndex(_In_ ComponentId componentId, _In_ ZIndex zIndex) noexcept
 {
-	std::unique_ptr<Graphics::Component> comp = removeComponent(componentId);
-	if (comp == nullptr) return false;
-	addComponent(std::move(comp), zIndex);
-	return true;
+	// Moved between the lists as is: the component keeps its id, its tasks, its transform and its scene node.
+	for (auto& [currentZIndex, components] : m_components) // ZIndex currentZIndex, std::vector<std::pair<ComponentPtr, ComponentId>> components.
+	{
+		for (auto it = components.begin(); it < components.end(); it++)
+		{
+			if (it->second == componentId)
+			{
+				if (m_pRecorder) m_pRecorder->recordSetZIndex(componentId, zIndex);
+				IndexedComponent component = std::move(*it);
+				components.erase(it);
+				m_components[zIndex].push_back(std::move(component));
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
 
 //TODO: Review this ASAP!
 LRESULT updateFrame(BaseWindow* window, HWND hwnd)
 {
-	ticker::time_point currentTime = ticker::now();
+	PROFILE_ZONE("updateFrame");
+	ticker::time_point currentTime = Replay::now();
 	std::chrono::milliseconds period = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastUpdateTime);
 	if (period.count() < window->getTimeBetweenFrames())
 		return S_OK;
@@ -196,7 +540,7 @@ LRESULT updateFrame(BaseWindow* window, HWND hwnd)
 	return S_OK;
 }
 
-const inline std::time_t BaseWindow::getTimeBetweenFrames() noexcept
+inline std::time_t BaseWindow::getTimeBetweenFrames() noexcept
 {
 	return m_timeBetweenFrames;
 }
@@ -206,7 +550,7 @@ inline void BaseWindow::setTimeBetweenFrames(std::time_t time) noexcept
 	m_timeBetweenFrames = time;
 }
 
-const inline unsigned int BaseWindow::getFps() noexcept
+inline unsigned int BaseWindow::getFps() noexcept
 {
 	return static_cast<unsigned int>(1000 / m_timeBetweenFrames);
 }
@@ -224,15 +568,78 @@ void BaseWindow::mainLoop()
 	m_isRunning = true;
 	MSG msg;
 
+	// The waits between the deadlines are precise to the millisecond instead of the scheduler's quantum.
+	timeBeginPeriod(1);
+
+	if (m_threadedRendering)
+	{
+		m_isRendering = true;
+		m_renderThread = std::thread(&BaseWindow::renderLoop, this);
+	}
+
 	while (m_isRunning)
 	{
-		if (PeekMessage(&msg, NULL, 0, 0, true))
+		const bool hasMessage = PeekMessage(&msg, NULL, 0, 0, true);
+		if (!hasMessage) waitNextDeadline();
+
+		// The render thread reads the resources between two iterations, or while the main loop waits.
+		std::unique_lock<std::mutex> lock(m_resourceLock, std::defer_lock);
+		if (m_threadedRendering) lock.lock();
+
+		if (hasMessage)
 		{
+			PROFILE_ZONE("DispatchMessage");
+			if (isInputMessage(msg.message) && m_pendingInputTime == ticker::time_point()) m_pendingInputTime = ticker::now();
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
 		updateFrame(this, m_hwnd);
+		updateTimers();
+		updateTasks();
+
+		if (!m_profilePath.empty() && !Profiler::isCapturing.load(std::memory_order_acquire))
+		{
+			Profiler::exportChromeTrace(m_profilePath.c_str());
+			m_profilePath.clear();
+		}
 	}
+
+	if (m_renderThread.joinable())
+	{
+		m_isRendering = false;
+		m_publishedCount.fetch_add(1, std::memory_order_release);
+		m_publishedCount.notify_one();
+		m_renderThread.join();
+	}
+	timeEndPeriod(1);
+}
+
+void BaseWindow::waitNextDeadline()
+{
+	PROFILE_ZONE("waitNextDeadline");
+	ticker::time_point deadline = lastUpdateTime + std::chrono::milliseconds(m_timeBetweenFrames);
+	deadline = (std::min)(deadline, m_timers.getNextDeadline());
+	deadline = (std::min)(deadline, m_tasks.getNextDeadline());
+
+	const ticker::time_point currentTime = Replay::now();
+	if (deadline <= currentTime) return;
+
+	// Rounded up: waking up early would only spin until the deadline.
+	const auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - currentTime);
+	MsgWaitForMultipleObjectsEx(0, NULL, static_cast<DWORD>(wait.count()), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+bool BaseWindow::captureProfile([[maybe_unused]] _In_ unsigned int frameCount, [[maybe_unused]] _In_ const std::wstring& path)
+{
+#ifdef ENABLE_PROFILER
+	if (!m_profilePath.empty() || frameCount == 0 || path.empty()) return false;
+	m_profilePath = path;
+	Profiler::beginCapture(frameCount);
+	return true;
+#else
+	// Without the frame marks, no capture would ever end.
+	return false;
+#endif
 }
 
 inline void BaseWindow::stop() noexcept
@@ -243,5 +650,6 @@ inline void BaseWindow::stop() noexcept
 
 BaseWindow::~BaseWindow()
 {
-	m_renderTools.~D2D1RenderTools();
+	m_renderTools.DestroyRenderTarget();
+	m_renderTools.DestroyFactory();
 }
@@ -4,10 +4,16 @@
 
 #include "EventHandler.h"
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <mutex>
+#include <set>
+#include <string>
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <thread>
 
 #include <Windows.h>
 #include <WinBase.h>
@@ -18,7 +24,19 @@
 
 #include <d2d1.h>
 
+#include "Animation.h"
+#include "ComponentPool.h"
+#include "FrameSnapshot.h"
+#include "GlyphCache.h"
 #include "GraphicComponents.h"
+#include "LayerCache.h"
+#include "OcclusionCuller.h"
+#include "QualityGovernor.h"
+#include "RenderCommands.h"
+#include "SoftwareRenderer.h"
+#include "Task.h"
+#include "TimerWheel.h"
+#include "UploadQueue.h"
 #include "fctdef.h"
 
 #pragma comment(lib, "d2d1")
@@ -26,10 +44,15 @@
 
 #define CM_UPDATEFRAME 0x407 // Custom message: Must update the frame !
 
+namespace Replay
+{
+	class Recorder;
+} // namespace Replay
+
 typedef unsigned long long ComponentId;
 typedef int ZIndex;
 
-typedef std::pair<std::unique_ptr<Graphics::Component>, ComponentId> IndexedComponent;
+typedef std::pair<Graphics::ComponentPtr, ComponentId> IndexedComponent;
 typedef std::map<ZIndex, std::vector<IndexedComponent>> ComponentMap; // Manages, for each ZIndex, a vector on component assiociated with their ID.
 
 class BaseWindow
@@ -38,13 +61,79 @@ private:
 	HWND m_hwnd = NULL;
 	LPCWSTR m_classname = L"DefaultClassName";
 
+	Render::ResourceTable m_resources; // Declared before the components, which unregister their resources on destruction.
+	Render::GlyphCache m_glyphs{ m_resources };
+	Graphics::TransformStore m_transforms; // Same for their transforms.
+	Graphics::SceneGraph m_scene;
+	Graphics::AnimationEngine m_animations; // Same for their tracks.
+	std::chrono::steady_clock::time_point m_lastAnimationTime = std::chrono::steady_clock::now();
+	bool m_useTransformStore = false;
+	std::vector<Graphics::ComponentPoolPtr> m_componentPools; // Indexed by getPoolIndex<T>. Shared with the components they allocate.
 	ComponentMap m_components;
+	Tasks::TaskScheduler m_tasks; // Declared after the components: the tasks are destroyed first.
+	Timers::TimerWheel m_timers;
 	ComponentId m_lastIdUsed = 0xF; // First 15 IDs reserved.
 	Graphics::D2D1RenderTools m_renderTools;
 
-	std::time_t m_timeBetweenFrames = 16i64; // 60 Frames per seconds
+	Render::CommandBuffer m_commandBuffer;
+	Render::D2D1Backend m_renderBackend;
+	Render::LayerCache m_layerCache;
+	Render::OcclusionCuller m_culler;
+	std::vector<void*> m_hits; // Reused by hitTest.
+	Render::UploadQueue m_uploadQueue;
+	std::vector<std::pair<const std::vector<IndexedComponent>*, Render::CommandList*>> m_recordJobs; // Reused between frames.
+	bool m_parallelRecording = false;
+	bool m_compressImages = false;
+
+	// Threaded rendering: the main loop records the frames, the render thread draws the latest one.
+	Render::TripleBuffer<Render::FrameSnapshot> m_snapshots;
+	Render::PresentStats m_presentStats;
+	std::thread m_renderThread;
+	std::mutex m_resourceLock; // Held by the main loop while it runs, and by the render thread while it reads the resources.
+	std::atomic<UINT64> m_publishedCount = 0;
+	std::atomic<bool> m_isRendering = false;
+	std::atomic<bool> m_isResizePending = false;
+	std::chrono::steady_clock::time_point m_pendingInputTime; // The oldest input not drawn yet, or time_point() if none.
+	UINT64 m_frameCount = 0;
+	bool m_threadedRendering = false;
+
+	// Adaptive quality: the governor picks the levers from the frame times, read where they apply.
+	Render::QualityGovernor m_quality;
+	std::set<ZIndex> m_lowPriorityLayers;
+	UINT32 m_animationFrame = 0;
+	float m_appliedScale = 1.0f; // Resolution scale of the render target, on the thread that draws.
+
+	Replay::Recorder* m_pRecorder = nullptr;
+	std::wstring m_profilePath; // Where the running profiler capture is written once over, empty if none.
+
+	std::time_t m_timeBetweenFrames = 16; // 60 Frames per seconds
 	bool m_isRunning = false;
 
+	/**
+	 * @brief Sleep until the next frame, timer or task delay, or until a message arrives.
+	 */
+	void waitNextDeadline();
+
+	/**
+	 * @brief Draw commands on the render target and present them.
+	 *
+	 * @note In threaded mode, holds the resource lock except while presenting.
+	 *
+	 * @param[in] commands	The commands to draw, culled first.
+	 * @param[in] inputTime	The oldest input the commands reflect, or time_point() if none.
+	 */
+	HRESULT presentCommands(_Inout_ Render::CommandBuffer& commands, _In_ std::chrono::steady_clock::time_point inputTime);
+
+	/**
+	 * @brief Size the render target for the resolution scale of the quality level.
+	 */
+	void applyResolutionScale();
+
+	/**
+	 * @brief Draw the snapshots as they are published, until the main loop stops.
+	 */
+	void renderLoop();
+
 protected:
 	BaseWindow() = default;
 
@@ -77,21 +166,59 @@ public:
 	 * @param[in] Component		The component to add.
 	 * @param[in] zIndex		The verticality index of the component.
 	 */
-	ComponentId addComponent(_In_ std::unique_ptr<Graphics::Component>&& component, _In_opt_ int zIndex = 0);
+	ComponentId addComponent(_In_ Graphics::ComponentPtr&& component, _In_opt_ int zIndex = 0);
+
+	/**
+	 * @brief Construct a component in the window's pool of its type, and add it.
+	 *
+	 * @note Meant for the components spawned and despawned often: their memory is recycled instead of freed.
+	 *       The component keeps its slot until deleted, even once removed from the window.
+	 *
+	 * @param[in] zIndex	The verticality index of the component.
+	 * @param[in] args		The arguments of T's constructor.
+	 *
+	 * @retval ComponentId
+	 * @return The id of the component.
+	 */
+	template <class T, class... Args>
+	ComponentId emplaceComponent(_In_ ZIndex zIndex, _In_ Args&&... args)
+	{
+		return addComponent(getComponentPool<T>().template create<T>(std::forward<Args>(args)...), zIndex);
+	}
+
+	/**
+	 * @brief Return the pool the window allocates the components of type T from.
+	 *
+	 * @retval ComponentPool
+	 * @return The pool of T, created on first use.
+	 */
+	template <class T>
+	Graphics::ComponentPool& getComponentPool()
+	{
+		const UINT32 index = Graphics::getPoolIndex<T>();
+		if (index >= m_componentPools.size()) m_componentPools.resize(index + 1);
+		Graphics::ComponentPoolPtr& pool = m_componentPools[index];
+		if (pool == nullptr) pool = Graphics::ComponentPool::make(sizeof(T), alignof(T));
+		return *pool;
+	}
 
 	/**
 	 * @brief Remove the component binded to the componentId.
 	 * 
+	 * @note Its tasks are cancelled, and it leaves the scene graph and the transform store of the window, keeping its absolute position.
+	 * 
 	 * @param[in] componentId The component's id to remove.
 	 * 
-	 * @retval std::unique_ptr<Component>& component
-	 * @return The component unique_ptr that has been remove, or nullptr if the component was not in the window's component list.
+	 * @retval ComponentPtr
+	 * @return The component that has been removed, or nullptr if the component was not in the window's component list.
 	 */
-	std::unique_ptr<Graphics::Component>&& removeComponent(_In_ ComponentId componentId) noexcept;
+	Graphics::ComponentPtr removeComponent(_In_ ComponentId componentId) noexcept;
 
 	/**
 	 * @brief Modify the z-index of the component binded to componentId.
 	 * 
+	 * @note The component is drawn last of its new z-index. It keeps its id and its tasks.
+	 * 
 	 * @param[in] componentId	The component's id.
 	 * @param[in] zIndex		The new z-index for the component.
 	 * 
@@ -106,7 +233,7 @@ public:
 	 * @retval HWND
 	 * @return The window handle.
 	 */
-	const HWND getHwnd() { return m_hwnd; }
+	HWND getHwnd() { return m_hwnd; }
 
 	/**
 	 * @brief Get the component's pointer binded to the id.
@@ -137,7 +264,7 @@ public:
 	 * @retval std::time_t
 	 * @return Time between frames.
 	 */
-	const inline std::time_t getTimeBetweenFrames() noexcept;
+	inline std::time_t getTimeBetweenFrames() noexcept;
 
 	/**
 	 * @brief Set the time to wait between frames.
@@ -152,7 +279,7 @@ public:
 	 * @retval unsigned int
 	 * @return Fps of the window.
 	 */
-	const inline unsigned int getFps() noexcept;
+	inline unsigned int getFps() noexcept;
 
 	/**
 	 * @brief Set the fps.
@@ -171,6 +298,344 @@ public:
 	 */
 	inline Graphics::D2D1RenderTools& getRenderTools() noexcept { return m_renderTools; }
 
+	/**
+	 * @brief Returns the transforms of the components added while the transform store is enabled.
+	 *
+	 * @retval TransformStore
+	 * @return Transform store of the window.
+	 */
+	inline Graphics::TransformStore& getTransforms() noexcept { return m_transforms; }
+
+	/**
+	 * @brief Store the transforms of the components added from now on in the window's transform store.
+	 *
+	 * @note Meant for windows moving many components each frame with the store's batch operations.
+	 *
+	 * @param[in] enable True to use the transform store.
+	 */
+	inline void setTransformStorage(_In_ bool enable) noexcept { m_useTransformStore = enable; }
+
+	/**
+	 * @brief Returns the hierarchy of the components that have a parent or children.
+	 *
+	 * @retval SceneGraph
+	 * @return Scene graph of the window.
+	 */
+	inline Graphics::SceneGraph& getScene() noexcept { return m_scene; }
+
+	/**
+	 * @brief Make a component the child of another: moving the parent then moves the child.
+	 *
+	 * @note The child's position becomes relative to its parent.
+	 *
+	 * @param[in] childId	The child component's id.
+	 * @param[in] parentId	The parent component's id, or zero to make the child a root again.
+	 *
+	 * @retval bool
+	 * @return True if the child has the new parent, false if a component is not in the window's component list or the parent is a descendant of the child.
+	 */
+	bool setComponentParent(_In_ ComponentId childId, _In_ ComponentId parentId);
+
+	/**
+	 * @brief Find the component of the scene graph under a point.
+	 *
+	 * @note Of the components hit, the one drawn last wins: the highest z-index, then the last added.
+	 *
+	 * @param[in] point The point in client pixels.
+	 *
+	 * @retval Component*
+	 * @return The top most component under the point, or nullptr if there is none.
+	 */
+	Graphics::Component* hitTest(_In_ const D2D1_POINT_2F& point) noexcept;
+
+	/**
+	 * @brief Returns the tweens of the components' properties.
+	 *
+	 * @retval AnimationEngine
+	 * @return Animation engine of the window.
+	 */
+	inline Graphics::AnimationEngine& getAnimations() noexcept { return m_animations; }
+
+	/**
+	 * @brief Advance the animations by the time elapsed since the previous call.
+	 *
+	 * @note Called once per frame, before recording it.
+	 */
+	void updateAnimations();
+
+	/**
+	 * @brief Make the next call to updateAnimations start from now, instead of the previous call.
+	 */
+	void resetAnimationClock() noexcept;
+
+	/**
+	 * @brief Capture the components added and removed from now on.
+	 *
+	 * @note The recorder captures the messages itself once started.
+	 *
+	 * @param[in] recorder The recorder, nullptr to stop capturing the components.
+	 */
+	inline void setRecorder(_In_opt_ Replay::Recorder* recorder) noexcept { m_pRecorder = recorder; }
+
+	/**
+	 * @brief Returns the coroutine tasks of the window.
+	 *
+	 * @note A task spawned with a component as owner is cancelled when the component is removed.
+	 *
+	 * @retval TaskScheduler
+	 * @return Task scheduler of the window.
+	 */
+	inline Tasks::TaskScheduler& getTasks() noexcept { return m_tasks; }
+
+	/**
+	 * @brief Resume the tasks whose wait is over, on the frame clock.
+	 *
+	 * @note Called by the main loop after each message.
+	 */
+	void updateTasks();
+
+	/**
+	 * @brief Returns the timers of the window.
+	 *
+	 * @note The timers call their function from the main loop, on the frame clock. Cancel them before destroying their context.
+	 *
+	 * @retval TimerWheel
+	 * @return Timer wheel of the window.
+	 */
+	inline Timers::TimerWheel& getTimers() noexcept { return m_timers; }
+
+	/**
+	 * @brief Call the timers due, on the frame clock.
+	 *
+	 * @note Called by the main loop after each message.
+	 */
+	void updateTimers();
+
+	/**
+	 * @brief Returns the bitmaps the components can draw.
+	 *
+	 * @retval ResourceTable
+	 * @return Resources of the window.
+	 */
+	inline Render::ResourceTable& getResources() noexcept { return m_resources; }
+
+	/**
+	 * @brief Returns the glyphs and shaped strings of the texts.
+	 *
+	 * @retval GlyphCache
+	 * @return Glyph cache of the window.
+	 */
+	inline Render::GlyphCache& getGlyphCache() noexcept { return m_glyphs; }
+
+	/**
+	 * @brief Returns the commands recorded by the last call to recordFrame.
+	 *
+	 * @retval CommandBuffer
+	 * @return Command buffer of the window.
+	 */
+	inline const Render::CommandBuffer& getCommandBuffer() const noexcept { return m_commandBuffer; }
+
+	/**
+	 * @brief Returns the backend executing the command buffer.
+	 *
+	 * @retval D2D1Backend
+	 * @return Render backend of the window.
+	 */
+	inline Render::D2D1Backend& getRenderBackend() noexcept { return m_renderBackend; }
+
+	/**
+	 * @brief Returns the cache of the static z-indexes.
+	 *
+	 * @retval LayerCache
+	 * @return Layer cache of the window.
+	 */
+	inline Render::LayerCache& getLayerCache() noexcept { return m_layerCache; }
+
+	/**
+	 * @brief Returns the queue creating the device bitmaps.
+	 *
+	 * @retval UploadQueue
+	 * @return Upload queue of the window.
+	 */
+	inline Render::UploadQueue& getUploadQueue() noexcept { return m_uploadQueue; }
+
+	/**
+	 * @brief Draw a z-index from an offscreen bitmap, rebuilt only when its components change.
+	 *
+	 * @note Meant for backgrounds and UI chrome: z-indexes changing every frame only pay the rebuild.
+	 *
+	 * @param[in] zIndex	The z-index to cache.
+	 * @param[in] cached	True to cache the z-index, false to draw it directly again.
+	 */
+	inline void setLayerCached(_In_ ZIndex zIndex, _In_ bool cached) { m_layerCache.setLayerCached(zIndex, cached); }
+
+	/**
+	 * @brief Record the draw commands of all drawable components in the command buffer.
+	 *
+	 * @note The previous frame's commands are discarded.
+	 */
+	void recordFrame();
+
+	/**
+	 * @brief Record each z-index on its own thread.
+	 *
+	 * @note The components' record method must then be thread safe.
+	 *
+	 * @param[in] parallel True to record the z-indexes in parallel.
+	 */
+	inline void setParallelRecording(_In_ bool parallel) noexcept { m_parallelRecording = parallel; }
+
+	/**
+	 * @brief Keep the pixels of the images added from now on compressed in the resource table.
+	 *
+	 * @note They are decoded when uploaded, drawn by the software renderer or read with Image::getPixels,
+	 *       into buffers evicted between frames over the texture store's budget.
+	 *
+	 * @param[in] enable True to compress the images.
+	 */
+	inline void setImageCompression(_In_ bool enable) noexcept { m_compressImages = enable; }
+	inline bool isImageCompressionEnabled() const noexcept { return m_compressImages; }
+
+	/**
+	 * @brief Returns the occlusion culler, and the counters of the last frame culled.
+	 *
+	 * @retval OcclusionCuller
+	 * @return Occlusion culler of the window.
+	 */
+	inline Render::OcclusionCuller& getCuller() noexcept { return m_culler; }
+
+	/**
+	 * @brief Skip the commands hidden behind opaque images and rectangles of the same or higher z-indexes.
+	 *
+	 * @note The frame drawn stays the same. The cached z-indexes are always drawn whole.
+	 *
+	 * @param[in] enable True to cull the hidden commands.
+	 */
+	inline void setOcclusionCulling(_In_ bool enable) noexcept { m_culler.setEnabled(enable); }
+
+	/**
+	 * @brief Remove the hidden and off screen commands of the last recorded frame, if the culling is enabled.
+	 *
+	 * @param[in] width		The width of the area drawn, in pixels.
+	 * @param[in] height	The height of the area drawn, in pixels.
+	 */
+	inline void cullFrame(_In_ UINT32 width, _In_ UINT32 height) { m_culler.cull(m_commandBuffer, width, height, &m_layerCache); }
+
+	/**
+	 * @brief Draw the frames on a render thread, while the main loop handles the messages, the timers, the tasks and the animations.
+	 *
+	 * @note Each frame, the main loop records the commands into a snapshot, handed to the render thread through
+	 *       a lock free triple buffer: a slow present no longer delays the messages. The render thread always draws
+	 *       the latest snapshot, older ones are dropped. The resources are shared, behind a lock the render thread
+	 *       only releases while presenting. Off by default, takes effect when the main loop starts.
+	 *
+	 * @param[in] enable True to draw on a render thread.
+	 */
+	inline void setThreadedRendering(_In_ bool enable) noexcept { if (!m_isRunning) m_threadedRendering = enable; }
+	inline bool isThreadedRenderingEnabled() const noexcept { return m_threadedRendering; }
+
+	/**
+	 * @brief Returns the counters of the frames presented, and their input latency.
+	 *
+	 * @note In threaded mode, only read them from the main loop.
+	 */
+	inline const Render::PresentStats& getPresentStats() const noexcept { return m_presentStats; }
+
+	/**
+	 * @brief Reset the counters of the frames presented, if the main loop is not running.
+	 */
+	inline void resetPresentStats() noexcept { if (!m_isRunning) m_presentStats = {}; }
+
+	/**
+	 * @brief Capture the profiler zones of the next frames, then write them as a Chrome trace.
+	 *
+	 * @note The main loop writes the trace once the frames are presented. With ENABLE_PROFILER, F9 captures 120 frames into profile.json.
+	 *
+	 * @param[in] frameCount	The number of frames to capture.
+	 * @param[in] path			The output json file.
+	 *
+	 * @retval bool
+	 * @return True if the capture started, false if the profiler is not compiled in or a capture is already running.
+	 */
+	bool captureProfile(_In_ unsigned int frameCount, _In_ const std::wstring& path);
+
+	/**
+	 * @brief Returns the quality governor: its level, its last decisions and its settings.
+	 *
+	 * @retval QualityGovernor
+	 * @return Quality governor of the window.
+	 */
+	inline Render::QualityGovernor& getQuality() noexcept { return m_quality; }
+
+	/**
+	 * @brief Lower the quality when the frames take longer than the time between frames, and raise it back with headroom.
+	 *
+	 * @note The levers are the render target resolution, the bitmap interpolation, the upload budget, the animation
+	 *       update rate, and the low priority z-indexes, which are skipped. Off by default.
+	 *
+	 * @param[in] enable True to adapt the quality.
+	 */
+	inline void setQualityScaling(_In_ bool enable) { m_quality.setEnabled(enable); }
+
+	/**
+	 * @brief Mark a z-index as low priority: the cheapest quality levels do not draw it.
+	 *
+	 * @note Meant for decorations. The cached z-indexes are always drawn.
+	 *
+	 * @param[in] zIndex		The z-index.
+	 * @param[in] lowPriority	True to allow skipping it.
+	 */
+	inline void setLayerLowPriority(_In_ ZIndex zIndex, _In_ bool lowPriority)
+	{
+		if (lowPriority) m_lowPriorityLayers.insert(zIndex);
+		else m_lowPriorityLayers.erase(zIndex);
+	}
+
+	/**
+	 * @brief Give the time of a frame to the quality governor.
+	 *
+	 * @note Called once per frame by paintFrame, or by submitFrame in threaded mode.
+	 *
+	 * @param[in] frameMs How long the frame took, in milliseconds.
+	 */
+	inline void updateQuality(_In_ double frameMs) { m_quality.update(frameMs, static_cast<double>(m_timeBetweenFrames)); }
+
+	/**
+	 * @brief Update the animations, record a frame and present it, then give its time to the quality governor.
+	 *
+	 * @note Called by onPaint in single threaded mode. The time EndDraw waits for the vsync is not counted.
+	 */
+	HRESULT paintFrame();
+
+	/**
+	 * @brief Record a frame and hand it to the render thread.
+	 *
+	 * @note Called by onPaint in threaded mode.
+	 */
+	void submitFrame();
+
+	/**
+	 * @brief Draw the commands of the last recorded frame on the render target and present them.
+	 *
+	 * @note Called by paintFrame in single threaded mode.
+	 */
+	HRESULT presentFrame();
+
+	/**
+	 * @brief Create the render target again at the window's size, on the thread that draws.
+	 */
+	void resizeRenderTarget();
+
+	/**
+	 * @brief Draw all the drawable components in memory, without the render target.
+	 *
+	 * @note Used for thumbnails and exports: the result does not depend on the renderer's thread count.
+	 *
+	 * @param[in] renderer	The software renderer to rasterize with.
+	 * @param[in] target	The framebuffer to draw on, its size is the area drawn.
+	 */
+	void renderOffscreen(_Inout_ Render::SoftwareRenderer& renderer, _Inout_ Render::Framebuffer& target);
+
 	/**
 	 * @brief Loop until the window is destroy.
 	 */
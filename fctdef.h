@@ -21,7 +21,8 @@ size_t dichotomous_search(_In_ const std::vector<T>& list, _In_ U searched_value
 	{
 		return dichotomous_search(list, searched_value, access_value, mid+1, end);
 	}
-	return dichotomous_search(list, searched_value, access_value, begin, mid-1);
+	// mid is kept: it is the place if the previous value is lower. mid-1 would skip it, and underflow at 0.
+	return dichotomous_search(list, searched_value, access_value, begin, mid);
 }
 
 template <class T>